@@ -40,6 +40,7 @@ REM -incremental:no = turn off incremental linking
 REM -opt:ref = eliminate functions and data that are not referenced
 
 set "BUILD_MODE=debug"
+set "RUN_BENCHMARK=0"
 
 if "%~1"=="" (
 	echo No mode specified. Building in debug mode.
@@ -47,8 +48,11 @@ if "%~1"=="" (
 	set "BUILD_MODE=debug"
 ) else if /I "%~1"=="release" (
 	set "BUILD_MODE=release"
+) else if /I "%~1"=="benchmark" (
+	set "BUILD_MODE=release"
+	set "RUN_BENCHMARK=1"
 ) else (
-	echo Invalid mode "%~1". Supported modes are debug or release.
+	echo Invalid mode "%~1". Supported modes are debug, release or benchmark.
 	exit /b 1
 )
 
@@ -71,6 +75,19 @@ cl ..\src\crossreferences.c %compiler_flags% /link %common_linker_flags% /out:cr
 cl ..\src\customers.c %compiler_flags% /link %common_linker_flags% /out:customers.exe
 cl ..\src\history.c %compiler_flags% /link %common_linker_flags% /out:producthistory.exe
 cl ..\src\invoices.c %compiler_flags% /link %common_linker_flags% /out:invoices.exe
+cl ..\src\lookup.c %compiler_flags% /link %common_linker_flags% /out:lookup.exe
+cl ..\src\generate.c %compiler_flags% /link %common_linker_flags% /out:generate.exe
+cl ..\src\benchmark.c %compiler_flags% /link %common_linker_flags% /out:benchmark.exe
+cl ..\src\watch.c %compiler_flags% /link %common_linker_flags% /out:watch.exe
+
+REM The first benchmark run saves a baseline; later runs are compared with it (delete it to start over).
+if "%RUN_BENCHMARK%"=="1" (
+	if exist benchmark-baseline.txt (
+		benchmark.exe --baseline benchmark-baseline.txt bench
+	) else (
+		benchmark.exe --save benchmark-baseline.txt bench
+	)
+)
 
 popd
 exit /b
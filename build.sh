@@ -0,0 +1,170 @@
+#!/bin/bash
+# Linux counterpart of build.bat: builds every tool into build/ with gcc (or clang, with CC=clang).
+#
+# USAGE: ./build.sh [debug|release|lto|pgo|benchmark]
+#
+#    debug     = no optimization, debug information and asserts (the default)
+#    release   = optimized
+#    lto       = release with link-time optimization
+#    pgo       = lto, plus profile-guided optimization: an instrumented build is trained by running every tool,
+#                in each of its output modes, on a corpus written by the generate tool, then everything is
+#                rebuilt using the profile. PGO_RECORDS sets the size of each training report (default 200000).
+#    benchmark = release, then run the benchmark against build/benchmark-baseline.txt (saved on the first run)
+#
+# Extra compiler flags can be given in CFLAGS (e.g. CFLAGS=-march=native).
+
+set -e
+cd "$(dirname "$0")"
+
+# COMPILER FLAGS
+#    Diagnostics & warnings
+# -Wall -Wextra = most warnings
+# -Wno-unused-parameter = unreferenced parameter (as -wd4100 in build.bat)
+# -Wno-sign-compare -Wno-type-limits -Wno-implicit-fallthrough = noisy for this code base and not in /W4 either
+#    Warnings are not errors here (unlike -WX in build.bat), as each new gcc or clang adds some.
+
+#    Language
+# -std=gnu17 = C17 with extensions; C23 makes bool, true and false keywords, which utils.h defines itself
+
+#    Debugging
+# -g = debug information
+# -DDEBUG=1 = enable asserts
+
+#    Optimization
+# -O2 = maximum optimization (as -O2 in build.bat)
+# -fno-math-errno -fno-trapping-math -ffp-contract=fast = roughly -fp:fast -fp:except-
+# -flto = link-time optimization
+# -fprofile-generate / -fprofile-use = profile-guided optimization (-fprofile-instr-* with clang)
+#    x86-64 always has SSE2, which is all simd.h needs, so no -march: the executables run on any x86-64.
+
+# LINKER FLAGS
+# -pthread = the progress reporter runs on a thread of its own
+
+BUILD_MODE="${1:-debug}"
+RUN_BENCHMARK=0
+
+case "$BUILD_MODE" in
+	debug|release|lto|pgo)
+		;;
+	benchmark)
+		BUILD_MODE=release
+		RUN_BENCHMARK=1
+		;;
+	*)
+		echo "Invalid mode \"$BUILD_MODE\". Supported modes are debug, release, lto, pgo or benchmark."
+		exit 1
+		;;
+esac
+if [ -z "$1" ]; then
+	echo "No mode specified. Building in debug mode."
+fi
+
+CC="${CC:-gcc}"
+if "$CC" --version 2>/dev/null | grep -qi clang; then
+	COMPILER=clang
+else
+	COMPILER=gcc
+fi
+
+common_flags="-std=gnu17 -Wall -Wextra -Wno-unused-parameter -Wno-sign-compare -Wno-type-limits -Wno-implicit-fallthrough"
+common_flags="$common_flags -fno-math-errno -fno-trapping-math -ffp-contract=fast $CFLAGS"
+linker_flags="-pthread"
+if [ "$COMPILER" = clang ]; then
+	lto_flags="-flto=thin"
+else
+	lto_flags="-flto=auto"
+fi
+
+# Source file and executable name of each tool.
+tools="classes:classes crossreferences:crossreferences customers:customers history:producthistory invoices:invoices lookup:lookup generate:generate benchmark:benchmark watch:watch"
+
+# build_tools <compiler flags> <object directory> <output directory>
+# Objects are kept (rather than compiling and linking in one step) so both PGO stages see the same object
+# names, which is what gcc names the profile data after.
+build_tools()
+{
+	mkdir -p "$2" "$3"
+	for tool in $tools; do
+		source_name="${tool%%:*}"
+		executable_name="${tool##*:}"
+		"$CC" $1 -c "../src/$source_name.c" -o "$2/$source_name.o"
+		"$CC" $1 "$2/$source_name.o" -o "$3/$executable_name" $linker_flags
+	done
+}
+
+# train <tool directory> <work directory>
+# Runs every parser in each of its output modes on a generated report of each type.
+train()
+{
+	local bin="$1" work="$2" records="${PGO_RECORDS:-200000}"
+	mkdir -p "$work"
+	for report in classes xrefs account address memo history invoices; do
+		"$bin/generate" "$report" "$records" "$work/$report.txt" > /dev/null
+	done
+
+	for mode in "" "-d" "-f"; do
+		"$bin/classes" --no-progress $mode "$work/classes.txt" "$work/classes.out" > /dev/null
+		"$bin/crossreferences" --no-progress $mode "$work/xrefs.txt" "$work/xrefs.out" > /dev/null
+		"$bin/customers" --no-progress $mode account "$work/account.txt" "$work/account.out" > /dev/null
+		"$bin/customers" --no-progress $mode address "$work/address.txt" "$work/address.out" > /dev/null
+		"$bin/customers" --no-progress $mode memo "$work/memo.txt" "$work/memo.out" > /dev/null
+		"$bin/producthistory" --no-progress $mode "$work/history.txt" "$work/history.out" > /dev/null
+		"$bin/invoices" --no-progress $mode "$work/invoices.txt" "$work/invoices.out" > /dev/null
+	done
+	"$bin/producthistory" --no-progress -r "$work/history.txt" "$work/reorder.out" > /dev/null
+
+	# The pipe-delimited outputs again, for the lookup index.
+	"$bin/crossreferences" --no-progress "$work/xrefs.txt" "$work/xrefs.out" > /dev/null
+	"$bin/producthistory" --no-progress "$work/history.txt" "$work/history.out" > /dev/null
+	"$bin/customers" --no-progress address "$work/address.txt" "$work/address.out" > /dev/null
+	"$bin/lookup" build "$work/lookup.idx" "$work/xrefs.out" "$work/history.out" "$work/address.out" > /dev/null
+	"$bin/lookup" -x query "$work/lookup.idx" sku 1 > /dev/null
+}
+
+mkdir -p build
+cd build
+
+case "$BUILD_MODE" in
+	debug)
+		echo "Building in debug mode..."
+		build_tools "$common_flags -O0 -g -DDEBUG=1" obj/debug .
+		;;
+	release)
+		echo "Building in release mode..."
+		build_tools "$common_flags -O2" obj/release .
+		;;
+	lto)
+		echo "Building in release mode with link-time optimization..."
+		build_tools "$common_flags -O2 $lto_flags" obj/lto .
+		;;
+	pgo)
+		echo "Building instrumented executables..."
+		rm -rf pgo
+		if [ "$COMPILER" = clang ]; then
+			build_tools "$common_flags -O2 $lto_flags -fprofile-instr-generate=$PWD/pgo/profile/%m-%p.profraw" pgo/obj pgo/bin
+		else
+			build_tools "$common_flags -O2 $lto_flags -fprofile-generate=$PWD/pgo/profile -fprofile-update=prefer-atomic" pgo/obj pgo/bin
+		fi
+
+		echo "Training on generated reports..."
+		train pgo/bin pgo/corpus
+
+		echo "Building with the profile..."
+		if [ "$COMPILER" = clang ]; then
+			llvm-profdata merge -output=pgo/profile/merged.profdata pgo/profile/*.profraw
+			build_tools "$common_flags -O2 $lto_flags -fprofile-instr-use=$PWD/pgo/profile/merged.profdata -Wno-profile-instr-unprofiled" pgo/obj .
+		else
+			build_tools "$common_flags -O2 $lto_flags -fprofile-use=$PWD/pgo/profile -fprofile-partial-training -Wno-missing-profile" pgo/obj .
+		fi
+		rm -rf pgo/corpus
+		;;
+esac
+
+# The first benchmark run saves a baseline; later runs are compared with it (delete it to start over).
+if [ "$RUN_BENCHMARK" = 1 ]; then
+	if [ -f benchmark-baseline.txt ]; then
+		./benchmark --baseline benchmark-baseline.txt bench
+	else
+		./benchmark --save benchmark-baseline.txt bench
+	fi
+fi
@@ -87,7 +87,48 @@ The three customer reports we must generate are:
   customers memo %USERPROFILE%\Documents\MEMO112024.TXT memos.txt
   ```
 
-  Ensure that the summary printed upon completion of each parse matches the totals on bottom of the original reports.
+  The report type can be left out (`customers ACCT112024.TXT accounts.txt`): it is then worked out from the report's title.
+  Every program also checks the title of the report it is given, and stops with the name of the right program if the report is of another kind, so a batch of reports can be converted with a script without checking which file is which.
+
+  Each program checks what it parsed against the totals on the bottom of the report (the number of records, the total balance of the account report, and the account totals of the trial balance), and says so in the summary printed upon completion of the parse.
+  If a total does not match, the summary gives the report's total and the parsed one, and the program fails: look at the report before importing its output.
+  A report without totals at the bottom fails too, as it may not have been transferred in full; if it comes from an old version of ProfitMaster that does not print them, add `--allow-missing-totals` to get a warning instead.
+
+  The memo output also has the email address, status card number and tax exemption note found in each memo in columns of their own (_Email_, _Status Number_ and _Exemption Note_).
+  To have the exemption info next to the _Tax Exemption_ column of the addresses, give the memo report when parsing the address report:
+
+  ```
+  customers -m %USERPROFILE%\Documents\MEMO112024.TXT address %USERPROFILE%\Documents\ADDR112024.TXT addresses.txt
+  ```
+
+  Adding `-n` to the address parse also does most of the cleanup that used to be done in Excel: names and cities are changed from upper case to title case, phone numbers are written as (807) 597-1234, the "(807) 597-" placeholders of blank numbers are dropped, postal codes are written as P0T 1C0, and old province codes (PQ, NF) are updated.
+  Anything it does not recognize is left as it was, and the summary says how many of those there are in each column.
+
+  To look for duplicate accounts (the same customer entered twice, perhaps spelled differently), add `-u duplicates.txt` to the address parse.
+  Accounts with a similar name, address, phone number and postal code are written to `duplicates.txt` in numbered groups, each with a score from 0 to 1 (how much of those the accounts have in common).
+  Review each group before merging anything: two people at the same address can score highly too.
+
+Instead of running the programs by hand, `watch` can be started before the transfer, on the directory the reports are transferred into:
+
+```
+watch %USERPROFILE%\Documents\PMC-DATA-112024
+```
+
+It follows each report as it arrives and converts it with the right program as soon as its last line (the totals) has been transferred, writing the output under the report's own name in the `converted` directory inside it (or in a directory given after the first).
+Reports already in the directory are converted too, `-o` converts those and stops, and `-e` and `-f` are passed on to the programs.
+A report whose totals never arrive is converted once it has not grown for a minute (`-t` sets how long), with a warning that the transfer may not have finished (and without failing for want of the totals).
+
+Large reports can take a while to parse. After the first second the tools show how far they have got, their current speed and an estimate of the time left; use `--no-progress` to turn this off.
+
+Names and memos with accented letters come out garbled in Excel unless the report's code page is given: `-e cp437` for reports from the old DOS installs, `-e cp1252` (or `-e latin1`) for those from Windows. The text is then written as UTF-8, which Excel reads correctly when the file is imported as "65001 : Unicode (UTF-8)". Feather files are always UTF-8, so give the code page for those as well: without it their text is taken to be `cp1252`.
+
+All the programs check where each column actually is before parsing, from the column headings in the page headers (where the report has them) and from the data on the first pages.
+If a different version of ProfitMaster has moved the columns, they print a warning listing the columns that moved and parse the report with the columns where they found them.
+Compare a few records of the output against the report when this happens; `--fixed-layout` parses with the usual columns regardless.
+
+All the programs also check each field as they parse it: amounts, dates, quantities and codes must hold only what such a field can hold, and a record line must not stop short of its last required field.
+If any do not, the summary ends with a warning counting them by kind.
+Add `-a anomalies.txt` to list them, with the line of the report each is on, the column, the problem and the field as it is in the report, so the records can be checked (and fixed in the report or in the output) before the import.
 
 == Creating the Customer Spreadsheet
 
@@ -165,7 +206,9 @@ You should now have a worksheet that combines the three worksheets together.
 + Copy the merged sheet. Paste it as text values into the newly-created Export worksheet.
 + With the data still selected, *Format as Table*.
 + Create a column to the right of _Tax Exemption_ and type "Exemption Info" in the column heading.
+  (If the addresses were parsed with `-m`, this column is already there.)
 + Move any tax exemption info from the memo field to the _Tax Exemption_ field.
+  Check the _Exemption Info_ column for anything the memo parse missed.
 + Create a column to the right of the newly-created _Exemption Info_ and type "Customer Type" in the column heading.
 
 
@@ -178,3 +221,142 @@ You should now have a worksheet that combines the three worksheets together.
 
 
 = Inventory
+
+== Seeding Reorder Settings
+
+Rather than carrying over the order points and quantities from ProfitMaster, which are often out of date,
+the `producthistory` program can suggest new ones from the sales history in the IRH report:
+
+```
+producthistory --reorder %USERPROFILE%\Documents\HIST112024.TXT reorder.txt
+```
+
+For each SKU the output lists the weekly sales velocity, the seasonality (last year's sales in the current period
+compared with last year's average period), the weeks of cover provided by the stock available and on order,
+the current order point and quantity, and the suggested order point and quantity.
+The periods are read from the history calendar at the start of the report: the current period is its latest month, whichever period number the business's calendar gives it. The program says which period that is, and warns if the report has no full calendar (P1 is then taken to be the current period).
+Review the suggestions before importing them into CashierPRO; products with no sales are given no order point.
+
+== Checking Barcodes
+
+CashierPRO rejects UPCs with a wrong check digit, and a barcode listed under two SKUs can only ring up one of them.
+Add `-v problems.txt` when parsing the cross-reference report to find these before the import:
+
+```
+crossreferences -v problems.txt %USERPROFILE%\Documents\XREF112024.TXT xrefs.txt
+```
+
+Each reference that is not a valid UPC-A, EAN-13, EAN-8 or GTIN-14 barcode is written to `problems.txt` with the reason.
+Those with a wrong or missing check digit, or with spaces or dashes in them, come with a suggested repair; check the
+suggestion against the product's packaging before using it. References marked "internal code" (vendor part numbers and
+the like) are not barcodes at all and are usually fine as they are.
+Barcodes shared by more than one SKU are listed at the end of the file, with the other SKUs in the last column.
+
+= Looking Up Records
+
+During the cutover it is often necessary to answer questions such as "what SKU is this UPC?" or "what is this customer's balance?".
+Rather than searching the original reports, build a lookup index from the parsed files once and query it with the `lookup` program.
+
++ Build the index from any of the parsed cross-reference, product history, account, address or memo files:
+  ```
+  lookup build lookup.idx xrefs.txt history.txt accounts.txt addresses.txt
+  ```
++ Query the index by `sku`, `upc` or `cust`:
+  ```
+  lookup query lookup.idx upc 062639301234
+  lookup query lookup.idx cust 100234
+  ```
++ Use `-x` (or `--prefix`) to list every record whose key starts with the given text:
+  ```
+  lookup -x query lookup.idx sku ABC
+  ```
+
+Rebuild the index whenever the parsed files are regenerated.
+
+Scripts that ask for many lookups or conversions can keep a program running on Linux instead of starting it for each one: `lookup --serve /tmp/lookup.sock /data/lookup.idx` keeps the index loaded (and reloads it when it is rebuilt), and `crossreferences --serve /tmp/xrefs.sock` (or any other of the parsing programs) does the same for conversions.
+Each request is the program's arguments, sent over the socket; the reply is its exit status and what it printed.
+The protocol is described at the top of `src/serve.h`.
+Use full paths in the requests, and the same path for the index as was given to `--serve`.
+A request to a running program takes well under a millisecond more than the work itself.
+
+= Analysing the Reports
+
+Every parsing program accepts `-f` (or `--feather`) to write the output file in the Arrow IPC (Feather v2) format instead of a pipe-delimited file.
+These files load directly into pandas, Polars, DuckDB or R with the column types intact, which makes them better suited than the text files for checking the data before the conversion:
+
+```
+producthistory --feather %USERPROFILE%\Documents\HIST112024.TXT history.arrow
+customers --feather account %USERPROFILE%\Documents\ACCT112024.TXT accounts.arrow
+```
+
+- Money is stored as whole cents (i.e., a balance of \$12.34 CR is `-1234`).
+- Dates are stored as dates, and quantities and history periods as integers.
+- Locations, classes, vendors, provinces and other short codes are dictionary-encoded.
+- Blank fields (and the history of products with no history records) are stored as nulls rather than empty text or zeros.
+
+The Feather files are not meant for importing into CashierPRO; use the pipe-delimited files for that.
+
+To look at just a few columns, name them with `--columns`, in the order wanted (the names are those of the Feather columns; a wrong one gets them all listed).
+Only the fields of the report that make up those columns are read, so a narrow export of a large report is faster, and it works with or without `-f`:
+
+```
+customers --feather --columns "Cust ID,Current Balance" account %USERPROFILE%\Documents\ACCT112024.TXT balances.arrow
+```
+
+To write only some of the records, give a filter with `--where`, e.g. the accounts with a balance at one location, or the invoices from before 2024:
+
+```
+customers --where "balance != 0 and location = 01" account %USERPROFILE%\Documents\ACCT112024.TXT accounts.txt
+invoices --where "date < 01/01/2024" %USERPROFILE%\Documents\RRT112024.TXT invoices.txt
+```
+
+- A filter compares fields of the report with values, using `=`, `!=`, `<`, `<=`, `>` or `>=`, and joins the comparisons with `and` and `or` (`and` first).
+- The columns are named as for `--columns` and `--sort-by`, with `_` for a space (`current_balance`), or by the shorter names of the anomalies file (`balance`); a wrong name gets them all listed. Columns that are worked out rather than read from one field of the report (such as `House Acct`, or the history periods) cannot be compared.
+- Amounts and numbers compare as numbers, and dates as dates (`01/31/24` or `2024-01-31`). Put text with spaces in single quotes (`city = 'THUNDER BAY'`).
+- The records left out are still counted, and checked against the totals at the end of the report.
+
+The pipe-delimited files come out in the order of the report. To have them sorted, e.g. by SKU for CashierPRO or by balance for a reconciliation, name the columns to sort by with `--sort-by`, with `desc` after any to sort from the largest down:
+
+```
+crossreferences --sort-by "UPC" %USERPROFILE%\Documents\XREF112024.TXT xrefs.txt
+customers --sort-by "Current Balance desc,Cust ID" account %USERPROFILE%\Documents\ACCT112024.TXT accounts.txt
+```
+
+- The names are those of the output's headings (a wrong one gets them listed). Amounts, numbers and dates sort as such, and everything else as text, except codes made only of digits, which sort as numbers.
+- Records that are equal on every column keep the order of the report.
+- However large the export, sorting uses no more than `--sort-memory` megabytes (256 if not given). A bigger output is sorted in parts, written beside the output file while it is being sorted and removed after, so leave room on the disk for a second copy of it.
+- `--sort-by` is only for the pipe-delimited files; it cannot be used with `-d`, `-f` or `-p`.
+
+= Benchmarking the Tools
+
+The `generate` program writes synthetic reports of any size, laid out exactly like the ProfitMaster reports, so the tools can be tested and timed without customer data:
+
+```
+generate history 1000000 history.txt
+generate --seed 7 address 50000 addresses.txt
+```
+
+The `benchmark` program generates one report of each type (only the first time) and times every tool in each of its output modes, reporting MB/s and records/s:
+
+```
+benchmark --save baseline.txt bench
+benchmark --baseline baseline.txt bench
+```
+
+With `--baseline`, each case is compared with the saved results and any case more than 5% slower (see `--threshold`) is flagged as a regression.
+`build benchmark` builds the release versions and runs the benchmark against `build\benchmark-baseline.txt`, saving it on the first run.
+
+On Linux, `build.sh` builds the same tools (without the `.exe`) with gcc, or clang with `CC=clang`. Besides `debug`, `release` and `benchmark` it has `lto`, for link-time optimization, and `pgo`, which trains an instrumented build on generated reports of every type and then rebuilds the tools using that profile:
+
+```
+./build.sh pgo
+PGO_RECORDS=1000000 ./build.sh pgo
+```
+
+Every tool also reports its own throughput when it finishes. Add `--stats` to see where the time went (reading the report, skipping page headers, extracting the fields, formatting the output, flushing it to disk and sorting it), or `--stats-json` to print the same figures as a line of JSON for scripts:
+
+```
+producthistory --stats --stats-json IRH.txt history.csv
+```
+
+On Linux, `--counters` adds the CPU's cycles, instructions, branch misses and cache misses in each phase to `--stats` and `--stats-json`. `benchmark --counters` shows them for every case, per MB of input, which tells a change that mispredicts more branches apart from one that misses the cache more.
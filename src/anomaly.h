@@ -0,0 +1,364 @@
+#ifndef ANOMALY
+#define ANOMALY
+
+#include <emmintrin.h>
+
+#include "platform.h"
+#include "encoding.h"
+
+/*	NOTES
+	=====
+
+	The parsers take every field from a fixed column, so a line that is not what they expect (cut short, shifted
+	over, or from a part of the report they do not know) still gives a record, just a wrong one. To catch those
+	without a separate pass over the report, each record line is checked as it is parsed, while it is still in
+	the cache:
+	  - A line shorter than the record's last required field is a short line. Fields past its end are left
+	    empty rather than read from the next line (see FillLineField()).
+	  - Each field must hold only the characters of its class: codes (letters, digits and - . / # &), numbers
+	    (digits and -), amounts (digits, . , - and CR), dates (digits and /), and text (anything printable but
+	    '|', which would split the field in two in the output). Spaces are allowed in all of them.
+
+	A line is checked 16 bytes at a time rather than a field at a time: a table of fields is compiled into a
+	Line_check, which has the bytes of each block of 16 that are in a field of each class. One SSE2 compare
+	finds the spaces and digits, which every class allows, and only a block with anything else in a field has
+	the bytes of every class worked out (a few more compares) and matched against the fields'. A line with
+	something wrong on it is then gone over field by field to tell which. The loads may reach past the end of
+	the line into the next one (masked off) or past the end of the report into the padding ReadEntireFile()
+	leaves after it.
+
+	Line numbers are only worked out when there is an anomaly to write, by counting the lines since the last
+	one, so a report without any costs nothing more than the checks.
+
+	With -a (--anomalies) each anomaly is written to a file with its line number, field, problem and the field
+	as it is in the report, up to ANOMALY_MAX_ROWS of them. Without it they are only counted, and the tools warn
+	about them after the parse.
+*/
+
+#define ANOMALY_MAX_ROWS 100000
+#define CHECK_MAX_BLOCKS 10 // Fields are only checked in the first 160 characters of a line.
+
+typedef enum
+{
+	field_text,
+	field_code,
+	field_number,
+	field_money,
+	field_date,
+	field_class_count
+} Field_class;
+
+typedef enum
+{
+	anomaly_short_line = field_class_count, // After one anomaly for each field class.
+	anomaly_kind_count
+} Anomaly_kind;
+
+char* anomaly_names[anomaly_kind_count] = {"unprintable text", "bad code", "bad number", "bad amount", "bad date", "short line"};
+
+typedef struct
+{
+	char* name;
+	u32 start;
+	u32 length;
+	Field_class class;
+} Field_check;
+
+typedef struct Anomaly_log
+{
+	FILE* file; // NULL to only count them.
+	char* file_name;
+	Code_page code_page;
+	char* counted_line; // Line numbers are counted up to here.
+	u64 counted_lines;
+	u64 num_anomalies;
+	u64 counts[anomaly_kind_count];
+} Anomaly_log;
+
+void StartAnomalyLog(Anomaly_log* log, char* data, FILE* file, char* file_name, Code_page code_page)
+{
+	memset(log, 0, sizeof(*log));
+	log->file = file;
+	log->file_name = file_name;
+	log->code_page = code_page;
+	log->counted_line = data;
+	if (file)
+	{
+		fprintf(file, "Line|Field|Problem|Text\n");
+	}
+}
+
+static inline __m128i BytesInRange(__m128i bytes, char low, char high)
+{
+	__m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(low));
+	return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8((char)(high - low))), offset);
+}
+
+static inline __m128i BytesEqual(__m128i bytes, char value)
+{
+	return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(value));
+}
+
+// Spaces and digits, which every class allows, a bit for each of the 16 bytes.
+static inline u32 PlainBytes(__m128i bytes)
+{
+	return (u32)_mm_movemask_epi8(_mm_or_si128(BytesEqual(bytes, ' '), BytesInRange(bytes, '0', '9')));
+}
+
+// The bytes that each class allows, a bit for each of the 16, given the plain ones. All of them are worked
+// out at once: it is cheaper than picking out the one class a field needs.
+static inline void AllowedBytes(__m128i bytes, u32 plain, u32 allowed[field_class_count])
+{
+	__m128i dash = BytesEqual(bytes, '-');
+	__m128i dot = BytesEqual(bytes, '.');
+	__m128i slash = BytesEqual(bytes, '/');
+	__m128i printable = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(' ')), bytes); // Code page letters included.
+	__m128i letters = BytesInRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+	__m128i code_marks = _mm_or_si128(_mm_or_si128(dot, slash), _mm_or_si128(BytesEqual(bytes, '#'), BytesEqual(bytes, '&')));
+	__m128i money_marks = _mm_or_si128(_mm_or_si128(dot, BytesEqual(bytes, ',')), _mm_or_si128(BytesEqual(bytes, 'C'), BytesEqual(bytes, 'R')));
+
+	allowed[field_text] = (u32)_mm_movemask_epi8(_mm_andnot_si128(BytesEqual(bytes, '|'), printable));
+	allowed[field_code] = plain | (u32)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(dash, letters), code_marks));
+	allowed[field_number] = plain | (u32)_mm_movemask_epi8(dash);
+	allowed[field_money] = plain | (u32)_mm_movemask_epi8(_mm_or_si128(dash, money_marks));
+	allowed[field_date] = plain | (u32)_mm_movemask_epi8(slash);
+}
+
+// The same for one class only, for a block that only has fields of that class.
+static inline u32 ClassAllowedBytes(__m128i bytes, u32 plain, Field_class class)
+{
+	__m128i allowed = _mm_setzero_si128();
+	switch (class)
+	{
+		case field_text:
+		{
+			__m128i printable = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(' ')), bytes);
+			allowed = _mm_andnot_si128(BytesEqual(bytes, '|'), printable);
+			break;
+		}
+		case field_code:
+		{
+			__m128i letters = BytesInRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+			__m128i marks = _mm_or_si128(_mm_or_si128(BytesEqual(bytes, '-'), BytesEqual(bytes, '.')),
+										 _mm_or_si128(_mm_or_si128(BytesEqual(bytes, '/'), BytesEqual(bytes, '#')), BytesEqual(bytes, '&')));
+			allowed = _mm_or_si128(letters, marks);
+			break;
+		}
+		case field_number:
+		{
+			allowed = BytesEqual(bytes, '-');
+			break;
+		}
+		case field_money:
+		{
+			allowed = _mm_or_si128(_mm_or_si128(BytesEqual(bytes, '.'), BytesEqual(bytes, ',')),
+								   _mm_or_si128(BytesEqual(bytes, '-'), _mm_or_si128(BytesEqual(bytes, 'C'), BytesEqual(bytes, 'R'))));
+			break;
+		}
+		case field_date:
+		{
+			allowed = BytesEqual(bytes, '/');
+			break;
+		}
+		default:
+			break;
+	}
+	return plain | (u32)_mm_movemask_epi8(allowed);
+}
+
+bool FieldHasDisallowedBytes(char* text, u32 length, Field_class class)
+{
+	for (u32 offset = 0; offset < length; offset += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((__m128i*)&text[offset]);
+		u32 allowed[field_class_count];
+		AllowedBytes(bytes, PlainBytes(bytes), allowed);
+		u32 mask = ~allowed[class] & 0xFFFF;
+		if (length - offset < 16)
+		{
+			mask &= (1u << (length - offset)) - 1;
+		}
+		if (mask)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// A table of fields turned into, for each 16 bytes of the line, the bytes in a field of each class, so that a
+// line is checked a block at a time rather than a field at a time. Blocks of only spaces and digits (most of
+// the numbers) need nothing more than the one compare.
+typedef struct
+{
+	Field_check* fields;
+	u32 num_fields;
+	u32 min_length;
+	u32 num_blocks;
+	u32 field_bytes[CHECK_MAX_BLOCKS]; // In any field.
+	u32 class_bytes[CHECK_MAX_BLOCKS][field_class_count];
+	u8 block_class[CHECK_MAX_BLOCKS]; // The one class of the block's fields, or field_class_count if several.
+} Line_check;
+
+void CompileLineCheck(Line_check* check, Field_check* fields, u32 num_fields, u32 min_length)
+{
+	memset(check, 0, sizeof(*check));
+	check->fields = fields;
+	check->num_fields = num_fields;
+	check->min_length = min_length;
+	for (u32 field_index = 0; field_index < num_fields; field_index++)
+	{
+		Field_check* field = &fields[field_index];
+		u32 end = MIN(field->start + field->length, CHECK_MAX_BLOCKS * 16);
+		for (u32 position = field->start; position < end; position++)
+		{
+			u32 bit = 1u << (position % 16);
+			check->field_bytes[position / 16] |= bit;
+			check->class_bytes[position / 16][field->class] |= bit;
+			check->num_blocks = MAX(check->num_blocks, position / 16 + 1);
+		}
+	}
+	for (u32 block = 0; block < CHECK_MAX_BLOCKS; block++)
+	{
+		check->block_class[block] = field_class_count;
+		for (u32 class = 0; class < field_class_count; class++)
+		{
+			if (check->class_bytes[block][class] == check->field_bytes[block])
+			{
+				check->block_class[block] = (u8)class;
+			}
+		}
+	}
+}
+
+// Line number of the line starting at line; lines must be asked for in the order they are in the report.
+u64 AnomalyLineNumber(Anomaly_log* log, char* line)
+{
+	while (log->counted_line < line)
+	{
+		char* newline = (char*)memchr(log->counted_line, '\n', (size_t)(line - log->counted_line));
+		if (!newline)
+		{
+			break;
+		}
+		log->counted_lines++;
+		log->counted_line = newline + 1;
+	}
+	return log->counted_lines + 1;
+}
+
+void NoteAnomaly(Anomaly_log* log, Anomaly_kind kind, char* line, char* field_name, char* text, u32 length)
+{
+	log->counts[kind]++;
+	if (!log->file || log->num_anomalies++ >= ANOMALY_MAX_ROWS)
+	{
+		return;
+	}
+
+	// The field as it is, but for anything that would break the row.
+	char field[128];
+	u32 field_length = 0;
+	for (u32 index = 0; index < length && field_length + 1 < sizeof(field); index++)
+	{
+		u8 character = (u8)text[index];
+		field[field_length++] = (character < ' ' || character == '|') ? '?' : (char)character;
+	}
+	while (field_length && field[field_length - 1] == ' ')
+	{
+		field_length--;
+	}
+	field[field_length] = '\0';
+
+	char buffer[256];
+	sprintf_s(buffer, sizeof(buffer), "%llu|%s|%s|%s\n", (unsigned long long)AnomalyLineNumber(log, line), field_name, anomaly_names[kind], field);
+	char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+	fprintf(log->file, "%s", TranscodeText(buffer, utf8, sizeof(utf8), log->code_page));
+}
+
+// Checks a record line: that it reaches the check's min_length, and that each field that is on it holds only
+// its class. Only a line with something wrong on it is gone over field by field, to tell which.
+void CheckRecordLine(Anomaly_log* log, char* line, size_t line_length, Line_check* check)
+{
+	if (line_length < check->min_length)
+	{
+		NoteAnomaly(log, anomaly_short_line, line, "", line, (u32)MIN(line_length, 100));
+	}
+
+	u32 num_blocks = (u32)MIN(check->num_blocks, (line_length + 15) / 16);
+	u32 disallowed = 0;
+	for (u32 block = 0; block < num_blocks; block++)
+	{
+		__m128i bytes = _mm_loadu_si128((__m128i*)&line[block * 16]);
+		u32 plain = PlainBytes(bytes);
+		u32 unchecked = check->field_bytes[block] & ~plain;
+		if (block * 16 + 16 > line_length)
+		{
+			unchecked &= (1u << (line_length - block * 16)) - 1; // Not what is past the end of the line.
+		}
+		if (unchecked && check->block_class[block] < field_class_count)
+		{
+			disallowed |= unchecked & ~ClassAllowedBytes(bytes, plain, (Field_class)check->block_class[block]);
+		}
+		else if (unchecked)
+		{
+			u32 allowed[field_class_count];
+			AllowedBytes(bytes, plain, allowed);
+			u32* class_bytes = check->class_bytes[block];
+			disallowed |= unchecked & ((class_bytes[field_text] & ~allowed[field_text]) | (class_bytes[field_code] & ~allowed[field_code]) |
+									   (class_bytes[field_number] & ~allowed[field_number]) | (class_bytes[field_money] & ~allowed[field_money]) |
+									   (class_bytes[field_date] & ~allowed[field_date]));
+		}
+	}
+	if (!disallowed)
+	{
+		return;
+	}
+
+	for (u32 field_index = 0; field_index < check->num_fields; field_index++)
+	{
+		Field_check* field = &check->fields[field_index];
+		if (field->start >= line_length)
+		{
+			continue;
+		}
+		u32 length = (u32)MIN(field->length, line_length - field->start);
+		if (FieldHasDisallowedBytes(&line[field->start], length, field->class))
+		{
+			NoteAnomaly(log, (Anomaly_kind)field->class, line, field->name, &line[field->start], length);
+		}
+	}
+}
+
+void PrintAnomalies(Anomaly_log* log)
+{
+	u64 total = 0;
+	for (u32 kind = 0; kind < anomaly_kind_count; kind++)
+	{
+		total += log->counts[kind];
+	}
+	if (!total)
+	{
+		return;
+	}
+
+	printf("Warning: %llu anomalies in the report (", (unsigned long long)total);
+	char* separator = "";
+	for (u32 kind = 0; kind < anomaly_kind_count; kind++)
+	{
+		if (log->counts[kind])
+		{
+			printf("%s%s: %llu", separator, anomaly_names[kind], (unsigned long long)log->counts[kind]);
+			separator = ", ";
+		}
+	}
+	if (log->file)
+	{
+		printf("), listed in %s%s.\n", log->file_name, (total > ANOMALY_MAX_ROWS) ? " (the first ones)" : "");
+	}
+	else
+	{
+		printf("). Use -a <file> to list them.\n");
+	}
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ARENA
+#define ARENA
+
+#include "platform.h"
+
+// Records are produced in batches of this many before being handed to the writers, after which the arena
+// holding them is reset as a whole. This bounds the memory used by a parse regardless of the report size.
+#define RECORD_BATCH_SIZE 4096
+
+typedef struct Memory_arena
+{
+	u8* base;
+	size_t size;
+	size_t used;
+} Memory_arena;
+
+Memory_arena AllocateArena(size_t size)
+{
+	Memory_arena arena = {0};
+	arena.base = (u8*)AllocateMemory(size);
+	if (arena.base)
+	{
+		arena.size = size;
+	}
+	return arena;
+}
+
+void FreeArena(Memory_arena* arena)
+{
+	FreeFileMemory(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+// Memory returned is always zeroed, so freshly pushed records need no further initialization.
+void* PushSize(Memory_arena* arena, size_t size)
+{
+	size = (size + 15) & ~(size_t)15; // Keep every allocation 16-byte aligned.
+	if (arena->used + size > arena->size)
+	{
+		printf("Error: Memory arena exhausted (%zu of %zu bytes used)!\n", arena->used, arena->size);
+		exit (-1);
+	}
+
+	void* result = arena->base + arena->used;
+	memset(result, 0, size);
+	arena->used += size;
+	return result;
+}
+
+#define PushStruct(arena, type) (type*)PushSize(arena, sizeof(type))
+#define PushArray(arena, count, type) (type*)PushSize(arena, (count) * sizeof(type))
+
+// Releases everything pushed since the arena was allocated.
+void ResetArena(Memory_arena* arena)
+{
+	arena->used = 0;
+}
+
+#endif
@@ -0,0 +1,828 @@
+#ifndef ARROW
+#define ARROW
+
+#include "platform.h"
+#include "encoding.h"
+
+/*	ARROW IPC (FEATHER V2) FILES
+	============================
+
+	- A file is the magic "ARROW1\0\0", a stream of encapsulated messages and a footer indexing them:
+	  0xFFFFFFFF, metadata length, flatbuffer Message (padded to 8 bytes), message body.
+	- The first message is the Schema. A RecordBatch is written every time the parser flushes a batch of records,
+	  so the columns only ever hold one batch. Dictionary-encoded columns keep growing their dictionary for the
+	  whole file; the DictionaryBatch messages are written last (readers of the file format locate them through
+	  the footer before reading any record batch).
+	- The metadata is flatbuffers. The small builder below writes back to front, like the reference
+	  implementation, so that children (strings, vectors, sub-tables) are always created before their parent.
+	- Only what the reports need is supported: utf8, dictionary-encoded utf8 (int32 indices), int32, int64,
+	  float32 and date32 columns, all nullable.
+	- Arrow strings must be UTF-8, so text is transcoded from the writer's code page (see encoding.h) as it is
+	  appended. Set code_page after ArrowOpen() and before adding the columns. Unlike the pipe-delimited
+	  output, which keeps the bytes of the report without -e, text is always transcoded here (from
+	  ARROW_DEFAULT_CODE_PAGE if none is set): readers reject a file with invalid UTF-8 in it.
+*/
+
+#define ARROW_MAX_STRING 1024 // Longest string (in bytes of the report) that is transcoded whole.
+#define ARROW_DEFAULT_CODE_PAGE code_page_1252 // Every byte of it is a character, as Windows reads the reports.
+
+#define ARROW_MAX_COLUMNS 64
+#define ARROW_METADATA_VERSION 4 // V5
+
+typedef enum
+{
+	arrow_utf8,
+	arrow_dictionary,
+	arrow_int32,
+	arrow_int64,
+	arrow_float32,
+	arrow_date32,
+} Arrow_type;
+
+typedef struct
+{
+	u8* data;
+	size_t size;
+	size_t capacity;
+} Arrow_buffer;
+
+typedef struct
+{
+	char* name;
+	Arrow_type type;
+	Code_page code_page;
+	u32 length;
+	u32 null_count;
+	Arrow_buffer validity; // One bit per value, least significant bit first.
+	Arrow_buffer values;   // Fixed-width values, string offsets or dictionary indices.
+	Arrow_buffer data;     // String bytes.
+
+	// Dictionary-encoded columns only.
+	i64 dictionary_id;
+	u32 dictionary_length;
+	Arrow_buffer dictionary_offsets;
+	Arrow_buffer dictionary_data;
+	u32* dictionary_slots; // Open addressing hash table of dictionary index + 1 (0 = empty slot).
+	u32 dictionary_capacity;
+} Arrow_column;
+
+// Layout of the flatbuffer structs Block, FieldNode and Buffer.
+typedef struct
+{
+	i64 offset;
+	i32 metadata_length;
+	i32 padding;
+	i64 body_length;
+} Arrow_block;
+
+typedef struct
+{
+	i64 length;
+	i64 null_count;
+} Arrow_field_node;
+
+typedef struct
+{
+	i64 offset;
+	i64 length;
+} Arrow_body_buffer;
+
+typedef struct
+{
+	FILE* file;
+	u64 position;
+	bool schema_written;
+	u32 num_columns;
+	u32 num_rows; // In the current batch.
+	Code_page code_page;
+	Arrow_column columns[ARROW_MAX_COLUMNS];
+	Arrow_buffer record_batch_blocks;
+	Arrow_buffer dictionary_blocks;
+} Arrow_writer;
+
+void ArrowReserve(Arrow_buffer* buffer, size_t additional)
+{
+	if (buffer->size + additional > buffer->capacity)
+	{
+		size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+		while (capacity < buffer->size + additional)
+		{
+			capacity *= 2;
+		}
+		u8* data = (u8*)realloc(buffer->data, capacity);
+		if (!data)
+		{
+			printf("Error: Out of memory writing Arrow file!\n");
+			exit (-1);
+		}
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+}
+
+void ArrowAppendBytes(Arrow_buffer* buffer, void* bytes, size_t size)
+{
+	ArrowReserve(buffer, size);
+	memcpy(buffer->data + buffer->size, bytes, size);
+	buffer->size += size;
+}
+
+void ArrowFreeBuffer(Arrow_buffer* buffer)
+{
+	free(buffer->data);
+	buffer->data = NULL;
+	buffer->size = 0;
+	buffer->capacity = 0;
+}
+
+//
+// Flatbuffer builder
+//
+
+typedef struct
+{
+	u8* data;
+	u32 capacity;
+	u32 size; // Bytes used, counted from the end of data.
+	u32 min_align;
+	u32 table_start;
+	u32 num_fields;
+	u32 field_locations[8];
+} Flatbuffer_builder;
+
+Flatbuffer_builder FbCreate(u32 capacity)
+{
+	Flatbuffer_builder fb = {0};
+	fb.data = (u8*)malloc(capacity);
+	fb.capacity = capacity;
+	fb.min_align = 8;
+	if (!fb.data)
+	{
+		printf("Error: Out of memory writing Arrow file!\n");
+		exit (-1);
+	}
+	return fb;
+}
+
+void FbPlace(Flatbuffer_builder* fb, void* bytes, u32 size)
+{
+	if (fb->size + size > fb->capacity)
+	{
+		printf("Error: Arrow metadata buffer exceeded!\n");
+		exit (-1);
+	}
+	fb->size += size;
+	memcpy(fb->data + fb->capacity - fb->size, bytes, size);
+}
+
+// Pads so that after writing additional bytes the size is a multiple of align.
+void FbPrep(Flatbuffer_builder* fb, u32 align, u32 additional)
+{
+	if (align > fb->min_align)
+	{
+		fb->min_align = align;
+	}
+	u32 padding = (~(fb->size + additional) + 1) & (align - 1);
+	u8 zero = 0;
+	for (u32 pad = 0; pad < padding; pad++)
+	{
+		FbPlace(fb, &zero, 1);
+	}
+}
+
+void FbPushU8(Flatbuffer_builder* fb, u8 value)		{ FbPrep(fb, 1, 0); FbPlace(fb, &value, 1); }
+void FbPushI16(Flatbuffer_builder* fb, i16 value)	{ FbPrep(fb, 2, 0); FbPlace(fb, &value, 2); }
+void FbPushI32(Flatbuffer_builder* fb, i32 value)	{ FbPrep(fb, 4, 0); FbPlace(fb, &value, 4); }
+void FbPushI64(Flatbuffer_builder* fb, i64 value)	{ FbPrep(fb, 8, 0); FbPlace(fb, &value, 8); }
+
+// Offsets are stored relative to where they are written.
+void FbPushOffset(Flatbuffer_builder* fb, u32 offset)
+{
+	FbPrep(fb, 4, 0);
+	u32 relative = fb->size + 4 - offset;
+	FbPlace(fb, &relative, 4);
+}
+
+u32 FbCreateString(Flatbuffer_builder* fb, char* string)
+{
+	u32 length = (u32)strlen(string);
+	u8 terminator = 0;
+	FbPrep(fb, 4, length + 1);
+	FbPlace(fb, &terminator, 1);
+	FbPlace(fb, string, length);
+	FbPlace(fb, &length, 4);
+	return fb->size;
+}
+
+// Elements must be pushed last to first between FbStartVector() and FbEndVector().
+void FbStartVector(Flatbuffer_builder* fb, u32 element_size, u32 count, u32 align)
+{
+	FbPrep(fb, 4, element_size * count);
+	FbPrep(fb, align, element_size * count);
+}
+
+u32 FbEndVector(Flatbuffer_builder* fb, u32 count)
+{
+	FbPlace(fb, &count, 4);
+	return fb->size;
+}
+
+u32 FbCreateStructVector(Flatbuffer_builder* fb, void* structs, u32 struct_size, u32 count)
+{
+	FbStartVector(fb, struct_size, count, 8);
+	for (u32 index = count; index > 0; index--)
+	{
+		FbPlace(fb, (u8*)structs + (index - 1) * struct_size, struct_size);
+	}
+	return FbEndVector(fb, count);
+}
+
+u32 FbCreateOffsetVector(Flatbuffer_builder* fb, u32* offsets, u32 count)
+{
+	FbStartVector(fb, 4, count, 4);
+	for (u32 index = count; index > 0; index--)
+	{
+		FbPushOffset(fb, offsets[index - 1]);
+	}
+	return FbEndVector(fb, count);
+}
+
+void FbStartTable(Flatbuffer_builder* fb, u32 num_fields)
+{
+	fb->table_start = fb->size;
+	fb->num_fields = num_fields;
+	memset(fb->field_locations, 0, sizeof(fb->field_locations));
+}
+
+void FbAddU8(Flatbuffer_builder* fb, u32 field, u8 value)		{ FbPushU8(fb, value); fb->field_locations[field] = fb->size; }
+void FbAddI16(Flatbuffer_builder* fb, u32 field, i16 value)		{ FbPushI16(fb, value); fb->field_locations[field] = fb->size; }
+void FbAddI32(Flatbuffer_builder* fb, u32 field, i32 value)		{ FbPushI32(fb, value); fb->field_locations[field] = fb->size; }
+void FbAddI64(Flatbuffer_builder* fb, u32 field, i64 value)		{ FbPushI64(fb, value); fb->field_locations[field] = fb->size; }
+void FbAddOffset(Flatbuffer_builder* fb, u32 field, u32 offset)	{ FbPushOffset(fb, offset); fb->field_locations[field] = fb->size; }
+
+u32 FbEndTable(Flatbuffer_builder* fb)
+{
+	FbPushI32(fb, 0); // Offset to the vtable, patched below.
+	u32 table = fb->size;
+
+	for (u32 field = fb->num_fields; field > 0; field--)
+	{
+		u32 location = fb->field_locations[field - 1];
+		FbPushI16(fb, (i16)(location ? table - location : 0));
+	}
+	FbPushI16(fb, (i16)(table - fb->table_start));
+	FbPushI16(fb, (i16)(4 + 2 * fb->num_fields));
+
+	i32 vtable_offset = (i32)(fb->size - table); // The vtable precedes the table.
+	memcpy(fb->data + fb->capacity - table, &vtable_offset, 4);
+	return table;
+}
+
+u32 FbFinish(Flatbuffer_builder* fb, u32 root)
+{
+	FbPrep(fb, fb->min_align, 4);
+	FbPushOffset(fb, root);
+	return fb->size;
+}
+
+//
+// Columns
+//
+
+void ArrowAddColumn(Arrow_writer* writer, char* name, Arrow_type type)
+{
+	if (writer->num_columns == ARROW_MAX_COLUMNS)
+	{
+		printf("Error: Too many Arrow columns!\n");
+		exit (-1);
+	}
+	Arrow_column* column = &writer->columns[writer->num_columns];
+	column->name = name;
+	column->type = type;
+	column->code_page = (writer->code_page == code_page_none) ? ARROW_DEFAULT_CODE_PAGE : writer->code_page;
+	column->dictionary_id = writer->num_columns;
+	writer->num_columns++;
+}
+
+void ArrowSetValidity(Arrow_column* column, bool valid)
+{
+	if ((column->length % 8) == 0)
+	{
+		u8 zero = 0;
+		ArrowAppendBytes(&column->validity, &zero, 1);
+	}
+	if (valid)
+	{
+		column->validity.data[column->length / 8] |= (u8)(1 << (column->length % 8));
+	}
+	else
+	{
+		column->null_count++;
+	}
+	column->length++;
+}
+
+void ArrowAppendInt32(Arrow_column* column, i32 value)
+{
+	ArrowAppendBytes(&column->values, &value, sizeof(value));
+	ArrowSetValidity(column, true);
+}
+
+void ArrowAppendInt64(Arrow_column* column, i64 value)
+{
+	ArrowAppendBytes(&column->values, &value, sizeof(value));
+	ArrowSetValidity(column, true);
+}
+
+void ArrowAppendFloat32(Arrow_column* column, float value)
+{
+	ArrowAppendBytes(&column->values, &value, sizeof(value));
+	ArrowSetValidity(column, true);
+}
+
+// Appends a string, or adds it to the dictionary and appends its index.
+void ArrowAppendString(Arrow_column* column, char* string)
+{
+	char utf8[TRANSCODED_SIZE(ARROW_MAX_STRING)];
+	string = TranscodeText(string, utf8, sizeof(utf8), column->code_page);
+	u32 length = (u32)strlen(string);
+
+	if (column->type == arrow_dictionary)
+	{
+		if (column->dictionary_offsets.size == 0)
+		{
+			i32 zero = 0;
+			ArrowAppendBytes(&column->dictionary_offsets, &zero, sizeof(zero));
+		}
+		if ((column->dictionary_length + 1) * 2 > column->dictionary_capacity)
+		{
+			// Grow and rehash the table, keeping it at most half full.
+			u32 capacity = column->dictionary_capacity ? column->dictionary_capacity * 2 : 256;
+			u32* slots = (u32*)calloc(capacity, sizeof(u32));
+			if (!slots)
+			{
+				printf("Error: Out of memory writing Arrow file!\n");
+				exit (-1);
+			}
+			for (u32 slot = 0; slot < column->dictionary_capacity; slot++)
+			{
+				u32 entry = column->dictionary_slots[slot];
+				if (entry)
+				{
+					i32* offsets = (i32*)column->dictionary_offsets.data;
+					u32 hash = HashBytes(column->dictionary_data.data + offsets[entry - 1], offsets[entry] - offsets[entry - 1]);
+					u32 new_slot = hash & (capacity - 1);
+					while (slots[new_slot])
+					{
+						new_slot = (new_slot + 1) & (capacity - 1);
+					}
+					slots[new_slot] = entry;
+				}
+			}
+			free(column->dictionary_slots);
+			column->dictionary_slots = slots;
+			column->dictionary_capacity = capacity;
+		}
+
+		u32 slot = HashBytes((u8*)string, length) & (column->dictionary_capacity - 1);
+		i32 index = -1;
+		while (column->dictionary_slots[slot])
+		{
+			u32 entry = column->dictionary_slots[slot];
+			i32* offsets = (i32*)column->dictionary_offsets.data;
+			if (((u32)(offsets[entry] - offsets[entry - 1]) == length) &&
+				(memcmp(column->dictionary_data.data + offsets[entry - 1], string, length) == 0))
+			{
+				index = (i32)entry - 1;
+				break;
+			}
+			slot = (slot + 1) & (column->dictionary_capacity - 1);
+		}
+		if (index < 0)
+		{
+			index = (i32)column->dictionary_length++;
+			column->dictionary_slots[slot] = (u32)index + 1;
+			ArrowAppendBytes(&column->dictionary_data, string, length);
+			i32 end = (i32)column->dictionary_data.size;
+			ArrowAppendBytes(&column->dictionary_offsets, &end, sizeof(end));
+		}
+		ArrowAppendBytes(&column->values, &index, sizeof(index));
+	}
+	else
+	{
+		if (column->values.size == 0)
+		{
+			i32 zero = 0;
+			ArrowAppendBytes(&column->values, &zero, sizeof(zero));
+		}
+		ArrowAppendBytes(&column->data, string, length);
+		i32 end = (i32)column->data.size;
+		ArrowAppendBytes(&column->values, &end, sizeof(end));
+	}
+
+	ArrowSetValidity(column, true);
+}
+
+void ArrowAppendNull(Arrow_column* column)
+{
+	switch (column->type)
+	{
+		case arrow_utf8:
+		{
+			if (column->values.size == 0)
+			{
+				i32 zero = 0;
+				ArrowAppendBytes(&column->values, &zero, sizeof(zero));
+			}
+			i32 end = (i32)column->data.size;
+			ArrowAppendBytes(&column->values, &end, sizeof(end));
+		} break;
+		case arrow_int64:
+		{
+			i64 zero = 0;
+			ArrowAppendBytes(&column->values, &zero, sizeof(zero));
+		} break;
+		default:
+		{
+			i32 zero = 0; // int32, float32, date32 and dictionary indices are all 4 bytes.
+			ArrowAppendBytes(&column->values, &zero, sizeof(zero));
+		} break;
+	}
+	ArrowSetValidity(column, false);
+}
+
+// Empty strings are stored as nulls, which is what the blank fields of the reports mean.
+void ArrowAppendText(Arrow_column* column, char* string)
+{
+	if (string[0] == '\0')
+	{
+		ArrowAppendNull(column);
+	}
+	else
+	{
+		ArrowAppendString(column, string);
+	}
+}
+
+void ArrowAppendMoney(Arrow_column* column, char* text)
+{
+	i64 cents = 0;
+	if (ParseMoneyCents(text, &cents))
+	{
+		ArrowAppendInt64(column, cents);
+	}
+	else
+	{
+		ArrowAppendNull(column);
+	}
+}
+
+void ArrowAppendDate(Arrow_column* column, char* text)
+{
+	i32 days = 0;
+	if (ParseReportDate(text, &days))
+	{
+		ArrowAppendBytes(&column->values, &days, sizeof(days));
+		ArrowSetValidity(column, true);
+	}
+	else
+	{
+		ArrowAppendNull(column);
+	}
+}
+
+//
+// Messages
+//
+
+u32 ArrowCreateIntType(Flatbuffer_builder* fb, i32 bit_width)
+{
+	FbStartTable(fb, 2);
+	FbAddI32(fb, 0, bit_width);
+	FbAddU8(fb, 1, true); // is_signed
+	return FbEndTable(fb);
+}
+
+u32 ArrowCreateSchema(Flatbuffer_builder* fb, Arrow_writer* writer)
+{
+	u32 fields[ARROW_MAX_COLUMNS];
+
+	for (u32 column_index = 0; column_index < writer->num_columns; column_index++)
+	{
+		Arrow_column* column = &writer->columns[column_index];
+
+		u32 name = FbCreateString(fb, column->name);
+		u32 children = FbCreateOffsetVector(fb, NULL, 0);
+
+		u8 type_type = 0;
+		u32 type = 0;
+		switch (column->type)
+		{
+			case arrow_utf8:
+			case arrow_dictionary:
+			{
+				type_type = 5; // Utf8
+				FbStartTable(fb, 0);
+				type = FbEndTable(fb);
+			} break;
+			case arrow_int32:
+			case arrow_int64:
+			{
+				type_type = 2; // Int
+				type = ArrowCreateIntType(fb, column->type == arrow_int32 ? 32 : 64);
+			} break;
+			case arrow_float32:
+			{
+				type_type = 3; // FloatingPoint
+				FbStartTable(fb, 1);
+				FbAddI16(fb, 0, 1); // SINGLE
+				type = FbEndTable(fb);
+			} break;
+			case arrow_date32:
+			{
+				type_type = 8; // Date
+				FbStartTable(fb, 1);
+				FbAddI16(fb, 0, 0); // DAY (the default is MILLISECOND, so it must be written)
+				type = FbEndTable(fb);
+			} break;
+		}
+
+		u32 dictionary = 0;
+		if (column->type == arrow_dictionary)
+		{
+			u32 index_type = ArrowCreateIntType(fb, 32);
+			FbStartTable(fb, 3);
+			FbAddI64(fb, 0, column->dictionary_id);
+			FbAddOffset(fb, 1, index_type);
+			FbAddU8(fb, 2, false); // isOrdered
+			dictionary = FbEndTable(fb);
+		}
+
+		FbStartTable(fb, 6);
+		FbAddOffset(fb, 0, name);
+		FbAddU8(fb, 1, true); // nullable
+		FbAddU8(fb, 2, type_type);
+		FbAddOffset(fb, 3, type);
+		if (dictionary)
+		{
+			FbAddOffset(fb, 4, dictionary);
+		}
+		FbAddOffset(fb, 5, children);
+		fields[column_index] = FbEndTable(fb);
+	}
+
+	u32 field_vector = FbCreateOffsetVector(fb, fields, writer->num_columns);
+	FbStartTable(fb, 2);
+	FbAddI16(fb, 0, 0); // Little endian
+	FbAddOffset(fb, 1, field_vector);
+	return FbEndTable(fb);
+}
+
+u32 ArrowCreateMessage(Flatbuffer_builder* fb, u8 header_type, u32 header, i64 body_length)
+{
+	FbStartTable(fb, 4);
+	FbAddI64(fb, 3, body_length);
+	FbAddOffset(fb, 2, header);
+	FbAddI16(fb, 0, ARROW_METADATA_VERSION);
+	FbAddU8(fb, 1, header_type);
+	return FbEndTable(fb);
+}
+
+void ArrowWritePadding(Arrow_writer* writer, size_t size)
+{
+	u8 zeros[8] = {0};
+	size_t padding = (8 - (size & 7)) & 7;
+	fwrite(zeros, 1, padding, writer->file);
+	writer->position += padding;
+}
+
+// Writes an encapsulated message followed by its body buffers (each padded to 8 bytes) and records its block.
+void ArrowWriteMessage(Arrow_writer* writer, Flatbuffer_builder* fb, Arrow_buffer* blocks, Arrow_buffer** body, u32 num_body_buffers, i64 body_length)
+{
+	u32 metadata_size = fb->size; // FbFinish() aligned this to 8.
+	u32 continuation = 0xFFFFFFFF;
+
+	Arrow_block block = {0};
+	block.offset = (i64)writer->position;
+	block.metadata_length = (i32)(metadata_size + 8);
+	block.body_length = body_length;
+
+	fwrite(&continuation, 4, 1, writer->file);
+	fwrite(&metadata_size, 4, 1, writer->file);
+	fwrite(fb->data + fb->capacity - fb->size, 1, metadata_size, writer->file);
+	writer->position += 8 + metadata_size;
+
+	for (u32 buffer = 0; buffer < num_body_buffers; buffer++)
+	{
+		if (body[buffer])
+		{
+			fwrite(body[buffer]->data, 1, body[buffer]->size, writer->file);
+			writer->position += body[buffer]->size;
+			ArrowWritePadding(writer, body[buffer]->size);
+		}
+	}
+
+	if (blocks)
+	{
+		ArrowAppendBytes(blocks, &block, sizeof(block));
+	}
+}
+
+void ArrowWriteSchema(Arrow_writer* writer)
+{
+	Flatbuffer_builder fb = FbCreate(64 * 1024);
+	u32 schema = ArrowCreateSchema(&fb, writer);
+	FbFinish(&fb, ArrowCreateMessage(&fb, 1, schema, 0)); // Schema
+	ArrowWriteMessage(writer, &fb, NULL, NULL, 0, 0);
+	free(fb.data);
+	writer->schema_written = true;
+}
+
+#define ARROW_MAX_BODY_BUFFERS (ARROW_MAX_COLUMNS * 3)
+
+typedef struct
+{
+	Arrow_field_node nodes[ARROW_MAX_COLUMNS];
+	Arrow_body_buffer buffers[ARROW_MAX_BODY_BUFFERS];
+	Arrow_buffer* body[ARROW_MAX_BODY_BUFFERS];
+	u32 num_nodes;
+	u32 num_buffers;
+	i64 body_length;
+} Arrow_record_layout;
+
+void ArrowAddBodyBuffer(Arrow_record_layout* layout, Arrow_buffer* buffer)
+{
+	Arrow_body_buffer* body_buffer = &layout->buffers[layout->num_buffers];
+	body_buffer->offset = layout->body_length;
+	body_buffer->length = buffer ? (i64)buffer->size : 0;
+	layout->body[layout->num_buffers] = buffer;
+	layout->num_buffers++;
+	layout->body_length += (body_buffer->length + 7) & ~7;
+}
+
+u32 ArrowCreateRecordBatch(Flatbuffer_builder* fb, Arrow_record_layout* layout, i64 length)
+{
+	u32 nodes = FbCreateStructVector(fb, layout->nodes, sizeof(Arrow_field_node), layout->num_nodes);
+	u32 buffers = FbCreateStructVector(fb, layout->buffers, sizeof(Arrow_body_buffer), layout->num_buffers);
+	FbStartTable(fb, 3);
+	FbAddI64(fb, 0, length);
+	FbAddOffset(fb, 1, nodes);
+	FbAddOffset(fb, 2, buffers);
+	return FbEndTable(fb);
+}
+
+// Writes the rows appended since the last call as one record batch.
+void ArrowWriteBatch(Arrow_writer* writer)
+{
+	if (!writer->file)
+	{
+		return;
+	}
+	if (!writer->schema_written)
+	{
+		ArrowWriteSchema(writer);
+	}
+
+	Arrow_record_layout layout = {0};
+	i64 length = writer->num_columns ? writer->columns[0].length : 0;
+	for (u32 column_index = 0; column_index < writer->num_columns; column_index++)
+	{
+		Arrow_column* column = &writer->columns[column_index];
+		if (column->type == arrow_utf8 && column->values.size == 0)
+		{
+			i32 zero = 0; // Even an empty string column needs its first offset.
+			ArrowAppendBytes(&column->values, &zero, sizeof(zero));
+		}
+
+		layout.nodes[layout.num_nodes].length = column->length;
+		layout.nodes[layout.num_nodes].null_count = column->null_count;
+		layout.num_nodes++;
+		ArrowAddBodyBuffer(&layout, column->null_count ? &column->validity : NULL);
+		ArrowAddBodyBuffer(&layout, &column->values);
+		if (column->type == arrow_utf8)
+		{
+			ArrowAddBodyBuffer(&layout, &column->data);
+		}
+	}
+
+	Flatbuffer_builder fb = FbCreate(64 * 1024);
+	u32 record_batch = ArrowCreateRecordBatch(&fb, &layout, length);
+	FbFinish(&fb, ArrowCreateMessage(&fb, 3, record_batch, layout.body_length)); // RecordBatch
+	ArrowWriteMessage(writer, &fb, &writer->record_batch_blocks, layout.body, layout.num_buffers, layout.body_length);
+	free(fb.data);
+
+	for (u32 column_index = 0; column_index < writer->num_columns; column_index++)
+	{
+		Arrow_column* column = &writer->columns[column_index];
+		column->length = 0;
+		column->null_count = 0;
+		column->validity.size = 0;
+		column->values.size = 0;
+		column->data.size = 0;
+	}
+}
+
+void ArrowWriteDictionaries(Arrow_writer* writer)
+{
+	for (u32 column_index = 0; column_index < writer->num_columns; column_index++)
+	{
+		Arrow_column* column = &writer->columns[column_index];
+		if (column->type != arrow_dictionary)
+		{
+			continue;
+		}
+		if (column->dictionary_offsets.size == 0)
+		{
+			i32 zero = 0;
+			ArrowAppendBytes(&column->dictionary_offsets, &zero, sizeof(zero));
+		}
+
+		Arrow_record_layout layout = {0};
+		layout.nodes[0].length = column->dictionary_length;
+		layout.num_nodes = 1;
+		ArrowAddBodyBuffer(&layout, NULL);
+		ArrowAddBodyBuffer(&layout, &column->dictionary_offsets);
+		ArrowAddBodyBuffer(&layout, &column->dictionary_data);
+
+		Flatbuffer_builder fb = FbCreate(4 * 1024);
+		u32 record_batch = ArrowCreateRecordBatch(&fb, &layout, column->dictionary_length);
+		FbStartTable(&fb, 3);
+		FbAddI64(&fb, 0, column->dictionary_id);
+		FbAddOffset(&fb, 1, record_batch);
+		FbAddU8(&fb, 2, false); // isDelta
+		u32 dictionary_batch = FbEndTable(&fb);
+		FbFinish(&fb, ArrowCreateMessage(&fb, 2, dictionary_batch, layout.body_length)); // DictionaryBatch
+		ArrowWriteMessage(writer, &fb, &writer->dictionary_blocks, layout.body, layout.num_buffers, layout.body_length);
+		free(fb.data);
+	}
+}
+
+bool ArrowOpen(Arrow_writer* writer, char* file_name)
+{
+	memset(writer, 0, sizeof(*writer));
+	errno_t error = fopen_s(&writer->file, file_name, "wb");
+	if (error)
+	{
+		writer->file = NULL;
+		return false;
+	}
+	fwrite("ARROW1\0\0", 1, 8, writer->file);
+	writer->position = 8;
+	return true;
+}
+
+// Writes any remaining rows, the dictionaries and the footer, then frees everything.
+void ArrowClose(Arrow_writer* writer)
+{
+	if (!writer->file)
+	{
+		return;
+	}
+	if (!writer->schema_written || (writer->num_columns && writer->columns[0].length))
+	{
+		ArrowWriteBatch(writer);
+	}
+	ArrowWriteDictionaries(writer);
+
+	u32 end_of_stream[2] = {0xFFFFFFFF, 0};
+	fwrite(end_of_stream, 4, 2, writer->file);
+	writer->position += 8;
+
+	u32 num_record_batches = (u32)(writer->record_batch_blocks.size / sizeof(Arrow_block));
+	u32 num_dictionaries = (u32)(writer->dictionary_blocks.size / sizeof(Arrow_block));
+	Flatbuffer_builder fb = FbCreate(64 * 1024 + (num_record_batches + num_dictionaries) * sizeof(Arrow_block) * 2);
+	u32 schema = ArrowCreateSchema(&fb, writer);
+	u32 dictionaries = FbCreateStructVector(&fb, writer->dictionary_blocks.data, sizeof(Arrow_block), num_dictionaries);
+	u32 record_batches = FbCreateStructVector(&fb, writer->record_batch_blocks.data, sizeof(Arrow_block), num_record_batches);
+	FbStartTable(&fb, 4);
+	FbAddOffset(&fb, 1, schema);
+	FbAddOffset(&fb, 2, dictionaries);
+	FbAddOffset(&fb, 3, record_batches);
+	FbAddI16(&fb, 0, ARROW_METADATA_VERSION);
+	u32 footer = FbEndTable(&fb);
+	FbFinish(&fb, footer);
+
+	i32 footer_size = (i32)fb.size;
+	fwrite(fb.data + fb.capacity - fb.size, 1, fb.size, writer->file);
+	fwrite(&footer_size, 4, 1, writer->file);
+	fwrite("ARROW1", 1, 6, writer->file);
+	free(fb.data);
+
+	fclose(writer->file);
+	writer->file = NULL;
+
+	for (u32 column_index = 0; column_index < writer->num_columns; column_index++)
+	{
+		Arrow_column* column = &writer->columns[column_index];
+		ArrowFreeBuffer(&column->validity);
+		ArrowFreeBuffer(&column->values);
+		ArrowFreeBuffer(&column->data);
+		ArrowFreeBuffer(&column->dictionary_offsets);
+		ArrowFreeBuffer(&column->dictionary_data);
+		free(column->dictionary_slots);
+	}
+	ArrowFreeBuffer(&writer->record_batch_blocks);
+	ArrowFreeBuffer(&writer->dictionary_blocks);
+}
+
+#endif
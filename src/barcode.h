@@ -0,0 +1,243 @@
+#ifndef BARCODE
+#define BARCODE
+
+#include <emmintrin.h>
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	Checks the references of the cross-reference report before they go to CashierPRO, which rejects barcodes
+	with a bad check digit, and finds barcodes that belong to more than one SKU (the till can only ring up one
+	of them).
+
+	Every all-digit reference of a barcode length is treated as a GTIN: UPC-A (12 digits), EAN-13 (13), EAN-8
+	(8) and GTIN-14 (14). Padded on the left with zeros to 14 digits they all share one check digit rule: the
+	first 13 digits weighted 3, 1, 3, 1, ... from the left, and the check digit bringing the sum up to a
+	multiple of 10. GtinCheckDigit() does the whole sum with one 16 byte load and two SSE2 multiply-adds.
+
+	Each reference is classified as
+	  - valid: a barcode as it stands.
+	  - repairable: a barcode once fixed, i.e. with the spaces or dashes taken out, the missing check digit of an
+	    11 digit UPC-A added, or a wrong check digit recalculated (which assumes the other 11 digits are right,
+	    so these should be checked against the product before the suggestion is used).
+	  - internal code: anything else (letters, other lengths), such as vendor part numbers. These are fine as
+	    references, they just are not barcodes.
+
+	The shared barcode index is a hash table from a code (valid and repairable barcodes by their repaired
+	digits, internal codes as they are) to the list of SKUs it has been seen with, filled as the references are
+	parsed. It holds every reference, those --where leaves out too, so that a barcode kept in the output is
+	still found to be shared with a SKU that is not; a barcode none of whose references were kept is not listed.
+*/
+
+typedef enum
+{
+	barcode_valid,
+	barcode_repairable,
+	barcode_internal,
+	barcode_status_count
+} Barcode_status;
+
+char* barcode_status_names[barcode_status_count] = {"valid", "repairable", "internal code"};
+
+#define BARCODE_SIZE 16 // 14 digits + \0, rounded up.
+
+typedef struct
+{
+	Barcode_status status;
+	char code[BARCODE_SIZE]; // Repaired, when repairable.
+	char* problem; // Why it needed repairing.
+} Barcode_check;
+
+// Check digit of a GTIN-14 (the first 13 of its 14 digits; the 16 bytes at gtin must be readable).
+u32 GtinCheckDigit(char* gtin)
+{
+	const __m128i weights_low = _mm_set_epi16(1, 3, 1, 3, 1, 3, 1, 3);
+	const __m128i weights_high = _mm_set_epi16(0, 0, 0, 3, 1, 3, 1, 3); // Check digit and padding weigh 0.
+
+	__m128i digits = _mm_sub_epi8(_mm_loadu_si128((__m128i*)gtin), _mm_set1_epi8('0'));
+	__m128i low = _mm_unpacklo_epi8(digits, _mm_setzero_si128());
+	__m128i high = _mm_unpackhi_epi8(digits, _mm_setzero_si128());
+	__m128i sums = _mm_add_epi32(_mm_madd_epi16(low, weights_low), _mm_madd_epi16(high, weights_high));
+
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+	u32 sum = (u32)_mm_cvtsi128_si32(sums);
+	return (10 - (sum % 10)) % 10;
+}
+
+void CheckBarcode(char* reference, Barcode_check* check)
+{
+	char digits[BARCODE_SIZE];
+	u32 num_digits = 0;
+	bool separated = false;
+	bool all_digits = true;
+	for (char* character = reference; *character; character++)
+	{
+		if (*character >= '0' && *character <= '9')
+		{
+			if (num_digits == 14)
+			{
+				all_digits = false;
+				break;
+			}
+			digits[num_digits++] = *character;
+		}
+		else if ((*character == ' ' || *character == '-') && num_digits)
+		{
+			separated = true;
+		}
+		else
+		{
+			all_digits = false;
+			break;
+		}
+	}
+
+	check->status = barcode_internal;
+	check->problem = "";
+	strcpy_s(check->code, sizeof(check->code), reference);
+	if (!all_digits || !(num_digits == 8 || num_digits == 11 || num_digits == 12 || num_digits == 13 || num_digits == 14))
+	{
+		return;
+	}
+
+	// Right-align in a zero padded GTIN-14, leaving a slot for the check digit if it is missing.
+	bool missing_check_digit = (num_digits == 11);
+	u32 length = missing_check_digit ? 12 : num_digits;
+	char gtin[BARCODE_SIZE];
+	memset(gtin, '0', sizeof(gtin));
+	memcpy(&gtin[14 - length], digits, num_digits);
+
+	char expected = (char)('0' + GtinCheckDigit(gtin));
+	if (!missing_check_digit && gtin[13] == expected && !separated)
+	{
+		check->status = barcode_valid;
+		return;
+	}
+
+	check->status = barcode_repairable;
+	check->problem = missing_check_digit ? "missing check digit" : (gtin[13] != expected) ? "wrong check digit" : "spaces or dashes";
+	gtin[13] = expected;
+	memcpy(check->code, &gtin[14 - length], length);
+	check->code[length] = '\0';
+}
+
+typedef struct
+{
+	char code[BARCODE_SIZE];
+	char sku[12];
+	u32 next; // Next SKU with the same code, + 1 (0 = none).
+	u32 num_skus; // SKUs with this code, in its first entry (0 in the others).
+	bool kept; // In its first entry: the code was seen in a reference that was kept (see AddBarcode()).
+} Barcode_entry;
+
+typedef struct
+{
+	Barcode_entry* entries;
+	u32 num_entries;
+	u32 entries_capacity;
+	u32* slots; // First entry of each code, + 1 (0 = empty slot).
+	u32 num_codes;
+	u32 capacity;
+} Barcode_index;
+
+void GrowBarcodeIndex(Barcode_index* index)
+{
+	u32 capacity = index->capacity ? index->capacity * 2 : 4096;
+	u32* slots = (u32*)calloc(capacity, sizeof(u32));
+	if (!slots)
+	{
+		printf("Error: Out of memory indexing barcodes!\n");
+		exit (-1);
+	}
+	for (u32 slot = 0; slot < index->capacity; slot++)
+	{
+		u32 entry = index->slots[slot];
+		if (entry)
+		{
+			char* code = index->entries[entry - 1].code;
+			u32 new_slot = HashBytes((u8*)code, strlen(code)) & (capacity - 1);
+			while (slots[new_slot])
+			{
+				new_slot = (new_slot + 1) & (capacity - 1);
+			}
+			slots[new_slot] = entry;
+		}
+	}
+	free(index->slots);
+	index->slots = slots;
+	index->capacity = capacity;
+}
+
+u32 PushBarcodeEntry(Barcode_index* index, char* code, char* sku)
+{
+	if (index->num_entries == index->entries_capacity)
+	{
+		index->entries_capacity = index->entries_capacity ? index->entries_capacity * 2 : 4096;
+		Barcode_entry* entries = (Barcode_entry*)realloc(index->entries, index->entries_capacity * sizeof(Barcode_entry));
+		if (!entries)
+		{
+			printf("Error: Out of memory indexing barcodes!\n");
+			exit (-1);
+		}
+		index->entries = entries;
+	}
+	Barcode_entry* entry = &index->entries[index->num_entries];
+	strcpy_s(entry->code, sizeof(entry->code), code);
+	strcpy_s(entry->sku, sizeof(entry->sku), sku);
+	entry->next = 0;
+	entry->num_skus = 1;
+	entry->kept = false;
+	return ++index->num_entries;
+}
+
+// Records that the code belongs to the SKU (once, however often the SKU lists it). kept is whether this
+// reference is kept in the output, as the index holds every reference for the barcodes that are shared with
+// SKUs that --where leaves out.
+void AddBarcode(Barcode_index* index, char* code, char* sku, bool kept)
+{
+	if ((index->num_codes + 1) * 2 > index->capacity)
+	{
+		GrowBarcodeIndex(index);
+	}
+
+	u32 slot = HashBytes((u8*)code, strlen(code)) & (index->capacity - 1);
+	while (index->slots[slot])
+	{
+		u32 first = index->slots[slot];
+		if (strcmp(index->entries[first - 1].code, code) == 0)
+		{
+			index->entries[first - 1].kept |= kept;
+			u32 last = first;
+			for (u32 entry = first; entry; entry = index->entries[entry - 1].next)
+			{
+				if (strcmp(index->entries[entry - 1].sku, sku) == 0)
+				{
+					return;
+				}
+				last = entry;
+			}
+			u32 added = PushBarcodeEntry(index, code, sku); // May move the entries.
+			index->entries[added - 1].num_skus = 0;
+			index->entries[last - 1].next = added;
+			index->entries[first - 1].num_skus++;
+			return;
+		}
+		slot = (slot + 1) & (index->capacity - 1);
+	}
+
+	index->slots[slot] = PushBarcodeEntry(index, code, sku);
+	index->entries[index->slots[slot] - 1].kept = kept;
+	index->num_codes++;
+}
+
+void FreeBarcodeIndex(Barcode_index* index)
+{
+	free(index->entries);
+	free(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
+#endif
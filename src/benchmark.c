@@ -0,0 +1,456 @@
+#include <stdio.h>
+
+#include "platform.h"
+#include "utils.h"
+#include "timing.h"
+
+#define VERSION "2026-10-19"
+
+#define MAX_PATH_LENGTH 1024
+#define MAX_BASELINE_CASES 64
+
+typedef struct
+{
+	u32 num_records;
+	u32 num_runs;
+	double threshold; // Percent slower than the baseline that counts as a regression.
+	char* baseline_file_name;
+	char* save_file_name;
+	bool counters;
+} Program_options;
+
+/*	NOTES
+	=====
+
+	- Each case runs one of the tools on a report written by the generate tool, which is (re)generated in the work
+	  directory only when a report of that type and size is not already there.
+	- Tools are run as separate processes, exactly as they are used, and are expected to sit next to this program.
+	  Timings therefore include starting the process; use enough records (the default is plenty) that it does not matter.
+	- Each case is run several times and the fastest run is reported, which is the least noisy measure on a busy machine.
+	- Records are counted by the tool itself ("Processed a total of N ..."), so records/s is in the tool's own unit
+	  (i.e. references for crossreferences, invoices for invoices).
+	- Baselines are compared by MB/s, so a baseline taken with a different number of records is still meaningful.
+	- With --counters each tool counts cycles, instructions, branch and cache misses in each phase of its parse
+	  (see counters.h and timing.h) and prints them with --stats-json, which is where they are read from here.
+	  They are shown per MB of input, for the fastest run, so cases and tools of different sizes can be compared.
+*/
+
+typedef struct
+{
+	char* name;		// Shown in the results and used to match the baseline.
+	char* report;	// Report type given to the generate tool.
+	char* tool;
+	char* arguments; // Before the input and output files.
+} Benchmark_case;
+
+Benchmark_case benchmark_cases[] =
+{
+	{"classes",                "classes",  "classes",          ""},
+	{"classes -d",             "classes",  "classes",          "-d"},
+	{"classes -f",             "classes",  "classes",          "-f"},
+	{"crossreferences",        "xrefs",    "crossreferences",  ""},
+	{"crossreferences -d",     "xrefs",    "crossreferences",  "-d"},
+	{"crossreferences -f",     "xrefs",    "crossreferences",  "-f"},
+	{"customers account",      "account",  "customers",        "account"},
+	{"customers account -d",   "account",  "customers",        "-d account"},
+	{"customers account -f",   "account",  "customers",        "-f account"},
+	{"customers address",      "address",  "customers",        "address"},
+	{"customers address -d",   "address",  "customers",        "-d address"},
+	{"customers address -f",   "address",  "customers",        "-f address"},
+	{"customers memo",         "memo",     "customers",        "memo"},
+	{"customers memo -d",      "memo",     "customers",        "-d memo"},
+	{"customers memo -f",      "memo",     "customers",        "-f memo"},
+	{"producthistory",         "history",  "producthistory",   ""},
+	{"producthistory -d",      "history",  "producthistory",   "-d"},
+	{"producthistory -f",      "history",  "producthistory",   "-f"},
+	{"producthistory -r",      "history",  "producthistory",   "-r"},
+	{"invoices",               "invoices", "invoices",         ""},
+	{"invoices -d",            "invoices", "invoices",         "-d"},
+	{"invoices -f",            "invoices", "invoices",         "-f"},
+};
+
+#define NUM_BENCHMARK_CASES (sizeof(benchmark_cases) / sizeof(benchmark_cases[0]))
+
+typedef struct
+{
+	char name[64];
+	double megabytes_per_second;
+	double records_per_second;
+} Benchmark_result;
+
+typedef struct
+{
+	Benchmark_result results[MAX_BASELINE_CASES];
+	u32 count;
+} Benchmark_baseline;
+
+double GetSeconds(void)
+{
+	return TicksToSeconds(ReadTimer());
+}
+
+// Runs a command, returning the number after "Processed a total of" in its output (0 if there is none).
+// Returns -1 if the command could not be run or failed. If stats is given, the tool's --stats-json line is
+// copied into it.
+i64 RunTool(char* command, char* stats, size_t stats_size)
+{
+	FILE* pipe = OpenCommandPipe(command);
+	if (!pipe)
+	{
+		return -1;
+	}
+
+	i64 num_records = 0;
+	char line[4096];
+	while (fgets(line, sizeof(line), pipe))
+	{
+		char* processed = strstr(line, "Processed a total of ");
+		if (processed)
+		{
+			num_records = strtoll(processed + strlen("Processed a total of "), NULL, 10);
+		}
+		if (stats && strncmp(line, "{\"tool\"", 7) == 0)
+		{
+			strcpy_s(stats, stats_size, line);
+		}
+	}
+
+	return (CloseCommandPipe(pipe) == 0) ? num_records : -1;
+}
+
+// Returns the number after "key": in the part of a --stats-json line that starts at text and ends at the
+// first '}', or 0 if the key is not there.
+u64 StatsCount(char* text, char* key)
+{
+	char quoted_key[64];
+	sprintf_s(quoted_key, sizeof(quoted_key), "\"%s\": ", key);
+	char* found = strstr(text, quoted_key);
+	char* end = strchr(text, '}');
+	if (!found || (end && found > end))
+	{
+		return 0;
+	}
+	return strtoull(found + strlen(quoted_key), NULL, 10);
+}
+
+// Prints the counts in each phase per MB of input. Returns false if the tool did not report any.
+bool PrintCounters(char* stats, double megabytes)
+{
+	char* counters = strstr(stats, "\"counters\": {");
+	if (!counters)
+	{
+		return false;
+	}
+
+	u64 totals[counter_count] = {0};
+	for (u32 phase = 0; phase <= phase_count; phase++)
+	{
+		u64 counts[counter_count] = {0};
+		if (phase < phase_count)
+		{
+			char key[64];
+			sprintf_s(key, sizeof(key), "\"%s\": {", phase_json_names[phase]);
+			char* phase_counts = strstr(counters, key);
+			for (u32 counter = 0; phase_counts && counter < counter_count; counter++)
+			{
+				counts[counter] = StatsCount(phase_counts + strlen(key), counter_names[counter]);
+				totals[counter] += counts[counter];
+			}
+		}
+		else
+		{
+			memcpy(counts, totals, sizeof(counts));
+		}
+
+		double ipc = counts[counter_cycles] ? (double)counts[counter_instructions] / (double)counts[counter_cycles] : 0.0;
+		printf("  %-22s %12.0f %12.0f %6.2f %12.0f %12.0f %12.0f\n", (phase < phase_count) ? phase_names[phase] : "total",
+				counts[counter_cycles] / megabytes, counts[counter_instructions] / megabytes, ipc,
+				counts[counter_branch_misses] / megabytes, counts[counter_l1d_misses] / megabytes, counts[counter_llc_misses] / megabytes);
+	}
+	return true;
+}
+
+bool LoadBaseline(char* file_name, Benchmark_baseline* baseline)
+{
+	FILE* file;
+	if (fopen_s(&file, file_name, "r"))
+	{
+		return false;
+	}
+
+	char line[256];
+	fgets(line, sizeof(line), file); // Column headers.
+	while (fgets(line, sizeof(line), file) && baseline->count < MAX_BASELINE_CASES)
+	{
+		Benchmark_result* result = &baseline->results[baseline->count];
+		char* separator = strchr(line, '|');
+		if (!separator || (size_t)(separator - line) >= sizeof(result->name))
+		{
+			continue;
+		}
+		memcpy(result->name, line, separator - line);
+		result->name[separator - line] = '\0';
+		result->megabytes_per_second = strtod(separator + 1, &separator);
+		result->records_per_second = strtod(separator + 1, NULL);
+		baseline->count++;
+	}
+
+	fclose(file);
+	return true;
+}
+
+Benchmark_result* FindBaselineResult(Benchmark_baseline* baseline, char* name)
+{
+	for (u32 result = 0; result < baseline->count; result++)
+	{
+		if (strcmp(baseline->results[result].name, name) == 0)
+		{
+			return &baseline->results[result];
+		}
+	}
+	return NULL;
+}
+
+i32 RunBenchmarks(char* tool_directory, char* work_directory, Program_options options)
+{
+	Benchmark_baseline baseline = {0};
+	if (options.baseline_file_name && !LoadBaseline(options.baseline_file_name, &baseline))
+	{
+		printf("Could not open baseline file: %s\n", options.baseline_file_name);
+		return -1;
+	}
+
+	Benchmark_result results[NUM_BENCHMARK_CASES] = {0};
+	u32 num_results = 0;
+	u32 num_regressions = 0;
+	bool failed = false;
+
+	char output_file_name[MAX_PATH_LENGTH];
+	sprintf_s(output_file_name, sizeof(output_file_name), "%s/benchmark-output.tmp", work_directory);
+
+	printf("%-24s %9s %10s %9s %9s %12s %9s\n", "Case", "Input MB", "Records", "Seconds", "MB/s", "Records/s", "Baseline");
+	if (options.counters)
+	{
+		printf("  %-22s %12s %12s %6s %12s %12s %12s\n", "Per MB", "Cycles", "Instructions", "IPC", "Branch miss", "L1d miss", "LLC miss");
+	}
+
+	for (u32 case_index = 0; case_index < NUM_BENCHMARK_CASES; case_index++)
+	{
+		Benchmark_case* benchmark = &benchmark_cases[case_index];
+		char report_file_name[MAX_PATH_LENGTH];
+		char command[3 * MAX_PATH_LENGTH];
+
+		sprintf_s(report_file_name, sizeof(report_file_name), "%s/%s-%u.txt", work_directory, benchmark->report, options.num_records);
+		u64 report_size = GetFileSize64(report_file_name);
+		if (report_size == 0)
+		{
+			sprintf_s(command, sizeof(command), "\"%sgenerate\" %s %u \"%s\"", tool_directory, benchmark->report, options.num_records, report_file_name);
+			if (RunTool(command, NULL, 0) < 0 || (report_size = GetFileSize64(report_file_name)) == 0)
+			{
+				printf("Could not generate report: %s\n", report_file_name);
+				return -1;
+			}
+		}
+
+		// The tools' progress would otherwise be drawn over the benchmark's own output.
+		sprintf_s(command, sizeof(command), "\"%s%s\" --no-progress %s %s \"%s\" \"%s\"",
+				tool_directory, benchmark->tool, options.counters ? "--stats-json --counters" : "",
+				benchmark->arguments, report_file_name, output_file_name);
+
+		double best_seconds = 0.0;
+		i64 num_records = 0;
+		char stats[4096] = "";
+		for (u32 run = 0; run < options.num_runs; run++)
+		{
+			char run_stats[4096] = "";
+			double start = GetSeconds();
+			num_records = RunTool(command, run_stats, sizeof(run_stats));
+			double seconds = GetSeconds() - start;
+			if (num_records < 0)
+			{
+				break;
+			}
+			if (run == 0 || seconds < best_seconds)
+			{
+				best_seconds = seconds;
+				strcpy_s(stats, sizeof(stats), run_stats);
+			}
+		}
+		if (num_records < 0)
+		{
+			printf("%-24s failed: %s\n", benchmark->name, command);
+			failed = true;
+			continue;
+		}
+
+		Benchmark_result* result = &results[num_results++];
+		strcpy_s(result->name, sizeof(result->name), benchmark->name);
+		double megabytes = (double)report_size / (1024.0 * 1024.0);
+		result->megabytes_per_second = megabytes / best_seconds;
+		result->records_per_second = (double)num_records / best_seconds;
+
+		char comparison[32] = "";
+		Benchmark_result* baseline_result = FindBaselineResult(&baseline, benchmark->name);
+		if (baseline_result && baseline_result->megabytes_per_second > 0.0)
+		{
+			double change = 100.0 * (result->megabytes_per_second / baseline_result->megabytes_per_second - 1.0);
+			bool regression = change < -options.threshold;
+			sprintf_s(comparison, sizeof(comparison), "%+8.1f%%%s", change, regression ? " REGRESSION" : "");
+			num_regressions += regression;
+		}
+
+		printf("%-24s %9.1f %10lld %9.3f %9.1f %12.0f %s\n",
+				benchmark->name, megabytes, (long long)num_records, best_seconds,
+				result->megabytes_per_second, result->records_per_second, comparison);
+
+		if (options.counters && !PrintCounters(stats, megabytes))
+		{
+			printf("Hardware performance counters are not available.\n");
+			options.counters = false;
+		}
+	}
+
+	remove(output_file_name);
+
+	if (options.save_file_name)
+	{
+		FILE* file;
+		if (fopen_s(&file, options.save_file_name, "w"))
+		{
+			printf("Could not create baseline file: %s\n", options.save_file_name);
+			return -1;
+		}
+		fprintf(file, "Case|MB/s|Records/s\n");
+		for (u32 result = 0; result < num_results; result++)
+		{
+			fprintf(file, "%s|%.3f|%.1f\n", results[result].name, results[result].megabytes_per_second, results[result].records_per_second);
+		}
+		fclose(file);
+		printf("Baseline saved to %s.\n", options.save_file_name);
+	}
+
+	if (options.baseline_file_name)
+	{
+		printf("%u of %u cases are more than %.1f%% slower than the baseline.\n", num_regressions, num_results, options.threshold);
+	}
+
+	return (failed || num_regressions) ? 1 : 0;
+}
+
+#define USAGE_STRING "\
+%s %s\n\
+John Hosick <john@atikokancastle.com>\n\n\
+%s measures the throughput (MB/s and records/s) of every parsing tool, in each of its output\n\
+modes, on synthetic reports written by the generate tool, and compares it with a saved baseline.\n\
+The tools must be in the same directory as %s.\n\n\
+USAGE: %s [OPTIONS] <workdirectory>\n\
+  OPTIONS:\n\
+    -b, --baseline <file>   Compare with a baseline saved earlier. Exits with 1 if any case regressed.\n\
+    -c, --counters          Also show the cycles, instructions, branch and cache misses per MB in each\n\
+                            phase of every case (Linux only). Counting slows the tools down a little.\n\
+    -h, --help              Show this help message.\n\
+    -n, --runs <n>          Run each case n times and report the fastest (default 3).\n\
+    -r, --records <n>       Number of records in each generated report (default 1000000).\n\
+    -s, --save <file>       Save the results as a baseline.\n\
+    -t, --threshold <n>     Percent slower than the baseline that counts as a regression (default 5).\n"
+
+void PrintUsageAndExit(char *program_name)
+{
+	printf(USAGE_STRING, program_name, VERSION, program_name, program_name, program_name);
+	exit (0);
+}
+
+int main(int argc, char *argv[])
+{
+	char* program_name = argv[0];
+	char* work_directory = {0};
+
+	Program_options options = {0};
+	options.num_records = 1000000;
+	options.num_runs = 3;
+	options.threshold = 5.0;
+
+	for (i32 arg = 1; arg < argc; arg++)
+	{
+		char c1 = argv[arg][0];
+		char c2 = argv[arg][1];
+		if (c1 == '-')
+		{
+			char* option = (c2 == '-') ? &argv[arg][2] : &argv[arg][1];
+			if ((strcmp(option, "help") == 0) || (strcmp(option, "h") == 0))
+			{
+				PrintUsageAndExit(program_name);
+			}
+
+			if ((strcmp(option, "counters") == 0) || (strcmp(option, "c") == 0))
+			{
+				options.counters = true;
+				continue;
+			}
+
+			// Every other option takes a value.
+			if (arg + 1 == argc)
+			{
+				printf("%s: No value given for '%s'. Use -h or --help for more details.\n", program_name, option);
+				return -1;
+			}
+			char* value = argv[++arg];
+
+			if ((strcmp(option, "baseline") == 0) || (strcmp(option, "b") == 0))
+			{
+				options.baseline_file_name = value;
+			}
+			else if ((strcmp(option, "runs") == 0) || (strcmp(option, "n") == 0))
+			{
+				options.num_runs = MIN((u32)atoi(value), 100);
+			}
+			else if ((strcmp(option, "records") == 0) || (strcmp(option, "r") == 0))
+			{
+				options.num_records = (u32)strtoul(value, NULL, 10);
+			}
+			else if ((strcmp(option, "save") == 0) || (strcmp(option, "s") == 0))
+			{
+				options.save_file_name = value;
+			}
+			else if ((strcmp(option, "threshold") == 0) || (strcmp(option, "t") == 0))
+			{
+				options.threshold = atof(value);
+			}
+			else
+			{
+				printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
+				return -1;
+			}
+			continue;
+		}
+		work_directory = argv[arg];
+		break; // No point in processing any additional arguments.
+	}
+
+	if (!work_directory)
+	{
+		printf("%s: Work directory not specified. Use -h or --help for more details.\n", program_name);
+		return -1;
+	}
+	if (options.num_runs == 0 || options.num_records == 0)
+	{
+		printf("%s: The number of runs and records must be at least 1.\n", program_name);
+		return -1;
+	}
+
+	// The tools live next to this program.
+	char tool_directory[MAX_PATH_LENGTH] = {0};
+	char* last_separator = strrchr(program_name, '\\');
+	char* last_slash = strrchr(program_name, '/');
+	if (!last_separator || (last_slash && last_slash > last_separator))
+	{
+		last_separator = last_slash;
+	}
+	if (last_separator && (size_t)(last_separator - program_name + 1) < sizeof(tool_directory))
+	{
+		memcpy(tool_directory, program_name, last_separator - program_name + 1);
+	}
+
+	MakeDirectory(work_directory); // Fails harmlessly if it already exists.
+	return RunBenchmarks(tool_directory, work_directory, options);
+}
@@ -1,20 +1,50 @@
-#include <windows.h>
 #include <stdio.h>
 
+#include "platform.h"
 #include "utils.h"
+#include "arena.h"
+#include "encoding.h"
+#include "arrow.h"
+#include "layout.h"
+#include "timing.h"
+#include "progress.h"
+#include "sniff.h"
+#include "serve.h"
+#include "anomaly.h"
+#include "reconcile.h"
+#include "columns.h"
+#include "filter.h"
+#include "sort.h"
 
-#define VERSION "2024-11-18"
+#define VERSION "2026-10-19"
 
 typedef struct Program_options
 {
 	bool print_to_screen;
 	bool debug_output;
+	bool feather_output;
+	bool print_stats;
+	bool stats_json;
+	bool no_progress;
+	bool allow_missing_totals;
+	bool counters;
+	bool fixed_layout;
+	Code_page code_page;
+	struct Anomaly_log* anomalies; // Checks the record lines as they are parsed (only counting them without -a).
+	struct Column_selection* columns; // Chosen with --columns; NULL for the usual output.
+	u64 fields; // The fields of the report to read, FIELD(Class_field) (see columns.h).
+	struct Record_filter* filter; // Given with --where; NULL to write every class.
 } Program_options;
 
 typedef struct Report_summary
 {
 	u32 num_classes;
 	u32 num_pages;
+	u32 num_left_out; // Of num_classes, by --where.
+	Footer_total report_total; // Of the classes, from the line after the rule at the end of the report.
+	Report_layout layout;
+	Phase_timings timings;
+	Progress* progress;
 } Report_summary;
 
 typedef struct Class
@@ -25,7 +55,153 @@ typedef struct Class
 	char history_by_class;
 } Class;
 
-void ParseClasses(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+typedef struct Class_batch
+{
+	Class* classes;
+	u32 count;
+} Class_batch;
+
+typedef enum
+{
+	class_id,
+	class_description,
+	class_history_periods,
+	class_field_count
+} Class_field;
+
+// The fields of a class line, checked as they are parsed (see anomaly.h) and compared by --where (see
+// filter.h). They start where the report's layout puts them.
+Field_check class_fields[class_field_count] =
+{
+	{"Class", 0, 4, field_code},
+	{"Description", 0, 32, field_text},
+	{"History Periods", 0, 2, field_number},
+};
+
+Layout_field class_layout[class_field_count] =
+{
+	{"Class", "CLASS", 18, 4, false},
+	{"Description", "DESCRIPTION", 25, 32, false},
+	{"History Periods", "PER", 57, 2, true},
+};
+
+typedef enum
+{
+	class_column_id,
+	class_column_description,
+	class_column_history_periods,
+	class_column_history_by_class,
+	class_column_count
+} Class_column;
+
+Output_column class_columns[class_column_count] =
+{
+	{"Class", arrow_dictionary, FIELD(class_id)},
+	{"Description", arrow_utf8, FIELD(class_description)},
+	{"History Periods", arrow_int32, FIELD(class_history_periods)},
+	{"History By Class", arrow_utf8, 0}, // The last character of the line.
+};
+
+char class_headings[] = "Class|Description"; // Of the usual output.
+
+void AddClassColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < class_column_count; column++)
+	{
+		ArrowAddColumn(arrow, class_columns[column].name, class_columns[column].type);
+	}
+}
+
+// The text of a column of the class, in buffer unless it is a field as it is.
+char* ClassColumnText(Class* class, Class_column column, char* buffer, size_t size)
+{
+	switch (column)
+	{
+		case class_column_id:				return class->class_id;
+		case class_column_description:		return class->description;
+		case class_column_history_periods:	sprintf_s(buffer, size, "%d", class->history_periods); return buffer;
+		case class_column_history_by_class:	sprintf_s(buffer, size, "%c", class->history_by_class); return buffer;
+		default:							return "";
+	}
+}
+
+void WriteSelectedClasses(Class_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	Column_selection* selection = options.columns;
+	for (u32 class_index = 0; class_index < batch->count; class_index++)
+	{
+		char row[SELECTED_ROW_SIZE];
+		size_t row_length = 0;
+		for (u32 position = 0; position < selection->num_selected; position++)
+		{
+			char buffer[64];
+			char* text = ClassColumnText(&batch->classes[class_index], (Class_column)selection->selected[position], buffer, sizeof(buffer));
+			PutSelectedColumn(selection, position, text, row, sizeof(row), &row_length, arrow);
+		}
+		WriteSelectedRow(row, output_file, options.print_to_screen, options.code_page);
+	}
+	if (arrow)
+	{
+		ArrowWriteBatch(arrow);
+	}
+}
+
+void WriteClasses(Class_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.columns)
+	{
+		WriteSelectedClasses(batch, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		for (u32 class_index = 0; class_index < batch->count; class_index++)
+		{
+			Class* class = &batch->classes[class_index];
+			char history_by_class[2] = {class->history_by_class, '\0'};
+			ArrowAppendText(&arrow->columns[0], class->class_id);
+			ArrowAppendText(&arrow->columns[1], class->description);
+			ArrowAppendInt32(&arrow->columns[2], class->history_periods);
+			ArrowAppendText(&arrow->columns[3], history_by_class);
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	for (u32 class_index = 0; class_index < batch->count; class_index++)
+	{
+		Class* class = &batch->classes[class_index];
+
+		char buffer[256] = {0};
+		if (options.debug_output)
+		{
+			sprintf_s(buffer, sizeof(buffer),
+			   	"                  %-4s   %-30s  %-2d              %c\n",
+			   	class->class_id,
+			   	class->description,
+			   	class->history_periods,
+			   	class->history_by_class
+			   	);
+		}
+		else
+		{
+			sprintf_s(buffer, sizeof(buffer), "%s|%s\n", class->class_id, class->description);
+		}
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+void ParseClasses(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
@@ -33,12 +209,39 @@ void ParseClasses(char* data, FILE* output_file, Program_options options, Report
 	i32 page_header_line	= 8;
 
 	char history_period_text[4] = {0};
-	Class class = {0};
-	Class class_reset = {0};
 
-	if (output_file && !options.debug_output)
+	u32 column[class_field_count];
+	InferLayout(&summary->layout, class_layout, class_field_count, data, 7, NULL);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
+
+	Field_check fields[class_field_count];
+	for (u32 field = 0; field < class_field_count; field++)
+	{
+		fields[field] = class_fields[field];
+		fields[field].start = column[field];
+	}
+	Line_check check; // A class line must reach its history periods.
+	CompileLineCheck(&check, fields, ArrayCount(fields), column[class_history_periods] + 2);
+
+	Memory_arena arena = AllocateArena(RECORD_BATCH_SIZE * sizeof(Class));
+	Class_batch batch = {0};
+	batch.classes = PushArray(&arena, RECORD_BATCH_SIZE, Class);
+
+	if (output_file && options.columns)
+	{
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
+	{
+		fprintf(output_file, "%s\n", class_headings);
+	}
+	if (arrow && options.columns)
 	{
-		fprintf(output_file, "Class|Description\n");
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddClassColumns(arrow);
 	}
 
 	while (data[index])
@@ -53,6 +256,7 @@ void ParseClasses(char* data, FILE* output_file, Program_options options, Report
 			if (line_position == 0)
 			{
 				// loop over header lines
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && page_header_line > 0) // data[index] != '\0' is necessary in the case the report ends with a header.
 				{
 					if (data[index] == '\n')
@@ -62,64 +266,73 @@ void ParseClasses(char* data, FILE* output_file, Program_options options, Report
 					index++;
 				}
 				page_header_line = 8;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_classes);
 				summary->num_pages++;
 				continue;
 			}
 
 			line_start_index = index - line_position;
+			char* line = &data[line_start_index];
 
 			if (data[index - 1] == '-') // @HACK: Reached the end of the report
 			{
+				summary->report_total = ReadFooterTotal(NextFooterLine(line), total_count);
 				break;
 			}
-			size_t class_char_length = FillTextFieldAndTrim(class.class_id, &data[line_start_index + 18], 4);
-			if (class_char_length != 1) // (zero characters + \0)
+
+			Class* class = &batch.classes[batch.count];
+			size_t class_char_length = FillLineField(class->class_id, line, line_position, column[class_id], 4);
+			if (class_char_length > 1) // (zero characters + \0)
 			{
-				FillTextFieldAndTrim(class.description, &data[line_start_index + 25], 32);
-				FillTextFieldAndTrim(history_period_text, &data[line_start_index + 57], 2);
-				class.history_periods = atoi(history_period_text);
-				class.history_by_class = data[index - 1];
+				CheckRecordLine(options.anomalies, line, line_position, &check);
+				if (options.filter && !FilterLine(options.filter, 0, fields, line, line_position))
+				{
+					summary->num_classes++; // Counted, but not written.
+					summary->num_left_out++;
+					line_position = 0;
+					index++;
+					continue;
+				}
+
+				if (options.fields & FIELD(class_description))
+				{
+					FillLineField(class->description, line, line_position, column[class_description], 32);
+				}
+				if (options.fields & FIELD(class_history_periods))
+				{
+					FillLineField(history_period_text, line, line_position, column[class_history_periods], 2);
+					class->history_periods = atoi(history_period_text);
+				}
+				class->history_by_class = data[index - 1];
 			}
-			else // Must be a class 'header'.
+			else // Must be a class 'header'. Nothing but the (empty) class id was written, so the slot can be reused.
 			{
-				class = class_reset;
 				line_position = 0;
 				index++;
 				continue;
 			}
 
-			char buffer[256] = {0};
-			if (options.debug_output)
-			{
-				sprintf_s(buffer, sizeof(buffer),
-				   	"                  %-4s   %-30s  %-2d              %c\n",
-				   	class.class_id,
-				   	class.description,
-				   	class.history_periods,
-				   	class.history_by_class
-				   	);
-			}
-			else
-			{
-				sprintf_s(buffer, sizeof(buffer), "%s|%s\n", class.class_id, class.description);
-			}
-
-			if (output_file)
-			{
-				fprintf(output_file, "%s", buffer);
-			}
-			if (options.print_to_screen)
+			summary->num_classes++;
+			if (++batch.count == RECORD_BATCH_SIZE)
 			{
-				printf("%s", buffer);
+				Phase_start format_start = BeginPhase(&summary->timings);
+				WriteClasses(&batch, output_file, arrow, options);
+				EndPhase(&summary->timings, phase_format, format_start);
+				ResetArena(&arena);
+				batch.classes = PushArray(&arena, RECORD_BATCH_SIZE, Class);
+				batch.count = 0;
 			}
 
-			class = class_reset;
-			summary->num_classes++;
-
 			line_position = 0;
 			index++;
 		}
 	}
+
+	Phase_start format_start = BeginPhase(&summary->timings);
+	WriteClasses(&batch, output_file, arrow, options);
+	EndPhase(&summary->timings, phase_format, format_start);
+	FreeArena(&arena);
 }
 
 #define USAGE_STRING "\
@@ -129,11 +342,47 @@ John Hosick <john@atikokancastle.com>\n\n\
 pipe-delimited file for use in the conversion to CashierPRO.\n\n\
 USAGE: %s [OPTIONS] <inputfile> [outputfile]\n\
   OPTIONS:\n\
+    -a, --anomalies <file>\n\
+                    Write the fields that do not look like what they should hold (a letter\n\
+                    in an amount, a line cut short, ...) to the file, with their line numbers.\n\
     -d, --debug     Dump output in original format (to check the correctness of the parse).\n\
+    -e, --encoding <code page>\n\
+                    Convert text from the report's code page (cp437, cp1252 or latin1)\n\
+                    to UTF-8. Without it, text is written exactly as it was read, except\n\
+                    in Feather files, which must be UTF-8 and take it to be cp1252.\n\
+    -f, --feather   Write the output file in Arrow IPC (Feather v2) format instead.\n\
     -h, --help      Show this help message.\n\
     -p, --print     Print to the screen. Note: This option does not preclude\n\
                     outputting to a file: If an output file is specified,\n\
-                    it will be created as well as displayed on the screen.\n"
+                    it will be created as well as displayed on the screen.\n\
+    -s, --stats     Show the time spent in each phase of the parse.\n\
+        --stats-json\n\
+                    Also print the throughput and phase times as a line of JSON.\n\
+        --counters  Count cycles, instructions, branch and cache misses in each phase\n\
+                    (Linux only) and add them to the statistics.\n\
+        --no-progress\n\
+                    Do not show the progress of a long parse on the console.\n\
+        --allow-missing-totals\n\
+                    Do not fail if the report has no totals at its end to check the parse\n\
+                    against (reports from old versions of ProfitMaster).\n\
+        --fixed-layout\n\
+                    Parse with the built-in column layout even if the report's headings\n\
+                    and data show that its columns have moved.\n\
+        --columns <names>\n\
+                    Write only these columns, in this order (names of the Feather columns,\n\
+                    separated by commas), reading only the fields of the report they need.\n\
+        --where <filter>\n\
+                    Write only the classes that match the filter, e.g. \"history_periods > 0\n\
+                    and class >= 1000\" (see the instructions for what a filter can be).\n\
+        --sort-by <columns>\n\
+                    Sort the output file by these columns (separated by commas, each with\n\
+                    \" desc\" after it to sort it descending) instead of in report order.\n\
+        --sort-memory <megabytes>\n\
+                    The most memory --sort-by may use (default 256); a bigger output is\n\
+                    sorted in runs that are merged from disk.\n\
+        --serve <socket>\n\
+                    Keep running, and convert the reports asked for over the Unix domain\n\
+                    socket (Linux only). Any other arguments are ignored.\n"
 
 void PrintUsageAndExit(char *program_name)
 {
@@ -146,6 +395,11 @@ int main(int argc, char *argv[])
 	char* program_name = argv[0];
 	char* file_input_name = {0};
 	char* file_output_name = {0};
+	char* file_anomalies_name = {0};
+	char* column_names = {0};
+	char* filter_text = {0};
+	char* sort_text = {0};
+	u32 sort_megabytes = SORT_DEFAULT_MEGABYTES;
 
 	Program_options options = {0};
 
@@ -176,6 +430,96 @@ int main(int argc, char *argv[])
 				{
 					options.debug_output = true;
 				}
+				else if (strcmp(option, "feather") == 0)
+				{
+					options.feather_output = true;
+				}
+				else if (strcmp(option, "stats") == 0)
+				{
+					options.print_stats = true;
+				}
+				else if (strcmp(option, "stats-json") == 0)
+				{
+					options.stats_json = true;
+				}
+				else if (strcmp(option, "no-progress") == 0)
+				{
+					options.no_progress = true;
+				}
+				else if (strcmp(option, "allow-missing-totals") == 0)
+				{
+					options.allow_missing_totals = true;
+				}
+				else if (strcmp(option, "counters") == 0)
+				{
+					options.counters = true;
+				}
+				else if (strcmp(option, "fixed-layout") == 0)
+				{
+					options.fixed_layout = true;
+				}
+				else if (strcmp(option, "encoding") == 0)
+				{
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: --encoding must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "columns") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --columns must be followed by the names of the columns to write, separated by commas.\n", program_name);
+						return -1;
+					}
+					column_names = argv[++arg];
+				}
+				else if (strcmp(option, "where") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --where must be followed by a filter, e.g. \"class = 1000\".\n", program_name);
+						return -1;
+					}
+					filter_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-by") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --sort-by must be followed by the names of the columns to sort by, separated by commas.\n", program_name);
+						return -1;
+					}
+					sort_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-memory") == 0)
+				{
+					sort_megabytes = (arg + 1 == argc) ? 0 : (u32)strtoul(argv[++arg], NULL, 10);
+					if (sort_megabytes < 1 || sort_megabytes > SORT_MAX_MEGABYTES)
+					{
+						printf("%s: --sort-memory must be followed by a number of megabytes, from 1 to %d.\n", program_name, SORT_MAX_MEGABYTES);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "anomalies") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --anomalies must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+				}
+				else if (strcmp(option, "serve") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --serve must be followed by the path of the socket to listen on.\n", program_name);
+						return -1;
+					}
+					return ServeRequests(program_name, argv[arg + 1], main, NULL); // Each request is run by main() itself.
+				}
 				else
 				{
 					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
@@ -193,6 +537,14 @@ int main(int argc, char *argv[])
 
 				switch (c2)
 				{
+				case 'a':
+					if (arg + 1 == argc)
+					{
+						printf("%s: -a must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+					break;
 				case 'h':
 					PrintUsageAndExit(program_name);
 				case 'p':
@@ -201,6 +553,19 @@ int main(int argc, char *argv[])
 				case 'd':
 					options.debug_output = true;
 					break;
+				case 'e':
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: -e must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+					break;
+				case 'f':
+					options.feather_output = true;
+					break;
+				case 's':
+					options.print_stats = true;
+					break;
 				default:
 					printf("%s: Invalid argument '%c'. Use -h or --help for more details.\n", program_name, c2);
 					return -1;
@@ -230,16 +595,121 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (!file_output_name && options.feather_output)
+	{
+		printf("Feather output requires an output file.\n");
+		return -1;
+	}
+
+	Column_selection selection;
+	options.fields = ALL_FIELDS;
+	if (column_names)
+	{
+		if (options.debug_output)
+		{
+			printf("--columns cannot be used with -d.\n");
+			return -1;
+		}
+		if (!SelectColumns(&selection, class_columns, class_column_count, column_names, program_name))
+		{
+			return -1;
+		}
+		options.columns = &selection;
+		options.fields = selection.fields | FIELD(class_id); // The id tells a class from a heading.
+	}
+
+	Record_filter filter;
+	if (filter_text)
+	{
+		Filter_table tables[] = {{class_fields, class_field_count}};
+		if (!CompileFilter(&filter, filter_text, tables, ArrayCount(tables), class_columns, class_column_count, NULL, 0, program_name))
+		{
+			return -1;
+		}
+		options.filter = &filter;
+	}
+
+	Sort_order sort_order;
+	if (sort_text)
+	{
+		if (options.debug_output || options.feather_output || options.print_to_screen || !file_output_name)
+		{
+			printf("--sort-by sorts the output file, so it needs one, and cannot be used with -d, -f or -p.\n");
+			return -1;
+		}
+		char headings[COLUMN_HEADINGS_SIZE];
+		if (options.columns)
+		{
+			FormatSelectedHeadings(options.columns, headings, sizeof(headings));
+		}
+		else
+		{
+			strcpy_s(headings, sizeof(headings), class_headings);
+		}
+		if (!CompileSortOrder(&sort_order, sort_text, class_columns, class_column_count, headings, sort_megabytes, program_name))
+		{
+			return -1;
+		}
+	}
+
+	if (!CheckReportKind(program_name, file_input_name, report_classes))
+	{
+		return -1;
+	}
+
+	FILE* anomaly_file = NULL;
+	if (file_anomalies_name && fopen_s(&anomaly_file, file_anomalies_name, "w"))
+	{
+		printf("Could not create anomalies file: %s\n", file_anomalies_name);
+		return -1;
+	}
+
+	Report_summary summary = {0};
+	if (options.counters && !OpenPerfCounters(&summary.timings.counters))
+	{
+		printf("Hardware performance counters are not available.\n");
+	}
+
+	Phase_start read_start = BeginPhase(&summary.timings);
 	char* data = ReadEntireFile(file_input_name);
 	if (!data)
 	{
 		printf("Could not open input file: %s\n", file_input_name);
 		return -1;
 	}
+	summary.timings.input_bytes = GetFileSize64(file_input_name);
+	EndPhase(&summary.timings, phase_read, read_start);
 
-	Report_summary summary = {0};
+	Anomaly_log anomalies;
+	StartAnomalyLog(&anomalies, data, anomaly_file, file_anomalies_name, options.code_page);
+	options.anomalies = &anomalies;
 
-	if (file_output_name)
+	// Progress goes to stderr and would be mixed in with the records printed to the screen.
+	Progress progress;
+	if (!options.no_progress && !options.print_to_screen && StderrIsConsole() && StartProgress(&progress, summary.timings.input_bytes))
+	{
+		summary.progress = &progress;
+	}
+
+	if (file_output_name && options.feather_output)
+	{
+		Arrow_writer arrow;
+		if (!ArrowOpen(&arrow, file_output_name))
+		{
+			printf("Could not create output file: %s\n", file_output_name);
+			return -1;
+		}
+		arrow.code_page = options.code_page;
+
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseClasses(data, NULL, &arrow, options, &summary);
+		EndParse(&summary.timings, parse_start);
+
+		Phase_start flush_start = BeginPhase(&summary.timings);
+		ArrowClose(&arrow);
+		EndPhase(&summary.timings, phase_flush, flush_start);
+	}
+	else if (file_output_name)
 	{
 		FILE* stream_output;
 		errno_t error;
@@ -251,19 +721,55 @@ int main(int argc, char *argv[])
 			return -1;
 		}
 
-		ParseClasses(data, stream_output, options, &summary);
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseClasses(data, stream_output, NULL, options, &summary);
+		EndParse(&summary.timings, parse_start);
+
+		Phase_start flush_start = BeginPhase(&summary.timings);
 		fclose(stream_output);
+		EndPhase(&summary.timings, phase_flush, flush_start);
 	}
 	else
 	{
-		ParseClasses(data, NULL, options, &summary);
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseClasses(data, NULL, NULL, options, &summary);
+		EndParse(&summary.timings, parse_start);
 	}
 
+	if (summary.progress)
+	{
+		StopProgress(summary.progress);
+	}
+	FreeFileMemory(data);
+
 	printf("Processed a total of %d classes (%d pages).\n", summary.num_classes, summary.num_pages);
+	if (options.filter)
+	{
+		printf("Left out %d of them that did not match --where.\n", summary.num_left_out);
+	}
+	bool reconciled = ReconcileTotal(summary.report_total, "number of classes", summary.num_classes, options.allow_missing_totals);
+	bool sorted = true;
+	if (sort_text)
+	{
+		Phase_start sort_start = BeginPhase(&summary.timings);
+		sorted = SortOutputFile(&sort_order, file_output_name, program_name);
+		EndPhase(&summary.timings, phase_sort, sort_start);
+	}
 	if (file_output_name)
 	{
 		printf("Output dumped to %s.\n", file_output_name);
 	}
+	PrintLayoutDrift(&summary.layout, options.fixed_layout);
+	PrintAnomalies(&anomalies);
+	if (anomaly_file)
+	{
+		fclose(anomaly_file);
+	}
+	PrintTimings(&summary.timings, summary.num_classes, options.print_stats);
+	if (options.stats_json)
+	{
+		PrintTimingsJson(&summary.timings, "classes", summary.num_classes, summary.num_pages);
+	}
 
-	return 0;
+	return (reconciled && sorted) ? 0 : -1;
 }
@@ -0,0 +1,208 @@
+#ifndef COLUMNS
+#define COLUMNS
+
+#include "arrow.h"
+
+/*	NOTES
+	=====
+
+	--columns chooses the columns of the output by name, in the order they are given, instead of the tool's
+	usual pipe-delimited columns: e.g. --columns "Cust ID,Current Balance". The names are those of the tool's
+	Feather columns (every column it can write, not just the few of the usual output; an unknown name gets
+	them listed), matched without regard to case. With -f the Feather file has just the chosen columns, with
+	their usual types.
+
+	The parse is planned from the chosen columns. Each column names the fields of the report it is made from,
+	as FIELD() bits of the tool's own field enum, and the parser only trims, copies and converts the fields in
+	selection.fields, so a narrow export costs little more than finding the lines. The fields that the parse
+	needs for itself are read whatever is chosen: those that tell a record from a heading, and those that
+	are reconciled with the report's totals (see reconcile.h).
+*/
+
+#define MAX_SELECTED_COLUMNS 64
+#define SELECTED_ROW_SIZE 1024
+#define COLUMN_HEADINGS_SIZE 4096
+#define FIELD(field) (1ull << (field))
+#define ALL_FIELDS (~0ull)
+
+typedef struct Output_column
+{
+	char* name; // As in the Feather output.
+	Arrow_type type;
+	u64 fields; // The report fields the column is made from.
+} Output_column;
+
+typedef struct Column_selection
+{
+	Output_column* columns; // All the tool's columns.
+	u32 selected[MAX_SELECTED_COLUMNS]; // Indices into columns, in output order.
+	u32 num_selected;
+	u64 fields; // Those needed by the selected columns.
+} Column_selection;
+
+bool ColumnNameMatches(char* name, char* text, size_t length)
+{
+	if (strlen(name) != length)
+	{
+		return false;
+	}
+	for (size_t index = 0; index < length; index++)
+	{
+		if (tolower((unsigned char)name[index]) != tolower((unsigned char)text[index]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Chooses the columns named in list (separated by commas). Prints what is wrong and returns false if a name is
+// not one of the tool's columns.
+bool SelectColumns(Column_selection* selection, Output_column* columns, u32 num_columns, char* list, char* program_name)
+{
+	memset(selection, 0, sizeof(*selection));
+	selection->columns = columns;
+
+	char* name = list;
+	while (*name)
+	{
+		char* end = strchr(name, ',');
+		char* next = end ? end + 1 : name + strlen(name);
+		end = end ? end : next;
+		while (name < end && *name == ' ')
+		{
+			name++;
+		}
+		while (end > name && end[-1] == ' ')
+		{
+			end--;
+		}
+
+		u32 column = 0;
+		while (column < num_columns && !ColumnNameMatches(columns[column].name, name, (size_t)(end - name)))
+		{
+			column++;
+		}
+		if (column < num_columns && selection->num_selected == MAX_SELECTED_COLUMNS)
+		{
+			printf("%s: --columns can choose at most %d columns.\n", program_name, MAX_SELECTED_COLUMNS);
+			return false;
+		}
+		if (column == num_columns)
+		{
+			printf("%s: Unknown column '%.*s'. The columns are:", program_name, (int)(end - name), name);
+			for (column = 0; column < num_columns; column++)
+			{
+				printf("%s %s", column ? "," : "", columns[column].name);
+			}
+			printf(".\n");
+			return false;
+		}
+		selection->selected[selection->num_selected++] = column;
+		selection->fields |= columns[column].fields;
+		name = next;
+	}
+
+	if (selection->num_selected == 0)
+	{
+		printf("%s: --columns must be followed by the names of the columns to write, separated by commas.\n", program_name);
+		return false;
+	}
+	return true;
+}
+
+// The headings of the selected columns, separated by '|' as in the output, without a line ending.
+void FormatSelectedHeadings(Column_selection* selection, char* headings, size_t size)
+{
+	size_t length = 0;
+	headings[0] = '\0';
+	for (u32 position = 0; position < selection->num_selected && length < size; position++)
+	{
+		length += sprintf_s(headings + length, size - length, "%s%s", position ? "|" : "", selection->columns[selection->selected[position]].name);
+	}
+}
+
+void WriteSelectedHeadings(Column_selection* selection, FILE* output_file)
+{
+	char headings[COLUMN_HEADINGS_SIZE];
+	FormatSelectedHeadings(selection, headings, sizeof(headings));
+	fprintf(output_file, "%s\n", headings);
+}
+
+void AddSelectedColumns(Column_selection* selection, Arrow_writer* arrow)
+{
+	for (u32 position = 0; position < selection->num_selected; position++)
+	{
+		Output_column* column = &selection->columns[selection->selected[position]];
+		ArrowAddColumn(arrow, column->name, column->type);
+	}
+}
+
+// Adds the text of the selected column at position to the pipe-delimited row, and to its Feather column
+// converted to the column's type.
+void PutSelectedColumn(Column_selection* selection, u32 position, char* text, char* row, size_t row_size, size_t* row_length, Arrow_writer* arrow)
+{
+	if (*row_length < row_size)
+	{
+		int written = snprintf(row + *row_length, row_size - *row_length, "%s%s", position ? "|" : "", text);
+		*row_length = MIN(*row_length + (size_t)MAX(written, 0), row_size - 1);
+	}
+
+	if (arrow)
+	{
+		Arrow_column* column = &arrow->columns[position];
+		switch (selection->columns[selection->selected[position]].type)
+		{
+			case arrow_int32:
+			{
+				if (text[0] == '\0')
+				{
+					ArrowAppendNull(column);
+				}
+				else
+				{
+					ArrowAppendInt32(column, atoi(text));
+				}
+			} break;
+			case arrow_int64:
+			{
+				ArrowAppendMoney(column, text); // Only amounts are int64.
+			} break;
+			case arrow_float32:
+			{
+				if (text[0] == '\0')
+				{
+					ArrowAppendNull(column);
+				}
+				else
+				{
+					ArrowAppendFloat32(column, strtof(text, NULL));
+				}
+			} break;
+			case arrow_date32:
+			{
+				ArrowAppendDate(column, text);
+			} break;
+			default:
+			{
+				ArrowAppendText(column, text);
+			} break;
+		}
+	}
+}
+
+void WriteSelectedRow(char* row, FILE* output_file, bool print_to_screen, Code_page code_page)
+{
+	char utf8[TRANSCODED_SIZE(SELECTED_ROW_SIZE)];
+	char* output_line = TranscodeText(row, utf8, sizeof(utf8), code_page);
+	if (output_file)
+	{
+		fprintf(output_file, "%s\n", output_line);
+	}
+	if (print_to_screen)
+	{
+		printf("%s\n", output_line);
+	}
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef COUNTERS
+#define COUNTERS
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	Hardware performance counters, read around each phase of a parse (see timing.h) when asked for with
+	--counters. On Linux they come from perf_event_open(), opened as one group on the calling thread so a
+	single read() returns all of them at once. User space only: the kernel's share of reading the report and
+	writing the output is in the phase times but not in the counts.
+
+	Windows has no user mode interface to the PMU (ETW can sample it, but only with administrator rights and
+	a trace session), so there OpenPerfCounters() just fails and the tools carry on with times alone.
+
+	Any counter the CPU (or the virtual machine) does not provide is left out; its counts stay zero and it is
+	reported as unavailable.
+*/
+
+#if defined(__linux__)
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+typedef enum
+{
+	counter_cycles,
+	counter_instructions,
+	counter_branch_misses,
+	counter_l1d_misses,
+	counter_llc_misses,
+	counter_count
+} Counter;
+
+char* counter_names[counter_count] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+
+typedef struct
+{
+	bool available;
+	bool enabled[counter_count];
+	i32 group_index[counter_count]; // Position of the counter in a group read.
+	i32 num_enabled;
+	int leader;
+	int descriptors[counter_count];
+} Perf_counters;
+
+#if defined(__linux__)
+
+bool OpenPerfCounters(Perf_counters* counters)
+{
+	static const u32 types[counter_count] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+	static const u64 configs[counter_count] =
+	{
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+	};
+
+	memset(counters, 0, sizeof(*counters));
+	counters->leader = -1;
+
+	for (u32 counter = 0; counter < counter_count; counter++)
+	{
+		struct perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = types[counter];
+		attributes.config = configs[counter];
+		attributes.disabled = (counters->leader < 0);
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP;
+
+		int descriptor = (int)syscall(__NR_perf_event_open, &attributes, 0, -1, counters->leader, 0);
+		counters->descriptors[counter] = descriptor;
+		if (descriptor < 0)
+		{
+			continue;
+		}
+		if (counters->leader < 0)
+		{
+			counters->leader = descriptor;
+		}
+		counters->enabled[counter] = true;
+		counters->group_index[counter] = counters->num_enabled++;
+	}
+
+	if (counters->leader < 0)
+	{
+		return false;
+	}
+
+	ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	counters->available = true;
+	return true;
+}
+
+void ReadPerfCounters(Perf_counters* counters, u64 counts[counter_count])
+{
+	u64 buffer[1 + counter_count] = {0}; // Number of counters, then their values.
+	if (read(counters->leader, buffer, sizeof(buffer)) < (ssize_t)sizeof(u64))
+	{
+		memset(counts, 0, counter_count * sizeof(u64));
+		return;
+	}
+	for (u32 counter = 0; counter < counter_count; counter++)
+	{
+		counts[counter] = counters->enabled[counter] ? buffer[1 + counters->group_index[counter]] : 0;
+	}
+}
+
+void ClosePerfCounters(Perf_counters* counters)
+{
+	for (u32 counter = 0; counter < counter_count; counter++)
+	{
+		if (counters->descriptors[counter] >= 0)
+		{
+			close(counters->descriptors[counter]);
+		}
+	}
+	counters->available = false;
+}
+
+#else
+
+bool OpenPerfCounters(Perf_counters* counters)
+{
+	memset(counters, 0, sizeof(*counters));
+	return false;
+}
+
+void ReadPerfCounters(Perf_counters* counters, u64 counts[counter_count])
+{
+	memset(counts, 0, counter_count * sizeof(u64));
+}
+
+void ClosePerfCounters(Perf_counters* counters)
+{
+	counters->available = false;
+}
+
+#endif
+
+#endif
@@ -1,14 +1,41 @@
-#include <windows.h>
 #include <stdio.h>
 
+#include "platform.h"
 #include "utils.h"
-
-#define VERSION "2024-11-18"
+#include "arena.h"
+#include "encoding.h"
+#include "arrow.h"
+#include "barcode.h"
+#include "layout.h"
+#include "timing.h"
+#include "progress.h"
+#include "sniff.h"
+#include "serve.h"
+#include "anomaly.h"
+#include "reconcile.h"
+#include "columns.h"
+#include "filter.h"
+#include "sort.h"
+
+#define VERSION "2026-10-19"
 
 typedef struct Program_options
 {
 	bool print_to_screen;
 	bool debug_output;
+	bool feather_output;
+	bool print_stats;
+	bool stats_json;
+	bool no_progress;
+	bool allow_missing_totals;
+	bool counters;
+	bool fixed_layout;
+	Code_page code_page;
+	struct Barcode_validation* validation; // Checks the references as they are written.
+	struct Anomaly_log* anomalies; // Checks the record lines as they are parsed (only counting them without -a).
+	struct Column_selection* columns; // Chosen with --columns; NULL for the usual output.
+	u64 fields; // The fields of the report to read, FIELD(Xref_field) (see columns.h).
+	struct Record_filter* filter; // Given with --where; NULL to write every cross-reference.
 } Program_options;
 
 typedef struct Report_summary
@@ -16,6 +43,11 @@ typedef struct Report_summary
 	u32 num_products;
 	u32 num_xrefs;
 	u32 num_pages;
+	u32 num_left_out; // Of num_xrefs, by --where.
+	Footer_total report_total; // Of the products, from the footer the parse stops at.
+	Report_layout layout;
+	Phase_timings timings;
+	Progress* progress;
 } Report_summary;
 
 typedef struct Product_reference
@@ -25,30 +57,293 @@ typedef struct Product_reference
 	char description_1[26]; // 25 + \0
 	char vendor[8]; // 6 + \0
 	char reference[16]; // 15 + \0
+	char current_sku[12]; // SKU the reference belongs to (product_id is only on the first line of a product).
+	char current_class[8]; // Likewise for the class, description and vendor.
+	char current_description[26];
+	char current_vendor[8];
 } Product_reference;
 
-void ParseCrossReferences(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+typedef struct Product_reference_batch
+{
+	Product_reference* xrefs;
+	u32 count;
+} Product_reference_batch;
+
+typedef enum
+{
+	xref_class,
+	xref_sku,
+	xref_description,
+	xref_reference,
+	xref_vendor,
+	xref_field_count
+} Xref_field;
+
+// The fields of a cross-reference line, checked as they are parsed (see anomaly.h) and compared by --where
+// (see filter.h). They start where the report's layout puts them. Only the first line of a product has its
+// class, SKU, description and vendor; every line has a reference.
+Field_check xref_fields[xref_field_count] =
+{
+	{"Class", 0, 4, field_code},
+	{"SKU Number", 0, 11, field_code},
+	{"Description", 0, 25, field_text},
+	{"UPC", 0, 15, field_code},
+	{"Vendor", 0, 6, field_code},
+};
+
+Layout_field xref_layout[xref_field_count] =
+{
+	{"Class", "CLASS", 2, 4, false},
+	{"SKU Number", "SKU", 8, 11, false},
+	{"Description", "DESCRIPTION", 21, 25, false},
+	{"UPC", "REFERENCE", 48, 15, false},
+	{"Vendor", "VENDOR", 70, 6, false},
+};
+
+typedef struct Barcode_validation
+{
+	FILE* file;
+	Barcode_index index;
+	u32 counts[barcode_status_count];
+} Barcode_validation;
+
+// Writes a row for each reference that is not a valid barcode as it stands (internal codes included, so
+// they can be told apart from typos). They were added to the index of shared barcodes as they were parsed.
+void ValidateCrossReferences(Product_reference_batch* batch, Barcode_validation* validation, Program_options options)
+{
+	for (u32 xref_index = 0; xref_index < batch->count; xref_index++)
+	{
+		Product_reference* xref = &batch->xrefs[xref_index];
+		if (!xref->reference[0])
+		{
+			continue;
+		}
+
+		Barcode_check check;
+		CheckBarcode(xref->reference, &check);
+		validation->counts[check.status]++;
+
+		if (check.status != barcode_valid)
+		{
+			char buffer[128] = {0};
+			sprintf_s(buffer, sizeof(buffer), "%s|%s|%s|%s|\n",
+					  xref->current_sku,
+					  xref->reference,
+					  (check.status == barcode_internal) ? barcode_status_names[barcode_internal] : check.problem,
+					  (check.status == barcode_repairable) ? check.code : "");
+
+			char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+			fprintf(validation->file, "%s", TranscodeText(buffer, utf8, sizeof(utf8), options.code_page));
+		}
+	}
+}
+
+// Writes a row for each barcode listed under more than one SKU, if --where kept a reference with it: the first
+// SKU it was seen with, and the others. Returns the number of them.
+u32 WriteSharedBarcodes(Barcode_validation* validation, Program_options options)
+{
+	Barcode_index* index = &validation->index;
+	u32 num_shared = 0;
+	for (u32 entry = 0; entry < index->num_entries; entry++)
+	{
+		Barcode_entry* first = &index->entries[entry];
+		if (first->num_skus < 2 || !first->kept)
+		{
+			continue;
+		}
+		num_shared++;
+
+		char utf8[TRANSCODED_SIZE(BARCODE_SIZE)];
+		fprintf(validation->file, "%s|", TranscodeText(first->sku, utf8, sizeof(utf8), options.code_page));
+		fprintf(validation->file, "%s|shared barcode||", TranscodeText(first->code, utf8, sizeof(utf8), options.code_page));
+		for (u32 other = first->next; other; other = index->entries[other - 1].next)
+		{
+			char* separator = (other == first->next) ? "" : " ";
+			fprintf(validation->file, "%s%s", separator, TranscodeText(index->entries[other - 1].sku, utf8, sizeof(utf8), options.code_page));
+		}
+		fprintf(validation->file, "\n");
+	}
+	return num_shared;
+}
+
+typedef enum
+{
+	xref_column_sku,
+	xref_column_reference,
+	xref_column_class,
+	xref_column_description,
+	xref_column_vendor,
+	xref_column_count
+} Xref_column;
+
+Output_column xref_columns[xref_column_count] =
+{
+	{"SKU Number", arrow_utf8, FIELD(xref_sku)},
+	{"UPC", arrow_utf8, FIELD(xref_reference)},
+	{"Class", arrow_dictionary, FIELD(xref_class)},
+	{"Description", arrow_utf8, FIELD(xref_description)},
+	{"Vendor", arrow_dictionary, FIELD(xref_vendor)},
+};
+
+char xref_headings[] = "SKU Number|UPC"; // Of the usual output.
+
+void AddCrossReferenceColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < xref_column_count; column++)
+	{
+		ArrowAddColumn(arrow, xref_columns[column].name, xref_columns[column].type);
+	}
+}
+
+char* CrossReferenceColumnText(Product_reference* xref, Xref_column column)
+{
+	switch (column)
+	{
+		case xref_column_sku:			return xref->current_sku;
+		case xref_column_reference:		return xref->reference;
+		case xref_column_class:			return xref->current_class;
+		case xref_column_description:	return xref->current_description;
+		case xref_column_vendor:		return xref->current_vendor;
+		default:						return "";
+	}
+}
+
+void WriteSelectedCrossReferences(Product_reference_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	Column_selection* selection = options.columns;
+	for (u32 xref_index = 0; xref_index < batch->count; xref_index++)
+	{
+		char row[SELECTED_ROW_SIZE];
+		size_t row_length = 0;
+		for (u32 position = 0; position < selection->num_selected; position++)
+		{
+			char* text = CrossReferenceColumnText(&batch->xrefs[xref_index], (Xref_column)selection->selected[position]);
+			PutSelectedColumn(selection, position, text, row, sizeof(row), &row_length, arrow);
+		}
+		WriteSelectedRow(row, output_file, options.print_to_screen, options.code_page);
+	}
+	if (arrow)
+	{
+		ArrowWriteBatch(arrow);
+	}
+}
+
+void WriteCrossReferences(Product_reference_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.validation)
+	{
+		ValidateCrossReferences(batch, options.validation, options);
+	}
+
+	if (options.columns)
+	{
+		WriteSelectedCrossReferences(batch, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		for (u32 xref_index = 0; xref_index < batch->count; xref_index++)
+		{
+			Product_reference* xref = &batch->xrefs[xref_index];
+			ArrowAppendText(&arrow->columns[0], xref->current_sku);
+			ArrowAppendText(&arrow->columns[1], xref->reference);
+			ArrowAppendText(&arrow->columns[2], xref->current_class);
+			ArrowAppendText(&arrow->columns[3], xref->current_description);
+			ArrowAppendText(&arrow->columns[4], xref->current_vendor);
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	for (u32 xref_index = 0; xref_index < batch->count; xref_index++)
+	{
+		Product_reference* xref = &batch->xrefs[xref_index];
+
+		char buffer[256] = {0};
+		if (options.debug_output)
+		{
+			sprintf_s(buffer, sizeof(buffer),
+				"  %-4s  %-11s  %-25s  %-21s %6s\n",
+				xref->class,
+				xref->product_id,
+				xref->description_1,
+				xref->reference,
+				xref->vendor);
+		}
+		else
+		{
+			sprintf_s(buffer, sizeof(buffer),
+				"%s|%s\n",
+				// "%s|%s|%s|%s|%s\n",
+				xref->current_sku,
+				// current_description,
+				// current_class,
+				// current_vendor,
+				xref->reference);
+		}
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+void ParseCrossReferences(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
 	size_t line_position	= 0;
 	i32 page_header_line	= 7; // Reports start with a header.
 
-	Product_reference xref = {0};
-	Product_reference xref_reset = {0};
+	Memory_arena arena = AllocateArena(RECORD_BATCH_SIZE * sizeof(Product_reference));
+	Product_reference_batch batch = {0};
+	batch.xrefs = PushArray(&arena, RECORD_BATCH_SIZE, Product_reference);
 
-	char current_class[8];
-	char current_sku[12];
-	char current_description[26];
-	char current_vendor[8];
+	char current_class[8] = {0};
+	char current_sku[12] = {0};
+	char current_description[26] = {0};
+	char current_vendor[8] = {0};
 	size_t current_class_length = 0;
 	size_t current_vendor_length = 0; // @TODO not really used yet
 	size_t description_length = 0;
 	size_t current_sku_length = 0;
 
-	if (output_file && !options.debug_output)
+	u32 column[xref_field_count];
+	InferLayout(&summary->layout, xref_layout, xref_field_count, data, 6, NULL);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
+	u32 footer_column = (column[xref_reference] + 15 + column[xref_vendor]) / 2; // In the gap before the vendor (66).
+
+	Field_check fields[xref_field_count];
+	for (u32 field = 0; field < xref_field_count; field++)
+	{
+		fields[field] = xref_fields[field];
+		fields[field].start = column[field];
+	}
+	Line_check check; // Every line must reach its reference.
+	CompileLineCheck(&check, fields, ArrayCount(fields), column[xref_reference] + 1);
+
+	if (output_file && options.columns)
 	{
-		fprintf(output_file, "SKU Number|UPC\n");
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
+	{
+		fprintf(output_file, "%s\n", xref_headings);
+	}
+	if (arrow && options.columns)
+	{
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddCrossReferenceColumns(arrow);
 	}
 
 	while (data[index])
@@ -63,6 +358,7 @@ void ParseCrossReferences(char* data, FILE* output_file, Program_options options
 			if (line_position == 0) // @BUG: Found issue around line 57,002 where the IRX reports generated do not put space before the header!
 			{						// will need another way of parsing these files if no manual fiddling is to be required.
 				// loop over header lines
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && (page_header_line > 0)) // data[index] != '\0' is necessary in the case the report ends with a header.
 				{
 					if (data[index] == '\n')
@@ -72,82 +368,118 @@ void ParseCrossReferences(char* data, FILE* output_file, Program_options options
 					index++;
 				}
 				page_header_line = 7;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_xrefs);
 				summary->num_pages++;
 				continue;
 			}
 
 			line_start_index = index - line_position;
-			xref = xref_reset;
+			char* line = &data[line_start_index];
+			Product_reference* xref = &batch.xrefs[batch.count];
 
-			if ((line_position > 66) && (data[line_start_index + 66] != ' '))
+			if ((line_position > footer_column) && (line[footer_column] != ' '))
 			{	// @HACK: Don't count report footer as product.
+				char* footer = LineIsRule(line, line_position, '=') ? NextFooterLine(line) : line;
+				summary->report_total = ReadFooterTotal(footer, total_count);
 				break;
 				// printf("------------------------------------");
 			}
 
-			if (data[line_start_index + 2] != ' ')
+			CheckRecordLine(options.anomalies, line, line_position, &check);
+
+			// The product's fields are read whatever --where says, as the lines after it carry them.
+			bool product_line = (line_position > column[xref_sku]) && (line[column[xref_sku]] != ' ');
+			if (options.filter && product_line)
+			{
+				FilterCompare(options.filter, 1, fields, line, line_position);
+			}
+
+			if ((options.fields & FIELD(xref_class)) && (line_position > column[xref_class]) && (line[column[xref_class]] != ' '))
 			{
-				current_class_length = FillTextFieldAndTrim(xref.class, &data[line_start_index + 2], 4);
-				memcpy(current_class, xref.class, current_class_length);
+				current_class_length = FillLineField(xref->class, line, line_position, column[xref_class], 4);
+				memcpy(current_class, xref->class, current_class_length);
 			}
-			if (data[line_start_index + 8] != ' ') // check if sku is present on line.
+			if (product_line)
 			{
-				current_sku_length = FillTextFieldAndTrim(xref.product_id, &data[line_start_index + 8], 11);
-				memcpy(current_sku, xref.product_id, current_sku_length);
+				current_sku_length = FillLineField(xref->product_id, line, line_position, column[xref_sku], 11);
+				memcpy(current_sku, xref->product_id, current_sku_length);
 				summary->num_products++;
 			}
 
-			if (data[line_start_index + 21] != ' ') // check if description is present on line.
+			if ((options.fields & FIELD(xref_description)) && (line_position > column[xref_description]) && (line[column[xref_description]] != ' ')) // check if description is present on line.
 			{
 				// FillTextFieldAndTrim(product.description_1, &data[line_start_index + 21], 25);
-				description_length = FillTextFieldAndTrim(xref.description_1, &data[line_start_index + 21], 25);
-				memcpy(current_description, xref.description_1, description_length);
+				description_length = FillLineField(xref->description_1, line, line_position, column[xref_description], 25);
+				memcpy(current_description, xref->description_1, description_length);
+			}
+			if ((options.fields & FIELD(xref_vendor)) && (line_position > column[xref_vendor]))
+			{
+				current_vendor_length = FillLineField(xref->vendor, line, line_position, column[xref_vendor], 6);
+				memcpy(current_vendor, xref->vendor, current_vendor_length);
 			}
-			FillTextFieldAndTrim(xref.reference, &data[line_start_index + 48], MIN(line_position - 48, 15));
 
-			if (line_position > 70)
+			// Every reference goes into the shared barcode index, including those --where leaves out.
+			Barcode_check barcode = {0};
+			if (options.validation)
 			{
-				current_vendor_length = FillTextFieldAndTrim(xref.vendor, &data[line_start_index + 70], 6);
-				memcpy(current_vendor, xref.vendor, current_vendor_length);
+				FillLineField(xref->reference, line, line_position, column[xref_reference], 15);
+				if (xref->reference[0])
+				{
+					CheckBarcode(xref->reference, &barcode);
+				}
 			}
 
-			char buffer[256] = {0};
-			if (options.debug_output)
+			bool kept = true;
+			if (options.filter)
 			{
-				sprintf_s(buffer, sizeof(buffer),
-					"  %-4s  %-11s  %-25s  %-21s %6s\n",
-					xref.class,
-					xref.product_id,
-					xref.description_1,
-					xref.reference,
-					xref.vendor);
+				// The product's comparisons were made on its first line, the reference's are made on each.
+				FilterCompare(options.filter, 0, &fields[xref_reference], line, line_position);
+				kept = FilterMatches(options.filter);
 			}
-			else
+			if (barcode.code[0])
 			{
-				sprintf_s(buffer, sizeof(buffer),
-					"%s|%s\n",
-					// "%s|%s|%s|%s|%s\n",
-					current_sku,
-					// current_description,
-					// current_class,
-					// current_vendor,
-					xref.reference);
+				AddBarcode(&options.validation->index, barcode.code, current_sku, kept);
 			}
-
-			if (output_file)
+			if (!kept)
 			{
-				fprintf(output_file, "%s", buffer);
+				memset(xref, 0, sizeof(*xref)); // The slot is reused.
+				summary->num_xrefs++; // Counted, but not written.
+				summary->num_left_out++;
+				line_position = 0;
+				index++;
+				continue;
 			}
-			if (options.print_to_screen)
+			if (options.fields & FIELD(xref_reference))
 			{
-				printf("%s", buffer);
+				FillLineField(xref->reference, line, line_position, column[xref_reference], 15);
 			}
 
-			line_position = 0;
+			memcpy(xref->current_sku, current_sku, sizeof(current_sku));
+			memcpy(xref->current_class, current_class, sizeof(current_class));
+			memcpy(xref->current_description, current_description, sizeof(current_description));
+			memcpy(xref->current_vendor, current_vendor, sizeof(current_vendor));
+
 			summary->num_xrefs++;
+			if (++batch.count == RECORD_BATCH_SIZE)
+			{
+				Phase_start format_start = BeginPhase(&summary->timings);
+				WriteCrossReferences(&batch, output_file, arrow, options);
+				EndPhase(&summary->timings, phase_format, format_start);
+				ResetArena(&arena);
+				batch.xrefs = PushArray(&arena, RECORD_BATCH_SIZE, Product_reference);
+				batch.count = 0;
+			}
+
+			line_position = 0;
 			index++;
 		}
 	}
+
+	Phase_start format_start = BeginPhase(&summary->timings);
+	WriteCrossReferences(&batch, output_file, arrow, options);
+	EndPhase(&summary->timings, phase_format, format_start);
+	FreeArena(&arena);
 }
 
 #define USAGE_STRING "\
@@ -157,11 +489,51 @@ John Hosick <john@atikokancastle.com>\n\n\
 pipe-delimited file for use in the conversion to CashierPRO.\n\n\
 USAGE: %s [OPTIONS] <inputfile> [outputfile]\n\
   OPTIONS:\n\
+    -a, --anomalies <file>\n\
+                    Write the fields that do not look like what they should hold (a letter\n\
+                    in an amount, a line cut short, ...) to the file, with their line numbers.\n\
     -d, --debug     Dump output in original format (to check the correctness of the parse).\n\
+    -e, --encoding <code page>\n\
+                    Convert text from the report's code page (cp437, cp1252 or latin1)\n\
+                    to UTF-8. Without it, text is written exactly as it was read, except\n\
+                    in Feather files, which must be UTF-8 and take it to be cp1252.\n\
+    -f, --feather   Write the output file in Arrow IPC (Feather v2) format instead.\n\
     -h, --help      Show this help message.\n\
     -p, --print     Print to the screen. Note: This option does not preclude\n\
                     outputting to a file: If an output file is specified,\n\
-                    it will be created as well as displayed on the screen.\n"
+                    it will be created as well as displayed on the screen.\n\
+    -s, --stats     Show the time spent in each phase of the parse.\n\
+    -v, --validate <file>\n\
+                    Check the UPC/EAN check digit of every reference and write the ones\n\
+                    that are not valid barcodes, with a suggested repair where there is\n\
+                    one, and the barcodes shared by more than one SKU to the file.\n\
+        --stats-json\n\
+                    Also print the throughput and phase times as a line of JSON.\n\
+        --counters  Count cycles, instructions, branch and cache misses in each phase\n\
+                    (Linux only) and add them to the statistics.\n\
+        --no-progress\n\
+                    Do not show the progress of a long parse on the console.\n\
+        --allow-missing-totals\n\
+                    Do not fail if the report has no totals at its end to check the parse\n\
+                    against (reports from old versions of ProfitMaster).\n\
+        --fixed-layout\n\
+                    Parse with the built-in column layout even if the report's headings\n\
+                    and data show that its columns have moved.\n\
+        --columns <names>\n\
+                    Write only these columns, in this order (names of the Feather columns,\n\
+                    separated by commas), reading only the fields of the report they need.\n\
+        --where <filter>\n\
+                    Write only the cross-references that match the filter, e.g. \"vendor =\n\
+                    TARGT and upc != ''\" (see the instructions for what a filter can be).\n\
+        --sort-by <columns>\n\
+                    Sort the output file by these columns (separated by commas, each with\n\
+                    \" desc\" after it to sort it descending) instead of in report order.\n\
+        --sort-memory <megabytes>\n\
+                    The most memory --sort-by may use (default 256); a bigger output is\n\
+                    sorted in runs that are merged from disk.\n\
+        --serve <socket>\n\
+                    Keep running, and convert the reports asked for over the Unix domain\n\
+                    socket (Linux only). Any other arguments are ignored.\n"
 
 void PrintUsageAndExit(char *program_name)
 {
@@ -174,6 +546,12 @@ int main(int argc, char *argv[])
 	char* program_name = argv[0];
 	char* file_input_name = {0};
 	char* file_output_name = {0};
+	char* file_anomalies_name = {0};
+	char* column_names = {0};
+	char* filter_text = {0};
+	char* sort_text = {0};
+	u32 sort_megabytes = SORT_DEFAULT_MEGABYTES;
+	char* file_validate_name = {0};
 
 	Program_options options = {0};
 
@@ -204,6 +582,105 @@ int main(int argc, char *argv[])
 				{
 					options.debug_output = true;
 				}
+				else if (strcmp(option, "feather") == 0)
+				{
+					options.feather_output = true;
+				}
+				else if (strcmp(option, "stats") == 0)
+				{
+					options.print_stats = true;
+				}
+				else if (strcmp(option, "stats-json") == 0)
+				{
+					options.stats_json = true;
+				}
+				else if (strcmp(option, "no-progress") == 0)
+				{
+					options.no_progress = true;
+				}
+				else if (strcmp(option, "allow-missing-totals") == 0)
+				{
+					options.allow_missing_totals = true;
+				}
+				else if (strcmp(option, "counters") == 0)
+				{
+					options.counters = true;
+				}
+				else if (strcmp(option, "fixed-layout") == 0)
+				{
+					options.fixed_layout = true;
+				}
+				else if (strcmp(option, "encoding") == 0)
+				{
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: --encoding must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "validate") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --validate must be followed by the name of the file to write the problems to.\n", program_name);
+						return -1;
+					}
+					file_validate_name = argv[++arg];
+				}
+				else if (strcmp(option, "columns") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --columns must be followed by the names of the columns to write, separated by commas.\n", program_name);
+						return -1;
+					}
+					column_names = argv[++arg];
+				}
+				else if (strcmp(option, "where") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --where must be followed by a filter, e.g. \"vendor = TARGT\".\n", program_name);
+						return -1;
+					}
+					filter_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-by") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --sort-by must be followed by the names of the columns to sort by, separated by commas.\n", program_name);
+						return -1;
+					}
+					sort_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-memory") == 0)
+				{
+					sort_megabytes = (arg + 1 == argc) ? 0 : (u32)strtoul(argv[++arg], NULL, 10);
+					if (sort_megabytes < 1 || sort_megabytes > SORT_MAX_MEGABYTES)
+					{
+						printf("%s: --sort-memory must be followed by a number of megabytes, from 1 to %d.\n", program_name, SORT_MAX_MEGABYTES);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "anomalies") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --anomalies must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+				}
+				else if (strcmp(option, "serve") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --serve must be followed by the path of the socket to listen on.\n", program_name);
+						return -1;
+					}
+					return ServeRequests(program_name, argv[arg + 1], main, NULL); // Each request is run by main() itself.
+				}
 				else
 				{
 					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
@@ -221,6 +698,14 @@ int main(int argc, char *argv[])
 
 				switch (c2)
 				{
+					case 'a':
+						if (arg + 1 == argc)
+						{
+							printf("%s: -a must be followed by the name of the file to write them to.\n", program_name);
+							return -1;
+						}
+						file_anomalies_name = argv[++arg];
+						break;
 					case 'h':
 						PrintUsageAndExit(program_name);
 					case 'p':
@@ -229,6 +714,27 @@ int main(int argc, char *argv[])
 					case 'd':
 						options.debug_output = true;
 						break;
+					case 'e':
+						if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+						{
+							printf("%s: -e must be followed by cp437, cp1252 or latin1.\n", program_name);
+							return -1;
+						}
+						break;
+					case 'f':
+						options.feather_output = true;
+						break;
+					case 's':
+						options.print_stats = true;
+						break;
+					case 'v':
+						if (arg + 1 == argc)
+						{
+							printf("%s: -v must be followed by the name of the file to write the problems to.\n", program_name);
+							return -1;
+						}
+						file_validate_name = argv[++arg];
+						break;
 					default:
 						printf("%s: Invalid argument '%c'. Use -h or --help for more details.\n", program_name, c2);
 						return -1;
@@ -258,16 +764,139 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (!file_output_name && options.feather_output)
+	{
+		printf("Feather output requires an output file.\n");
+		return -1;
+	}
+
+	if (!CheckReportKind(program_name, file_input_name, report_cross_references))
+	{
+		return -1;
+	}
+
+	Barcode_validation validation = {0};
+	if (file_validate_name)
+	{
+		errno_t error = fopen_s(&validation.file, file_validate_name, "w");
+		if (error)
+		{
+			printf("Could not create validation file: %s\n", file_validate_name);
+			return -1;
+		}
+		fprintf(validation.file, "SKU Number|UPC|Problem|Suggested UPC|Other SKUs\n");
+		options.validation = &validation;
+	}
+
+	Column_selection selection;
+	options.fields = ALL_FIELDS;
+	if (column_names)
+	{
+		if (options.debug_output)
+		{
+			printf("--columns cannot be used with -d.\n");
+			return -1;
+		}
+		if (!SelectColumns(&selection, xref_columns, xref_column_count, column_names, program_name))
+		{
+			return -1;
+		}
+		options.columns = &selection;
+		options.fields = selection.fields | FIELD(xref_sku); // Counted for the reconciliation.
+		if (options.validation)
+		{
+			options.fields |= FIELD(xref_reference);
+		}
+	}
+
+	Record_filter filter;
+	if (filter_text)
+	{
+		// The reference first, as it is on every line, and the rest only on the first line of each product.
+		Filter_table tables[] = {{&xref_fields[xref_reference], 1}, {xref_fields, xref_field_count}};
+		if (!CompileFilter(&filter, filter_text, tables, ArrayCount(tables), xref_columns, xref_column_count, NULL, 0, program_name))
+		{
+			return -1;
+		}
+		options.filter = &filter;
+	}
+
+	Sort_order sort_order;
+	if (sort_text)
+	{
+		if (options.debug_output || options.feather_output || options.print_to_screen || !file_output_name)
+		{
+			printf("--sort-by sorts the output file, so it needs one, and cannot be used with -d, -f or -p.\n");
+			return -1;
+		}
+		char headings[COLUMN_HEADINGS_SIZE];
+		if (options.columns)
+		{
+			FormatSelectedHeadings(options.columns, headings, sizeof(headings));
+		}
+		else
+		{
+			strcpy_s(headings, sizeof(headings), xref_headings);
+		}
+		if (!CompileSortOrder(&sort_order, sort_text, xref_columns, xref_column_count, headings, sort_megabytes, program_name))
+		{
+			return -1;
+		}
+	}
+
+	FILE* anomaly_file = NULL;
+	if (file_anomalies_name && fopen_s(&anomaly_file, file_anomalies_name, "w"))
+	{
+		printf("Could not create anomalies file: %s\n", file_anomalies_name);
+		return -1;
+	}
+
+	Report_summary summary = {0};
+	if (options.counters && !OpenPerfCounters(&summary.timings.counters))
+	{
+		printf("Hardware performance counters are not available.\n");
+	}
+
+	Phase_start read_start = BeginPhase(&summary.timings);
 	char* data = ReadEntireFile(file_input_name);
 	if (!data)
 	{
 		printf("Could not open input file: %s\n", file_input_name);
 		return -1;
 	}
+	summary.timings.input_bytes = GetFileSize64(file_input_name);
+	EndPhase(&summary.timings, phase_read, read_start);
 
-	Report_summary summary = {0};
+	Anomaly_log anomalies;
+	StartAnomalyLog(&anomalies, data, anomaly_file, file_anomalies_name, options.code_page);
+	options.anomalies = &anomalies;
 
-	if (file_output_name)
+	// Progress goes to stderr and would be mixed in with the records printed to the screen.
+	Progress progress;
+	if (!options.no_progress && !options.print_to_screen && StderrIsConsole() && StartProgress(&progress, summary.timings.input_bytes))
+	{
+		summary.progress = &progress;
+	}
+
+	if (file_output_name && options.feather_output)
+	{
+		Arrow_writer arrow;
+		if (!ArrowOpen(&arrow, file_output_name))
+		{
+			printf("Could not create output file: %s\n", file_output_name);
+			return -1;
+		}
+		arrow.code_page = options.code_page;
+
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseCrossReferences(data, NULL, &arrow, options, &summary);
+		EndParse(&summary.timings, parse_start);
+
+		Phase_start flush_start = BeginPhase(&summary.timings);
+		ArrowClose(&arrow);
+		EndPhase(&summary.timings, phase_flush, flush_start);
+	}
+	else if (file_output_name)
 	{
 		FILE* stream_output;
 		errno_t error;
@@ -279,18 +908,68 @@ int main(int argc, char *argv[])
 			return -1;
 		}
 
-		ParseCrossReferences(data, stream_output, options, &summary);
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseCrossReferences(data, stream_output, NULL, options, &summary);
+		EndParse(&summary.timings, parse_start);
+
+		Phase_start flush_start = BeginPhase(&summary.timings);
 		fclose(stream_output);
+		EndPhase(&summary.timings, phase_flush, flush_start);
 	}
 	else
 	{
-		ParseCrossReferences(data, NULL, options, &summary);
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseCrossReferences(data, NULL, NULL, options, &summary);
+		EndParse(&summary.timings, parse_start);
 	}
 
+	u32 num_shared_barcodes = 0;
+	if (file_validate_name)
+	{
+		num_shared_barcodes = WriteSharedBarcodes(&validation, options);
+		fclose(validation.file);
+		FreeBarcodeIndex(&validation.index);
+	}
+
+	if (summary.progress)
+	{
+		StopProgress(summary.progress);
+	}
+	FreeFileMemory(data);
+
 	printf("Processed a total of %d cross-references in %d products (%d pages).\n", summary.num_xrefs, summary.num_products, summary.num_pages);
+	if (options.filter)
+	{
+		printf("Left out %d of the cross-references that did not match --where.\n", summary.num_left_out);
+	}
+	bool reconciled = ReconcileTotal(summary.report_total, "number of products", summary.num_products, options.allow_missing_totals);
+	bool sorted = true;
+	if (sort_text)
+	{
+		Phase_start sort_start = BeginPhase(&summary.timings);
+		sorted = SortOutputFile(&sort_order, file_output_name, program_name);
+		EndPhase(&summary.timings, phase_sort, sort_start);
+	}
 	if (file_output_name)
 	{
 		printf("Output dumped to %s.\n", file_output_name);
 	}
-	return 0;
+	PrintLayoutDrift(&summary.layout, options.fixed_layout);
+	if (file_validate_name)
+	{
+		printf("References: %u valid, %u repairable, %u internal codes; %u barcodes shared by more than one SKU. Problems written to %s.\n",
+			   validation.counts[barcode_valid], validation.counts[barcode_repairable], validation.counts[barcode_internal],
+			   num_shared_barcodes, file_validate_name);
+	}
+	PrintAnomalies(&anomalies);
+	if (anomaly_file)
+	{
+		fclose(anomaly_file);
+	}
+	PrintTimings(&summary.timings, summary.num_xrefs, options.print_stats);
+	if (options.stats_json)
+	{
+		PrintTimingsJson(&summary.timings, "crossreferences", summary.num_xrefs, summary.num_pages);
+	}
+	return (reconciled && sorted) ? 0 : -1;
 }
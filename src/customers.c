@@ -1,20 +1,58 @@
-#include <windows.h>
 #include <stdio.h>
 
+#include "platform.h"
 #include "utils.h"
-
-#define VERSION "2024-11-19"
+#include "arena.h"
+#include "encoding.h"
+#include "arrow.h"
+#include "layout.h"
+#include "scanner.h"
+#include "normalize.h"
+#include "dedupe.h"
+#include "timing.h"
+#include "progress.h"
+#include "sniff.h"
+#include "serve.h"
+#include "anomaly.h"
+#include "reconcile.h"
+#include "columns.h"
+#include "filter.h"
+#include "sort.h"
+
+#define VERSION "2026-10-19"
 
 typedef struct
 {
 	bool print_to_screen;
 	bool debug_output;
+	bool feather_output;
+	bool print_stats;
+	bool stats_json;
+	bool no_progress;
+	bool allow_missing_totals;
+	bool fixed_layout;
+	bool counters;
+	bool normalize;
+	Code_page code_page;
+	struct Memo_table* memo_table; // Filled in by the memo parse; adds Exemption Info to the address output.
+	struct Duplicate_index* duplicates; // Collects the addresses, to look for duplicate accounts.
+	struct Anomaly_log* anomalies; // Checks the record lines as they are parsed (only counting them without -a).
+	struct Column_selection* columns; // Chosen with --columns; NULL for the usual output.
+	u64 fields; // The fields of the report to read, FIELD() of the report's field enum (see columns.h).
+	struct Record_filter* filter; // Given with --where; NULL to write every account.
 } Program_options;
 
 typedef struct
 {
 	u32 num_accounts;
 	u32 num_pages;
+	u32 num_left_out; // Of num_accounts, by --where.
+	i64 total_balance; // In cents (account report only).
+	Footer_total report_total; // Of the accounts (or memos), from the summary line the parse stops at.
+	Footer_total report_balance; // From the line after the account report's summary line.
+	Report_layout layout;
+	Phase_timings timings;
+	Progress* progress;
 } Report_summary;
 
 typedef struct
@@ -37,6 +75,11 @@ typedef struct Customer_memo
 	char sum_line_1[41]; // 40 + \0
 	char sum_line_2[41];
 	char sum_line_3[41];
+
+	// Pulled out of the lines above by ExtractMemoFields().
+	char email[41];
+	char status_number[11]; // 10 + \0
+	char exemption[41]; // The whole line that mentions it.
 } Customer_memo;
 
 typedef struct Customer_account
@@ -67,24 +110,1241 @@ typedef struct Customer_account
 
 typedef enum
 {
+	no_report = -1,
 	account,
 	address,
 	memo
 } Report_type;
 
-void ParseAccountBalances(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+typedef struct
+{
+	Customer_account* accounts;
+	u32 count;
+} Customer_batch;
+
+// The fields of each report, for reading only those of the chosen columns (see columns.h). The customer id
+// is always read in the address and memo reports: it tells the records from the summary.
+typedef enum
+{
+	account_location,
+	account_id,
+	account_type,
+	account_tax_authority,
+	account_price_level,
+	account_payment_code,
+	account_name,
+	account_phone,
+	account_credit_limit,
+	account_balance,
+	account_ytd_sales,
+	account_ytd_fin_charges,
+	account_date_setup,
+	account_date_last_payment,
+	account_date_last_purchase,
+	account_field_count
+} Account_field;
+
+typedef enum
+{
+	address_type,
+	address_tax_authority,
+	address_price_level,
+	address_payment_code,
+	address_name,
+	address_phone,
+	address_line_1,
+	address_line_2,
+	address_city,
+	address_province,
+	address_postal_code,
+	address_fax,
+	address_field_count
+} Address_field;
+
+typedef enum
+{
+	memo_lines,
+	memo_extracted, // The email, status number and exemption found in the lines.
+	memo_field_count
+} Memo_field;
+
+/*	MEMO FIELDS
+	===========
+
+	Staff keep email addresses, First Nation status card numbers and tax exemption notes in the memos, and
+	these used to be moved into their own columns by hand. The patterns below are compiled once per parse into
+	a DFA (see scanner.h), which finds all of them in a single pass over each memo line:
+	  - email: an '@', widened to the address around it.
+	  - status number: a 10 digit number (the registration number on a status card) on its own, in a memo that
+	    also says STATUS, TREATY, BAND, REGISTRY or INDIAN.
+	  - exemption: the first line that says EXEMPT (or EXEMPTION), TAX FREE or NO PST.
+	Only the first of each is kept.
+*/
+
+typedef enum
+{
+	memo_pattern_at,
+	memo_pattern_status,
+	memo_pattern_treaty,
+	memo_pattern_band,
+	memo_pattern_registry,
+	memo_pattern_indian,
+	memo_pattern_number,
+	memo_pattern_exempt,
+	memo_pattern_tax_free,
+	memo_pattern_no_pst,
+	memo_pattern_count
+} Memo_pattern;
+
+char* memo_patterns[memo_pattern_count] = {"@", "STATUS", "TREATY", "BAND", "REGISTRY", "INDIAN", "0000000000", "EXEMPT", "TAX FREE", "NO PST"};
+
+typedef struct Memo_exemption
+{
+	char id[10]; // Empty in unused slots.
+	char info[64];
+} Memo_exemption;
+
+// Exemption info of each account whose memo has any, by account id (open addressing, at most half full).
+typedef struct Memo_table
+{
+	Memo_exemption* entries;
+	u32 count;
+	u32 capacity;
+} Memo_table;
+
+void CompileMemoScanner(Pattern_scanner* scanner)
+{
+	InitScanner(scanner);
+	for (u32 pattern = 0; pattern < memo_pattern_count; pattern++)
+	{
+		AddScannerPattern(scanner, memo_patterns[pattern]);
+	}
+	CompileScanner(scanner);
+}
+
+bool IsLetterSymbol(u8 symbol)
+{
+	return symbol >= 1 && symbol <= 26;
+}
+
+bool IsEmailSymbol(u8 symbol)
+{
+	return symbol != symbol_other && symbol != symbol_at && symbol != symbol_hash;
+}
+
+// Widens the '@' at line[at] into the address around it. Returns false if there is no name in front of it or
+// no dot in the domain.
+bool ExtractEmail(Pattern_scanner* scanner, char* line, size_t length, size_t at, char* email, size_t email_size)
+{
+	size_t start = at;
+	while (start > 0 && (IsEmailSymbol(scanner->symbols[(u8)line[start - 1]]) || line[start - 1] == '_' || line[start - 1] == '+'))
+	{
+		start--;
+	}
+	size_t end = at + 1;
+	while (end < length && IsEmailSymbol(scanner->symbols[(u8)line[end]]))
+	{
+		end++;
+	}
+	while (end > at + 1 && (line[end - 1] == '.' || line[end - 1] == '-')) // Punctuation ending the sentence.
+	{
+		end--;
+	}
+
+	if (start == at || !memchr(&line[at + 1], '.', end - at - 1) || end - start >= email_size)
+	{
+		return false;
+	}
+	memcpy(email, &line[start], end - start);
+	email[end - start] = '\0';
+	return true;
+}
+
+void ExtractMemoFields(Pattern_scanner* scanner, Customer_memo* memo)
+{
+	char* lines[7] = {
+		memo->rum_line_1, memo->rum_line_2, memo->rum_line_3, memo->rum_line_4,
+		memo->sum_line_1, memo->sum_line_2, memo->sum_line_3 };
+	bool mentions_status = false;
+	char number[11] = {0};
+
+	for (u32 line_index = 0; line_index < 7; line_index++)
+	{
+		char* line = lines[line_index];
+		size_t length = strlen(line);
+		Scanner_match matches[SCANNER_MAX_MATCHES];
+		u32 num_matches = ScanText(scanner, line, length, matches, SCANNER_MAX_MATCHES);
+
+		for (u32 match_index = 0; match_index < num_matches; match_index++)
+		{
+			u32 start = matches[match_index].start;
+			u32 end = start + scanner->pattern_lengths[matches[match_index].pattern];
+			u8 before = start > 0 ? scanner->symbols[(u8)line[start - 1]] : symbol_other;
+			u8 after = end < length ? scanner->symbols[(u8)line[end]] : symbol_other;
+
+			switch (matches[match_index].pattern)
+			{
+				case memo_pattern_at:
+				{
+					if (!memo->email[0])
+					{
+						ExtractEmail(scanner, line, length, start, memo->email, sizeof(memo->email));
+					}
+				} break;
+				case memo_pattern_number:
+				{
+					if (!number[0] && before != symbol_digit && after != symbol_digit)
+					{
+						memcpy(number, &line[start], 10);
+					}
+				} break;
+				case memo_pattern_exempt:
+				case memo_pattern_tax_free:
+				case memo_pattern_no_pst:
+				{
+					if (!memo->exemption[0] && !IsLetterSymbol(before))
+					{
+						strcpy_s(memo->exemption, sizeof(memo->exemption), line);
+					}
+				} break;
+				default: // One of the words that goes with a status card.
+				{
+					if (!IsLetterSymbol(before) && !IsLetterSymbol(after))
+					{
+						mentions_status = true;
+					}
+				} break;
+			}
+		}
+	}
+
+	if (mentions_status)
+	{
+		strcpy_s(memo->status_number, sizeof(memo->status_number), number);
+	}
+}
+
+// What goes in the address report's Exemption Info column: the status number and/or the exemption note.
+void MemoExemptionInfo(Customer_memo* memo, char* info, size_t info_size)
+{
+	if (memo->status_number[0] && memo->exemption[0])
+	{
+		sprintf_s(info, info_size, "Status %s; %s", memo->status_number, memo->exemption);
+	}
+	else if (memo->status_number[0])
+	{
+		sprintf_s(info, info_size, "Status %s", memo->status_number);
+	}
+	else
+	{
+		sprintf_s(info, info_size, "%s", memo->exemption);
+	}
+}
+
+void AddMemoExemption(Memo_table* table, char* id, char* info)
+{
+	if ((table->count + 1) * 2 > table->capacity)
+	{
+		u32 capacity = table->capacity ? table->capacity * 2 : 1024;
+		Memo_exemption* entries = (Memo_exemption*)calloc(capacity, sizeof(Memo_exemption));
+		if (!entries)
+		{
+			printf("Error: Out of memory reading the memos!\n");
+			exit (-1);
+		}
+		for (u32 slot = 0; slot < table->capacity; slot++)
+		{
+			Memo_exemption* entry = &table->entries[slot];
+			if (entry->id[0])
+			{
+				u32 new_slot = HashBytes((u8*)entry->id, strlen(entry->id)) & (capacity - 1);
+				while (entries[new_slot].id[0])
+				{
+					new_slot = (new_slot + 1) & (capacity - 1);
+				}
+				entries[new_slot] = *entry;
+			}
+		}
+		free(table->entries);
+		table->entries = entries;
+		table->capacity = capacity;
+	}
+
+	u32 slot = HashBytes((u8*)id, strlen(id)) & (table->capacity - 1);
+	while (table->entries[slot].id[0])
+	{
+		if (strcmp(table->entries[slot].id, id) == 0)
+		{
+			return; // The first memo of an account wins, as it does for every field within one.
+		}
+		slot = (slot + 1) & (table->capacity - 1);
+	}
+	strcpy_s(table->entries[slot].id, sizeof(table->entries[slot].id), id);
+	strcpy_s(table->entries[slot].info, sizeof(table->entries[slot].info), info);
+	table->count++;
+}
+
+char* FindMemoExemption(Memo_table* table, char* id)
+{
+	if (table->count)
+	{
+		u32 slot = HashBytes((u8*)id, strlen(id)) & (table->capacity - 1);
+		while (table->entries[slot].id[0])
+		{
+			if (strcmp(table->entries[slot].id, id) == 0)
+			{
+				return table->entries[slot].info;
+			}
+			slot = (slot + 1) & (table->capacity - 1);
+		}
+	}
+	return "";
+}
+
+// The text of a column of a customer, in buffer unless it is a field as it is.
+typedef char* Customer_column_text(Customer_account* account, u32 column, char* buffer, size_t size, Program_options options);
+
+// Writes the columns chosen with --columns, with the text of each from column_text.
+void WriteSelectedColumns(Customer_batch* batch, Customer_column_text* column_text, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	Column_selection* selection = options.columns;
+	for (u32 account_index = 0; account_index < batch->count; account_index++)
+	{
+		char row[SELECTED_ROW_SIZE];
+		size_t row_length = 0;
+		for (u32 position = 0; position < selection->num_selected; position++)
+		{
+			char buffer[512];
+			char* text = column_text(&batch->accounts[account_index], selection->selected[position], buffer, sizeof(buffer), options);
+			PutSelectedColumn(selection, position, text, row, sizeof(row), &row_length, arrow);
+		}
+		WriteSelectedRow(row, output_file, options.print_to_screen, options.code_page);
+	}
+	if (arrow)
+	{
+		ArrowWriteBatch(arrow);
+	}
+}
+
+// The columns of the account report are its fields, in the same order.
+Output_column account_columns[account_field_count] =
+{
+	{"Location", arrow_dictionary, FIELD(account_location)},
+	{"Cust ID", arrow_utf8, FIELD(account_id)},
+	{"Type", arrow_dictionary, FIELD(account_type)},
+	{"Tax Authority", arrow_dictionary, FIELD(account_tax_authority)},
+	{"Price Level", arrow_dictionary, FIELD(account_price_level)},
+	{"Payment Code", arrow_dictionary, FIELD(account_payment_code)},
+	{"Name", arrow_utf8, FIELD(account_name)},
+	{"Phone", arrow_utf8, FIELD(account_phone)},
+	{"Credit Limit", arrow_int64, FIELD(account_credit_limit)}, // Money is in cents.
+	{"Current Balance", arrow_int64, FIELD(account_balance)},
+	{"YTD Sales", arrow_int64, FIELD(account_ytd_sales)},
+	{"YTD Finance Charges", arrow_int64, FIELD(account_ytd_fin_charges)},
+	{"Account Setup", arrow_date32, FIELD(account_date_setup)},
+	{"Last Payment", arrow_date32, FIELD(account_date_last_payment)},
+	{"Last Purchase", arrow_date32, FIELD(account_date_last_purchase)},
+};
+
+char account_headings[] = "Cust ID|Credit Limit|Current Balance"; // Of the usual output.
+
+void AddAccountBalanceColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < account_field_count; column++)
+	{
+		ArrowAddColumn(arrow, account_columns[column].name, account_columns[column].type);
+	}
+}
+
+// Amounts in credit are negative.
+char* AccountColumnText(Customer_account* account, u32 column, char* buffer, size_t size, Program_options options)
+{
+	switch (column)
+	{
+		case account_location:				return account->location;
+		case account_id:					return account->id;
+		case account_type:					sprintf_s(buffer, size, "%c", account->type); return buffer;
+		case account_tax_authority:			return account->tax_authority;
+		case account_price_level:			sprintf_s(buffer, size, "%c", account->price_level); return buffer;
+		case account_payment_code:			return account->payment_code;
+		case account_name:					return account->last_name_or_company_name;
+		case account_phone:					return account->phone_number;
+		case account_credit_limit:			return account->credit_limit[0] ? account->credit_limit : "0"; // No limit is a limit of 0.
+		case account_balance:				sprintf_s(buffer, size, "%s%s", account->balance_credit[0] == 'C' ? "-" : "", account->balance); return buffer;
+		case account_ytd_sales:				sprintf_s(buffer, size, "%s%s", account->ytd_sales_credit[0] == 'C' ? "-" : "", account->ytd_sales); return buffer;
+		case account_ytd_fin_charges:		return account->ytd_fin_charges;
+		case account_date_setup:			return account->date_account_setup;
+		case account_date_last_payment:		return account->date_last_payment;
+		case account_date_last_purchase:	return account->date_last_purchase;
+		default:							return "";
+	}
+}
+
+void WriteAccountBalances(Customer_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.columns)
+	{
+		WriteSelectedColumns(batch, AccountColumnText, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		for (u32 account_index = 0; account_index < batch->count; account_index++)
+		{
+			Customer_account* account = &batch->accounts[account_index];
+			char type[2] = {account->type, '\0'};
+			char price_level[2] = {account->price_level, '\0'};
+			char balance[16] = {0};
+			char ytd_sales[16] = {0};
+			sprintf_s(balance, sizeof(balance), "%s%s", account->balance, account->balance_credit);
+			sprintf_s(ytd_sales, sizeof(ytd_sales), "%s%s", account->ytd_sales, account->ytd_sales_credit);
+
+			Arrow_column* columns = arrow->columns;
+			ArrowAppendText(&columns[0], account->location);
+			ArrowAppendText(&columns[1], account->id);
+			ArrowAppendText(&columns[2], type);
+			ArrowAppendText(&columns[3], account->tax_authority);
+			ArrowAppendText(&columns[4], price_level);
+			ArrowAppendText(&columns[5], account->payment_code);
+			ArrowAppendText(&columns[6], account->last_name_or_company_name);
+			ArrowAppendText(&columns[7], account->phone_number);
+			if (account->credit_limit[0] == '\0') // Same as the pipe-delimited output: no limit is a limit of 0.
+			{
+				ArrowAppendInt64(&columns[8], 0);
+			}
+			else
+			{
+				ArrowAppendMoney(&columns[8], account->credit_limit);
+			}
+			ArrowAppendMoney(&columns[9], balance);
+			ArrowAppendMoney(&columns[10], ytd_sales);
+			ArrowAppendMoney(&columns[11], account->ytd_fin_charges);
+			ArrowAppendDate(&columns[12], account->date_account_setup);
+			ArrowAppendDate(&columns[13], account->date_last_payment);
+			ArrowAppendDate(&columns[14], account->date_last_purchase);
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	for (u32 account_index = 0; account_index < batch->count; account_index++)
+	{
+		Customer_account* account = &batch->accounts[account_index];
+
+		char buffer[256] = {0};
+		if (options.debug_output)
+		{
+			sprintf_s(buffer, sizeof(buffer),
+		        "%2s %9s-%c  %-4s %c %s %-26s %8s %7s %10s%s %10s%s %11s %-9s %-9s %8s\n",
+		        account->location,
+		        account->id,
+		        account->type,
+		        account->tax_authority,
+		        account->price_level,
+		        account->payment_code,
+		        account->last_name_or_company_name,
+		        account->phone_number,
+		        account->credit_limit,
+		        account->balance,
+		        account->balance_credit,
+		        account->ytd_sales,
+		        account->ytd_sales_credit,
+		        account->ytd_fin_charges,
+		        account->date_account_setup,
+		        account->date_last_payment[0] != '\0' ? account->date_last_payment : "",
+		        account->date_last_purchase[0] != '\0' ? account->date_last_purchase : ""
+			   	);
+		}
+		else
+		{
+			bool limit_zero = false;
+			bool balance_minus = false;
+			bool balance_zero = false;
+			if (account->credit_limit[0] == '\0')
+			{
+				limit_zero = true;
+			}
+			if (account->balance_credit[0] == 'C' && account->balance_credit[1] == 'R')
+			{
+				balance_minus = true;
+			}
+			if (account->balance[0] == '.' && account->balance[1] == '0' && account->balance[2] == '0')
+			{
+				balance_zero = true;
+			}
+			sprintf_s(buffer, sizeof(buffer),
+				"%s|%s|%s%s\n",
+				account->id,
+				limit_zero ? "0" : account->credit_limit,
+				balance_minus ? "-" : "",
+				balance_zero ? "0" : account->balance);
+		}
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+/*	DUPLICATE ACCOUNTS
+	==================
+
+	With --duplicates, every account of the address report is also reduced to a MinHash signature (see
+	dedupe.h) of:
+	  - the 3 letter runs of its name and of its first address line (so a misspelling changes a few of them)
+	  - its house number, the last 7 digits of its phone number and its postal code, which count
+	    DUPLICATE_EXACT_WEIGHT times as much as a run of letters: they rarely differ between two entries of the
+	    same customer, and neighbours with the same name (or the same business at two addresses) are not
+	    duplicates.
+	Once the whole report is read, the accounts sharing an LSH bucket are compared and those whose estimated
+	similarity is at least DUPLICATE_THRESHOLD are grouped into clusters, which are written to their own file.
+*/
+
+#define DUPLICATE_THRESHOLD 0.6f
+#define DUPLICATE_EXACT_WEIGHT 8
+#define DUPLICATE_MAX_SHINGLES 128
+
+typedef struct Duplicate_record
+{
+	char id[10];
+	char name[60];
+	char address[30];
+	char city[20];
+	char postal_code[12];
+	char phone_number[16];
+} Duplicate_record;
+
+typedef struct Duplicate_index
+{
+	Duplicate_record* records;
+	Minhash_signature* signatures;
+	bool* blank; // No shingles at all, so nothing to compare.
+	u32 count;
+	u32 capacity;
+} Duplicate_index;
+
+// Adds the 3 letter runs of the text, upper cased, with anything but letters and digits as a single space.
+u32 AddTextShingles(char* text, char tag, u32* shingles, u32 num_shingles)
+{
+	u8 previous[2] = {' ', ' '};
+	for (char* character = text; ; character++)
+	{
+		u8 current = (u8)*character;
+		if (current >= 'a' && current <= 'z')
+		{
+			current -= 'a' - 'A';
+		}
+		else if (!((current >= 'A' && current <= 'Z') || (current >= '0' && current <= '9')))
+		{
+			current = ' ';
+		}
+
+		if (!(current == ' ' && previous[1] == ' ') && num_shingles < DUPLICATE_MAX_SHINGLES)
+		{
+			shingles[num_shingles++] = ((u32)tag << 24) | ((u32)previous[0] << 16) | ((u32)previous[1] << 8) | current;
+		}
+		if (!(current == ' ' && previous[1] == ' '))
+		{
+			previous[0] = previous[1];
+			previous[1] = current;
+		}
+		if (*character == '\0')
+		{
+			break;
+		}
+	}
+	return num_shingles;
+}
+
+u32 AddExactShingles(char* text, size_t length, char tag, u32* shingles, u32 num_shingles)
+{
+	u32 hash = HashBytes((u8*)text, length);
+	for (u32 copy = 0; copy < DUPLICATE_EXACT_WEIGHT && num_shingles < DUPLICATE_MAX_SHINGLES; copy++)
+	{
+		shingles[num_shingles++] = MixBits32(hash + ((u32)tag << 8) + copy);
+	}
+	return num_shingles;
+}
+
+void AddDuplicateRecords(Duplicate_index* index, Customer_batch* batch)
+{
+	if (index->count + batch->count > index->capacity)
+	{
+		u32 capacity = index->capacity ? index->capacity * 2 : RECORD_BATCH_SIZE;
+		while (capacity < index->count + batch->count)
+		{
+			capacity *= 2;
+		}
+		Duplicate_record* records = (Duplicate_record*)realloc(index->records, capacity * sizeof(Duplicate_record));
+		Minhash_signature* signatures = (Minhash_signature*)realloc(index->signatures, capacity * sizeof(Minhash_signature));
+		bool* blank = (bool*)realloc(index->blank, capacity * sizeof(bool));
+		if (!records || !signatures || !blank)
+		{
+			printf("Error: Out of memory finding duplicates!\n");
+			exit (-1);
+		}
+		index->records = records;
+		index->signatures = signatures;
+		index->blank = blank;
+		index->capacity = capacity;
+	}
+
+	for (u32 account_index = 0; account_index < batch->count; account_index++)
+	{
+		Customer_account* account = &batch->accounts[account_index];
+		Duplicate_record* record = &index->records[index->count];
+		strcpy_s(record->id, sizeof(record->id), account->id);
+		sprintf_s(record->name, sizeof(record->name), account->first_name[0] ? "%s %s" : "%s%s", account->first_name, account->last_name_or_company_name);
+		strcpy_s(record->address, sizeof(record->address), account->address.line_1);
+		strcpy_s(record->city, sizeof(record->city), account->address.city);
+		strcpy_s(record->postal_code, sizeof(record->postal_code), account->address.postal_code);
+		strcpy_s(record->phone_number, sizeof(record->phone_number), account->phone_number);
+
+		u32 shingles[DUPLICATE_MAX_SHINGLES];
+		u32 num_shingles = AddTextShingles(record->name, 'N', shingles, 0);
+		num_shingles = AddTextShingles(record->address, 'A', shingles, num_shingles);
+
+		size_t house_number_length = 0;
+		while (record->address[house_number_length] >= '0' && record->address[house_number_length] <= '9')
+		{
+			house_number_length++;
+		}
+		if (house_number_length)
+		{
+			num_shingles = AddExactShingles(record->address, house_number_length, 'H', shingles, num_shingles);
+		}
+
+		char digits[32];
+		size_t num_digits = 0;
+		for (char* character = record->phone_number; *character && num_digits < sizeof(digits); character++)
+		{
+			if (*character >= '0' && *character <= '9')
+			{
+				digits[num_digits++] = *character;
+			}
+		}
+		if (num_digits >= 7) // Otherwise it is the "(807) 597-" placeholder.
+		{
+			num_shingles = AddExactShingles(&digits[num_digits - 7], 7, 'P', shingles, num_shingles);
+		}
+
+		char postal_code[12];
+		size_t postal_code_length = 0;
+		for (char* character = record->postal_code; *character; character++)
+		{
+			if (*character != ' ')
+			{
+				postal_code[postal_code_length++] = (*character >= 'a' && *character <= 'z') ? *character - ('a' - 'A') : *character;
+			}
+		}
+		if (postal_code_length)
+		{
+			num_shingles = AddExactShingles(postal_code, postal_code_length, 'Z', shingles, num_shingles);
+		}
+
+		ComputeMinhash(shingles, num_shingles, &index->signatures[index->count]);
+		index->blank[index->count] = (num_shingles == 0);
+		index->count++;
+	}
+}
+
+// Writes the clusters of likely duplicates. Returns the number of clusters, and the accounts in them in
+// num_accounts, or -1 if the file could not be created.
+i32 WriteDuplicateClusters(Duplicate_index* index, char* file_name, Program_options options, u32* num_accounts)
+{
+	FILE* file;
+	errno_t error = fopen_s(&file, file_name, "w");
+	if (error)
+	{
+		return -1;
+	}
+	fprintf(file, "Cluster|Score|Cust ID|Name|Address1|City|Postal Cd|PhoneNo\n");
+
+	u32 num_pairs = 0;
+	Candidate_pair* pairs = FindCandidatePairs(index->signatures, index->blank, index->count, &num_pairs);
+
+	u32* parents = (u32*)malloc((size_t)index->count * sizeof(u32) + 1);
+	float* scores = (float*)malloc((size_t)index->count * sizeof(float) + 1);
+	u32* sizes = (u32*)calloc((size_t)index->count + 1, sizeof(u32));
+	u32* next = (u32*)malloc((size_t)index->count * sizeof(u32) + 1);
+	u32* first = (u32*)malloc((size_t)index->count * sizeof(u32) + 1);
+	if (!parents || !scores || !sizes || !next || !first)
+	{
+		printf("Error: Out of memory finding duplicates!\n");
+		exit (-1);
+	}
+	ClusterPairs(pairs, num_pairs, DUPLICATE_THRESHOLD, index->count, parents, scores);
+
+	// Chain the members of each cluster together, in report order.
+	for (u32 record = index->count; record-- > 0; )
+	{
+		u32 root = parents[record];
+		next[record] = sizes[root] ? first[root] : record;
+		first[root] = record;
+		sizes[root]++;
+	}
+
+	i32 num_clusters = 0;
+	*num_accounts = 0;
+	for (u32 root = 0; root < index->count; root++)
+	{
+		if (parents[root] != root || sizes[root] < 2)
+		{
+			continue;
+		}
+		num_clusters++;
+		*num_accounts += sizes[root];
+
+		u32 record = first[root];
+		for (u32 member = 0; member < sizes[root]; member++)
+		{
+			Duplicate_record* duplicate = &index->records[record];
+			char buffer[256] = {0};
+			sprintf_s(buffer, sizeof(buffer), "%d|%.2f|%s|%s|%s|%s|%s|%s\n",
+					  num_clusters, scores[root], duplicate->id, duplicate->name, duplicate->address,
+					  duplicate->city, duplicate->postal_code, duplicate->phone_number);
+
+			char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+			fprintf(file, "%s", TranscodeText(buffer, utf8, sizeof(utf8), options.code_page));
+			record = next[record];
+		}
+	}
+
+	fclose(file);
+	free(pairs);
+	free(parents);
+	free(scores);
+	free(sizes);
+	free(next);
+	free(first);
+	return num_clusters;
+}
+
+Normalize_step address_normalize_steps[] =
+{
+	NORMALIZE_STEP("First Name", Customer_account, first_name, NormalizeNameCase),
+	NORMALIZE_STEP("Last Name or Company Name", Customer_account, last_name_or_company_name, NormalizeNameCase),
+	NORMALIZE_STEP("City", Customer_account, address.city, NormalizeNameCase),
+	NORMALIZE_STEP("Prov", Customer_account, address.province, NormalizeProvince),
+	NORMALIZE_STEP("Postal Cd", Customer_account, address.postal_code, NormalizePostalCode),
+	NORMALIZE_STEP("PhoneNo", Customer_account, phone_number, NormalizePhone),
+	NORMALIZE_STEP("FaxNo", Customer_account, fax_number, NormalizePhone),
+};
+
+char* TaxExemption(Customer_account* account)
+{
+	if (strcmp(account->tax_authority, "EXEM") == 0)
+	{
+		return "Exempt";
+	}
+	else if (strcmp(account->tax_authority, "ONFN") == 0)
+	{
+		return "GST";
+	}
+	return "Tax"; // else if (strcmp(account->tax_authority, "ON") == 0)
+}
+
+typedef enum
+{
+	address_column_id,
+	address_column_first_name,
+	address_column_last_name,
+	address_column_line_1,
+	address_column_line_2,
+	address_column_city,
+	address_column_province,
+	address_column_postal_code,
+	address_column_phone,
+	address_column_fax,
+	address_column_tax_authority,
+	address_column_tax_exemption,
+	address_column_exemption_info,
+	address_column_house_account,
+	address_column_count
+} Address_column;
+
+Output_column address_columns[address_column_count] =
+{
+	{"Cust ID", arrow_utf8, 0},
+	{"First Name", arrow_utf8, FIELD(address_name)},
+	{"Last Name or Company Name", arrow_utf8, FIELD(address_name)},
+	{"Address1", arrow_utf8, FIELD(address_line_1)},
+	{"Address2", arrow_utf8, FIELD(address_line_2)},
+	{"City", arrow_dictionary, FIELD(address_city)},
+	{"Prov", arrow_dictionary, FIELD(address_province)},
+	{"Postal Cd", arrow_utf8, FIELD(address_postal_code)},
+	{"PhoneNo", arrow_utf8, FIELD(address_phone)},
+	{"FaxNo", arrow_utf8, FIELD(address_fax)},
+	{"Tax Authority", arrow_dictionary, FIELD(address_tax_authority)},
+	{"Tax Exemption", arrow_dictionary, FIELD(address_tax_authority)},
+	{"Exemption Info", arrow_utf8, 0}, // From the memo report given with -m, blank without it.
+	{"House Acct", arrow_dictionary, FIELD(address_type)},
+};
+
+// Of the usual output, with "Exemption Info|" for the %s with -m.
+char address_headings[] = "Cust ID|First Name|Last Name or Company Name|Address1|Address2|City|Prov|Postal Cd|PhoneNo|FaxNo|Tax Exemption|%sHouse Acct";
+
+char* AddressColumnText(Customer_account* account, u32 column, char* buffer, size_t size, Program_options options)
+{
+	switch (column)
+	{
+		case address_column_id:				return account->id;
+		case address_column_first_name:		return account->first_name;
+		case address_column_last_name:		return account->last_name_or_company_name;
+		case address_column_line_1:			return account->address.line_1;
+		case address_column_line_2:			return account->address.line_2;
+		case address_column_city:			return account->address.city;
+		case address_column_province:		return account->address.province;
+		case address_column_postal_code:	return account->address.postal_code;
+		case address_column_phone:			return account->phone_number;
+		case address_column_fax:			return account->fax_number;
+		case address_column_tax_authority:	return account->tax_authority;
+		case address_column_tax_exemption:	return TaxExemption(account);
+		case address_column_exemption_info:	return options.memo_table ? FindMemoExemption(options.memo_table, account->id) : "";
+		case address_column_house_account:	return account->type == 'O' ? "Yes" : "No";
+		default:							return "";
+	}
+}
+
+void AddAccountAddressColumns(Arrow_writer* arrow, Program_options options)
+{
+	ArrowAddColumn(arrow, "Cust ID", arrow_utf8);
+	ArrowAddColumn(arrow, "First Name", arrow_utf8);
+	ArrowAddColumn(arrow, "Last Name or Company Name", arrow_utf8);
+	ArrowAddColumn(arrow, "Address1", arrow_utf8);
+	ArrowAddColumn(arrow, "Address2", arrow_utf8);
+	ArrowAddColumn(arrow, "City", arrow_dictionary);
+	ArrowAddColumn(arrow, "Prov", arrow_dictionary);
+	ArrowAddColumn(arrow, "Postal Cd", arrow_utf8);
+	ArrowAddColumn(arrow, "PhoneNo", arrow_utf8);
+	ArrowAddColumn(arrow, "FaxNo", arrow_utf8);
+	ArrowAddColumn(arrow, "Tax Authority", arrow_dictionary);
+	ArrowAddColumn(arrow, "Tax Exemption", arrow_dictionary);
+	if (options.memo_table)
+	{
+		ArrowAddColumn(arrow, "Exemption Info", arrow_utf8);
+	}
+	ArrowAddColumn(arrow, "House Acct", arrow_dictionary);
+}
+
+void WriteAccountAddresses(Customer_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.normalize && !options.debug_output) // Debug output must match the report.
+	{
+		NormalizeBatch(address_normalize_steps, ArrayCount(address_normalize_steps), batch->accounts, batch->count, sizeof(Customer_account));
+	}
+	if (options.duplicates)
+	{
+		AddDuplicateRecords(options.duplicates, batch);
+	}
+	if (options.columns)
+	{
+		WriteSelectedColumns(batch, AddressColumnText, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		for (u32 account_index = 0; account_index < batch->count; account_index++)
+		{
+			Customer_account* account = &batch->accounts[account_index];
+
+			Arrow_column* columns = arrow->columns;
+			ArrowAppendText(&columns[0], account->id);
+			ArrowAppendText(&columns[1], account->first_name);
+			ArrowAppendText(&columns[2], account->last_name_or_company_name);
+			ArrowAppendText(&columns[3], account->address.line_1);
+			ArrowAppendText(&columns[4], account->address.line_2);
+			ArrowAppendText(&columns[5], account->address.city);
+			ArrowAppendText(&columns[6], account->address.province);
+			ArrowAppendText(&columns[7], account->address.postal_code);
+			ArrowAppendText(&columns[8], account->phone_number);
+			ArrowAppendText(&columns[9], account->fax_number);
+			ArrowAppendText(&columns[10], account->tax_authority);
+			ArrowAppendText(&columns[11], TaxExemption(account));
+			u32 column = 12;
+			if (options.memo_table)
+			{
+				ArrowAppendText(&columns[column++], FindMemoExemption(options.memo_table, account->id));
+			}
+			ArrowAppendText(&columns[column], account->type == 'O' ? "Yes" : "No");
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	for (u32 account_index = 0; account_index < batch->count; account_index++)
+	{
+		Customer_account* account = &batch->accounts[account_index];
+
+		char buffer[512] = {0};
+		if (options.debug_output)
+		{
+			sprintf_s(buffer, sizeof(buffer),
+		        "%9s %c %-4s %c %s %-95s %s\n                       %-27s %-27s %-20s %-2s %-10s FAX %s\n",
+		        account->id,
+		        account->type,
+		        account->tax_authority,
+		        account->price_level,
+		        account->payment_code,
+		        account->original_name,
+		        account->phone_number[0] == '\0' ? "(807) 597-" : account->phone_number,
+		        account->address.line_1,
+		        account->address.line_2,
+		        account->address.city,
+		        account->address.province,
+		        account->address.postal_code,
+		        account->fax_number[0] == '\0' ? "(807) 597-" : account->fax_number
+			   	);
+		}
+		else
+		{
+			sprintf_s(buffer, sizeof(buffer),
+		        "%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s%s%s|%s\n",
+		        account->id,
+		        account->first_name,
+		        account->last_name_or_company_name,
+		        account->address.line_1,
+		        account->address.line_2,
+		        account->address.city,
+		        account->address.province,
+		        account->address.postal_code,
+		        account->phone_number,
+		        account->fax_number,
+		        TaxExemption(account),
+		        options.memo_table ? "|" : "",
+		        options.memo_table ? FindMemoExemption(options.memo_table, account->id) : "",
+		        account->type == 'O' ? "Yes" : "No"
+		        );
+		}
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+typedef enum
+{
+	memo_column_id,
+	memo_column_memo,
+	memo_column_email,
+	memo_column_status_number,
+	memo_column_exemption,
+	memo_column_count
+} Memo_column;
+
+Output_column memo_columns[memo_column_count] =
+{
+	{"Cust ID", arrow_utf8, 0},
+	{"Memo", arrow_utf8, FIELD(memo_lines)},
+	{"Email", arrow_utf8, FIELD(memo_lines) | FIELD(memo_extracted)},
+	{"Status Number", arrow_utf8, FIELD(memo_lines) | FIELD(memo_extracted)},
+	{"Exemption Note", arrow_utf8, FIELD(memo_lines) | FIELD(memo_extracted)},
+};
+
+char memo_headings[] = "Cust ID|Memo|Email|Status Number|Exemption Note"; // Of the usual output.
+
+void AddAccountMemoColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < memo_column_count; column++)
+	{
+		ArrowAddColumn(arrow, memo_columns[column].name, memo_columns[column].type);
+	}
+}
+
+// The memo lines in the order of the pipe-delimited output, without the blanks left by empty lines.
+void JoinMemoLines(Customer_memo* memo, char* text, size_t size)
+{
+	char* lines[7] = {
+		memo->rum_line_1, memo->rum_line_2, memo->rum_line_3, memo->rum_line_4,
+		memo->sum_line_1, memo->sum_line_2, memo->sum_line_3 };
+
+	size_t length = 0;
+	text[0] = '\0';
+	for (u32 line = 0; line < 7; line++)
+	{
+		if (lines[line][0] != '\0')
+		{
+			length += sprintf_s(text + length, size - length, length ? " %s" : "%s", lines[line]);
+		}
+	}
+}
+
+char* MemoColumnText(Customer_account* account, u32 column, char* buffer, size_t size, Program_options options)
+{
+	switch (column)
+	{
+		case memo_column_id:				return account->id;
+		case memo_column_memo:				JoinMemoLines(&account->memo, buffer, size); return buffer;
+		case memo_column_email:				return account->memo.email;
+		case memo_column_status_number:		return account->memo.status_number;
+		case memo_column_exemption:			return account->memo.exemption;
+		default:							return "";
+	}
+}
+
+void WriteAccountMemos(Customer_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.columns)
+	{
+		WriteSelectedColumns(batch, MemoColumnText, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		for (u32 account_index = 0; account_index < batch->count; account_index++)
+		{
+			Customer_account* account = &batch->accounts[account_index];
+			char memo[512];
+			JoinMemoLines(&account->memo, memo, sizeof(memo));
+
+			ArrowAppendText(&arrow->columns[0], account->id);
+			ArrowAppendText(&arrow->columns[1], memo);
+			ArrowAppendText(&arrow->columns[2], account->memo.email);
+			ArrowAppendText(&arrow->columns[3], account->memo.status_number);
+			ArrowAppendText(&arrow->columns[4], account->memo.exemption);
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	if (!output_file && !options.print_to_screen) // Only reading the memos for the address report.
+	{
+		return;
+	}
+
+	for (u32 account_index = 0; account_index < batch->count; account_index++)
+	{
+		Customer_account* account = &batch->accounts[account_index];
+
+		char buffer[512] = {0}; // This should be big enough for even the longest memo.
+		if (options.debug_output)
+		{
+			sprintf_s(buffer, sizeof(buffer),
+					"%10s-00          %-25s %s\n                       %-25s %s\n                       %-25s %s\n                       %s\n",
+					account->id,
+					account->memo.rum_line_1,
+					account->memo.sum_line_1,
+					account->memo.rum_line_2,
+					account->memo.sum_line_2,
+					account->memo.rum_line_3,
+					account->memo.sum_line_3,
+					account->memo.rum_line_4
+					);
+		}
+		else
+		{
+			sprintf_s(buffer, sizeof(buffer),
+					"%s|%s %s %s %s %s %s %s|%s|%s|%s\n",
+					account->id,
+					account->memo.rum_line_1,
+					account->memo.rum_line_2,
+					account->memo.rum_line_3,
+					account->memo.rum_line_4,
+					account->memo.sum_line_1,
+					account->memo.sum_line_2,
+					account->memo.sum_line_3,
+					account->memo.email,
+					account->memo.status_number,
+					account->memo.exemption
+					);
+		}
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+// Where the fields of each record line start in the version of ProfitMaster the reports were taken from (see
+// layout.h). The page headers of the IRL reports have no column headings, so only the data can move them.
+Layout_field account_layout[account_field_count] =
+{
+	{"Location", NULL, 0, 2, false},
+	{"Cust ID", NULL, 3, 9, true},
+	{"Type", NULL, 13, 1, false},
+	{"Tax Authority", NULL, 16, 4, false},
+	{"Price Level", NULL, 21, 1, false},
+	{"Payment Code", NULL, 23, 2, false},
+	{"Name", NULL, 26, 26, false},
+	{"Phone", NULL, 53, 8, false},
+	{"Credit Limit", NULL, 62, 7, true},
+	{"Balance", NULL, 70, 10, true},
+	{"YTD Sales", NULL, 82, 8, true},
+	{"YTD Finance Charges", NULL, 92, 11, true},
+	{"Account Setup", NULL, 104, 8, false},
+	{"Last Payment", NULL, 114, 8, false},
+	{"Last Purchase", NULL, 124, 8, false},
+};
+
+// The address report has two lines to an account, in one layout: the phone number on the first line and the
+// fax number on the second are in the same column.
+typedef enum
+{
+	address_layout_id,
+	address_layout_type,
+	address_layout_tax_authority,
+	address_layout_price_level,
+	address_layout_payment_code,
+	address_layout_name,
+	address_layout_line_1,
+	address_layout_line_2,
+	address_layout_city,
+	address_layout_province,
+	address_layout_postal_code,
+	address_layout_phone,
+	address_layout_field_count
+} Address_layout_field;
+
+Layout_field address_layout[address_layout_field_count] =
+{
+	{"Cust ID", NULL, 0, 9, true},
+	{"Type", NULL, 10, 1, false},
+	{"Tax Authority", NULL, 12, 4, false},
+	{"Price Level", NULL, 17, 1, false},
+	{"Payment Code", NULL, 19, 2, false},
+	{"Name", NULL, 22, 27, false},
+	{"Address1", NULL, 23, 27, false},
+	{"Address2", NULL, 51, 27, false},
+	{"City", NULL, 79, 17, false},
+	{"Prov", NULL, 100, 2, false},
+	{"Postal Cd", NULL, 103, 10, false},
+	{"PhoneNo", NULL, 118, 14, false},
+};
+
+typedef enum
+{
+	memo_layout_id,
+	memo_layout_rum, // The memos on the left.
+	memo_layout_sum, // And those on the right.
+	memo_layout_field_count
+} Memo_layout_field;
+
+Layout_field memo_layout[memo_layout_field_count] =
+{
+	{"Cust ID", NULL, 1, 9, true},
+	{"Memo", NULL, 23, 25, false},
+	{"Memo", NULL, 49, 40, false},
+};
+
+// The fields of each record line, checked as it is parsed (see anomaly.h) and compared by --where (see
+// filter.h). They start where the report's layout puts them. A record line must reach its last required field;
+// the fields after it may be left blank, and the line cut short after the last one filled in.
+Field_check account_fields[account_field_count] =
+{
+	{"Location", 0, 2, field_code},
+	{"Cust ID", 0, 9, field_code},
+	{"Type", 0, 1, field_code},
+	{"Tax Authority", 0, 4, field_code},
+	{"Price Level", 0, 1, field_code},
+	{"Payment Code", 0, 2, field_code},
+	{"Name", 0, 26, field_text},
+	{"Phone", 0, 8, field_code},
+	{"Credit Limit", 0, 7, field_money},
+	{"Balance", 0, 12, field_money},
+	{"YTD Sales", 0, 10, field_money},
+	{"YTD Finance Charges", 0, 12, field_money},
+	{"Account Setup", 0, 8, field_date},
+	{"Last Payment", 0, 8, field_date},
+	{"Last Purchase", 0, 8, field_date},
+};
+
+Field_check address_name_fields[] =
+{
+	{"Cust ID", 0, 9, field_code},
+	{"Type", 0, 1, field_code},
+	{"Tax Authority", 0, 4, field_code},
+	{"Price Level", 0, 1, field_code},
+	{"Payment Code", 0, 2, field_code},
+	{"Name", 0, 27, field_text},
+	{"PhoneNo", 0, 17, field_text},
+};
+
+Field_check address_fields[] =
+{
+	{"Address1", 0, 27, field_text},
+	{"Address2", 0, 27, field_text},
+	{"City", 0, 17, field_text},
+	{"Prov", 0, 2, field_code},
+	{"Postal Cd", 0, 10, field_code},
+	{"FaxNo", 0, 14, field_text},
+};
+
+Field_check memo_id_fields[] =
+{
+	{"Cust ID", 0, 9, field_code},
+	{"Memo", 0, 25, field_text},
+	{"Memo", 0, 40, field_text},
+};
+
+// The lines after the first, with anything before the memos checked as text.
+Field_check memo_fields[] =
+{
+	{"Memo", 0, 23, field_text},
+	{"Memo", 0, 25, field_text},
+	{"Memo", 0, 40, field_text},
+};
+
+void ParseAccountBalances(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
 	size_t line_position	= 0;
 	i32 page_header_line	= 8; // Reports start with a header.
 
-	Customer_account account = {0};
-	Customer_account account_reset = {0};
+	Memory_arena arena = AllocateArena(RECORD_BATCH_SIZE * sizeof(Customer_account));
+	Customer_batch batch = {0};
+	batch.accounts = PushArray(&arena, RECORD_BATCH_SIZE, Customer_account);
 
-	if (output_file && !options.debug_output)
+	u32 column[account_field_count];
+	InferLayout(&summary->layout, account_layout, account_field_count, data, 7, NULL);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
+
+	Field_check line_fields[account_field_count];
+	for (u32 field = 0; field < account_field_count; field++)
 	{
-		fprintf(output_file, "Cust ID|Credit Limit|Current Balance\n");
+		line_fields[field] = account_fields[field];
+		line_fields[field].start = column[field];
+	}
+	Line_check account_check; // An account line must reach its setup date.
+	CompileLineCheck(&account_check, line_fields, ArrayCount(line_fields), column[account_date_setup] + 8);
+
+	if (output_file && options.columns)
+	{
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
+	{
+		fprintf(output_file, "%s\n", account_headings);
+	}
+	if (arrow && options.columns)
+	{
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddAccountBalanceColumns(arrow);
 	}
 
 	while (data[index])
@@ -99,6 +1359,7 @@ void ParseAccountBalances(char* data, FILE* output_file, Program_options options
 			if (line_position == 0)
 			{
 				// loop over header lines
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && page_header_line > 0) // data[index] != '\0' is necessary in the case the report ends with a header.
 				{
 					if (data[index] == '\n')
@@ -108,109 +1369,92 @@ void ParseAccountBalances(char* data, FILE* output_file, Program_options options
 					index++;
 				}
 				page_header_line = 8;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_accounts);
 				summary->num_pages++;
 				continue;
 			}
 
 			line_start_index = index - line_position;
-
-			FillTextFieldAndTrim(account.location, &data[line_start_index], 2);
-			FillTextFieldAndTrim(account.id, &data[line_start_index + 3], 9);
-			account.type = data[line_start_index + 13];
-			FillTextFieldAndTrim(account.tax_authority, &data[line_start_index + 16], 4);
-			account.price_level = data[line_start_index + 21];
-			FillTextFieldAndTrim(account.payment_code, &data[line_start_index + 23], 2);
-			FillTextFieldAndTrim(account.last_name_or_company_name, &data[line_start_index + 26], 26);
-			FillTextFieldAndTrim(account.phone_number, &data[line_start_index + 53], 8);
-			FillTextFieldAndTrim(account.credit_limit, &data[line_start_index + 62], 7);
-			FillTextFieldAndTrim(account.balance, &data[line_start_index + 70], 10);
-			FillTextFieldAndTrim(account.balance_credit, &data[line_start_index + 80], 2);
-			FillTextFieldAndTrim(account.ytd_sales, &data[line_start_index + 82], 8);
-			FillTextFieldAndTrim(account.ytd_sales_credit, &data[line_start_index + 90], 2);
-			FillTextFieldAndTrim(account.ytd_fin_charges, &data[line_start_index + 92], 12);
-			FillTextFieldAndTrim(account.date_account_setup, &data[line_start_index + 104], 8);
-			if (line_position > 113)
-			{
-				FillTextFieldAndTrim(account.date_last_payment, &data[line_start_index + 114], MIN(line_position - 114, 8));
-			}
-			if (line_position > 123)
-			{
-				FillTextFieldAndTrim(account.date_last_purchase, &data[line_start_index + 124], MIN(line_position - 124, 8));
-			}
+			char* line = &data[line_start_index];
 
 			if (line_position == 69) // @HACK: ensure that we don't include summary lines in our account total.
 			{
+				summary->report_total = ReadLineTotal(line, line_position, total_count);
+				summary->report_balance = ReadFooterTotal(NextFooterLine(line), total_amount);
 				break;
 			}
-
-			char buffer[256] = {0};
-			if (options.debug_output)
-			{
-				sprintf_s(buffer, sizeof(buffer),
-			        "%2s %9s-%c  %-4s %c %s %-26s %8s %7s %10s%s %10s%s %11s %-9s %-9s %8s\n",
-			        account.location,
-			        account.id,
-			        account.type,
-			        account.tax_authority,
-			        account.price_level,
-			        account.payment_code,
-			        account.last_name_or_company_name,
-			        account.phone_number,
-			        account.credit_limit,
-			        account.balance,
-			        account.balance_credit,
-			        account.ytd_sales,
-			        account.ytd_sales_credit,
-			        account.ytd_fin_charges,
-			        account.date_account_setup,
-			        account.date_last_payment[0] != '\0' ? account.date_last_payment : "",
-			        account.date_last_purchase[0] != '\0' ? account.date_last_purchase : ""
-				   	);
-			}
-			else
+			Customer_account* account = &batch.accounts[batch.count];
+			CheckRecordLine(options.anomalies, line, line_position, &account_check);
+
+			bool keep = !options.filter || FilterLine(options.filter, 0, line_fields, line, line_position);
+			u64 fields = keep ? options.fields : 0;
+			if (fields & FIELD(account_location))
+				FillLineField(account->location, line, line_position, column[account_location], 2);
+			if (fields & FIELD(account_id))
+				FillLineField(account->id, line, line_position, column[account_id], 9);
+			if (fields & FIELD(account_type))
+				account->type = (line_position > column[account_type]) ? line[column[account_type]] : ' ';
+			if (fields & FIELD(account_tax_authority))
+				FillLineField(account->tax_authority, line, line_position, column[account_tax_authority], 4);
+			if (fields & FIELD(account_price_level))
+				account->price_level = (line_position > column[account_price_level]) ? line[column[account_price_level]] : ' ';
+			if (fields & FIELD(account_payment_code))
+				FillLineField(account->payment_code, line, line_position, column[account_payment_code], 2);
+			if (fields & FIELD(account_name))
+				FillLineField(account->last_name_or_company_name, line, line_position, column[account_name], 26);
+			if (fields & FIELD(account_phone))
+				FillLineField(account->phone_number, line, line_position, column[account_phone], 8);
+			if (fields & FIELD(account_credit_limit))
+				FillLineField(account->credit_limit, line, line_position, column[account_credit_limit], 7);
+			// Always: reconciled with the report's TOTAL BALANCE.
+			FillLineField(account->balance, line, line_position, column[account_balance], 10);
+			FillLineField(account->balance_credit, line, line_position, column[account_balance] + 10, 2);
+			i64 balance = 0;
+			ParseMoneyCents(account->balance, &balance);
+			summary->total_balance += (account->balance_credit[0] == 'C' && account->balance_credit[1] == 'R') ? -balance : balance;
+			if (fields & FIELD(account_ytd_sales))
 			{
-				bool limit_zero = false;
-				bool balance_minus = false;
-				bool balance_zero = false;
-				if (account.credit_limit[0] == '\0')
-				{
-					limit_zero = true;
-				}
-				if (account.balance_credit[0] == 'C' && account.balance_credit[1] == 'R')
-				{
-					balance_minus = true;
-				}
-				if (account.balance[0] == '.' && account.balance[1] == '0' && account.balance[2] == '0')
-				{
-					balance_zero = true;
-				}
-				sprintf_s(buffer, sizeof(buffer),
-					"%s|%s|%s%s\n",
-					account.id,
-					limit_zero ? "0" : account.credit_limit,
-					balance_minus ? "-" : "",
-					balance_zero ? "0" : account.balance);
+				FillLineField(account->ytd_sales, line, line_position, column[account_ytd_sales], 8);
+				FillLineField(account->ytd_sales_credit, line, line_position, column[account_ytd_sales] + 8, 2);
 			}
+			if (fields & FIELD(account_ytd_fin_charges))
+				FillLineField(account->ytd_fin_charges, line, line_position, column[account_ytd_fin_charges], 12);
+			if (fields & FIELD(account_date_setup))
+				FillLineField(account->date_account_setup, line, line_position, column[account_date_setup], 8);
+			if (fields & FIELD(account_date_last_payment))
+				FillLineField(account->date_last_payment, line, line_position, column[account_date_last_payment], 8);
+			if (fields & FIELD(account_date_last_purchase))
+				FillLineField(account->date_last_purchase, line, line_position, column[account_date_last_purchase], 8);
 
-			if (output_file)
+			summary->num_accounts++;
+			if (!keep) // Counted, but not written.
 			{
-				fprintf(output_file, "%s", buffer);
+				memset(account, 0, sizeof(*account)); // The slot is reused.
+				summary->num_left_out++;
 			}
-			if (options.print_to_screen)
+			else if (++batch.count == RECORD_BATCH_SIZE)
 			{
-				printf("%s", buffer);
+				Phase_start format_start = BeginPhase(&summary->timings);
+				WriteAccountBalances(&batch, output_file, arrow, options);
+				EndPhase(&summary->timings, phase_format, format_start);
+				ResetArena(&arena);
+				batch.accounts = PushArray(&arena, RECORD_BATCH_SIZE, Customer_account);
+				batch.count = 0;
 			}
 
-			account = account_reset;
 			line_position = 0;
-
-			summary->num_accounts++;
 			index++;
 		}
 	}
+
+	Phase_start format_start = BeginPhase(&summary->timings);
+	WriteAccountBalances(&batch, output_file, arrow, options);
+	EndPhase(&summary->timings, phase_format, format_start);
+	FreeArena(&arena);
 }
 
-void ParseAccountAddresses(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+void ParseAccountAddresses(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
@@ -218,14 +1462,58 @@ void ParseAccountAddresses(char* data, FILE* output_file, Program_options option
 	i32 semicolon_position  = 0;
 	u32 page_header_line	= 7;
 	u32 account_line		= 0;
-
-	Customer_account account = {0};
-	Customer_account empty_account = {0};
+	bool left_out			= false; // The account does not match --where.
+
+	Memory_arena arena = AllocateArena(RECORD_BATCH_SIZE * sizeof(Customer_account));
+	Customer_batch batch = {0};
+	batch.accounts = PushArray(&arena, RECORD_BATCH_SIZE, Customer_account);
+
+	u32 column[address_layout_field_count];
+	InferLayout(&summary->layout, address_layout, address_layout_field_count, data, 6, NULL);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
+
+	// The layout field each checked field is in.
+	u32 name_layout[ArrayCount(address_name_fields)] = {address_layout_id, address_layout_type, address_layout_tax_authority,
+		address_layout_price_level, address_layout_payment_code, address_layout_name, address_layout_phone};
+	u32 line_layout[ArrayCount(address_fields)] = {address_layout_line_1, address_layout_line_2, address_layout_city,
+		address_layout_province, address_layout_postal_code, address_layout_phone};
+	Field_check name_fields[ArrayCount(address_name_fields)];
+	for (u32 field = 0; field < ArrayCount(name_fields); field++)
+	{
+		name_fields[field] = address_name_fields[field];
+		name_fields[field].start = column[name_layout[field]];
+	}
+	Field_check line_fields[ArrayCount(address_fields)];
+	for (u32 field = 0; field < ArrayCount(line_fields); field++)
+	{
+		line_fields[field] = address_fields[field];
+		line_fields[field].start = column[line_layout[field]];
+	}
+	Line_check address_name_check, address_check; // The first line must reach the name.
+	CompileLineCheck(&address_name_check, name_fields, ArrayCount(name_fields), column[address_layout_name] + 1);
+	CompileLineCheck(&address_check, line_fields, ArrayCount(line_fields), 0);
 
 	// Output table headers
-	if (output_file && !options.debug_output)
+	if (output_file && options.columns)
 	{
-		fprintf(output_file, "Cust ID|First Name|Last Name or Company Name|Address1|Address2|City|Prov|Postal Cd|PhoneNo|FaxNo|Tax Exemption|House Acct\n");
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
+	{
+		fprintf(output_file, address_headings, options.memo_table ? "Exemption Info|" : "");
+		fprintf(output_file, "\n");
+	}
+	if (arrow && options.columns)
+	{
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddAccountAddressColumns(arrow, options);
+	}
+	if (options.normalize)
+	{
+		InitNormalizeTables();
 	}
 
 	while (data[index])
@@ -239,6 +1527,7 @@ void ParseAccountAddresses(char* data, FILE* output_file, Program_options option
 		{
 			if (page_header_line > 0)
 			{
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && (page_header_line > 0)) // skip header lines
 				{
 					if (data[index] == '\n')
@@ -248,125 +1537,93 @@ void ParseAccountAddresses(char* data, FILE* output_file, Program_options option
 					index++;
 				}
 				account_line = 1;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_accounts);
 				summary->num_pages++;
 				/*index++;*/
 				continue;
 			}
 
 			line_start_index = index - line_position;
+			char* line = &data[line_start_index];
+			Customer_account* account = &batch.accounts[batch.count];
 
 			if (account_line == 1)
 			{
-				FillTextFieldAndTrim(account.id, &data[line_start_index], 9);
-				account.type = data[line_start_index + 10];
-				FillTextFieldAndTrim(account.tax_authority, &data[line_start_index + 12], 4);
-				account.price_level = data[line_start_index + 17];
-				FillTextFieldAndTrim(account.payment_code, &data[line_start_index + 19], 2);
-				FillTextFieldAndTrim(account.last_name_or_company_name, &data[line_start_index + 22], 27);
-				FillTextFieldAndTrim(account.original_name, &data[line_start_index + 22], 27);
-
-				semicolon_position = FindCharInString(account.last_name_or_company_name, ';');
-				if (semicolon_position >= 0)
+				FillLineField(account->id, line, line_position, column[address_layout_id], 9);
+				if (account->id[0]) // Not the summary line.
 				{
-					memcpy(account.first_name, account.last_name_or_company_name, sizeof(char) * semicolon_position);
-					size_t last_name_length = strlen(account.last_name_or_company_name);
-					memmove(account.last_name_or_company_name, account.last_name_or_company_name + semicolon_position + 1, last_name_length - semicolon_position);
-					account.last_name_or_company_name[last_name_length - semicolon_position] = '\0';
+					CheckRecordLine(options.anomalies, line, line_position, &address_name_check);
+				}
+				else
+				{
+					summary->report_total = ReadLineTotal(line, line_position, total_count);
+				}
+				left_out = options.filter && !FilterLine(options.filter, 0, name_fields, line, line_position);
+				u64 fields = left_out ? 0 : options.fields;
+				if (fields & FIELD(address_type))
+					account->type = (line_position > column[address_layout_type]) ? line[column[address_layout_type]] : ' ';
+				if (fields & FIELD(address_tax_authority))
+					FillLineField(account->tax_authority, line, line_position, column[address_layout_tax_authority], 4);
+				if (fields & FIELD(address_price_level))
+					account->price_level = (line_position > column[address_layout_price_level]) ? line[column[address_layout_price_level]] : ' ';
+				if (fields & FIELD(address_payment_code))
+					FillLineField(account->payment_code, line, line_position, column[address_layout_payment_code], 2);
+				if (fields & FIELD(address_name))
+				{
+					FillLineField(account->last_name_or_company_name, line, line_position, column[address_layout_name], 27);
+					FillLineField(account->original_name, line, line_position, column[address_layout_name], 27);
+
+					semicolon_position = FindCharInString(account->last_name_or_company_name, ';');
+					if (semicolon_position >= 0)
+					{
+						memcpy(account->first_name, account->last_name_or_company_name, sizeof(char) * semicolon_position);
+						size_t last_name_length = strlen(account->last_name_or_company_name);
+						memmove(account->last_name_or_company_name, account->last_name_or_company_name + semicolon_position + 1, last_name_length - semicolon_position);
+						account->last_name_or_company_name[last_name_length - semicolon_position] = '\0';
+					}
 				}
 
-				if (line_position > 128)
-					FillTextFieldAndTrim(account.phone_number, &data[line_start_index + 118], MIN(line_position - 17, 17));
+				if (line_position > column[address_layout_phone] + 10 && (fields & FIELD(address_phone)))
+					FillLineField(account->phone_number, line, line_position, column[address_layout_phone], 17);
 
 				account_line++;
 			}
 			else if (account_line == 2)
 			{
-				if (line_position > 23)
-					FillTextFieldAndTrim(account.address.line_1, &data[line_start_index + 23], MIN(line_position - 23, 27));
-
-				if (line_position > 51)
-					FillTextFieldAndTrim(account.address.line_2, &data[line_start_index + 51], MIN(line_position - 51, 27));
-
-				if (line_position > 79)
-					FillTextFieldAndTrim(account.address.city, &data[line_start_index + 79], MIN(line_position - 79, 17));
-
-				if (line_position > 100)
-					FillTextFieldAndTrim(account.address.province, &data[line_start_index + 100], MIN(line_position - 100, 2));
+				if (account->id[0])
+				{
+					CheckRecordLine(options.anomalies, line, line_position, &address_check);
+				}
+				if (options.filter && !left_out)
+				{
+					left_out = !FilterLine(options.filter, 1, line_fields, line, line_position);
+				}
 
-				if (line_position > 103)
-					FillTextFieldAndTrim(account.address.postal_code, &data[line_start_index + 103], MIN(line_position - 103, 10));
+				u64 fields = left_out ? 0 : options.fields;
+				if (line_position > column[address_layout_line_1] && (fields & FIELD(address_line_1)))
+					FillTextFieldAndTrim(account->address.line_1, &line[column[address_layout_line_1]], MIN(line_position - column[address_layout_line_1], 27));
 
-				if (line_position > 128)
-					FillTextFieldAndTrim(account.fax_number, &data[line_start_index + 118], MIN(line_position - 17, 14));
+				if (line_position > column[address_layout_line_2] && (fields & FIELD(address_line_2)))
+					FillTextFieldAndTrim(account->address.line_2, &line[column[address_layout_line_2]], MIN(line_position - column[address_layout_line_2], 27));
 
-				if (account.id[0] == '\0') // break loop when out of records.
-				{
-					break;
-				}
+				if (line_position > column[address_layout_city] && (fields & FIELD(address_city)))
+					FillTextFieldAndTrim(account->address.city, &line[column[address_layout_city]], MIN(line_position - column[address_layout_city], 17));
 
-				char buffer[512] = {0};
-				if (options.debug_output)
-				{
-					sprintf_s(buffer, sizeof(buffer),
-				        "%9s %c %-4s %c %s %-95s %s\n                       %-27s %-27s %-20s %-2s %-10s FAX %s\n",
-				        account.id,
-				        account.type,
-				        account.tax_authority,
-				        account.price_level,
-				        account.payment_code,
-				        account.original_name,
-				        account.phone_number[0] == '\0' ? "(807) 597-" : account.phone_number,
-				        account.address.line_1,
-				        account.address.line_2,
-				        account.address.city,
-				        account.address.province,
-				        account.address.postal_code,
-				        account.fax_number[0] == '\0' ? "(807) 597-" : account.fax_number
-					   	);
-				}
-				else
-				{
-					char* tax_exemptions = {0};
-					if (strcmp(account.tax_authority, "EXEM") == 0)
-					{
-						tax_exemptions = "Exempt";
-					}
-					else if (strcmp(account.tax_authority, "ONFN") == 0)
-					{
-						tax_exemptions = "GST";
-					}
-					else // else if (strcmp(account.tax_authority, "ON") == 0)
-					{
-						tax_exemptions = "Tax";
-					}
+				if (line_position > column[address_layout_province] && (fields & FIELD(address_province)))
+					FillTextFieldAndTrim(account->address.province, &line[column[address_layout_province]], MIN(line_position - column[address_layout_province], 2));
 
-					sprintf_s(buffer, sizeof(buffer),
-				        "%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s\n",
-				        account.id,
-				        account.first_name,
-				        account.last_name_or_company_name,
-				        account.address.line_1,
-				        account.address.line_2,
-				        account.address.city,
-				        account.address.province,
-				        account.address.postal_code,
-				        account.phone_number,
-				        account.fax_number,
-				        tax_exemptions,
-				        account.type == 'O' ? "Yes" : "No"
-				        );
-				}
+				if (line_position > column[address_layout_postal_code] && (fields & FIELD(address_postal_code)))
+					FillTextFieldAndTrim(account->address.postal_code, &line[column[address_layout_postal_code]], MIN(line_position - column[address_layout_postal_code], 10));
 
-				if (output_file)
-				{
-					fprintf(output_file, "%s", buffer);
-				}
-				if (options.print_to_screen)
+				if (line_position > column[address_layout_phone] + 10 && (fields & FIELD(address_fax)))
+					FillLineField(account->fax_number, line, line_position, column[address_layout_phone], 14);
+
+				if (account->id[0] == '\0') // break loop when out of records.
 				{
-					printf("%s", buffer);
+					break;
 				}
 
-				account = empty_account; // reset struct.
 				account_line = 1;
 
 				summary->num_accounts++;
@@ -374,30 +1631,85 @@ void ParseAccountAddresses(char* data, FILE* output_file, Program_options option
 				{
 					page_header_line = 7;
 				}
+				if (left_out) // Counted, but not written.
+				{
+					memset(account, 0, sizeof(*account)); // The slot is reused.
+					summary->num_left_out++;
+				}
+				else if (++batch.count == RECORD_BATCH_SIZE)
+				{
+					Phase_start format_start = BeginPhase(&summary->timings);
+					WriteAccountAddresses(&batch, output_file, arrow, options);
+					EndPhase(&summary->timings, phase_format, format_start);
+					ResetArena(&arena);
+					batch.accounts = PushArray(&arena, RECORD_BATCH_SIZE, Customer_account);
+					batch.count = 0;
+				}
 			}
 
 			line_position = 0;
 			index++;
 		}
 	}
+
+	Phase_start format_start = BeginPhase(&summary->timings);
+	WriteAccountAddresses(&batch, output_file, arrow, options);
+	EndPhase(&summary->timings, phase_format, format_start);
+	FreeArena(&arena);
 }
 
-void ParseAccountMemos(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+void ParseAccountMemos(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
 	size_t line_position	= 0;
 	u32 page_header_line	= 6; // Reports start with a header.
 	u32 account_line		= 0;
+	bool left_out			= false; // The account does not match --where.
+
+	Memory_arena arena = AllocateArena(RECORD_BATCH_SIZE * sizeof(Customer_account));
+	Customer_batch batch = {0};
+	batch.accounts = PushArray(&arena, RECORD_BATCH_SIZE, Customer_account);
+
+	u32 column[memo_layout_field_count];
+	InferLayout(&summary->layout, memo_layout, memo_layout_field_count, data, 5, NULL);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
 
-	Customer_account account = {0};
-	Customer_account empty_account = {0};
+	Field_check id_fields[ArrayCount(memo_id_fields)];
+	Field_check line_fields[ArrayCount(memo_fields)];
+	for (u32 field = 0; field < memo_layout_field_count; field++)
+	{
+		id_fields[field] = memo_id_fields[field];
+		id_fields[field].start = column[field];
+		line_fields[field] = memo_fields[field];
+		line_fields[field].start = column[field];
+	}
+	line_fields[memo_layout_id].start = 0; // Up to the first memo.
+	line_fields[memo_layout_id].length = column[memo_layout_rum];
+	Line_check memo_id_check, memo_check; // The first line must reach the customer id.
+	CompileLineCheck(&memo_id_check, id_fields, ArrayCount(id_fields), column[memo_layout_id] + 9);
+	CompileLineCheck(&memo_check, line_fields, ArrayCount(line_fields), 0);
 
-	if (output_file && !options.debug_output)
+	if (output_file && options.columns)
+	{
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
 	{
-		fprintf(output_file, "Cust ID|Memo\n");
+		fprintf(output_file, "%s\n", memo_headings);
+	}
+	if (arrow && options.columns)
+	{
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddAccountMemoColumns(arrow);
 	}
 
+	Pattern_scanner scanner;
+	CompileMemoScanner(&scanner);
+
 	while (data[index])
 	{
 		if (data[index] != '\n')
@@ -409,6 +1721,7 @@ void ParseAccountMemos(char* data, FILE* output_file, Program_options options, R
 		{
 			if (page_header_line > 0)
 			{
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && (page_header_line > 0)) // Skip header lines.
 				{
 					if (data[index] == '\n')
@@ -418,109 +1731,124 @@ void ParseAccountMemos(char* data, FILE* output_file, Program_options options, R
 					index++;
 				}
 				account_line = 1;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_accounts);
 				summary->num_pages++;
 				continue;
 			}
 
 			line_start_index = index - line_position;
+			char* line = &data[line_start_index];
+			Customer_account* account = &batch.accounts[batch.count];
+
+			if (account_line == 1)
+			{
+				CheckRecordLine(options.anomalies, line, line_position, &memo_id_check);
+			}
+			else
+			{
+				CheckRecordLine(options.anomalies, line, line_position, &memo_check);
+			}
 
+			if (options.filter && account_line == 1)
+			{
+				left_out = !FilterLine(options.filter, 0, id_fields, line, line_position);
+			}
+			bool lines = !left_out && (options.fields & FIELD(memo_lines));
 			switch (account_line)
 			{
 				case 1:
 				{
-					FillTextFieldAndTrim(account.id, &data[line_start_index + 1], 9);
+					FillLineField(account->id, line, line_position, column[memo_layout_id], 9);
 
-					if (line_position > 23) // Must have at least one note on the first line.
-						FillTextFieldAndTrim(account.memo.rum_line_1, &data[line_start_index + 23], MIN(line_position - 23, 25));
+					if (line_position > column[memo_layout_rum] && lines) // Must have at least one note on the first line.
+						FillTextFieldAndTrim(account->memo.rum_line_1, &line[column[memo_layout_rum]], MIN(line_position - column[memo_layout_rum], 25));
 
-					if (line_position > 49) // Must have a SUM memo.
-						FillTextFieldAndTrim(account.memo.sum_line_1, &data[line_start_index + 49], line_position - 49);
+					if (line_position > column[memo_layout_sum] && lines) // Must have a SUM memo.
+						FillTextFieldAndTrim(account->memo.sum_line_1, &line[column[memo_layout_sum]], MIN(line_position - column[memo_layout_sum], 40));
 
 					break;
 				}
 				case 2:
 				{
-					if (line_position > 23)
-						FillTextFieldAndTrim(account.memo.rum_line_2, &data[line_start_index + 23], MIN(line_position - 23, 25));
+					if (line_position > column[memo_layout_rum] && lines)
+						FillTextFieldAndTrim(account->memo.rum_line_2, &line[column[memo_layout_rum]], MIN(line_position - column[memo_layout_rum], 25));
 
-					if (line_position > 49) // Must have a SUM memo.
-						FillTextFieldAndTrim(account.memo.sum_line_2, &data[line_start_index + 49], line_position - 49);
+					if (line_position > column[memo_layout_sum] && lines) // Must have a SUM memo.
+						FillTextFieldAndTrim(account->memo.sum_line_2, &line[column[memo_layout_sum]], MIN(line_position - column[memo_layout_sum], 40));
 
 					break;
 				}
 				case 3:
 				{
-					if (line_position > 23)
-						FillTextFieldAndTrim(account.memo.rum_line_3, &data[line_start_index + 23], MIN(line_position - 23, 25));
+					if (line_position > column[memo_layout_rum] && lines)
+						FillTextFieldAndTrim(account->memo.rum_line_3, &line[column[memo_layout_rum]], MIN(line_position - column[memo_layout_rum], 25));
 
-					if (line_position > 49) // Must have a SUM memo.
-						FillTextFieldAndTrim(account.memo.sum_line_3, &data[line_start_index + 49], line_position - 49);
+					if (line_position > column[memo_layout_sum] && lines) // Must have a SUM memo.
+						FillTextFieldAndTrim(account->memo.sum_line_3, &line[column[memo_layout_sum]], MIN(line_position - column[memo_layout_sum], 40));
 
 					break;
 				}
 				case 4:
 				{
-					if (line_position > 23)
-						FillTextFieldAndTrim(account.memo.rum_line_4, &data[line_start_index + 23], MIN(line_position - 23, 25));
+					if (line_position > column[memo_layout_rum] && lines)
+						FillTextFieldAndTrim(account->memo.rum_line_4, &line[column[memo_layout_rum]], MIN(line_position - column[memo_layout_rum], 25));
 				}
 			}
 
 			account_line++;
 			if (account_line > 4)
 			{
-				char buffer[512] = {0}; // This should be big enough for even the longest memo.
-				if (options.debug_output)
-				{
-					sprintf_s(buffer, sizeof(buffer),
-							"%10s-00          %-25s %s\n                       %-25s %s\n                       %-25s %s\n                       %s\n",
-							account.id,
-							account.memo.rum_line_1,
-							account.memo.sum_line_1,
-							account.memo.rum_line_2,
-							account.memo.sum_line_2,
-							account.memo.rum_line_3,
-							account.memo.sum_line_3,
-							account.memo.rum_line_4
-							);
-				}
-				else
-				{
-					sprintf_s(buffer, sizeof(buffer),
-							"%s|%s %s %s %s %s %s %s\n",
-							account.id,
-							account.memo.rum_line_1,
-							account.memo.rum_line_2,
-							account.memo.rum_line_3,
-							account.memo.rum_line_4,
-							account.memo.sum_line_1,
-							account.memo.sum_line_2,
-							account.memo.sum_line_3
-							);
-				}
+				account_line = 1;
 
-				if (output_file)
+				if (!left_out && ((options.fields & FIELD(memo_extracted)) || options.memo_table))
 				{
-					fprintf(output_file, "%s", buffer);
+					ExtractMemoFields(&scanner, &account->memo);
 				}
-				if (options.print_to_screen)
+				if (options.memo_table && (account->memo.status_number[0] || account->memo.exemption[0]))
 				{
-					printf("%s", buffer);
+					char info[64];
+					MemoExemptionInfo(&account->memo, info, sizeof(info));
+					AddMemoExemption(options.memo_table, account->id, info);
 				}
 
-				account = empty_account; // Reset struct.
-				account_line = 1;
-
 				summary->num_accounts++;
 				if ((summary->num_accounts % 13) == 0) // Each page contains exactly 13 accounts.
 				{   // Next line will be the start of a header.
 					page_header_line = 6;
 				}
+				if (left_out) // Counted, but not written.
+				{
+					memset(account, 0, sizeof(*account)); // The slot is reused.
+					summary->num_left_out++;
+				}
+				else if (++batch.count == RECORD_BATCH_SIZE)
+				{
+					Phase_start format_start = BeginPhase(&summary->timings);
+					WriteAccountMemos(&batch, output_file, arrow, options);
+					EndPhase(&summary->timings, phase_format, format_start);
+					ResetArena(&arena);
+					batch.accounts = PushArray(&arena, RECORD_BATCH_SIZE, Customer_account);
+					batch.count = 0;
+				}
 			}
 
 			line_position = 0;
 			index++;
 		}
 	}
+
+	// The memos are indented, and the count is on the only line that is not.
+	char* last_line = LastFooterLine(data, index);
+	if (last_line && last_line[0] != ' ')
+	{
+		summary->report_total = ReadFooterTotal(last_line, total_count);
+	}
+
+	Phase_start format_start = BeginPhase(&summary->timings);
+	WriteAccountMemos(&batch, output_file, arrow, options);
+	EndPhase(&summary->timings, phase_format, format_start);
+	FreeArena(&arena);
 }
 
 #define USAGE_STRING "\
@@ -528,17 +1856,63 @@ void ParseAccountMemos(char* data, FILE* output_file, Program_options options, R
 John Hosick <john@atikokancastle.com>\n\n\
 %s is used to process a ProfitMaster IRL customer report and output a\n\
 pipe-delimited file for use in the conversion to CashierPRO.\n\n\
-USAGE: %s [OPTIONS] <reporttype> <inputfile> [outputfile]\n\
+USAGE: %s [OPTIONS] [reporttype] <inputfile> [outputfile]\n\
   REPORT TYPES:\n\
     account         Process a customer account listing report.\n\
     address         Process a customer address report.\n\
     memo            Process a customer memo report.\n\
+                    Without a report type, it is worked out from the report's header.\n\
   OPTIONS:\n\
+    -a, --anomalies <file>\n\
+                    Write the fields that do not look like what they should hold (a letter\n\
+                    in an amount, a line cut short, ...) to the file, with their line numbers.\n\
     -d, --debug     Dump output in original format (to check the correctness of the parse).\n\
+    -e, --encoding <code page>\n\
+                    Convert text from the report's code page (cp437, cp1252 or latin1)\n\
+                    to UTF-8. Without it, text is written exactly as it was read, except\n\
+                    in Feather files, which must be UTF-8 and take it to be cp1252.\n\
+    -f, --feather   Write the output file in Arrow IPC (Feather v2) format instead.\n\
     -h, --help      Show this help message.\n\
+    -m, --memos <memo report>\n\
+                    Add the exemption info (status card number and tax exemption notes)\n\
+                    found in the memo report to the address report, as Exemption Info.\n\
+    -n, --normalize Clean up the address report: title case names and cities, format phone\n\
+                    numbers and postal codes, drop placeholder phone numbers and update old\n\
+                    province codes.\n\
     -p, --print     Print to the screen. Note: This option does not preclude\n\
                     outputting to a file: If an output file is specified,\n\
-                    it will be created as well as displayed on the screen.\n"
+                    it will be created as well as displayed on the screen.\n\
+    -s, --stats     Show the time spent in each phase of the parse.\n\
+    -u, --duplicates <file>\n\
+                    Look for accounts in the address report that are probably the same\n\
+                    customer, and write them to the file in numbered groups.\n\
+        --stats-json\n\
+                    Also print the throughput and phase times as a line of JSON.\n\
+        --counters  Count cycles, instructions, branch and cache misses in each phase\n\
+                    (Linux only) and add them to the statistics.\n\
+        --no-progress\n\
+                    Do not show the progress of a long parse on the console.\n\
+        --allow-missing-totals\n\
+                    Do not fail if the report has no totals at its end to check the parse\n\
+                    against (reports from old versions of ProfitMaster).\n\
+        --fixed-layout\n\
+                    Parse with the built-in column layout even if the report's data shows\n\
+                    that its columns have moved.\n\
+        --columns <names>\n\
+                    Write only these columns, in this order (names of the Feather columns,\n\
+                    separated by commas), reading only the fields of the report they need.\n\
+        --where <filter>\n\
+                    Write only the accounts that match the filter, e.g. \"balance != 0 and\n\
+                    location = 01\" (see the instructions for what a filter can be).\n\
+        --sort-by <columns>\n\
+                    Sort the output file by these columns (separated by commas, each with\n\
+                    \" desc\" after it to sort it descending) instead of in report order.\n\
+        --sort-memory <megabytes>\n\
+                    The most memory --sort-by may use (default 256); a bigger output is\n\
+                    sorted in runs that are merged from disk.\n\
+        --serve <socket>\n\
+                    Keep running, and convert the reports asked for over the Unix domain\n\
+                    socket (Linux only). Any other arguments are ignored.\n"
 
 void PrintUsageAndExit(char *program_name)
 {
@@ -551,10 +1925,17 @@ int main(int argc, char *argv[])
 	char* program_name = argv[0];
 	char* file_input_name = {0};
 	char* file_output_name = {0};
+	char* file_anomalies_name = {0};
+	char* column_names = {0};
+	char* filter_text = {0};
+	char* sort_text = {0};
+	u32 sort_megabytes = SORT_DEFAULT_MEGABYTES;
+	char* file_memo_name = {0};
+	char* file_duplicates_name = {0};
 
 	Program_options options = {0};
 	
-	Report_type report_type = -1;
+	Report_type report_type = no_report;
 
 	if (argc < 2)
 	{
@@ -583,6 +1964,118 @@ int main(int argc, char *argv[])
 				{
 					options.debug_output = true;
 				}
+				else if (strcmp(option, "feather") == 0)
+				{
+					options.feather_output = true;
+				}
+				else if (strcmp(option, "stats") == 0)
+				{
+					options.print_stats = true;
+				}
+				else if (strcmp(option, "stats-json") == 0)
+				{
+					options.stats_json = true;
+				}
+				else if (strcmp(option, "no-progress") == 0)
+				{
+					options.no_progress = true;
+				}
+				else if (strcmp(option, "allow-missing-totals") == 0)
+				{
+					options.allow_missing_totals = true;
+				}
+				else if (strcmp(option, "fixed-layout") == 0)
+				{
+					options.fixed_layout = true;
+				}
+				else if (strcmp(option, "counters") == 0)
+				{
+					options.counters = true;
+				}
+				else if (strcmp(option, "normalize") == 0)
+				{
+					options.normalize = true;
+				}
+				else if (strcmp(option, "duplicates") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --duplicates must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_duplicates_name = argv[++arg];
+				}
+				else if (strcmp(option, "memos") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --memos must be followed by the memo report.\n", program_name);
+						return -1;
+					}
+					file_memo_name = argv[++arg];
+				}
+				else if (strcmp(option, "encoding") == 0)
+				{
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: --encoding must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "columns") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --columns must be followed by the names of the columns to write, separated by commas.\n", program_name);
+						return -1;
+					}
+					column_names = argv[++arg];
+				}
+				else if (strcmp(option, "where") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --where must be followed by a filter, e.g. \"balance != 0\".\n", program_name);
+						return -1;
+					}
+					filter_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-by") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --sort-by must be followed by the names of the columns to sort by, separated by commas.\n", program_name);
+						return -1;
+					}
+					sort_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-memory") == 0)
+				{
+					sort_megabytes = (arg + 1 == argc) ? 0 : (u32)strtoul(argv[++arg], NULL, 10);
+					if (sort_megabytes < 1 || sort_megabytes > SORT_MAX_MEGABYTES)
+					{
+						printf("%s: --sort-memory must be followed by a number of megabytes, from 1 to %d.\n", program_name, SORT_MAX_MEGABYTES);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "anomalies") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --anomalies must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+				}
+				else if (strcmp(option, "serve") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --serve must be followed by the path of the socket to listen on.\n", program_name);
+						return -1;
+					}
+					return ServeRequests(program_name, argv[arg + 1], main, NULL); // Each request is run by main() itself.
+				}
 				else
 				{
 					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
@@ -600,6 +2093,14 @@ int main(int argc, char *argv[])
 
 				switch (c2)
 				{
+					case 'a':
+						if (arg + 1 == argc)
+						{
+							printf("%s: -a must be followed by the name of the file to write them to.\n", program_name);
+							return -1;
+						}
+						file_anomalies_name = argv[++arg];
+						break;
 					case 'h':
 						PrintUsageAndExit(program_name);
 					case 'p':
@@ -608,6 +2109,38 @@ int main(int argc, char *argv[])
 					case 'd':
 						options.debug_output = true;
 						break;
+					case 'e':
+						if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+						{
+							printf("%s: -e must be followed by cp437, cp1252 or latin1.\n", program_name);
+							return -1;
+						}
+						break;
+					case 'u':
+						if (arg + 1 == argc)
+						{
+							printf("%s: -u must be followed by the name of the file to write them to.\n", program_name);
+							return -1;
+						}
+						file_duplicates_name = argv[++arg];
+						break;
+					case 'm':
+						if (arg + 1 == argc)
+						{
+							printf("%s: -m must be followed by the memo report.\n", program_name);
+							return -1;
+						}
+						file_memo_name = argv[++arg];
+						break;
+					case 'n':
+						options.normalize = true;
+						break;
+					case 'f':
+						options.feather_output = true;
+						break;
+					case 's':
+						options.print_stats = true;
+						break;
 					default:
 						printf("%s: Invalid argument '%c'. Use -h or --help for more details.\n", program_name, c2);
 						return -1;
@@ -615,27 +2148,33 @@ int main(int argc, char *argv[])
 				continue;
 			}
 		}
-		if (report_type < 0)
+		if (report_type == no_report && !file_input_name) // The report type may be left out.
 		{
 			char* type = argv[arg];
 			if (strcmp(type, "account") == 0)
 			{
 				report_type = account;
+				continue;
 			}
 			else if (strcmp(type, "address") == 0)
 			{
 				report_type = address;
+				continue;
 			}
 			else if (strcmp(type, "memo") == 0)
 			{
 				report_type = memo;
+				continue;
 			}
-			else
+
+			// Otherwise it is the input file, unless there is no such file or an input and output follow it.
+			FILE* input_file;
+			if (arg + 2 < argc || fopen_s(&input_file, type, "rb"))
 			{
 				printf("%s: Invalid report type '%s'. Use -h or --help for more details.\n", program_name, type);
 				return -1;
 			}
-			continue;
+			fclose(input_file);
 		}
 		if (!file_input_name) // The first argument after the last option switch must be the input file.
 		{
@@ -659,17 +2198,201 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (!file_output_name && options.feather_output)
+	{
+		printf("Feather output requires an output file.\n");
+		return -1;
+	}
+
+	// Work out the report type if it was not given, and refuse a report of another type if it was.
+	Report_kind report_kinds[] = {report_accounts, report_addresses, report_memos};
+	if (report_type == no_report)
+	{
+		char report_start[SNIFF_SIZE];
+		size_t report_start_length = ReadFileStart(file_input_name, report_start, sizeof(report_start));
+		if (!report_start_length)
+		{
+			printf("Could not open input file: %s\n", file_input_name);
+			return -1;
+		}
+		Report_kind kind = SniffReport(report_start, report_start_length);
+		for (u32 type = 0; type < ArrayCount(report_kinds); type++)
+		{
+			if (kind == report_kinds[type])
+			{
+				report_type = (Report_type)type;
+			}
+		}
+		if (report_type == no_report && kind != report_unknown)
+		{
+			printf("%s: %s is an %s, not a customer report. Use '%s' for it.\n", program_name, file_input_name,
+				   report_signatures[kind].name, report_signatures[kind].command);
+			return -1;
+		}
+		if (report_type == no_report)
+		{
+			printf("%s: Could not tell which customer report %s is. Give the report type (account, address or memo).\n", program_name, file_input_name);
+			return -1;
+		}
+	}
+	else if (!CheckReportKind(program_name, file_input_name, report_kinds[report_type]))
+	{
+		return -1;
+	}
+
+	if (file_memo_name && !CheckReportKind(program_name, file_memo_name, report_memos))
+	{
+		return -1;
+	}
+
+	if (options.normalize && report_type != address)
+	{
+		printf("Only the address report can be normalized.\n");
+		return -1;
+	}
+
+	if (file_memo_name && report_type != address)
+	{
+		printf("Memos can only be added to the address report.\n");
+		return -1;
+	}
+
+	if (file_duplicates_name && report_type != address)
+	{
+		printf("Duplicates can only be found in the address report.\n");
+		return -1;
+	}
+
+	Output_column* columns[] = {account_columns, address_columns, memo_columns};
+	u32 num_columns[] = {account_field_count, address_column_count, memo_column_count};
+	Column_selection selection;
+	options.fields = ALL_FIELDS;
+	if (column_names)
+	{
+		if (options.debug_output)
+		{
+			printf("--columns cannot be used with -d.\n");
+			return -1;
+		}
+		if (!SelectColumns(&selection, columns[report_type], num_columns[report_type], column_names, program_name))
+		{
+			return -1;
+		}
+		options.columns = &selection;
+		options.fields = selection.fields;
+		if (file_duplicates_name) // The fields the accounts are compared on.
+		{
+			options.fields |= FIELD(address_name) | FIELD(address_phone) | FIELD(address_line_1) | FIELD(address_city) | FIELD(address_postal_code);
+		}
+	}
+
+	Record_filter filter;
+	if (filter_text)
+	{
+		// The lines of a record of each report; only the first line of a memo has anything but memo text.
+		Filter_table tables[][2] =
+		{
+			{{account_fields, ArrayCount(account_fields)}},
+			{{address_name_fields, ArrayCount(address_name_fields)}, {address_fields, ArrayCount(address_fields)}},
+			{{memo_id_fields, ArrayCount(memo_id_fields)}},
+		};
+		u32 num_tables[] = {1, 2, 1};
+		Filter_alias account_aliases[] = {{"Current Balance", "Balance"}};
+		Filter_alias* aliases[] = {account_aliases, NULL, NULL};
+		u32 num_aliases[] = {ArrayCount(account_aliases), 0, 0};
+		if (!CompileFilter(&filter, filter_text, tables[report_type], num_tables[report_type], columns[report_type],
+				num_columns[report_type], aliases[report_type], num_aliases[report_type], program_name))
+		{
+			return -1;
+		}
+		options.filter = &filter;
+	}
+
+	Sort_order sort_order;
+	if (sort_text)
+	{
+		if (options.debug_output || options.feather_output || options.print_to_screen || !file_output_name)
+		{
+			printf("--sort-by sorts the output file, so it needs one, and cannot be used with -d, -f or -p.\n");
+			return -1;
+		}
+		char headings[COLUMN_HEADINGS_SIZE];
+		if (options.columns)
+		{
+			FormatSelectedHeadings(options.columns, headings, sizeof(headings));
+		}
+		else
+		{
+			char* usual_headings[] = {account_headings, address_headings, memo_headings};
+			sprintf_s(headings, sizeof(headings), usual_headings[report_type], file_memo_name ? "Exemption Info|" : "");
+		}
+		if (!CompileSortOrder(&sort_order, sort_text, columns[report_type], num_columns[report_type], headings, sort_megabytes, program_name))
+		{
+			return -1;
+		}
+	}
+
+	FILE* anomaly_file = NULL;
+	if (file_anomalies_name && fopen_s(&anomaly_file, file_anomalies_name, "w"))
+	{
+		printf("Could not create anomalies file: %s\n", file_anomalies_name);
+		return -1;
+	}
+
+	Report_summary summary = {0};
+	if (options.counters && !OpenPerfCounters(&summary.timings.counters))
+	{
+		printf("Hardware performance counters are not available.\n");
+	}
+
+	Phase_start read_start = BeginPhase(&summary.timings);
 	char* data = ReadEntireFile(file_input_name);
 	if (!data)
 	{
 		printf("Could not open input file: %s\n", file_input_name);
 		return -1;
 	}
+	summary.timings.input_bytes = GetFileSize64(file_input_name);
+
+	char* memo_data = NULL;
+	if (file_memo_name)
+	{
+		memo_data = ReadEntireFile(file_memo_name);
+		if (!memo_data)
+		{
+			printf("Could not open memo file: %s\n", file_memo_name);
+			return -1;
+		}
+		summary.timings.input_bytes += GetFileSize64(file_memo_name);
+	}
+	EndPhase(&summary.timings, phase_read, read_start);
+
+	Anomaly_log anomalies;
+	StartAnomalyLog(&anomalies, data, anomaly_file, file_anomalies_name, options.code_page);
+	options.anomalies = &anomalies;
+
+	// Progress goes to stderr and would be mixed in with the records printed to the screen.
+	Progress progress;
+	if (!options.no_progress && !options.print_to_screen && StderrIsConsole() && StartProgress(&progress, summary.timings.input_bytes))
+	{
+		summary.progress = &progress;
+	}
 
-	Report_summary summary = {0};
 	FILE* stream_output = NULL;
+	Arrow_writer arrow;
+	Arrow_writer* arrow_output = NULL;
 
-	if (file_output_name)
+	if (file_output_name && options.feather_output)
+	{
+		if (!ArrowOpen(&arrow, file_output_name))
+		{
+			printf("Could not create output file: %s\n", file_output_name);
+			return -1;
+		}
+		arrow.code_page = options.code_page;
+		arrow_output = &arrow;
+	}
+	else if (file_output_name)
 	{
 		errno_t error;
 
@@ -681,27 +2404,131 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	Phase_start parse_start = BeginPhase(&summary.timings);
+
+	// The memos are parsed first, without any output, just to collect their exemption info.
+	Memo_table memo_table = {0};
+	Report_summary memo_summary = {0};
+	if (memo_data)
+	{
+		Program_options memo_options = {0};
+		memo_options.memo_table = &memo_table;
+		memo_options.fields = ALL_FIELDS;
+		Anomaly_log memo_anomalies; // Only counted, and not reported: -a is for the report being converted.
+		StartAnomalyLog(&memo_anomalies, memo_data, NULL, NULL, options.code_page);
+		memo_options.anomalies = &memo_anomalies;
+		ParseAccountMemos(memo_data, NULL, NULL, memo_options, &memo_summary);
+		FreeFileMemory(memo_data);
+		options.memo_table = &memo_table;
+	}
+
+	Duplicate_index duplicates = {0};
+	if (file_duplicates_name)
+	{
+		options.duplicates = &duplicates;
+	}
+
 	switch (report_type)
 	{
 		case account:
-			ParseAccountBalances(data, stream_output, options, &summary);
-			printf("Processed a total of %d accounts (%d pages).\n", summary.num_accounts, summary.num_pages);
+			ParseAccountBalances(data, stream_output, arrow_output, options, &summary);
 			break;
 		case address:
-			ParseAccountAddresses(data, stream_output, options, &summary);
-			printf("Processed a total of %d addresses (%d pages).\n", summary.num_accounts, summary.num_pages);
+			ParseAccountAddresses(data, stream_output, arrow_output, options, &summary);
 			break;
 		case memo:
-			ParseAccountMemos(data, stream_output, options, &summary);
-			printf("Processed a total of %d memos (%d pages).\n", summary.num_accounts, summary.num_pages);
+			ParseAccountMemos(data, stream_output, arrow_output, options, &summary);
 			break;
+		case no_report: // Not possible once there is an input file.
+			break;
+	}
+
+	u32 num_duplicate_accounts = 0;
+	i32 num_duplicate_clusters = 0;
+	if (file_duplicates_name)
+	{
+		num_duplicate_clusters = WriteDuplicateClusters(&duplicates, file_duplicates_name, options, &num_duplicate_accounts);
+		free(duplicates.records);
+		free(duplicates.signatures);
+		free(duplicates.blank);
+	}
+	EndParse(&summary.timings, parse_start);
+
+	if (summary.progress)
+	{
+		StopProgress(summary.progress);
+	}
+	FreeFileMemory(data);
+
+	char* record_names[] = {"accounts", "addresses", "memos"};
+	printf("Processed a total of %d %s (%d pages).\n", summary.num_accounts, record_names[report_type], summary.num_pages);
+	if (options.filter)
+	{
+		printf("Left out %d of them that did not match --where.\n", summary.num_left_out);
+	}
+	char* total_names[] = {"number of accounts", "number of accounts", "number of memos"};
+	bool reconciled = ReconcileTotal(summary.report_total, total_names[report_type], summary.num_accounts, options.allow_missing_totals);
+	if (report_type == account)
+	{
+		reconciled = ReconcileTotal(summary.report_balance, "total balance", summary.total_balance, true) && reconciled;
+	}
+	if (file_memo_name)
+	{
+		printf("Found exemption info in %u of %u memos.\n", memo_table.count, memo_summary.num_accounts);
+		free(memo_table.entries);
+	}
+	if (num_duplicate_clusters < 0)
+	{
+		printf("Could not create duplicates file: %s\n", file_duplicates_name);
+	}
+	else if (file_duplicates_name)
+	{
+		printf("Found %d groups of possible duplicates (%u accounts); written to %s.\n", num_duplicate_clusters, num_duplicate_accounts, file_duplicates_name);
+	}
+	if (options.normalize && !options.debug_output)
+	{
+		for (u32 step = 0; step < ArrayCount(address_normalize_steps); step++)
+		{
+			Normalize_step* normalize_step = &address_normalize_steps[step];
+			if (normalize_step->num_unrecognized)
+			{
+				printf("%u %s values were not recognized and were left as they were.\n", normalize_step->num_unrecognized, normalize_step->name);
+			}
+		}
 	}
 
-	if (file_output_name)
+	Phase_start flush_start = BeginPhase(&summary.timings);
+	if (arrow_output)
+	{
+		ArrowClose(arrow_output);
+		printf("Output dumped to %s.\n", file_output_name);
+	}
+	else if (file_output_name)
 	{
 		fclose(stream_output);
 		printf("Output dumped to %s.\n", file_output_name);
 	}
+	EndPhase(&summary.timings, phase_flush, flush_start);
+	bool sorted = true;
+	if (sort_text)
+	{
+		Phase_start sort_start = BeginPhase(&summary.timings);
+		sorted = SortOutputFile(&sort_order, file_output_name, program_name);
+		EndPhase(&summary.timings, phase_sort, sort_start);
+	}
+
+	PrintLayoutDrift(&summary.layout, options.fixed_layout);
+	PrintAnomalies(&anomalies);
+	if (anomaly_file)
+	{
+		fclose(anomaly_file);
+	}
+	PrintTimings(&summary.timings, summary.num_accounts, options.print_stats);
+	if (options.stats_json)
+	{
+		char* tool_names[] = {"account", "address", "memo"};
+		PrintTimingsJson(&summary.timings, tool_names[report_type], summary.num_accounts, summary.num_pages);
+	}
 
-	return 0;
+	return (reconciled && sorted) ? 0 : -1;
 }
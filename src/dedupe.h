@@ -0,0 +1,251 @@
+#ifndef DEDUPE
+#define DEDUPE
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	Finds records that are probably the same thing entered twice, without comparing every pair.
+
+	Each record is reduced to a set of shingles: 32-bit hashes of the pieces of its text (the caller decides
+	what they are, e.g. the 3 letter runs of a name and the digits of a phone number). Two records are as
+	similar as their sets are (the Jaccard index: shared shingles over all shingles).
+
+	MinHash: for each of MINHASH_SIZE hash functions, a record's signature keeps the smallest hash of any of
+	its shingles. The chance that two records keep the same one is exactly their Jaccard index, so the fraction
+	of matching signature entries estimates their similarity, from a fixed 128 bytes per record.
+
+	LSH: the signature is cut into LSH_BANDS bands of LSH_ROWS entries, and each band hashed into a bucket.
+	Records that share a bucket in any band become candidate pairs; all others are never compared. With 8 bands
+	of 4 rows, pairs at 0.8 similarity are candidates 98% of the time, at 0.6 67%, and at 0.3 only 6%.
+
+	The buckets are found by sorting (band, bucket) keys, so it all takes O(n log n) time. A bucket holding more
+	than LSH_MAX_BUCKET records (a very common name, or many blank records) is not expanded into every pair:
+	its records are only paired with their neighbours, which still puts them all in one cluster.
+
+	Pairs scoring at least the threshold are then joined into clusters with union-find.
+*/
+
+#define MINHASH_SIZE 32
+#define LSH_BANDS 8
+#define LSH_ROWS (MINHASH_SIZE / LSH_BANDS)
+#define LSH_MAX_BUCKET 64
+
+typedef struct
+{
+	u32 hashes[MINHASH_SIZE];
+} Minhash_signature;
+
+typedef struct
+{
+	u32 first;
+	u32 second;
+	float score;
+} Candidate_pair;
+
+typedef struct
+{
+	u64 key;
+	u32 record;
+} Lsh_entry;
+
+// Murmur3 finalizer.
+static inline u32 MixBits32(u32 value)
+{
+	value ^= value >> 16;
+	value *= 0x85EBCA6Bu;
+	value ^= value >> 13;
+	value *= 0xC2B2AE35u;
+	value ^= value >> 16;
+	return value;
+}
+
+// An empty set gets an all ones signature, which the callers should keep out of the index.
+void ComputeMinhash(u32* shingles, u32 num_shingles, Minhash_signature* signature)
+{
+	for (u32 hash = 0; hash < MINHASH_SIZE; hash++)
+	{
+		signature->hashes[hash] = 0xFFFFFFFFu;
+	}
+	for (u32 shingle = 0; shingle < num_shingles; shingle++)
+	{
+		u32 base = MixBits32(shingles[shingle]);
+		for (u32 hash = 0; hash < MINHASH_SIZE; hash++)
+		{
+			u32 value = MixBits32(base + hash * 0x9E3779B9u);
+			if (value < signature->hashes[hash])
+			{
+				signature->hashes[hash] = value;
+			}
+		}
+	}
+}
+
+float SignatureSimilarity(Minhash_signature* first, Minhash_signature* second)
+{
+	u32 matches = 0;
+	for (u32 hash = 0; hash < MINHASH_SIZE; hash++)
+	{
+		matches += (first->hashes[hash] == second->hashes[hash]);
+	}
+	return (float)matches / MINHASH_SIZE;
+}
+
+int CompareLshEntries(const void* first, const void* second)
+{
+	u64 first_key = ((Lsh_entry*)first)->key;
+	u64 second_key = ((Lsh_entry*)second)->key;
+	return (first_key > second_key) - (first_key < second_key);
+}
+
+int CompareCandidatePairs(const void* first, const void* second)
+{
+	Candidate_pair* a = (Candidate_pair*)first;
+	Candidate_pair* b = (Candidate_pair*)second;
+	if (a->first != b->first)
+	{
+		return (a->first > b->first) - (a->first < b->first);
+	}
+	return (a->second > b->second) - (a->second < b->second);
+}
+
+void AddCandidatePair(Candidate_pair** pairs, u32* num_pairs, u32* capacity, u32 first, u32 second)
+{
+	if (*num_pairs == *capacity)
+	{
+		*capacity = *capacity ? *capacity * 2 : 4096;
+		Candidate_pair* grown = (Candidate_pair*)realloc(*pairs, *capacity * sizeof(Candidate_pair));
+		if (!grown)
+		{
+			printf("Error: Out of memory finding duplicates!\n");
+			exit (-1);
+		}
+		*pairs = grown;
+	}
+	Candidate_pair* pair = &(*pairs)[(*num_pairs)++];
+	pair->first = MIN(first, second);
+	pair->second = (first < second) ? second : first;
+	pair->score = 0.0f;
+}
+
+// Returns the distinct candidate pairs (first < second), scored, in an array to be freed by the caller.
+// Records marked in skip (may be NULL) are left out.
+Candidate_pair* FindCandidatePairs(Minhash_signature* signatures, bool* skip, u32 count, u32* num_pairs)
+{
+	Lsh_entry* entries = (Lsh_entry*)malloc((size_t)count * LSH_BANDS * sizeof(Lsh_entry) + 1);
+	if (!entries)
+	{
+		printf("Error: Out of memory finding duplicates!\n");
+		exit (-1);
+	}
+
+	u32 num_entries = 0;
+	for (u32 record = 0; record < count; record++)
+	{
+		if (skip && skip[record])
+		{
+			continue;
+		}
+		for (u32 band = 0; band < LSH_BANDS; band++)
+		{
+			u32 bucket = HashBytes((u8*)&signatures[record].hashes[band * LSH_ROWS], LSH_ROWS * sizeof(u32));
+			entries[num_entries].key = ((u64)band << 32) | bucket;
+			entries[num_entries].record = record;
+			num_entries++;
+		}
+	}
+	qsort(entries, num_entries, sizeof(Lsh_entry), CompareLshEntries);
+
+	Candidate_pair* pairs = NULL;
+	u32 capacity = 0;
+	*num_pairs = 0;
+	for (u32 start = 0; start < num_entries; )
+	{
+		u32 end = start + 1;
+		while (end < num_entries && entries[end].key == entries[start].key)
+		{
+			end++;
+		}
+
+		if (end - start <= LSH_MAX_BUCKET)
+		{
+			for (u32 first = start; first < end; first++)
+			{
+				for (u32 second = first + 1; second < end; second++)
+				{
+					AddCandidatePair(&pairs, num_pairs, &capacity, entries[first].record, entries[second].record);
+				}
+			}
+		}
+		else
+		{
+			for (u32 first = start; first + 1 < end; first++)
+			{
+				AddCandidatePair(&pairs, num_pairs, &capacity, entries[first].record, entries[first + 1].record);
+			}
+		}
+		start = end;
+	}
+	free(entries);
+
+	// The same pair turns up in every band it shares.
+	if (*num_pairs)
+	{
+		qsort(pairs, *num_pairs, sizeof(Candidate_pair), CompareCandidatePairs);
+	}
+	u32 num_distinct = 0;
+	for (u32 pair = 0; pair < *num_pairs; pair++)
+	{
+		if (num_distinct == 0 || pairs[pair].first != pairs[num_distinct - 1].first || pairs[pair].second != pairs[num_distinct - 1].second)
+		{
+			pairs[num_distinct] = pairs[pair];
+			pairs[num_distinct].score = SignatureSimilarity(&signatures[pairs[pair].first], &signatures[pairs[pair].second]);
+			num_distinct++;
+		}
+	}
+	*num_pairs = num_distinct;
+	return pairs;
+}
+
+u32 FindClusterRoot(u32* parents, u32 record)
+{
+	while (parents[record] != record)
+	{
+		parents[record] = parents[parents[record]]; // Path halving.
+		record = parents[record];
+	}
+	return record;
+}
+
+// Joins the pairs scoring at least threshold. Afterwards parents[record] is the record's cluster (the
+// smallest record in it), and scores[cluster] the best score of the pairs that joined it.
+void ClusterPairs(Candidate_pair* pairs, u32 num_pairs, float threshold, u32 count, u32* parents, float* scores)
+{
+	for (u32 record = 0; record < count; record++)
+	{
+		parents[record] = record;
+		scores[record] = 0.0f;
+	}
+	for (u32 pair = 0; pair < num_pairs; pair++)
+	{
+		if (pairs[pair].score < threshold)
+		{
+			continue;
+		}
+		u32 first = FindClusterRoot(parents, pairs[pair].first);
+		u32 second = FindClusterRoot(parents, pairs[pair].second);
+		u32 root = MIN(first, second);
+		u32 other = (first < second) ? second : first;
+		parents[other] = root;
+		float score = pairs[pair].score;
+		scores[root] = (scores[root] > score) ? scores[root] : score;
+		scores[root] = (scores[root] > scores[other]) ? scores[root] : scores[other];
+	}
+	for (u32 record = 0; record < count; record++)
+	{
+		parents[record] = FindClusterRoot(parents, record);
+	}
+}
+
+#endif
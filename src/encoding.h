@@ -0,0 +1,184 @@
+#ifndef ENCODING
+#define ENCODING
+
+#include <emmintrin.h>
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	ProfitMaster writes its reports in whatever single byte code page the store's machine was set up with:
+	CP437 on the old DOS installs, Windows-1252 or plain Latin-1 on the newer ones. The parsers work on bytes
+	(every field is at a fixed byte offset), so the input is never converted. Instead each formatted output
+	line, and each string handed to the Arrow writer, goes through TranscodeText() on its way out, which turns
+	the upper half of the code page into UTF-8.
+
+	Almost everything in the reports is ASCII, which needs no conversion at all, so:
+	 - Runs of ASCII are found 32 bytes at a time (two SSE2 loads, one OR and a movemask) and copied as is.
+	 - Text that is entirely ASCII is not copied at all: TranscodeText() hands back the pointer it was given.
+
+	With no code page selected (the default) the bytes are written exactly as they were read, except to Feather
+	files, which must be UTF-8 (see arrow.h).
+
+	Every byte from 0x80 up becomes at most three bytes of UTF-8 (the largest code point in the tables is
+	below U+10000), hence TRANSCODED_SIZE().
+*/
+
+typedef enum
+{
+	code_page_none,
+	code_page_437,
+	code_page_1252,
+	code_page_latin1
+} Code_page;
+
+#define TRANSCODED_SIZE(size) ((size) * 3)
+
+// Code points of bytes 0x80 to 0xFF.
+static const u16 cp437_code_points[128] =
+{
+	0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7, 0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+	0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9, 0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+	0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA, 0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+	0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+	0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+	0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+	0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4, 0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+	0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0,
+};
+
+// Code points of bytes 0x80 to 0x9F; the rest of Windows-1252 is Latin-1. The five bytes it leaves undefined
+// map to the C1 controls of the same value, as Windows itself does.
+static const u16 cp1252_code_points[32] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+// Accepts the names used on the command line.
+bool ParseCodePage(char* name, Code_page* code_page)
+{
+	if (strcmp(name, "cp437") == 0)
+	{
+		*code_page = code_page_437;
+	}
+	else if (strcmp(name, "cp1252") == 0 || strcmp(name, "windows-1252") == 0)
+	{
+		*code_page = code_page_1252;
+	}
+	else if (strcmp(name, "latin1") == 0 || strcmp(name, "iso-8859-1") == 0)
+	{
+		*code_page = code_page_latin1;
+	}
+	else if (strcmp(name, "none") == 0)
+	{
+		*code_page = code_page_none;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+// Number of bytes at the start of the text (up to length) that are ASCII.
+size_t AsciiPrefixLength(char* text, size_t length)
+{
+	size_t index = 0;
+	for (; index + 32 <= length; index += 32)
+	{
+		__m128i low = _mm_loadu_si128((__m128i*)&text[index]);
+		__m128i high = _mm_loadu_si128((__m128i*)&text[index + 16]);
+		if (_mm_movemask_epi8(_mm_or_si128(low, high)))
+		{
+			break; // The scalar loop finds the exact byte.
+		}
+	}
+	while (index < length && (u8)text[index] < 0x80)
+	{
+		index++;
+	}
+	return index;
+}
+
+u32 CodePoint(u8 byte, Code_page code_page)
+{
+	switch (code_page)
+	{
+		case code_page_437:
+		{
+			return cp437_code_points[byte - 0x80];
+		}
+		case code_page_1252:
+		{
+			return (byte < 0xA0) ? cp1252_code_points[byte - 0x80] : byte;
+		}
+		default:
+		{
+			return byte;
+		}
+	}
+}
+
+// Returns the text as UTF-8: the text itself if there is nothing to convert, otherwise the converted copy in
+// utf8. Output that would not fit in utf8_size bytes (which TRANSCODED_SIZE() of the text's buffer always
+// does) is cut off at the last whole character.
+char* TranscodeText(char* text, char* utf8, size_t utf8_size, Code_page code_page)
+{
+	if (code_page == code_page_none)
+	{
+		return text;
+	}
+
+	size_t length = strlen(text);
+	size_t ascii_length = AsciiPrefixLength(text, length);
+	if (ascii_length == length)
+	{
+		return text;
+	}
+
+	size_t in = 0;
+	size_t out = 0;
+	while (in < length)
+	{
+		size_t run = MIN(ascii_length, utf8_size - 1 - out);
+		memcpy(&utf8[out], &text[in], run);
+		in += run;
+		out += run;
+		if (in == length || out == utf8_size - 1)
+		{
+			break;
+		}
+
+		u32 code_point = CodePoint((u8)text[in], code_page);
+		size_t encoded_length = (code_point < 0x80) ? 1 : (code_point < 0x800) ? 2 : 3;
+		if (out + encoded_length > utf8_size - 1)
+		{
+			break;
+		}
+		if (encoded_length == 1)
+		{
+			utf8[out] = (char)code_point;
+		}
+		else if (encoded_length == 2)
+		{
+			utf8[out]	  = (char)(0xC0 | (code_point >> 6));
+			utf8[out + 1] = (char)(0x80 | (code_point & 0x3F));
+		}
+		else
+		{
+			utf8[out]	  = (char)(0xE0 | (code_point >> 12));
+			utf8[out + 1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+			utf8[out + 2] = (char)(0x80 | (code_point & 0x3F));
+		}
+		in++;
+		out += encoded_length;
+
+		ascii_length = AsciiPrefixLength(&text[in], length - in);
+	}
+	utf8[out] = '\0';
+	return utf8;
+}
+
+#endif
@@ -0,0 +1,479 @@
+#ifndef FILTER
+#define FILTER
+
+#include "anomaly.h"
+#include "columns.h"
+
+/*	NOTES
+	=====
+
+	--where keeps only the records that match a filter, e.g. --where "balance != 0 and location = 01":
+	  - A comparison is a column, one of = != < <= > >= and a value. The columns are named as for --columns
+	    and --sort-by, without regard to case and with _ for a space (current_balance), and are those made
+	    from a field checked on the record lines (see anomaly.h), which is what is compared. The fields'
+	    own names, where they are shorter (balance), are taken too. A value with spaces in it goes in single
+	    quotes ('PAINT BRUSH').
+	  - Comparisons are joined with "and" and "or", "and" first: a or b and c is a or (b and c).
+	  - Amounts compare as amounts (in cents, CR is negative, a blank one is 0), and so do numbers. Dates
+	    compare as dates, given as MM/DD/YY, MM/DD/YYYY or YYYY-MM-DD; a blank date matches nothing. Text and
+	    codes compare as text, without regard to case or to the spaces around them, except that a code and a
+	    value that are both all digits compare as numbers (class >= 1000 is not true of class 2).
+
+	The filter is compiled once, into comparisons that each know their field's class, and the field's position
+	on its line, and then run on the bytes of each record line as it is in the report, before any of the
+	record's fields are copied out of it. A record that does not match is left there, so it costs little more
+	than finding its lines: only the few bytes of the compared fields are looked at, and only amounts, numbers
+	and dates are converted (in a small buffer on the stack).
+
+	A record that spans several lines is decided at the last line with a compared field, and the parser skips
+	the rest of it once it is. The record is still counted (the parse is reconciled with the report's totals
+	whatever it writes, see reconcile.h), and so are the fields the parser always reads.
+*/
+
+#define FILTER_MAX_COMPARISONS 32
+#define FILTER_MAX_VALUE 48
+#define FILTER_FIELD_SIZE 32 // Amounts, numbers and dates are copied here to be converted.
+
+typedef enum
+{
+	filter_equal,
+	filter_not_equal,
+	filter_less,
+	filter_less_or_equal,
+	filter_greater,
+	filter_greater_or_equal
+} Filter_operator;
+
+// The fields of one line of a record, in the order of the record's lines.
+typedef struct
+{
+	Field_check* fields;
+	u32 num_fields;
+} Filter_table;
+
+// An output column written from a field that is named otherwise (Current Balance, from the Balance field).
+typedef struct
+{
+	char* column;
+	char* field;
+} Filter_alias;
+
+typedef struct
+{
+	u32 table;
+	u32 field;
+	Field_class class;
+	Filter_operator operator;
+	bool starts_group; // The first comparison after an "or".
+	i64 number; // The value of an amount (in cents), number (in hundredths) or date (in days).
+	char text[FILTER_MAX_VALUE]; // The value of text and codes.
+	size_t text_length;
+	bool digits; // The value of a code is all digits, in number.
+} Filter_comparison;
+
+typedef struct Record_filter
+{
+	Filter_comparison comparisons[FILTER_MAX_COMPARISONS];
+	u32 num_comparisons;
+	u32 last_table; // The record is decided at this line.
+	u32 matched; // A bit for each comparison that holds, for the record being read.
+} Record_filter;
+
+// Reads the text as a number if it is nothing but digits (and not so many that they overflow).
+static inline bool ParseDigits(char* text, size_t length, i64* number)
+{
+	*number = 0;
+	for (size_t index = 0; index < length; index++)
+	{
+		if (text[index] < '0' || text[index] > '9')
+		{
+			return false;
+		}
+		*number = *number * 10 + (text[index] - '0');
+	}
+	return length > 0 && length <= 18;
+}
+
+static inline bool IsFilterNameCharacter(char character)
+{
+	return isalnum((unsigned char)character) || character == '_';
+}
+
+bool FilterNameMatches(char* field_name, char* name, size_t length)
+{
+	if (strlen(field_name) != length)
+	{
+		return false;
+	}
+	for (size_t index = 0; index < length; index++)
+	{
+		char character = (name[index] == '_') ? ' ' : name[index];
+		if (tolower((unsigned char)field_name[index]) != tolower((unsigned char)character))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// ParseReportDate(), but also taking YYYY-MM-DD.
+bool ParseFilterDate(char* text, i32* days)
+{
+	if (strlen(text) == 10 && text[4] == '-' && text[7] == '-')
+	{
+		char report_date[11];
+		sprintf_s(report_date, sizeof(report_date), "%.2s/%.2s/%.4s", &text[5], &text[8], text);
+		return ParseReportDate(report_date, days);
+	}
+	return ParseReportDate(text, days);
+}
+
+// The name of the output column the field is written to.
+char* FilterColumnName(char* field_name, Filter_alias* aliases, u32 num_aliases)
+{
+	for (u32 alias = 0; alias < num_aliases; alias++)
+	{
+		if (strcmp(aliases[alias].field, field_name) == 0)
+		{
+			return aliases[alias].column;
+		}
+	}
+	return field_name;
+}
+
+// Compiles the filter text against the fields of the record's lines, named as the tool's output columns (or as
+// the fields themselves). Prints what is wrong and returns false if it is not a filter.
+bool CompileFilter(Record_filter* filter, char* text, Filter_table* tables, u32 num_tables, Output_column* columns,
+		u32 num_columns, Filter_alias* aliases, u32 num_aliases, char* program_name)
+{
+	memset(filter, 0, sizeof(*filter));
+
+	char* at = text;
+	bool starts_group = true;
+	while (true)
+	{
+		while (*at == ' ')
+		{
+			at++;
+		}
+		char* name = at;
+		while (IsFilterNameCharacter(*at))
+		{
+			at++;
+		}
+		size_t name_length = (size_t)(at - name);
+		if (name_length == 0)
+		{
+			printf("%s: --where expects the name of a column at '%s'.\n", program_name, name);
+			return false;
+		}
+
+		char* field_name = NULL;
+		for (u32 alias = 0; alias < num_aliases && !field_name; alias++)
+		{
+			if (FilterNameMatches(aliases[alias].column, name, name_length))
+			{
+				field_name = aliases[alias].field;
+			}
+		}
+
+		u32 table = 0;
+		u32 field = 0;
+		bool found = false;
+		for (table = 0; table < num_tables && !found; table++)
+		{
+			for (field = 0; field < tables[table].num_fields && !found; field++)
+			{
+				char* check_name = tables[table].fields[field].name;
+				found = field_name ? (strcmp(check_name, field_name) == 0) : FilterNameMatches(check_name, name, name_length);
+			}
+		}
+		if (!found)
+		{
+			bool is_column = false;
+			for (u32 column = 0; column < num_columns && !is_column; column++)
+			{
+				is_column = FilterNameMatches(columns[column].name, name, name_length);
+			}
+			if (is_column)
+			{
+				printf("%s: --where cannot compare '%.*s', as it is not written from one field of the report. The columns it can compare are:",
+						program_name, (int)name_length, name);
+			}
+			else
+			{
+				printf("%s: --where has an unknown column '%.*s'. The columns it can compare are:", program_name, (int)name_length, name);
+			}
+			bool first = true;
+			for (table = 0; table < num_tables; table++)
+			{
+				for (field = 0; field < tables[table].num_fields; field++)
+				{
+					char* column_name = FilterColumnName(tables[table].fields[field].name, aliases, num_aliases);
+					bool listed = false; // Tables may share a field, and lines have fields of the same name.
+					for (u32 earlier = 0; earlier <= table && !listed; earlier++)
+					{
+						u32 num_earlier = (earlier < table) ? tables[earlier].num_fields : field;
+						for (u32 other = 0; other < num_earlier && !listed; other++)
+						{
+							listed = (strcmp(tables[earlier].fields[other].name, tables[table].fields[field].name) == 0);
+						}
+					}
+					if (!listed)
+					{
+						printf("%s %s", first ? "" : ",", column_name);
+						first = false;
+					}
+				}
+			}
+			printf(".\n");
+			return false;
+		}
+		table--; // The loops went one past.
+		field--;
+
+		while (*at == ' ')
+		{
+			at++;
+		}
+		Filter_operator operator;
+		if (at[0] == '!' && at[1] == '=')			{ operator = filter_not_equal; at += 2; }
+		else if (at[0] == '<' && at[1] == '>')		{ operator = filter_not_equal; at += 2; }
+		else if (at[0] == '<' && at[1] == '=')		{ operator = filter_less_or_equal; at += 2; }
+		else if (at[0] == '>' && at[1] == '=')		{ operator = filter_greater_or_equal; at += 2; }
+		else if (at[0] == '=' && at[1] == '=')		{ operator = filter_equal; at += 2; }
+		else if (at[0] == '=')						{ operator = filter_equal; at += 1; }
+		else if (at[0] == '<')						{ operator = filter_less; at += 1; }
+		else if (at[0] == '>')						{ operator = filter_greater; at += 1; }
+		else
+		{
+			printf("%s: --where expects one of = != < <= > >= after '%.*s'.\n", program_name, (int)name_length, name);
+			return false;
+		}
+
+		while (*at == ' ')
+		{
+			at++;
+		}
+		char value[FILTER_MAX_VALUE];
+		size_t value_length = 0;
+		if (*at == '\'')
+		{
+			at++;
+			while (*at && *at != '\'' && value_length < sizeof(value) - 1)
+			{
+				value[value_length++] = *at++;
+			}
+			if (*at != '\'')
+			{
+				printf("%s: --where has a value without its closing quote, or longer than %d characters.\n", program_name, FILTER_MAX_VALUE - 1);
+				return false;
+			}
+			at++;
+		}
+		else
+		{
+			while (*at && *at != ' ' && value_length < sizeof(value) - 1)
+			{
+				value[value_length++] = *at++;
+			}
+			if (value_length == 0)
+			{
+				printf("%s: --where expects a value after '%.*s' (in quotes, '', for a blank one).\n", program_name, (int)name_length, name);
+				return false;
+			}
+		}
+		value[value_length] = '\0';
+
+		if (filter->num_comparisons == FILTER_MAX_COMPARISONS)
+		{
+			printf("%s: --where can only have %d comparisons.\n", program_name, FILTER_MAX_COMPARISONS);
+			return false;
+		}
+		Filter_comparison* comparison = &filter->comparisons[filter->num_comparisons++];
+		comparison->table = table;
+		comparison->field = field;
+		comparison->class = tables[table].fields[field].class;
+		comparison->operator = operator;
+		comparison->starts_group = starts_group;
+		filter->last_table = MAX(filter->last_table, table);
+
+		bool valid = true;
+		switch (comparison->class)
+		{
+			case field_money:
+			case field_number:
+			{
+				valid = ParseMoneyCents(value, &comparison->number);
+			} break;
+			case field_date:
+			{
+				i32 days = 0;
+				valid = ParseFilterDate(value, &days);
+				comparison->number = days;
+			} break;
+			default:
+			{
+				memcpy(comparison->text, value, value_length + 1);
+				comparison->text_length = value_length;
+				comparison->digits = (comparison->class == field_code) && ParseDigits(value, value_length, &comparison->number);
+			} break;
+		}
+		if (!valid)
+		{
+			printf("%s: --where compares %s with '%s', which is not %s.\n", program_name, tables[table].fields[field].name, value,
+				   (comparison->class == field_date) ? "a date" : (comparison->class == field_money) ? "an amount" : "a number");
+			return false;
+		}
+
+		while (*at == ' ')
+		{
+			at++;
+		}
+		if (*at == '\0')
+		{
+			return true;
+		}
+		char* word = at;
+		while (IsFilterNameCharacter(*at))
+		{
+			at++;
+		}
+		if (FilterNameMatches("and", word, (size_t)(at - word)))
+		{
+			starts_group = false;
+		}
+		else if (FilterNameMatches("or", word, (size_t)(at - word)))
+		{
+			starts_group = true;
+		}
+		else
+		{
+			printf("%s: --where expects \"and\" or \"or\" at '%s'.\n", program_name, word);
+			return false;
+		}
+	}
+}
+
+static inline bool FilterOrderHolds(Filter_operator operator, i32 order)
+{
+	switch (operator)
+	{
+		case filter_equal:				return order == 0;
+		case filter_not_equal:			return order != 0;
+		case filter_less:				return order < 0;
+		case filter_less_or_equal:		return order <= 0;
+		case filter_greater:			return order > 0;
+		default:						return order >= 0;
+	}
+}
+
+// Compares the field as it is on the line with the comparison's value.
+bool FilterFieldHolds(Filter_comparison* comparison, Field_check* field, char* line, size_t line_length)
+{
+	char* start = &line[MIN(field->start, line_length)];
+	char* end = &line[MIN(field->start + field->length, line_length)];
+	if (field->class == field_money && end < &line[line_length] && *end == '-')
+	{
+		end++; // The sign of a right aligned amount can be just after it (RRT).
+	}
+	while (start < end && isspace((unsigned char)*start))
+	{
+		start++;
+	}
+	while (end > start && isspace((unsigned char)end[-1]))
+	{
+		end--;
+	}
+	size_t length = (size_t)(end - start);
+
+	i32 order = 0;
+	i64 value = 0;
+	if (comparison->digits && ParseDigits(start, length, &value))
+	{
+		order = (value > comparison->number) - (value < comparison->number);
+		return FilterOrderHolds(comparison->operator, order);
+	}
+	if (comparison->class == field_text || comparison->class == field_code)
+	{
+		size_t common = MIN(length, comparison->text_length);
+		for (size_t index = 0; index < common && order == 0; index++)
+		{
+			order = tolower((unsigned char)start[index]) - tolower((unsigned char)comparison->text[index]);
+		}
+		if (order == 0)
+		{
+			order = (length > comparison->text_length) - (length < comparison->text_length);
+		}
+		return FilterOrderHolds(comparison->operator, order);
+	}
+
+	char text[FILTER_FIELD_SIZE];
+	if (length >= sizeof(text))
+	{
+		return false;
+	}
+	memcpy(text, start, length);
+	text[length] = '\0';
+
+	if (comparison->class == field_date)
+	{
+		i32 days;
+		if (!ParseReportDate(text, &days))
+		{
+			return false; // Blank, or not a date.
+		}
+		value = days;
+	}
+	else if (length > 0 && !ParseMoneyCents(text, &value))
+	{
+		return false; // Not an amount. A blank one is 0.
+	}
+	order = (value > comparison->number) - (value < comparison->number);
+	return FilterOrderHolds(comparison->operator, order);
+}
+
+// Runs the comparisons on the fields of a line of the record: those of tables[table] of the ones the filter was
+// compiled with, here at the columns of the report being parsed. What they come to is kept until the next line
+// with the same table.
+void FilterCompare(Record_filter* filter, u32 table, Field_check* fields, char* line, size_t line_length)
+{
+	for (u32 index = 0; index < filter->num_comparisons; index++)
+	{
+		Filter_comparison* comparison = &filter->comparisons[index];
+		if (comparison->table == table)
+		{
+			bool holds = FilterFieldHolds(comparison, &fields[comparison->field], line, line_length);
+			filter->matched = (filter->matched & ~(1u << index)) | ((u32)holds << index);
+		}
+	}
+}
+
+// Whether any group of comparisons joined by "and" all held, on the lines compared so far.
+bool FilterMatches(Record_filter* filter)
+{
+	bool group_holds = true;
+	for (u32 index = 0; index < filter->num_comparisons; index++)
+	{
+		if (filter->comparisons[index].starts_group && index > 0)
+		{
+			if (group_holds)
+			{
+				return true;
+			}
+			group_holds = true;
+		}
+		group_holds = group_holds && (filter->matched & (1u << index));
+	}
+	return group_holds;
+}
+
+// FilterCompare() for the lines of a record, in order. Returns false once the record is known not to match (at
+// the last line with a compared field), true until then.
+bool FilterLine(Record_filter* filter, u32 table, Field_check* fields, char* line, size_t line_length)
+{
+	FilterCompare(filter, table, fields, line, line_length);
+	return (table < filter->last_table) || FilterMatches(filter);
+}
+
+#endif
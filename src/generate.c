@@ -0,0 +1,851 @@
+#include <stdio.h>
+
+#include "platform.h"
+#include "utils.h"
+
+#define VERSION "2026-10-19"
+
+#define MAX_LINE_LENGTH 160
+
+typedef struct
+{
+	u64 seed;
+} Program_options;
+
+typedef enum
+{
+	report_classes,
+	report_xrefs,
+	report_account,
+	report_address,
+	report_memo,
+	report_history,
+	report_invoices,
+	report_type_count
+} Report_type;
+
+char* report_type_names[report_type_count] = {"classes", "xrefs", "account", "address", "memo", "history", "invoices"};
+
+/*	NOTES
+	=====
+
+	- Every report is laid out exactly where the parsers read it (see the column offsets in each parser), with
+	  the page headers, the irregular IRH headers after the eleventh page and the footers the parsers stop at.
+	- Content is random but plausible: the same seed always produces the same report, customer IDs are shared
+	  by the IRL and RRT reports, and UPCs carry valid check digits (except for a few deliberately bad ones).
+	- Lines are written without trailing blanks, like the reports downloaded from ProfitMaster.
+*/
+
+typedef struct
+{
+	u64 state;
+} Random_series;
+
+u32 RandomNext(Random_series* series)
+{
+	// xorshift64*
+	series->state ^= series->state >> 12;
+	series->state ^= series->state << 25;
+	series->state ^= series->state >> 27;
+	return (u32)((series->state * 2685821657736338717ULL) >> 32);
+}
+
+// Inclusive of both min and max.
+i32 RandomBetween(Random_series* series, i32 min, i32 max)
+{
+	return min + (i32)(RandomNext(series) % (u32)(max - min + 1));
+}
+
+bool RandomChance(Random_series* series, u32 percent)
+{
+	return (RandomNext(series) % 100) < percent;
+}
+
+char* RandomChoice(Random_series* series, char** choices, u32 num_choices)
+{
+	return choices[RandomNext(series) % num_choices];
+}
+
+
+char* words[] =
+{
+	"HAMMER", "NAIL", "SCREW", "BOLT", "WASHER", "HINGE", "PAINT", "BRUSH", "ROLLER", "TAPE", "GLUE", "SAW",
+	"DRILL", "BIT", "CHISEL", "LEVEL", "SQUARE", "CLAMP", "PLIERS", "WRENCH", "SOCKET", "FUSE", "WIRE", "LAMP",
+	"BULB", "SWITCH", "OUTLET", "PIPE", "VALVE", "ELBOW", "TEE", "CAULK", "STAIN", "SEALER", "RAKE", "SHOVEL",
+	"HOSE", "NOZZLE", "BUCKET", "LADDER", "GLOVES", "KNIFE", "BLADE", "FILTER", "BATTERY", "CHAIN", "ROPE", "TARP",
+	"GALV", "BRASS", "STEEL", "WHITE", "BLACK", "RED", "1/2IN", "3/4IN", "2X4", "8FT", "12V", "LARGE", "SMALL", "PK10",
+};
+
+char* first_names[] = {"JOHN", "MARY", "ROBERT", "LINDA", "MICHEL", "SUSAN", "DAVID", "KAREN", "PIERRE", "ANNE", "JAMES", "NANCY"};
+char* last_names[] = {"SMITH", "TREMBLAY", "MARTIN", "ROY", "WILSON", "GAGNON", "MACDONALD", "TAYLOR", "BROWN", "LEBLANC", "CAMPBELL", "HOSICK"};
+char* company_suffixes[] = {"CONSTRUCTION", "LUMBER LTD", "CONTRACTING", "MARINE", "LODGE", "TOWNSHIP OF", "ELECTRIC", "PLUMBING"};
+char* streets[] = {"MAIN ST", "MOWAT AVE", "OCTAVIA ST", "GORROD ST", "MAIN ST W", "HWY 11", "FIRST AVE", "MILL RD"};
+char* cities[] = {"ATIKOKAN", "FORT FRANCES", "THUNDER BAY", "DRYDEN", "KENORA", "WINNIPEG", "SIOUX LOOKOUT", "IGNACE"};
+char* provinces[] = {"ON", "ON", "ON", "ON", "MB", "QC", "AB", "BC"};
+char* tax_authorities[] = {"ON", "ON", "ON", "ON", "ONFN", "EXEM"};
+char* payment_codes[] = {"01", "01", "02", "03", "CA", "CH"};
+char* locations[] = {"01", "01", "01", "02"};
+char* vendors[] = {"ACME", "STANLY", "RICHEL", "ORGILL", "CIL", "DEWALT", "BENJMN", "NOMVAL", "TARGT", "SIMPSN"};
+char* transaction_types[] = {"INV", "INV", "INV", "PAY", "CRM", "FIN"};
+char* memo_phrases[] =
+{
+	"CALL BEFORE DELIVERY", "PO REQUIRED", "NET 30", "SEE MANAGER FOR CREDIT", "EMAIL STATEMENTS",
+	"TAX EXEMPT # ON FILE", "CHARGE TO JOB SITE", "CASH ONLY", "DELIVER TO BACK DOOR", "ACCOUNT ON HOLD",
+};
+
+void RandomWords(Random_series* series, char* buffer, size_t buffer_size, u32 max_length)
+{
+	size_t length = 0;
+	buffer[0] = '\0';
+	u32 num_words = (u32)RandomBetween(series, 1, 4);
+	for (u32 word = 0; word < num_words; word++)
+	{
+		char* next = RandomChoice(series, words, ArrayCount(words));
+		size_t next_length = strlen(next);
+		if (length + (length ? 1 : 0) + next_length > max_length || length + next_length + 2 > buffer_size)
+		{
+			break;
+		}
+		length += sprintf_s(buffer + length, buffer_size - length, length ? " %s" : "%s", next);
+	}
+}
+
+void RandomSku(Random_series* series, char* buffer, size_t buffer_size, u32 index)
+{
+	static char* prefixes[] = {"", "", "", "A", "HW", "PL", "EL"};
+	sprintf_s(buffer, buffer_size, "%s%0*u", RandomChoice(series, prefixes, ArrayCount(prefixes)), RandomBetween(series, 5, 8), index + 10000);
+}
+
+// UPC-A with a valid check digit, unless the report should carry one of the occasional bad ones.
+void RandomUpc(Random_series* series, char* buffer)
+{
+	i32 sum = 0;
+	for (i32 digit = 0; digit < 11; digit++)
+	{
+		buffer[digit] = (char)('0' + RandomBetween(series, 0, 9));
+		sum += (buffer[digit] - '0') * ((digit % 2) == 0 ? 3 : 1);
+	}
+	i32 check = (10 - (sum % 10)) % 10;
+	if (RandomChance(series, 2))
+	{
+		check = (check + 1) % 10;
+	}
+	buffer[11] = (char)('0' + check);
+	buffer[12] = '\0';
+}
+
+void CustomerId(char* buffer, size_t buffer_size, u32 index)
+{
+	sprintf_s(buffer, buffer_size, "%u", 100000 + index * 3);
+}
+
+void RandomDate(Random_series* series, char* buffer, size_t buffer_size)
+{
+	sprintf_s(buffer, buffer_size, "%02d/%02d/%02d", RandomBetween(series, 1, 12), RandomBetween(series, 1, 28), RandomBetween(series, 0, 24) % 100);
+}
+
+// ProfitMaster prints zero cents as ".00" and leaves off the leading zero of amounts under a dollar.
+void FormatMoney(char* buffer, size_t buffer_size, i64 cents)
+{
+	if (cents < 0)
+	{
+		cents = -cents;
+	}
+	if (cents < 100)
+	{
+		sprintf_s(buffer, buffer_size, ".%02d", (i32)cents);
+	}
+	else
+	{
+		sprintf_s(buffer, buffer_size, "%lld.%02d", (long long)(cents / 100), (i32)(cents % 100));
+	}
+}
+
+//
+// Lines are composed in a blank buffer and written without their trailing blanks.
+//
+
+void ClearLine(char* line)
+{
+	memset(line, ' ', MAX_LINE_LENGTH);
+	line[MAX_LINE_LENGTH] = '\0';
+}
+
+void PutLeft(char* line, u32 column, char* text, u32 width)
+{
+	size_t length = MIN(strlen(text), width);
+	memcpy(&line[column], text, length);
+}
+
+void PutRight(char* line, u32 column, char* text, u32 width)
+{
+	size_t length = MIN(strlen(text), width);
+	memcpy(&line[column + width - length], text, length);
+}
+
+void PutNumber(char* line, u32 column, i64 value, u32 width)
+{
+	char text[24];
+	sprintf_s(text, sizeof(text), "%lld", (long long)value);
+	PutRight(line, column, text, width);
+}
+
+void EmitLine(FILE* file, char* line)
+{
+	i32 length = MAX_LINE_LENGTH;
+	while (length > 0 && line[length - 1] == ' ')
+	{
+		length--;
+	}
+	fwrite(line, 1, length, file);
+	fputc('\n', file);
+}
+
+// A page header: a blank line followed by the given number of lines of header text, the third of which has the
+// column headings (if given; made with PutLeft() and PutRight() like a record).
+void EmitPageHeader(FILE* file, char* report, char* title, char* headings, u32 page, u32 num_text_lines)
+{
+	fprintf(file, "\n");
+	for (u32 line = 0; line < num_text_lines; line++)
+	{
+		if (line == 2 && headings)
+		{
+			EmitLine(file, headings);
+			continue;
+		}
+		switch (line)
+		{
+			case 0:  fprintf(file, "%-6s %-50s PAGE %5u\n", report, "ATIKOKAN HARDWARE", page); break;
+			case 1:  fprintf(file, "       %s\n", title); break;
+			default: fprintf(file, "-------------------------------------------------------------------------------\n"); break;
+		}
+	}
+}
+
+//
+// Reports
+//
+
+void GenerateClasses(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 0;
+
+	char headings[MAX_LINE_LENGTH + 1];
+	ClearLine(headings);
+	PutLeft(headings, 18, "CLASS", 5);
+	PutLeft(headings, 25, "DESCRIPTION", 11);
+	PutRight(headings, 56, "PER", 3);
+	PutLeft(headings, 69, "BY CLASS", 8);
+
+	for (u32 record = 0; record < num_records; record++)
+	{
+		if ((record % 50) == 0)
+		{
+			EmitPageHeader(file, "IRK", "CLASS LISTING", headings, ++page, 7);
+			if (RandomChance(series, 50)) // Department heading (no class id), which the parser skips.
+			{
+				ClearLine(line);
+				RandomWords(series, text, sizeof(text), 30);
+				PutLeft(line, 25, text, 30);
+				EmitLine(file, line);
+			}
+		}
+
+		ClearLine(line);
+		sprintf_s(text, sizeof(text), "%u", record % 10000);
+		PutLeft(line, 18, text, 4);
+		RandomWords(series, text, sizeof(text), 30);
+		PutLeft(line, 25, text, 30);
+		PutNumber(line, 57, RandomChance(series, 80) ? 24 : RandomBetween(series, 0, 24), 2);
+		line[73] = RandomChance(series, 70) ? 'Y' : 'N';
+		EmitLine(file, line);
+	}
+
+	fprintf(file, "-------------------------------------------------------------------------\n");
+	fprintf(file, "TOTAL CLASSES: %u\n", num_records);
+}
+
+void GenerateCrossReferences(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 0;
+	u32 lines_on_page = 55;
+
+	char headings[MAX_LINE_LENGTH + 1];
+	ClearLine(headings);
+	PutLeft(headings, 2, "CLASS", 5);
+	PutLeft(headings, 8, "SKU", 3);
+	PutLeft(headings, 21, "DESCRIPTION", 11);
+	PutLeft(headings, 48, "REFERENCE", 9);
+	PutLeft(headings, 70, "VENDOR", 6);
+
+	for (u32 record = 0; record < num_records; record++)
+	{
+		u32 num_references = (u32)RandomBetween(series, 1, 4);
+		for (u32 reference = 0; reference < num_references; reference++)
+		{
+			if (lines_on_page++ == 55)
+			{
+				EmitPageHeader(file, "IRX", "CROSS REFERENCE LISTING", headings, ++page, 6);
+				lines_on_page = 1;
+			}
+
+			ClearLine(line);
+			if (reference == 0)
+			{
+				sprintf_s(text, sizeof(text), "%u", record % 10000);
+				PutLeft(line, 2, text, 4);
+				RandomSku(series, text, sizeof(text), record);
+				PutLeft(line, 8, text, 11);
+				RandomWords(series, text, sizeof(text), 25);
+				PutLeft(line, 21, text, 25);
+				PutLeft(line, 70, RandomChoice(series, vendors, ArrayCount(vendors)), 6);
+			}
+			if (RandomChance(series, 85))
+			{
+				RandomUpc(series, text);
+			}
+			else
+			{
+				sprintf_s(text, sizeof(text), "V%u-%u", RandomBetween(series, 100, 99999), reference);
+			}
+			PutLeft(line, 48, text, 15);
+			EmitLine(file, line);
+		}
+	}
+
+	// The parser stops at the first line with something in column 66.
+	fprintf(file, "==============================================================================\n");
+	fprintf(file, "TOTAL PRODUCTS: %u\n", num_records);
+}
+
+// Cents of a random amount, mostly small, occasionally large or zero.
+i64 RandomCents(Random_series* series, i32 max_dollars)
+{
+	if (RandomChance(series, 15))
+	{
+		return 0;
+	}
+	i64 dollars = RandomChance(series, 90) ? RandomBetween(series, 0, max_dollars / 10) : RandomBetween(series, 0, max_dollars);
+	return dollars * 100 + RandomBetween(series, 0, 99);
+}
+
+void RandomName(Random_series* series, char* buffer, size_t buffer_size, bool with_semicolon)
+{
+	if (RandomChance(series, 70))
+	{
+		sprintf_s(buffer, buffer_size, with_semicolon ? "%s;%s" : "%s %s",
+				RandomChoice(series, first_names, ArrayCount(first_names)), RandomChoice(series, last_names, ArrayCount(last_names)));
+	}
+	else
+	{
+		sprintf_s(buffer, buffer_size, "%s %s",
+				RandomChoice(series, last_names, ArrayCount(last_names)), RandomChoice(series, company_suffixes, ArrayCount(company_suffixes)));
+	}
+}
+
+void GenerateAccounts(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 0;
+	i64 total_balance = 0;
+
+	for (u32 record = 0; record < num_records; record++)
+	{
+		if ((record % 50) == 0)
+		{
+			EmitPageHeader(file, "IRL", "CUSTOMER ACCOUNT LISTING", NULL, ++page, 7);
+		}
+
+		ClearLine(line);
+		PutLeft(line, 0, RandomChoice(series, locations, ArrayCount(locations)), 2);
+		CustomerId(text, sizeof(text), record);
+		PutRight(line, 3, text, 9);
+		line[12] = '-';
+		line[13] = RandomChance(series, 90) ? 'R' : 'O';
+		PutLeft(line, 16, RandomChoice(series, tax_authorities, ArrayCount(tax_authorities)), 4);
+		line[21] = (char)('1' + RandomBetween(series, 0, 3));
+		PutLeft(line, 23, RandomChoice(series, payment_codes, ArrayCount(payment_codes)), 2);
+		RandomName(series, text, sizeof(text), false);
+		PutLeft(line, 26, text, 26);
+		sprintf_s(text, sizeof(text), "597-%04d", RandomBetween(series, 0, 9999));
+		PutLeft(line, 53, text, 8);
+		if (RandomChance(series, 70))
+		{
+			PutNumber(line, 62, RandomBetween(series, 1, 50) * 100, 7);
+		}
+		i64 balance = RandomCents(series, 20000);
+		FormatMoney(text, sizeof(text), balance);
+		PutRight(line, 70, text, 10);
+		bool credit = balance && RandomChance(series, 10);
+		if (credit)
+		{
+			PutLeft(line, 80, "CR", 2);
+		}
+		total_balance += credit ? -balance : balance;
+		FormatMoney(text, sizeof(text), RandomCents(series, 99999));
+		PutRight(line, 82, text, 8);
+		FormatMoney(text, sizeof(text), RandomChance(series, 90) ? 0 : RandomCents(series, 500));
+		PutRight(line, 92, text, 11);
+		RandomDate(series, text, sizeof(text));
+		PutLeft(line, 104, text, 8);
+		if (RandomChance(series, 80))
+		{
+			RandomDate(series, text, sizeof(text));
+			PutLeft(line, 114, text, 8);
+		}
+		if (RandomChance(series, 85))
+		{
+			RandomDate(series, text, sizeof(text));
+			PutLeft(line, 124, text, 8);
+		}
+		EmitLine(file, line);
+	}
+
+	// The parser stops at the summary line, which is exactly 69 characters long.
+	fprintf(file, "%-59s%10u\n", "TOTAL ACCOUNTS", num_records);
+	FormatMoney(text, sizeof(text), total_balance);
+	fprintf(file, "%-66s%14s%s\n", "TOTAL BALANCE", text, (total_balance < 0) ? "CR" : "");
+}
+
+void GenerateAddresses(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 0;
+
+	for (u32 record = 0; record <= num_records; record++)
+	{
+		if ((record % 25) == 0) // Each page contains exactly 25 accounts.
+		{
+			EmitPageHeader(file, "IRL", "CUSTOMER ADDRESS LISTING", NULL, ++page, 6);
+		}
+		if (record == num_records)
+		{
+			break;
+		}
+
+		ClearLine(line);
+		CustomerId(text, sizeof(text), record);
+		PutRight(line, 0, text, 9);
+		line[10] = RandomChance(series, 90) ? 'R' : 'O';
+		PutLeft(line, 12, RandomChoice(series, tax_authorities, ArrayCount(tax_authorities)), 4);
+		line[17] = (char)('1' + RandomBetween(series, 0, 3));
+		PutLeft(line, 19, RandomChoice(series, payment_codes, ArrayCount(payment_codes)), 2);
+		RandomName(series, text, sizeof(text), true);
+		PutLeft(line, 22, text, 27);
+		sprintf_s(text, sizeof(text), "(807) 597-%04d", RandomBetween(series, 0, 9999));
+		PutLeft(line, 118, text, 17);
+		EmitLine(file, line);
+
+		ClearLine(line);
+		sprintf_s(text, sizeof(text), "%d %s", RandomBetween(series, 1, 999), RandomChoice(series, streets, ArrayCount(streets)));
+		PutLeft(line, 23, text, 27);
+		if (RandomChance(series, 20))
+		{
+			sprintf_s(text, sizeof(text), "PO BOX %d", RandomBetween(series, 1, 2000));
+			PutLeft(line, 51, text, 27);
+		}
+		u32 city = RandomNext(series) % ArrayCount(cities);
+		PutLeft(line, 79, cities[city], 17);
+		PutLeft(line, 100, provinces[city], 2);
+		sprintf_s(text, sizeof(text), "P0T %dC%d", RandomBetween(series, 0, 9), RandomBetween(series, 0, 9));
+		PutLeft(line, 103, text, 10);
+		PutLeft(line, 113, "FAX", 3);
+		sprintf_s(text, sizeof(text), "(807) 597-%04d", RandomBetween(series, 0, 9999));
+		PutLeft(line, 118, RandomChance(series, 30) ? text : "(807) 597-", 14);
+		EmitLine(file, line);
+	}
+
+	// The parser stops at the first account without an id.
+	fprintf(file, "          TOTAL ACCOUNTS: %u\n", num_records);
+	fprintf(file, "\n");
+}
+
+void GenerateMemos(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 0;
+
+	for (u32 record = 0; record <= num_records; record++)
+	{
+		if ((record % 13) == 0) // Each page contains exactly 13 accounts.
+		{
+			EmitPageHeader(file, "IRL", "CUSTOMER MEMO LISTING", NULL, ++page, 5);
+		}
+		if (record == num_records)
+		{
+			break;
+		}
+
+		for (u32 memo_line = 0; memo_line < 4; memo_line++)
+		{
+			ClearLine(line);
+			if (memo_line == 0)
+			{
+				CustomerId(text, sizeof(text), record);
+				PutRight(line, 0, text, 10);
+				PutLeft(line, 10, "-00", 3);
+			}
+			if (RandomChance(series, memo_line == 0 ? 80 : 30))
+			{
+				PutLeft(line, 23, RandomChoice(series, memo_phrases, ArrayCount(memo_phrases)), 25);
+			}
+			if (memo_line < 3 && RandomChance(series, memo_line == 0 ? 40 : 15))
+			{
+				// Some of what staff keep in the memos: status card numbers and email addresses.
+				u32 kind = RandomNext(series) % 10;
+				if (kind == 0)
+				{
+					sprintf_s(text, sizeof(text), "STATUS CARD %05d%05d", RandomBetween(series, 0, 99999), RandomBetween(series, 0, 99999));
+				}
+				else if (kind == 1)
+				{
+					sprintf_s(text, sizeof(text), "EMAIL %s@%s.CA",
+							  RandomChoice(series, first_names, ArrayCount(first_names)), RandomChoice(series, last_names, ArrayCount(last_names)));
+				}
+				else
+				{
+					sprintf_s(text, sizeof(text), "%s %d", RandomChoice(series, memo_phrases, ArrayCount(memo_phrases)), RandomBetween(series, 1, 9999));
+				}
+				PutLeft(line, 49, text, 40);
+			}
+			EmitLine(file, line);
+		}
+	}
+
+	// Shorter than an account, so the parser never counts it.
+	fprintf(file, "TOTAL MEMOS: %u\n", num_records);
+}
+
+void GenerateHistory(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 0;
+
+	// History calendar, between two blank lines.
+	fprintf(file, "\n");
+	fprintf(file, "HISTORY CALENDAR\n");
+	for (i32 year = 0; year < 2; year++)
+	{
+		fprintf(file, "  %d:", 2024 - year);
+		for (i32 period = 0; period < 12; period++)
+		{
+			fprintf(file, " P%-2d %02d/%02d", year * 12 + period + 1, 12 - period, 24 - year);
+		}
+		fprintf(file, "\n");
+	}
+
+	for (u32 record = 0; record < num_records; record++)
+	{
+		if ((record % 15) == 0)
+		{
+			page++;
+			if (page <= 11)
+			{
+				EmitPageHeader(file, "IRH", "PRODUCT HISTORY", NULL, page, 6);
+			}
+			else // After the first eleven pages the header has an empty line in the middle.
+			{
+				fprintf(file, "\n");
+				fprintf(file, "%-6s %-50s PAGE %5u\n", "IRH", "ATIKOKAN HARDWARE", page);
+				fprintf(file, "       PRODUCT HISTORY\n");
+				fprintf(file, "\n");
+				fprintf(file, "-------------------------------------------------------------------------------\n");
+				fprintf(file, "-------------------------------------------------------------------------------\n");
+				fprintf(file, "-------------------------------------------------------------------------------\n");
+			}
+		}
+
+		ClearLine(line);
+		RandomSku(series, text, sizeof(text), record);
+		PutLeft(line, 0, text, 11);
+		RandomWords(series, text, sizeof(text), 25);
+		PutLeft(line, 12, text, 25);
+		PutLeft(line, 38, RandomChoice(series, locations, ArrayCount(locations)), 2);
+		i64 cost = RandomCents(series, 500);
+		FormatMoney(text, sizeof(text), cost);
+		PutRight(line, 40, text, 10);
+		FormatMoney(text, sizeof(text), cost + RandomBetween(series, -100, 100) * (cost > 100));
+		PutRight(line, 50, text, 10);
+		RandomDate(series, text, sizeof(text));
+		PutLeft(line, 61, text, 8);
+		FormatMoney(text, sizeof(text), cost * RandomBetween(series, 13, 20) / 10);
+		PutRight(line, 70, text, 10);
+		PutNumber(line, 80, RandomChance(series, 5) ? -RandomBetween(series, 1, 5) : RandomBetween(series, 0, 200), 7);
+		PutNumber(line, 87, RandomChance(series, 90) ? 0 : RandomBetween(series, 1, 10), 7);
+		PutNumber(line, 94, RandomChance(series, 80) ? 0 : RandomBetween(series, 1, 48), 7);
+		PutNumber(line, 101, RandomBetween(series, 0, 12), 7);
+		PutNumber(line, 108, RandomBetween(series, 0, 24), 7);
+		PutLeft(line, 115, "12/24", 8);
+		if (RandomChance(series, 90))
+		{
+			PutLeft(line, 124, RandomChoice(series, vendors, ArrayCount(vendors)), 6);
+		}
+		EmitLine(file, line);
+
+		ClearLine(line);
+		if (RandomChance(series, 50))
+		{
+			RandomWords(series, text, sizeof(text), 25);
+			PutLeft(line, 2, text, 25);
+		}
+		if (RandomChance(series, 10))
+		{
+			PutLeft(line, 29, "*** NO HISTORY RECORDS FOUND ***", 32);
+			EmitLine(file, line);
+			continue;
+		}
+
+		i32 rate = RandomBetween(series, 0, 40);
+		for (i32 year = 0; year < 2; year++)
+		{
+			if (year == 1)
+			{
+				ClearLine(line);
+			}
+			i32 year_total = 0;
+			for (i32 period = 0; period < 12; period++)
+			{
+				i32 sales = rate ? RandomBetween(series, 0, rate) : 0;
+				if (RandomChance(series, 2))
+				{
+					sales = -RandomBetween(series, 1, 3); // Returns.
+				}
+				year_total += sales;
+				PutNumber(line, 27 + period * 8, sales, 8);
+			}
+			PutNumber(line, 27 + 12 * 8, year_total, 8);
+			EmitLine(file, line);
+		}
+	}
+
+	fprintf(file, "=================================================================================\n");
+	fprintf(file, "TOTAL PRODUCTS: %u\n", num_records);
+}
+
+void GenerateInvoices(FILE* file, u32 num_records, Random_series* series)
+{
+	char line[MAX_LINE_LENGTH + 1];
+	char text[64];
+	u32 page = 1;
+	u32 lines_on_page = 0;
+	u32 account = 0;
+
+	char headings[MAX_LINE_LENGTH + 1];
+	ClearLine(headings);
+	PutLeft(headings, 41, "CRM", 3);
+	PutLeft(headings, 45, "LC", 2);
+	PutLeft(headings, 48, "PC", 2);
+	PutLeft(headings, 51, "INVOICE", 7);
+	PutLeft(headings, 59, "TYP", 3);
+	PutLeft(headings, 63, "REF", 3);
+	PutLeft(headings, 70, "DATE", 4);
+	PutRight(headings, 108, "AMOUNT", 10);
+	PutRight(headings, 120, "BALANCE", 10);
+
+	// The first header has one more line than the others.
+	EmitPageHeader(file, "RRT", "ACCOUNTS RECEIVABLE TRIAL BALANCE", headings, page, 5);
+
+	u32 record = 0;
+	while (record < num_records)
+	{
+		u32 num_invoices = (u32)RandomBetween(series, 1, 6);
+		num_invoices = MIN(num_invoices, num_records - record);
+		if (lines_on_page + num_invoices + 2 > 55)
+		{
+			EmitPageHeader(file, "RRT", "ACCOUNTS RECEIVABLE TRIAL BALANCE", headings, ++page, 4);
+			lines_on_page = 0;
+		}
+
+		// Account line (shorter than an invoice line, starting with the account id).
+		CustomerId(text, sizeof(text), account++);
+		char name[64];
+		RandomName(series, name, sizeof(name), false);
+		fprintf(file, "%s  %s\n", text, name);
+
+		i64 account_total = 0;
+		for (u32 invoice = 0; invoice < num_invoices; invoice++, record++)
+		{
+			ClearLine(line);
+			if (RandomChance(series, 5))
+			{
+				PutLeft(line, 41, "CRM", 3);
+			}
+			PutLeft(line, 45, RandomChoice(series, locations, ArrayCount(locations)), 2);
+			PutLeft(line, 48, RandomChoice(series, payment_codes, ArrayCount(payment_codes)), 2);
+			PutNumber(line, 51, 100000 + record % 900000, 6);
+			char* type = RandomChoice(series, transaction_types, ArrayCount(transaction_types));
+			PutLeft(line, 59, type, 3);
+			sprintf_s(text, sizeof(text), "%u", RandomBetween(series, 1000, 999999));
+			PutLeft(line, 63, text, 6);
+			RandomDate(series, text, sizeof(text));
+			PutLeft(line, 70, text, 8);
+			i64 amount = RandomCents(series, 5000);
+			bool negative = (strcmp(type, "PAY") == 0 || strcmp(type, "CRM") == 0) && amount;
+			account_total += negative ? -amount : amount;
+			FormatMoney(text, sizeof(text), amount);
+			PutRight(line, 108, text, 10);
+			FormatMoney(text, sizeof(text), amount);
+			PutRight(line, 120, text, 10);
+			if (negative)
+			{
+				line[118] = '-';
+				line[130] = '-';
+			}
+			EmitLine(file, line);
+		}
+
+		// Account total (the parser skips lines with a '.' where the invoice number would be).
+		ClearLine(line);
+		PutLeft(line, 23, "ACCOUNT TOTAL", 13);
+		PutRight(line, 44, ".00", 10);
+		FormatMoney(text, sizeof(text), account_total);
+		PutRight(line, 120, text, 10);
+		if (account_total < 0)
+		{
+			line[130] = '-';
+		}
+		EmitLine(file, line);
+		lines_on_page += num_invoices + 2;
+	}
+
+	// The summary starts with a short line naming the customer location.
+	fprintf(file, "Cust Loc: 01  TOTAL INVOICES: %u\n", num_records);
+}
+
+#define USAGE_STRING "\
+%s %s\n\
+John Hosick <john@atikokancastle.com>\n\n\
+%s writes a synthetic ProfitMaster report with the given number of records, laid out like the\n\
+real reports, for testing and benchmarking the other tools without using customer data.\n\n\
+USAGE: %s [OPTIONS] <reporttype> <records> <outputfile>\n\
+  REPORT TYPES:\n\
+    classes         IRK class report (classes).\n\
+    xrefs           IRX cross-reference report (crossreferences). Records are products.\n\
+    account         IRL customer account listing (customers account).\n\
+    address         IRL customer address report (customers address).\n\
+    memo            IRL customer memo report (customers memo).\n\
+    history         IRH product history report (producthistory).\n\
+    invoices        RRT accounts receivable report (invoices).\n\
+  OPTIONS:\n\
+    -h, --help      Show this help message.\n\
+    -s, --seed <n>  Seed for the random content (default 1). The same seed gives the same report.\n"
+
+void PrintUsageAndExit(char *program_name)
+{
+	printf(USAGE_STRING, program_name, VERSION, program_name, program_name);
+	exit (0);
+}
+
+int main(int argc, char *argv[])
+{
+	char* program_name = argv[0];
+	char* report_type_name = {0};
+	char* records_text = {0};
+	char* file_output_name = {0};
+
+	Program_options options = {0};
+	options.seed = 1;
+
+	if (argc < 2)
+	{
+		printf("%s: Report type not specified. Use -h or --help for more details.\n", program_name);
+		return -1;
+	}
+
+	for (i32 arg = 1; arg < argc; arg++)
+	{
+		char c1 = argv[arg][0];
+		char c2 = argv[arg][1];
+		if (c1 == '-')
+		{
+			char* option = (c2 == '-') ? &argv[arg][2] : &argv[arg][1];
+			if ((strcmp(option, "help") == 0) || (strcmp(option, "h") == 0))
+			{
+				PrintUsageAndExit(program_name);
+			}
+			else if ((strcmp(option, "seed") == 0) || (strcmp(option, "s") == 0))
+			{
+				if (arg + 1 == argc)
+				{
+					printf("%s: No seed given. Use -h or --help for more details.\n", program_name);
+					return -1;
+				}
+				options.seed = strtoull(argv[++arg], NULL, 10);
+			}
+			else
+			{
+				printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
+				return -1;
+			}
+			continue;
+		}
+		if (!report_type_name)
+		{
+			report_type_name = argv[arg];
+			continue;
+		}
+		if (!records_text)
+		{
+			records_text = argv[arg];
+			continue;
+		}
+		file_output_name = argv[arg];
+		break; // No point in processing any additional arguments.
+	}
+
+	if (!report_type_name || !records_text || !file_output_name)
+	{
+		printf("%s: Report type, number of records or output file not specified. Use -h or --help for more details.\n", program_name);
+		return -1;
+	}
+
+	Report_type report_type = report_type_count;
+	for (u32 type = 0; type < report_type_count; type++)
+	{
+		if (strcmp(report_type_name, report_type_names[type]) == 0)
+		{
+			report_type = (Report_type)type;
+		}
+	}
+	if (report_type == report_type_count)
+	{
+		printf("%s: Invalid report type '%s'. Use -h or --help for more details.\n", program_name, report_type_name);
+		return -1;
+	}
+
+	u32 num_records = (u32)strtoul(records_text, NULL, 10);
+
+	FILE* stream_output;
+	errno_t error = fopen_s(&stream_output, file_output_name, "wb");
+	if (error)
+	{
+		printf("Could not create output file: %s\n", file_output_name);
+		return -1;
+	}
+	setvbuf(stream_output, NULL, _IOFBF, 1 << 20);
+
+	Random_series series = {options.seed * 0x9E3779B97F4A7C15ULL + 1}; // Never zero, whatever the seed.
+	switch (report_type)
+	{
+		case report_classes:	GenerateClasses(stream_output, num_records, &series); break;
+		case report_xrefs:		GenerateCrossReferences(stream_output, num_records, &series); break;
+		case report_account:	GenerateAccounts(stream_output, num_records, &series); break;
+		case report_address:	GenerateAddresses(stream_output, num_records, &series); break;
+		case report_memo:		GenerateMemos(stream_output, num_records, &series); break;
+		case report_history:	GenerateHistory(stream_output, num_records, &series); break;
+		case report_invoices:	GenerateInvoices(stream_output, num_records, &series); break;
+		default: break;
+	}
+
+	fclose(stream_output);
+	printf("Generated %u %s records in %s.\n", num_records, report_type_name, file_output_name);
+	return 0;
+}
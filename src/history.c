@@ -1,20 +1,67 @@
-#include <windows.h>
 #include <stdio.h>
 
+#include "platform.h"
 #include "utils.h"
+#include "arena.h"
+#include "simd.h"
+#include "encoding.h"
+#include "arrow.h"
+#include "layout.h"
+#include "timing.h"
+#include "progress.h"
+#include "sniff.h"
+#include "serve.h"
+#include "anomaly.h"
+#include "reconcile.h"
+#include "columns.h"
+#include "filter.h"
+#include "sort.h"
 
-#define VERSION "2024-11-19"
+#define VERSION "2026-10-19"
 
 typedef struct
 {
 	bool print_to_screen;
 	bool debug_output;
+	bool feather_output;
+	bool reorder_analysis;
+	bool print_stats;
+	bool stats_json;
+	bool no_progress;
+	bool allow_missing_totals;
+	bool fixed_layout;
+	bool counters;
+	Code_page code_page;
+	struct Anomaly_log* anomalies; // Checks the record lines as they are parsed (only counting them without -a).
+	struct Column_selection* columns; // Chosen with --columns; NULL for the usual output.
+	u64 fields; // The fields of the report to read, FIELD(Product_field) (see columns.h).
+	struct Record_filter* filter; // Given with --where; NULL to write every product.
 } Program_options;
 
+#define NUM_HISTORY_PERIODS 24
+
+// The history calendar at the start of the report, which gives the month of each period.
+typedef struct
+{
+	i32 months[NUM_HISTORY_PERIODS]; // Of each period, as year * 12 + month - 1; -1 if the calendar does not give it.
+	u32 periods[NUM_HISTORY_PERIODS]; // By months back from the current period: 0 is the current one, 12 a year before.
+	bool complete; // It gave all 24 months, one after the other; otherwise periods are taken to be in order.
+} History_calendar;
+
 typedef struct
 {
 	u32 num_products;
 	u32 num_pages;
+	u32 num_left_out; // Of num_products, by --where.
+	Footer_total report_total; // Of the products, from the line after the '=' rule at the end of the report.
+	History_calendar calendar;
+	Report_layout layout;
+	i64 period_totals[24]; // Units sold per history period across the whole catalogue.
+	i64 total_available;
+	i64 total_on_order;
+	u32 num_below_suggested_order_point;
+	Phase_timings timings;
+	Progress* progress;
 } Report_summary;
 
 typedef struct
@@ -35,11 +82,107 @@ typedef struct
 	char order_quantity[8]; // 7 + \0
 	char current_period[10]; // 8 + \0
 	char vendor[8]; // 6 + \0
-	i32  history_periods[24];
-	i32  year_1_sales;
-	i32  year_2_sales;
+	bool has_history;
 } Product;
 
+typedef enum
+{
+	product_sku,
+	product_description_1,
+	product_description_2,
+	product_location,
+	product_avg_cost,
+	product_last_cost,
+	product_last_received,
+	product_retail_price,
+	product_available,
+	product_reserved,
+	product_on_order,
+	product_order_point,
+	product_order_quantity,
+	product_current_period,
+	product_vendor,
+	product_history, // All the periods.
+	product_field_count
+} Product_field;
+
+// Those added up for the summary.
+#define SUMMARY_FIELDS (FIELD(product_history) | FIELD(product_available) | FIELD(product_on_order))
+
+// The text fields of a product stay together in Product, but the numbers are stored by column (one
+// contiguous array per history period and per quantity) so that totals are computed a batch at a time.
+typedef struct
+{
+	Product* products;
+	u32 count;
+
+	i32* history_periods[NUM_HISTORY_PERIODS];
+	i32* year_1_sales;
+	i32* year_2_sales;
+	i32* available;
+	i32* reserved;
+	i32* on_order;
+	i32* order_point;
+	i32* order_quantity;
+
+	// Reorder analysis (only computed with --reorder).
+	float* weekly_velocity;
+	float* seasonality;
+	float* weeks_of_cover;
+	i32* suggested_order_point;
+	i32* suggested_order_quantity;
+} Product_batch;
+
+void PushProductBatch(Memory_arena* arena, Product_batch* batch)
+{
+	batch->count = 0;
+	batch->products = PushArray(arena, RECORD_BATCH_SIZE, Product);
+	for (i32 period = 0; period < NUM_HISTORY_PERIODS; period++)
+	{
+		batch->history_periods[period] = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	}
+	batch->year_1_sales = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->year_2_sales = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->available = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->reserved = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->on_order = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->order_point = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->order_quantity = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->weekly_velocity = PushArray(arena, RECORD_BATCH_SIZE, float);
+	batch->seasonality = PushArray(arena, RECORD_BATCH_SIZE, float);
+	batch->weeks_of_cover = PushArray(arena, RECORD_BATCH_SIZE, float);
+	batch->suggested_order_point = PushArray(arena, RECORD_BATCH_SIZE, i32);
+	batch->suggested_order_quantity = PushArray(arena, RECORD_BATCH_SIZE, i32);
+}
+
+// Empties the slot of a product that --where left out, for the next one. Its history was not read.
+void ClearProductSlot(Product_batch* batch, u32 slot)
+{
+	memset(&batch->products[slot], 0, sizeof(Product));
+	batch->available[slot] = 0;
+	batch->reserved[slot] = 0;
+	batch->on_order[slot] = 0;
+	batch->order_point[slot] = 0;
+	batch->order_quantity[slot] = 0;
+}
+
+// Size of the arena needed for one batch (PushSize() rounds every array up to 16 bytes).
+#define PRODUCT_BATCH_SIZE (RECORD_BATCH_SIZE * (sizeof(Product) + (NUM_HISTORY_PERIODS + 12) * sizeof(i32)) + 64 * 16)
+
+// Computes the per-product year totals and adds the batch to the catalogue totals.
+void AggregateProducts(Product_batch* batch, Report_summary* summary)
+{
+	AddColumns(&batch->history_periods[0], 12, batch->count, batch->year_1_sales);
+	AddColumns(&batch->history_periods[12], 12, batch->count, batch->year_2_sales);
+
+	for (i32 period = 0; period < NUM_HISTORY_PERIODS; period++)
+	{
+		summary->period_totals[period] += SumColumn(batch->history_periods[period], batch->count);
+	}
+	summary->total_available += SumColumn(batch->available, batch->count);
+	summary->total_on_order += SumColumn(batch->on_order, batch->count);
+}
+
 /*	NOTES
 	=====
 
@@ -50,7 +193,680 @@ typedef struct
 	- Each product requires three lines unless there is no history, in which case two are required.
 */
 
-void ParseProductHistory(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+// Lines 2 and 3 of a product hold twelve right-aligned 8 character periods each, starting at column `start` (27 in
+// the built-in layout). Returns false if they had to be converted one at a time, i.e. when something in them is not
+// a number.
+bool ParseHistoryPeriods(Product_batch* batch, i32 first_period, char* line, size_t line_length, size_t start)
+{
+	i32 sales[12];
+	bool regular = (line_length >= start + 12 * 8) && ParseEightCharIntegers(&line[start], 12, sales);
+	if (!regular)
+	{
+		// Short or irregular line: trim and convert each field on its own.
+		char sales_for_current_period[9] = {0};
+		for (i32 period = 0; period < 12; period++)
+		{
+			FillLineField(sales_for_current_period, line, line_length, start + (size_t)period * 8, 8);
+			sales[period] = atoi(sales_for_current_period);
+		}
+	}
+
+	for (i32 period = 0; period < 12; period++)
+	{
+		batch->history_periods[first_period + period][batch->count] = sales[period];
+	}
+	return regular;
+}
+
+/*	REORDER ANALYSIS
+	================
+
+	- The periods are placed by the history calendar at the start of the report, which gives the month of each
+	  (e.g. "P1  12/24"): the current period is the latest month in it, last year is the twelve months up to
+	  it and the year before that the twelve before them, so the same period last year is the one twelve
+	  months before the current one, wherever the business's calendar starts its periods. A report without a
+	  full calendar is taken to have P1 as the current period and P13 a year before it, and gets a warning.
+	- Weekly velocity is the last year's sales spread over 52 weeks.
+	- Seasonality is how last year's current period compared with last year's average period (1.0 without history).
+	- The seasonal weekly velocity is the weekly velocity scaled by the seasonality, limited to between half and
+	  double so that a single odd period last year does not dominate.
+	- Weeks of cover is the stock available and on order divided by the seasonal weekly velocity.
+	- The suggested order point covers the lead time plus safety stock at the seasonal velocity; the suggested
+	  order quantity covers REORDER_COVER_WEEKS of sales (at least one unit for anything that sells).
+*/
+
+#define REORDER_LEAD_TIME_WEEKS 2.0f
+#define REORDER_SAFETY_WEEKS	1.0f
+#define REORDER_COVER_WEEKS		4.0f
+#define REORDER_MAX_COVER_WEEKS 999.0f // Reported for products that do not sell.
+#define REORDER_MIN_SEASONAL_FACTOR 0.5f // One odd period last year should not zero (or swamp) the velocity.
+#define REORDER_MAX_SEASONAL_FACTOR 2.0f
+
+// Reads the month of each period from the history calendar, the text up to length: pairs of a period and its
+// month, as in "  2024: P1  12/24 P2  11/24 ...". Then finds the periods by months back from the current one.
+void ReadHistoryCalendar(History_calendar* calendar, char* text, size_t length)
+{
+	i32 current_month = -1;
+	for (u32 period = 0; period < NUM_HISTORY_PERIODS; period++)
+	{
+		calendar->months[period] = -1;
+	}
+	for (size_t at = 0; at + 1 < length; at++)
+	{
+		if (text[at] != 'P' || (at > 0 && text[at - 1] != ' ') || !isdigit((unsigned char)text[at + 1]))
+		{
+			continue;
+		}
+		size_t cursor = at + 1;
+		u32 period = 0;
+		while (cursor < length && isdigit((unsigned char)text[cursor]) && period <= NUM_HISTORY_PERIODS)
+		{
+			period = period * 10 + (u32)(text[cursor++] - '0');
+		}
+		while (cursor < length && text[cursor] == ' ')
+		{
+			cursor++;
+		}
+		char* date = &text[cursor];
+		if (period < 1 || period > NUM_HISTORY_PERIODS || cursor + 5 > length || date[2] != '/' ||
+			!isdigit((unsigned char)date[0]) || !isdigit((unsigned char)date[1]) ||
+			!isdigit((unsigned char)date[3]) || !isdigit((unsigned char)date[4]))
+		{
+			continue;
+		}
+		i32 month = (date[0] - '0') * 10 + (date[1] - '0');
+		i32 year = (date[3] - '0') * 10 + (date[4] - '0');
+		if (month >= 1 && month <= 12)
+		{
+			year += (year < 70) ? 2000 : 1900; // As ParseReportDate() reads two digit years.
+			calendar->months[period - 1] = year * 12 + month - 1;
+			current_month = MAX(current_month, calendar->months[period - 1]);
+		}
+	}
+
+	calendar->complete = (current_month >= 0);
+	for (u32 back = 0; back < NUM_HISTORY_PERIODS && calendar->complete; back++)
+	{
+		u32 period = 0;
+		while (period < NUM_HISTORY_PERIODS && calendar->months[period] != current_month - (i32)back)
+		{
+			period++;
+		}
+		calendar->complete = (period < NUM_HISTORY_PERIODS);
+		calendar->periods[back] = period;
+	}
+	if (!calendar->complete)
+	{
+		for (u32 back = 0; back < NUM_HISTORY_PERIODS; back++)
+		{
+			calendar->periods[back] = back;
+		}
+	}
+}
+
+// Rounds each lane up to the next integer (SSE2 has no ceil instruction).
+static inline __m128i CeilToInt(__m128 values)
+{
+	__m128i truncated = _mm_cvttps_epi32(values);
+	__m128 has_fraction = _mm_cmpgt_ps(values, _mm_cvtepi32_ps(truncated));
+	return _mm_sub_epi32(truncated, _mm_castps_si128(has_fraction)); // The mask is -1 where rounding up.
+}
+
+// Computes the reorder analysis for four products at a time, with the periods placed by the calendar.
+void ComputeReorderPoints(Product_batch* batch, Report_summary* summary)
+{
+	u32* periods = summary->calendar.periods;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 weeks_per_year = _mm_set1_ps(52.0f);
+	const __m128 periods_per_year = _mm_set1_ps(12.0f);
+	const __m128 lead_weeks = _mm_set1_ps(REORDER_LEAD_TIME_WEEKS + REORDER_SAFETY_WEEKS);
+	const __m128 cover_weeks = _mm_set1_ps(REORDER_COVER_WEEKS);
+	const __m128 max_cover_weeks = _mm_set1_ps(REORDER_MAX_COVER_WEEKS);
+	const __m128 min_factor = _mm_set1_ps(REORDER_MIN_SEASONAL_FACTOR);
+	const __m128 max_factor = _mm_set1_ps(REORDER_MAX_SEASONAL_FACTOR);
+
+	// Pad the batch to a multiple of four; the padding lanes are zero and never written out.
+	u32 count = (batch->count + 3) & ~3u;
+	for (u32 index = 0; index < count; index += 4)
+	{
+		__m128i last_year_sales = _mm_setzero_si128();
+		__m128i year_before_sales = _mm_setzero_si128();
+		for (u32 back = 0; back < 12; back++)
+		{
+			last_year_sales = _mm_add_epi32(last_year_sales, _mm_loadu_si128((__m128i*)&batch->history_periods[periods[back]][index]));
+			year_before_sales = _mm_add_epi32(year_before_sales, _mm_loadu_si128((__m128i*)&batch->history_periods[periods[back + 12]][index]));
+		}
+		__m128 year_1 = _mm_cvtepi32_ps(last_year_sales);
+		__m128 year_2 = _mm_cvtepi32_ps(year_before_sales);
+		__m128 same_period_last_year = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i*)&batch->history_periods[periods[12]][index]));
+		__m128 stock = _mm_cvtepi32_ps(_mm_add_epi32(_mm_loadu_si128((__m128i*)&batch->available[index]),
+													 _mm_loadu_si128((__m128i*)&batch->on_order[index])));
+
+		__m128 velocity = _mm_max_ps(_mm_div_ps(year_1, weeks_per_year), zero); // Net returns do not sell.
+
+		__m128 has_last_year = _mm_cmpgt_ps(year_2, zero);
+		__m128 safe_year_2 = _mm_or_ps(_mm_and_ps(has_last_year, year_2), _mm_andnot_ps(has_last_year, one));
+		__m128 seasonality = _mm_div_ps(_mm_mul_ps(same_period_last_year, periods_per_year), safe_year_2);
+		seasonality = _mm_or_ps(_mm_and_ps(has_last_year, seasonality), _mm_andnot_ps(has_last_year, one));
+
+		__m128 seasonal_velocity = _mm_mul_ps(velocity, _mm_min_ps(_mm_max_ps(seasonality, min_factor), max_factor));
+		__m128 sells = _mm_cmpgt_ps(seasonal_velocity, zero);
+		__m128 safe_velocity = _mm_or_ps(_mm_and_ps(sells, seasonal_velocity), _mm_andnot_ps(sells, one));
+		__m128 cover = _mm_min_ps(_mm_max_ps(_mm_div_ps(stock, safe_velocity), zero), max_cover_weeks);
+		cover = _mm_or_ps(_mm_and_ps(sells, cover), _mm_andnot_ps(sells, max_cover_weeks));
+
+		__m128i order_point = CeilToInt(_mm_mul_ps(seasonal_velocity, lead_weeks));
+		__m128i order_quantity = CeilToInt(_mm_mul_ps(seasonal_velocity, cover_weeks));
+
+		_mm_storeu_ps(&batch->weekly_velocity[index], velocity);
+		_mm_storeu_ps(&batch->seasonality[index], seasonality);
+		_mm_storeu_ps(&batch->weeks_of_cover[index], cover);
+		_mm_storeu_si128((__m128i*)&batch->suggested_order_point[index], order_point);
+		_mm_storeu_si128((__m128i*)&batch->suggested_order_quantity[index], order_quantity);
+	}
+
+	for (u32 index = 0; index < batch->count; index++)
+	{
+		if (batch->order_point[index] < batch->suggested_order_point[index])
+		{
+			summary->num_below_suggested_order_point++;
+		}
+	}
+}
+
+// The columns of the reorder analysis, which --columns does not choose from (but --sort-by sorts by).
+Output_column reorder_columns[] =
+{
+	{"SKU", arrow_utf8, 0},
+	{"Weekly Velocity", arrow_float32, 0},
+	{"Seasonality", arrow_float32, 0},
+	{"Weeks of Cover", arrow_float32, 0},
+	{"Order Point", arrow_int32, 0},
+	{"Order Quantity", arrow_int32, 0},
+	{"Suggested Order Point", arrow_int32, 0},
+	{"Suggested Order Quantity", arrow_int32, 0},
+};
+
+char reorder_headings[] = "SKU|Weekly Velocity|Seasonality|Weeks of Cover|Order Point|Order Quantity|Suggested Order Point|Suggested Order Quantity";
+
+void AddReorderColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < ArrayCount(reorder_columns); column++)
+	{
+		ArrowAddColumn(arrow, reorder_columns[column].name, reorder_columns[column].type);
+	}
+}
+
+void WriteReorderRecommendations(Product_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (arrow)
+	{
+		Arrow_column* columns = arrow->columns;
+		for (u32 product_index = 0; product_index < batch->count; product_index++)
+		{
+			ArrowAppendText(&columns[0], batch->products[product_index].sku);
+			ArrowAppendFloat32(&columns[1], batch->weekly_velocity[product_index]);
+			ArrowAppendFloat32(&columns[2], batch->seasonality[product_index]);
+			ArrowAppendFloat32(&columns[3], batch->weeks_of_cover[product_index]);
+			ArrowAppendInt32(&columns[4], batch->order_point[product_index]);
+			ArrowAppendInt32(&columns[5], batch->order_quantity[product_index]);
+			ArrowAppendInt32(&columns[6], batch->suggested_order_point[product_index]);
+			ArrowAppendInt32(&columns[7], batch->suggested_order_quantity[product_index]);
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	for (u32 product_index = 0; product_index < batch->count; product_index++)
+	{
+		Product* product = &batch->products[product_index];
+
+		char buffer[256] = {0};
+		sprintf_s(buffer, sizeof(buffer),
+				"%s|%.2f|%.2f|%.1f|%d|%d|%d|%d\n",
+				product->sku,
+				batch->weekly_velocity[product_index],
+				batch->seasonality[product_index],
+				batch->weeks_of_cover[product_index],
+				batch->order_point[product_index],
+				batch->order_quantity[product_index],
+				batch->suggested_order_point[product_index],
+				batch->suggested_order_quantity[product_index]);
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+typedef enum
+{
+	product_column_sku,
+	product_column_description_1,
+	product_column_description_2,
+	product_column_location,
+	product_column_avg_cost,
+	product_column_last_cost,
+	product_column_last_received,
+	product_column_retail_price,
+	product_column_available,
+	product_column_reserved,
+	product_column_on_order,
+	product_column_order_point,
+	product_column_order_quantity,
+	product_column_current_period,
+	product_column_vendor,
+	product_column_first_period,
+	product_column_year_1_sales = product_column_first_period + NUM_HISTORY_PERIODS,
+	product_column_year_2_sales,
+	product_column_count
+} Product_column;
+
+#define PERIOD_COLUMN(name) {name, arrow_int32, FIELD(product_history)}
+
+Output_column product_columns[product_column_count] =
+{
+	{"SKU", arrow_utf8, FIELD(product_sku)},
+	{"Description 1", arrow_utf8, FIELD(product_description_1)},
+	{"Description 2", arrow_utf8, FIELD(product_description_2)},
+	{"Location", arrow_dictionary, FIELD(product_location)},
+	{"Avg Cost", arrow_int64, FIELD(product_avg_cost)}, // Money is in cents.
+	{"Last Cost", arrow_int64, FIELD(product_last_cost)},
+	{"Last Received", arrow_date32, FIELD(product_last_received)},
+	{"Retail Price", arrow_int64, FIELD(product_retail_price)},
+	{"Available", arrow_int32, FIELD(product_available)},
+	{"Reserved", arrow_int32, FIELD(product_reserved)},
+	{"On Order", arrow_int32, FIELD(product_on_order)},
+	{"Order Point", arrow_int32, FIELD(product_order_point)},
+	{"Order Quantity", arrow_int32, FIELD(product_order_quantity)},
+	{"Current Period", arrow_dictionary, FIELD(product_current_period)},
+	{"Vendor", arrow_dictionary, FIELD(product_vendor)},
+	PERIOD_COLUMN("P1"), PERIOD_COLUMN("P2"), PERIOD_COLUMN("P3"), PERIOD_COLUMN("P4"),
+	PERIOD_COLUMN("P5"), PERIOD_COLUMN("P6"), PERIOD_COLUMN("P7"), PERIOD_COLUMN("P8"),
+	PERIOD_COLUMN("P9"), PERIOD_COLUMN("P10"), PERIOD_COLUMN("P11"), PERIOD_COLUMN("P12"),
+	PERIOD_COLUMN("P13"), PERIOD_COLUMN("P14"), PERIOD_COLUMN("P15"), PERIOD_COLUMN("P16"),
+	PERIOD_COLUMN("P17"), PERIOD_COLUMN("P18"), PERIOD_COLUMN("P19"), PERIOD_COLUMN("P20"),
+	PERIOD_COLUMN("P21"), PERIOD_COLUMN("P22"), PERIOD_COLUMN("P23"), PERIOD_COLUMN("P24"),
+	PERIOD_COLUMN("Year 1 Sales"), PERIOD_COLUMN("Year 2 Sales"),
+};
+
+char product_headings[] = "SKU|CURRENT|P1|P2|P3|P4|P5|P6|P7|P8|P9|P10|P11|P12|P13|P14|P15|P16|P17|P18|P19|P20|P21|P22|P23|P24"; // Of the usual output.
+
+void AddProductColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < product_column_count; column++)
+	{
+		ArrowAddColumn(arrow, product_columns[column].name, product_columns[column].type);
+	}
+}
+
+// The text of a column of a product of the batch, in buffer unless it is a field as it is. The periods and
+// year totals of a product without history are blank.
+char* ProductColumnText(Product_batch* batch, u32 product_index, Product_column column, char* buffer, size_t size)
+{
+	Product* product = &batch->products[product_index];
+	if (column >= product_column_first_period)
+	{
+		if (!product->has_history)
+		{
+			return "";
+		}
+		i32 units = (column == product_column_year_1_sales) ? batch->year_1_sales[product_index] :
+					(column == product_column_year_2_sales) ? batch->year_2_sales[product_index] :
+					batch->history_periods[column - product_column_first_period][product_index];
+		sprintf_s(buffer, size, "%d", units);
+		return buffer;
+	}
+
+	switch (column)
+	{
+		case product_column_sku:				return product->sku;
+		case product_column_description_1:		return product->description_1;
+		case product_column_description_2:		return product->description_2;
+		case product_column_location:			return product->location;
+		case product_column_avg_cost:			return product->avg_cost;
+		case product_column_last_cost:			return product->last_cost;
+		case product_column_last_received:		return product->last_received;
+		case product_column_retail_price:		return product->retail_price;
+		case product_column_available:			sprintf_s(buffer, size, "%d", batch->available[product_index]); return buffer;
+		case product_column_reserved:			sprintf_s(buffer, size, "%d", batch->reserved[product_index]); return buffer;
+		case product_column_on_order:			sprintf_s(buffer, size, "%d", batch->on_order[product_index]); return buffer;
+		case product_column_order_point:		sprintf_s(buffer, size, "%d", batch->order_point[product_index]); return buffer;
+		case product_column_order_quantity:		sprintf_s(buffer, size, "%d", batch->order_quantity[product_index]); return buffer;
+		case product_column_current_period:		return product->current_period;
+		case product_column_vendor:				return product->vendor;
+		default:								return "";
+	}
+}
+
+void WriteSelectedProducts(Product_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	Column_selection* selection = options.columns;
+	for (u32 product_index = 0; product_index < batch->count; product_index++)
+	{
+		char row[SELECTED_ROW_SIZE];
+		size_t row_length = 0;
+		for (u32 position = 0; position < selection->num_selected; position++)
+		{
+			char buffer[16];
+			char* text = ProductColumnText(batch, product_index, (Product_column)selection->selected[position], buffer, sizeof(buffer));
+			PutSelectedColumn(selection, position, text, row, sizeof(row), &row_length, arrow);
+		}
+		WriteSelectedRow(row, output_file, options.print_to_screen, options.code_page);
+	}
+	if (arrow)
+	{
+		ArrowWriteBatch(arrow);
+	}
+}
+
+// Products without history get null periods and year totals rather than the zeros of the pipe-delimited output.
+void AppendProductsToArrow(Product_batch* batch, Arrow_writer* arrow)
+{
+	Arrow_column* columns = arrow->columns;
+	for (u32 product_index = 0; product_index < batch->count; product_index++)
+	{
+		Product* product = &batch->products[product_index];
+		ArrowAppendText(&columns[0], product->sku);
+		ArrowAppendText(&columns[1], product->description_1);
+		ArrowAppendText(&columns[2], product->description_2);
+		ArrowAppendText(&columns[3], product->location);
+		ArrowAppendMoney(&columns[4], product->avg_cost);
+		ArrowAppendMoney(&columns[5], product->last_cost);
+		ArrowAppendDate(&columns[6], product->last_received);
+		ArrowAppendMoney(&columns[7], product->retail_price);
+		ArrowAppendInt32(&columns[8], batch->available[product_index]);
+		ArrowAppendInt32(&columns[9], batch->reserved[product_index]);
+		ArrowAppendInt32(&columns[10], batch->on_order[product_index]);
+		ArrowAppendInt32(&columns[11], batch->order_point[product_index]);
+		ArrowAppendInt32(&columns[12], batch->order_quantity[product_index]);
+		ArrowAppendText(&columns[13], product->current_period);
+		ArrowAppendText(&columns[14], product->vendor);
+		for (i32 period = 0; period < NUM_HISTORY_PERIODS + 2; period++)
+		{
+			if (!product->has_history)
+			{
+				ArrowAppendNull(&columns[15 + period]);
+			}
+			else if (period < NUM_HISTORY_PERIODS)
+			{
+				ArrowAppendInt32(&columns[15 + period], batch->history_periods[period][product_index]);
+			}
+			else
+			{
+				ArrowAppendInt32(&columns[15 + period], period == NUM_HISTORY_PERIODS ? batch->year_1_sales[product_index] : batch->year_2_sales[product_index]);
+			}
+		}
+	}
+	ArrowWriteBatch(arrow);
+}
+
+void WriteProducts(Product_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.columns)
+	{
+		WriteSelectedProducts(batch, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		AppendProductsToArrow(batch, arrow);
+	}
+
+	for (u32 product_index = 0; product_index < batch->count; product_index++)
+	{
+		Product* product = &batch->products[product_index];
+
+		char buffer[512] = {0};
+		size_t offset = 0;
+		size_t written = 0;
+		if (!product->has_history)
+		{
+			// Print just the first line and description from second line.
+			if (options.debug_output)
+			{
+				sprintf_s(buffer, sizeof(buffer),
+					"%-11s %-25s %2s%10s%10s %8s %10s%7s%7s%7s%7s%7s%8s %6s\n  %-25s  *** NO HISTORY RECORDS FOUND ***\n",
+			        product->sku,
+			        product->description_1,
+			        product->location,
+			        product->avg_cost,
+			        product->last_cost,
+			        product->last_received,
+			        product->retail_price,
+			        product->available,
+			        product->reserved,
+			        product->on_order,
+			        product->order_point,
+			        product->order_quantity,
+			        product->current_period,
+			        product->vendor,
+			        product->description_2
+			        );
+			}
+			else
+			{
+				sprintf_s(buffer, sizeof(buffer),
+					"%s|%s|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0\n",
+			        product->sku,
+			        product->current_period);
+			}
+		}
+		else if (options.debug_output)
+		{
+			written = sprintf_s(buffer, sizeof(buffer),
+					"%-11s %-25s %2s%10s%10s %8s %10s%7s%7s%7s%7s%7s%8s %6s\n  %-25s",
+					product->sku,
+					product->description_1,
+					product->location,
+					product->avg_cost,
+					product->last_cost,
+					product->last_received,
+					product->retail_price,
+					product->available,
+					product->reserved,
+					product->on_order,
+					product->order_point,
+					product->order_quantity,
+					product->current_period,
+					product->vendor,
+					product->description_2
+					);
+			offset = written;
+			if ((written < 0) || (size_t)written >= sizeof(buffer) - offset)
+			{
+				printf("Error: Buffer size exceeded!\n");
+				exit (-1);
+			}
+			for (i32 year = 0; year < 2; year++)
+			{
+				for (i32 period = 0; period < 12; period++)
+				{
+					written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "%8d", batch->history_periods[(year * 12) + period][product_index]);
+					if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
+					{
+						printf("Error: Buffer size exceeded!\n");
+						exit (-1);
+					}
+					offset += written;
+				}
+				if (year == 0)
+				{
+					written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "%8d\n                           ", batch->year_1_sales[product_index]);
+					if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
+					{
+						printf("Error: Buffer size exceeded!\n");
+						exit (-1);
+					}
+					offset += written;
+				}
+				else
+				{
+					written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "%8d\n", batch->year_2_sales[product_index]);
+					if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
+					{
+						printf("Error: Buffer size exceeded!\n");
+						exit (-1);
+					}
+					offset += written;
+				}
+			}
+		}
+		else
+		{
+			written = sprintf_s(buffer, sizeof(buffer),
+					"%s|%s", product->sku, product->current_period);
+			offset = written;
+			if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
+			{
+				printf("Error: Buffer size excedded!\n");
+				exit (-1);
+			}
+			for (i32 period = 0; period < 24; period++)
+			{
+				written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "|%d", batch->history_periods[period][product_index]);
+				if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
+				{
+					printf("Error: Buffer size exceeded!\n");
+					exit (-1);
+				}
+				offset += written;
+			}
+			written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "\n");
+		}
+
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+void FlushProducts(Product_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
+{
+	Phase_start format_start = BeginPhase(&summary->timings);
+	AggregateProducts(batch, summary);
+	if (options.reorder_analysis)
+	{
+		ComputeReorderPoints(batch, summary);
+		WriteReorderRecommendations(batch, output_file, arrow, options);
+	}
+	else
+	{
+		WriteProducts(batch, output_file, arrow, options);
+	}
+	EndPhase(&summary->timings, phase_format, format_start);
+}
+
+// The fields of the three lines of a product, in one layout and in the order they start in (see layout.h): the
+// second description and the history periods are under the first line, and move with it. The page headers have
+// no column headings, so only the data can move them. The history is the first of its periods; the others follow
+// it.
+typedef enum
+{
+	product_layout_sku,
+	product_layout_description_2,
+	product_layout_description_1,
+	product_layout_history,
+	product_layout_location,
+	product_layout_avg_cost,
+	product_layout_last_cost,
+	product_layout_last_received,
+	product_layout_retail_price,
+	product_layout_available,
+	product_layout_reserved,
+	product_layout_on_order,
+	product_layout_order_point,
+	product_layout_order_quantity,
+	product_layout_current_period,
+	product_layout_vendor,
+	product_layout_field_count
+} Product_layout_field;
+
+Layout_field product_layout[product_layout_field_count] =
+{
+	{"SKU", NULL, 0, 11, false},
+	{"Description 2", NULL, 2, 25, false},
+	{"Description 1", NULL, 12, 25, false},
+	{"History", NULL, 27, 8, true},
+	{"Location", NULL, 38, 2, false},
+	{"Avg Cost", NULL, 40, 10, true},
+	{"Last Cost", NULL, 50, 10, true},
+	{"Last Received", NULL, 61, 8, false},
+	{"Retail Price", NULL, 70, 10, true},
+	{"Available", NULL, 80, 7, true},
+	{"Reserved", NULL, 87, 7, true},
+	{"On Order", NULL, 94, 7, true},
+	{"Order Point", NULL, 101, 7, true},
+	{"Order Quantity", NULL, 108, 7, true},
+	{"Current Period", NULL, 115, 5, true}, // MM/YY, seen by where it ends: the order quantity runs into it.
+	{"Vendor", NULL, 124, 6, false},
+};
+
+// The fields of the product lines, checked as they are parsed (see anomaly.h) and compared by --where (see
+// filter.h). They start where the report's layout puts them. The first line must reach the current period; the
+// vendor may be left out.
+Field_check product_fields[] =
+{
+	{"SKU", 0, 11, field_code},
+	{"Description 1", 0, 25, field_text},
+	{"Location", 0, 2, field_code},
+	{"Avg Cost", 0, 10, field_money},
+	{"Last Cost", 0, 10, field_money},
+	{"Last Received", 0, 8, field_date},
+	{"Retail Price", 0, 10, field_money},
+	{"Available", 0, 7, field_number},
+	{"Reserved", 0, 7, field_number},
+	{"On Order", 0, 7, field_number},
+	{"Order Point", 0, 7, field_number},
+	{"Order Quantity", 0, 7, field_number},
+	{"Current Period", 0, 8, field_date},
+	{"Vendor", 0, 6, field_code},
+};
+
+// The layout field each field of the first line is in.
+u32 product_line_layout[ArrayCount(product_fields)] =
+{
+	product_layout_sku, product_layout_description_1, product_layout_location, product_layout_avg_cost,
+	product_layout_last_cost, product_layout_last_received, product_layout_retail_price, product_layout_available,
+	product_layout_reserved, product_layout_on_order, product_layout_order_point, product_layout_order_quantity,
+	product_layout_current_period, product_layout_vendor,
+};
+
+Field_check description_fields[] =
+{
+	{"Description 2", 0, 25, field_text},
+};
+
+// Only checked when ParseHistoryPeriods() finds something in the periods that is not a number: the fast parse
+// of a regular line is the check.
+Field_check history_fields[] =
+{
+	{"History", 0, 12 * 8, field_number},
+};
+
+// The layout is inferred from the first line of each product only: the history periods under it are in columns
+// of their own, which would blur the edges of its fields.
+bool IsProductLine(char* line, size_t length)
+{
+	return length > 0 && line[0] != ' ';
+}
+
+void ParseProductHistory(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
@@ -58,11 +874,14 @@ void ParseProductHistory(char* data, FILE* output_file, Program_options options,
 	i32 page_header_line	= 7;
 	i32 empty_lines_to_skip	= 2; // Used to skip history calendar at start of report.
 	i32 product_line		= 0;
+	bool left_out			= false; // The product does not match --where.
 
-	Product product = {0};
-	Product product_reset = {0};
+	Memory_arena arena = AllocateArena(PRODUCT_BATCH_SIZE);
+	Product_batch batch = {0};
+	PushProductBatch(&arena, &batch);
 
 	// Skip over history calendar at the start of the report.
+	Phase_start calendar_start = BeginPhase(&summary->timings);
 	while (data[index])
 	{
 		if ((data[index] == '\n'))// && (line_position == 0))
@@ -82,12 +901,55 @@ void ParseProductHistory(char* data, FILE* output_file, Program_options options,
 		index++;
 		line_position++;
 	}
+	ReadHistoryCalendar(&summary->calendar, data, index);
+	EndPhase(&summary->timings, phase_header_skip, calendar_start);
+
+	// The pages start after the calendar.
+	u32 column[product_layout_field_count];
+	InferLayout(&summary->layout, product_layout, product_layout_field_count, &data[index], 6, IsProductLine);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
+
+	Field_check line_fields[ArrayCount(product_fields)];
+	for (u32 field = 0; field < ArrayCount(line_fields); field++)
+	{
+		line_fields[field] = product_fields[field];
+		line_fields[field].start = column[product_line_layout[field]];
+	}
+	Field_check description_line_fields[] = {description_fields[0]};
+	description_line_fields[0].start = column[product_layout_description_2];
+	Field_check history_line_fields[] = {history_fields[0]};
+	history_line_fields[0].start = column[product_layout_history];
+
+	Line_check product_check, description_check, history_check; // The first line must reach the current period.
+	CompileLineCheck(&product_check, line_fields, ArrayCount(line_fields), column[product_layout_current_period] + 1);
+	CompileLineCheck(&description_check, description_line_fields, ArrayCount(description_line_fields), 0);
+	CompileLineCheck(&history_check, history_line_fields, ArrayCount(history_line_fields), 0);
 
 	// @TODO: add option to specify what period is current or period 1 and subtract back in time.
 	// Put in headers the month names instead of 'P1', 'P2', etc.?
-	if (output_file && !options.debug_output)
+	if (output_file && options.reorder_analysis)
+	{
+		fprintf(output_file, "%s\n", reorder_headings);
+	}
+	else if (output_file && options.columns)
+	{
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
 	{
-		fprintf(output_file, "SKU|CURRENT|P1|P2|P3|P4|P5|P6|P7|P8|P9|P10|P11|P12|P13|P14|P15|P16|P17|P18|P19|P20|P21|P22|P23|P24\n");
+		fprintf(output_file, "%s\n", product_headings);
+	}
+	if (arrow && options.reorder_analysis)
+	{
+		AddReorderColumns(arrow);
+	}
+	else if (arrow && options.columns)
+	{
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddProductColumns(arrow);
 	}
 
 	// Now start parsing report.
@@ -103,6 +965,7 @@ void ParseProductHistory(char* data, FILE* output_file, Program_options options,
 			if (line_position == 0)
 			{
 				// loop over header lines
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && page_header_line > 0) // data[index] != '\0' is necessary in the case the report ends with a header.
 				{
 					if (data[index] == '\n')
@@ -112,209 +975,155 @@ void ParseProductHistory(char* data, FILE* output_file, Program_options options,
 					index++;
 				}
 				page_header_line = 7;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_products);
 				product_line = 1;
 				summary->num_pages++;
 				continue;
 			}
 
 			line_start_index = index - line_position;
-			char buffer[512] = {0};
+			char* line = &data[line_start_index];
+			Product* product = &batch.products[batch.count];
+			bool product_complete = false;
 
-			if (data[line_start_index] != ' ')
+			if (line[0] != ' ')
 			{
-				if (data[line_start_index] == '=') // Reached the report footer/summary.
+				if (line[0] == '=') // Reached the report footer/summary.
 				{
+					summary->report_total = ReadFooterTotal(NextFooterLine(line), total_count);
 					break;
 				}
-				FillTextFieldAndTrim(product.sku, &data[line_start_index], 11);
-				FillTextFieldAndTrim(product.description_1, &data[line_start_index + 12], 25);
-				FillTextFieldAndTrim(product.location, &data[line_start_index + 38], 2);
-				FillTextFieldAndTrim(product.avg_cost, &data[line_start_index + 40], 10);
-				FillTextFieldAndTrim(product.last_cost, &data[line_start_index + 50], 10);
-				FillTextFieldAndTrim(product.last_received, &data[line_start_index + 61], 8);
-				FillTextFieldAndTrim(product.retail_price, &data[line_start_index + 70], 10);
-				FillTextFieldAndTrim(product.available, &data[line_start_index + 80], 7);
-				FillTextFieldAndTrim(product.reserved, &data[line_start_index + 87], 7);
-				FillTextFieldAndTrim(product.on_order, &data[line_start_index + 94], 7);
-				FillTextFieldAndTrim(product.order_point, &data[line_start_index + 101], 7);
-				FillTextFieldAndTrim(product.order_quantity, &data[line_start_index + 108], 7);
-				FillTextFieldAndTrim(product.current_period, &data[line_start_index + 115], 8);
-				if (line_position > 123)
+				CheckRecordLine(options.anomalies, line, line_position, &product_check);
+				left_out = options.filter && !FilterLine(options.filter, 0, line_fields, line, line_position);
+				u64 fields_to_read = left_out ? 0 : options.fields;
+				if (fields_to_read & FIELD(product_sku))
 				{
-					FillTextFieldAndTrim(product.vendor, &data[line_start_index + 124], 6);
+					FillLineField(product->sku, line, line_position, column[product_layout_sku], 11);
+				}
+				if (fields_to_read & FIELD(product_description_1))
+				{
+					FillLineField(product->description_1, line, line_position, column[product_layout_description_1], 25);
+				}
+				if (fields_to_read & FIELD(product_location))
+				{
+					FillLineField(product->location, line, line_position, column[product_layout_location], 2);
+				}
+				if (fields_to_read & FIELD(product_avg_cost))
+				{
+					FillLineField(product->avg_cost, line, line_position, column[product_layout_avg_cost], 10);
+				}
+				if (fields_to_read & FIELD(product_last_cost))
+				{
+					FillLineField(product->last_cost, line, line_position, column[product_layout_last_cost], 10);
+				}
+				if (fields_to_read & FIELD(product_last_received))
+				{
+					FillLineField(product->last_received, line, line_position, column[product_layout_last_received], 8);
+				}
+				if (fields_to_read & FIELD(product_retail_price))
+				{
+					FillLineField(product->retail_price, line, line_position, column[product_layout_retail_price], 10);
+				}
+				if (fields_to_read & FIELD(product_available))
+				{
+					FillLineField(product->available, line, line_position, column[product_layout_available], 7);
+					batch.available[batch.count] = atoi(product->available);
+				}
+				if (fields_to_read & FIELD(product_reserved))
+				{
+					FillLineField(product->reserved, line, line_position, column[product_layout_reserved], 7);
+					batch.reserved[batch.count] = atoi(product->reserved);
+				}
+				if (fields_to_read & FIELD(product_on_order))
+				{
+					FillLineField(product->on_order, line, line_position, column[product_layout_on_order], 7);
+					batch.on_order[batch.count] = atoi(product->on_order);
+				}
+				if (fields_to_read & FIELD(product_order_point))
+				{
+					FillLineField(product->order_point, line, line_position, column[product_layout_order_point], 7);
+					batch.order_point[batch.count] = atoi(product->order_point);
+				}
+				if (fields_to_read & FIELD(product_order_quantity))
+				{
+					FillLineField(product->order_quantity, line, line_position, column[product_layout_order_quantity], 7);
+					batch.order_quantity[batch.count] = atoi(product->order_quantity);
+				}
+				if (fields_to_read & FIELD(product_current_period))
+				{
+					FillLineField(product->current_period, line, line_position, column[product_layout_current_period], 8);
+				}
+				if ((fields_to_read & FIELD(product_vendor)) && line_position >= column[product_layout_vendor])
+				{
+					FillLineField(product->vendor, line, line_position, column[product_layout_vendor], 6);
 				}
 
 				product_line++;
 			}
 			else if (product_line == 2)
 			{
-				FillTextFieldAndTrim(product.description_2, &data[line_start_index + 2], 25);
+				CheckRecordLine(options.anomalies, line, line_position, &description_check);
+				if (options.filter && !left_out)
+				{
+					left_out = !FilterLine(options.filter, 1, description_line_fields, line, line_position);
+				}
+				if (!left_out && (options.fields & FIELD(product_description_2)))
+				{
+					FillLineField(product->description_2, line, line_position, column[product_layout_description_2], 25);
+				}
 
 				product_line++;
 
-				if ((line_position > 61) && (data[index - 1] != '*')) // @TODO: is the check for '*' even necessary?
+				if ((line_position > column[product_layout_history] + 34) && (data[index - 1] != '*')) // @TODO: is the check for '*' even necessary?
 				{
-					char sales_for_current_period[9] = {0};
-					for (i32 current_period = 0; current_period < 12; current_period++)
+					bool regular = !left_out && (options.fields & FIELD(product_history)) && ParseHistoryPeriods(&batch, 0, line, line_position, column[product_layout_history]); // Checked by field if not.
+					if (!regular)
 					{
-
-						FillTextFieldAndTrim(sales_for_current_period, &data[line_start_index + 27 + current_period * 8], 8);
-						product.history_periods[current_period] = atoi(sales_for_current_period);
-						product.year_1_sales += product.history_periods[current_period];
+						CheckRecordLine(options.anomalies, line, line_position, &history_check);
 					}
 				}
 				else
 				{
 					// Must be no history records found.
-
-					// Print just the first line and description from second line.
-					if (options.debug_output)
-					{
-						sprintf_s(buffer, sizeof(buffer),
-							"%-11s %-25s %2s%10s%10s %8s %10s%7s%7s%7s%7s%7s%8s %6s\n  %-25s  *** NO HISTORY RECORDS FOUND ***\n",
-					        product.sku,
-					        product.description_1,
-					        product.location,
-					        product.avg_cost,
-					        product.last_cost,
-					        product.last_received,
-					        product.retail_price,
-					        product.available,
-					        product.reserved,
-					        product.on_order,
-					        product.order_point,
-					        product.order_quantity,
-					        product.current_period,
-					        product.vendor,
-					        product.description_2
-					        );
-					}
-					else
-					{
-						sprintf_s(buffer, sizeof(buffer),
-							"%s|%s|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0|0\n",
-					        product.sku,
-					        product.current_period);
-					}
-
-					product_line = 1;
-					product = product_reset;
-					summary->num_products++;
+					product_complete = true;
 				}
 			}
 			else if (product_line == 3)
 			{
-				char sales_for_current_period[9] = {0};
-				for (i32 current_period = 12; current_period < 24; current_period++)
-				{
-					FillTextFieldAndTrim(sales_for_current_period, &data[line_start_index + 27 + (current_period - 12) * 8], 8);
-					product.history_periods[current_period] = atoi(sales_for_current_period);
-					product.year_2_sales += product.history_periods[current_period];
-				}
-
-				size_t offset = 0;
-				size_t written = 0;
-				if (options.debug_output)
-				{
-					written = sprintf_s(buffer, sizeof(buffer),
-							"%-11s %-25s %2s%10s%10s %8s %10s%7s%7s%7s%7s%7s%8s %6s\n  %-25s",
-							product.sku,
-							product.description_1,
-							product.location,
-							product.avg_cost,
-							product.last_cost,
-							product.last_received,
-							product.retail_price,
-							product.available,
-							product.reserved,
-							product.on_order,
-							product.order_point,
-							product.order_quantity,
-							product.current_period,
-							product.vendor,
-							product.description_2
-							);
-					offset = written;
-					if ((written < 0) || (size_t)written >= sizeof(buffer) - offset)
-					{
-						printf("Error: Buffer size exceeded!\n");
-						exit (-1);
-					}
-					for (i32 year = 0; year < 2; year++)
-					{
-						for (i32 period = 0; period < 12; period++)
-						{
-							written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "%8d", product.history_periods[(year * 12) + period]);
-							if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
-							{
-								printf("Error: Buffer size exceeded!\n");
-								exit (-1);
-							}
-							offset += written;
-						}
-						if (year == 0)
-						{
-							written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "%8d\n                           ", product.year_1_sales);
-							if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
-							{
-								printf("Error: Buffer size exceeded!\n");
-								exit (-1);
-							}
-							offset += written;
-						}
-						else
-						{
-							written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "%8d\n", product.year_2_sales);
-							if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
-							{
-								printf("Error: Buffer size exceeded!\n");
-								exit (-1);
-							}
-							offset += written;
-						}
-					}
-				}
-				else
+				bool regular = !left_out && (options.fields & FIELD(product_history)) && ParseHistoryPeriods(&batch, 12, line, line_position, column[product_layout_history]); // Checked by field if not.
+				if (!regular)
 				{
-					written = sprintf_s(buffer, sizeof(buffer),
-							"%s|%s", product.sku, product.current_period);
-					offset = written;
-					if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
-					{
-						printf("Error: Buffer size excedded!\n");
-						exit (-1);
-					}
-					for (i32 period = 0; period < 24; period++)
-					{
-						written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "|%d", product.history_periods[period]);
-						if (written < 0 || (size_t)written >= sizeof(buffer) - offset)
-						{
-							printf("Error: Buffer size exceeded!\n");
-							exit (-1);
-						}
-						offset += written;
-					}
-					written = sprintf_s(buffer + offset, sizeof(buffer) - offset, "\n");
+					CheckRecordLine(options.anomalies, line, line_position, &history_check);
 				}
-
-				product = product_reset;
-				product_line = 1;
-				summary->num_products++;
+				product->has_history = true;
+				product_complete = true;
 			}
 
-			if (output_file)
+			if (product_complete)
 			{
-				fprintf(output_file, "%s", buffer);
-			}
-			if (options.print_to_screen)
-			{
-				printf("%s", buffer);
+				product_line = 1;
+				summary->num_products++;
+				if (left_out) // Counted, but not written.
+				{
+					ClearProductSlot(&batch, batch.count);
+					summary->num_left_out++;
+				}
+				else if (++batch.count == RECORD_BATCH_SIZE)
+				{
+					FlushProducts(&batch, output_file, arrow, options, summary);
+					ResetArena(&arena);
+					PushProductBatch(&arena, &batch);
+				}
 			}
 
 			line_position = 0;
 			index++;
 		}
 	}
+
+	FlushProducts(&batch, output_file, arrow, options, summary);
+	FreeArena(&arena);
 }
 
 #define USAGE_STRING "\
@@ -324,11 +1133,49 @@ John Hosick <john@atikokancastle.com>\n\n\
 pipe-delimited file for use in the conversion to CashierPRO.\n\n\
 USAGE: %s [OPTIONS] <inputfile> [outputfile]\n\
   OPTIONS:\n\
+    -a, --anomalies <file>\n\
+                    Write the fields that do not look like what they should hold (a letter\n\
+                    in an amount, a line cut short, ...) to the file, with their line numbers.\n\
     -d, --debug     Dump output in original format (to check the correctness of the parse).\n\
+    -e, --encoding <code page>\n\
+                    Convert text from the report's code page (cp437, cp1252 or latin1)\n\
+                    to UTF-8. Without it, text is written exactly as it was read, except\n\
+                    in Feather files, which must be UTF-8 and take it to be cp1252.\n\
+    -f, --feather   Write the output file in Arrow IPC (Feather v2) format instead.\n\
     -h, --help      Show this help message.\n\
     -p, --print     Print to the screen. Note: This option does not preclude\n\
                     outputting to a file: If an output file is specified,\n\
-                    it will be created as well as displayed on the screen.\n"
+                    it will be created as well as displayed on the screen.\n\
+    -r, --reorder   Output the sales velocity, seasonality, weeks of cover and a suggested\n\
+                    order point and quantity for each SKU instead of the history.\n\
+    -s, --stats     Show the time spent in each phase of the parse.\n\
+        --stats-json\n\
+                    Also print the throughput and phase times as a line of JSON.\n\
+        --counters  Count cycles, instructions, branch and cache misses in each phase\n\
+                    (Linux only) and add them to the statistics.\n\
+        --no-progress\n\
+                    Do not show the progress of a long parse on the console.\n\
+        --allow-missing-totals\n\
+                    Do not fail if the report has no totals at its end to check the parse\n\
+                    against (reports from old versions of ProfitMaster).\n\
+        --fixed-layout\n\
+                    Parse with the built-in column layout even if the report's data shows\n\
+                    that its columns have moved.\n\
+        --columns <names>\n\
+                    Write only these columns, in this order (names of the Feather columns,\n\
+                    separated by commas), reading only the fields of the report they need.\n\
+        --where <filter>\n\
+                    Write only the products that match the filter, e.g. \"available > 0 and\n\
+                    location = 01\" (see the instructions for what a filter can be).\n\
+        --sort-by <columns>\n\
+                    Sort the output file by these columns (separated by commas, each with\n\
+                    \" desc\" after it to sort it descending) instead of in report order.\n\
+        --sort-memory <megabytes>\n\
+                    The most memory --sort-by may use (default 256); a bigger output is\n\
+                    sorted in runs that are merged from disk.\n\
+        --serve <socket>\n\
+                    Keep running, and convert the reports asked for over the Unix domain\n\
+                    socket (Linux only). Any other arguments are ignored.\n"
 
 void PrintUsageAndExit(char *program_name)
 {
@@ -341,6 +1188,11 @@ int main(int argc, char *argv[])
 	char* program_name = argv[0];
 	char* file_input_name = {0};
 	char* file_output_name = {0};
+	char* file_anomalies_name = {0};
+	char* column_names = {0};
+	char* filter_text = {0};
+	char* sort_text = {0};
+	u32 sort_megabytes = SORT_DEFAULT_MEGABYTES;
 
 	Program_options options = {0};
 
@@ -371,6 +1223,100 @@ int main(int argc, char *argv[])
 				{
 					options.debug_output = true;
 				}
+				else if (strcmp(option, "feather") == 0)
+				{
+					options.feather_output = true;
+				}
+				else if (strcmp(option, "reorder") == 0)
+				{
+					options.reorder_analysis = true;
+				}
+				else if (strcmp(option, "stats") == 0)
+				{
+					options.print_stats = true;
+				}
+				else if (strcmp(option, "stats-json") == 0)
+				{
+					options.stats_json = true;
+				}
+				else if (strcmp(option, "no-progress") == 0)
+				{
+					options.no_progress = true;
+				}
+				else if (strcmp(option, "allow-missing-totals") == 0)
+				{
+					options.allow_missing_totals = true;
+				}
+				else if (strcmp(option, "counters") == 0)
+				{
+					options.counters = true;
+				}
+				else if (strcmp(option, "fixed-layout") == 0)
+				{
+					options.fixed_layout = true;
+				}
+				else if (strcmp(option, "encoding") == 0)
+				{
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: --encoding must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "columns") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --columns must be followed by the names of the columns to write, separated by commas.\n", program_name);
+						return -1;
+					}
+					column_names = argv[++arg];
+				}
+				else if (strcmp(option, "where") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --where must be followed by a filter, e.g. \"available > 0\".\n", program_name);
+						return -1;
+					}
+					filter_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-by") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --sort-by must be followed by the names of the columns to sort by, separated by commas.\n", program_name);
+						return -1;
+					}
+					sort_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-memory") == 0)
+				{
+					sort_megabytes = (arg + 1 == argc) ? 0 : (u32)strtoul(argv[++arg], NULL, 10);
+					if (sort_megabytes < 1 || sort_megabytes > SORT_MAX_MEGABYTES)
+					{
+						printf("%s: --sort-memory must be followed by a number of megabytes, from 1 to %d.\n", program_name, SORT_MAX_MEGABYTES);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "anomalies") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --anomalies must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+				}
+				else if (strcmp(option, "serve") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --serve must be followed by the path of the socket to listen on.\n", program_name);
+						return -1;
+					}
+					return ServeRequests(program_name, argv[arg + 1], main, NULL); // Each request is run by main() itself.
+				}
 				else
 				{
 					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
@@ -388,6 +1334,14 @@ int main(int argc, char *argv[])
 
 				switch (c2)
 				{
+				case 'a':
+					if (arg + 1 == argc)
+					{
+						printf("%s: -a must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+					break;
 				case 'h':
 					PrintUsageAndExit(program_name);
 				case 'p':
@@ -396,6 +1350,22 @@ int main(int argc, char *argv[])
 				case 'd':
 					options.debug_output = true;
 					break;
+				case 'e':
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: -e must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+					break;
+				case 'f':
+					options.feather_output = true;
+					break;
+				case 'r':
+					options.reorder_analysis = true;
+					break;
+				case 's':
+					options.print_stats = true;
+					break;
 				default:
 					printf("%s: Invalid argument '%c'. Use -h or --help for more details.\n", program_name, c2);
 					return -1;
@@ -425,17 +1395,120 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (!file_output_name && options.feather_output)
+	{
+		printf("Feather output requires an output file.\n");
+		return -1;
+	}
+
+	Column_selection selection;
+	options.fields = ALL_FIELDS;
+	if (column_names)
+	{
+		if (options.debug_output || options.reorder_analysis)
+		{
+			printf("--columns cannot be used with -d or -r.\n");
+			return -1;
+		}
+		if (!SelectColumns(&selection, product_columns, product_column_count, column_names, program_name))
+		{
+			return -1;
+		}
+		options.columns = &selection;
+		options.fields = selection.fields;
+	}
+
+	Record_filter filter;
+	if (filter_text)
+	{
+		// The product line, then the second description; not the history.
+		Filter_table tables[] = {{product_fields, ArrayCount(product_fields)}, {description_fields, ArrayCount(description_fields)}};
+		if (!CompileFilter(&filter, filter_text, tables, ArrayCount(tables), product_columns, product_column_count, NULL, 0, program_name))
+		{
+			return -1;
+		}
+		options.filter = &filter;
+	}
+
+	Sort_order sort_order;
+	if (sort_text)
+	{
+		if (options.debug_output || options.feather_output || options.print_to_screen || !file_output_name)
+		{
+			printf("--sort-by sorts the output file, so it needs one, and cannot be used with -d, -f or -p.\n");
+			return -1;
+		}
+		Output_column* columns = options.reorder_analysis ? reorder_columns : product_columns;
+		u32 num_columns = options.reorder_analysis ? ArrayCount(reorder_columns) : product_column_count;
+		char headings[COLUMN_HEADINGS_SIZE];
+		if (options.reorder_analysis || !options.columns)
+		{
+			strcpy_s(headings, sizeof(headings), options.reorder_analysis ? reorder_headings : product_headings);
+		}
+		else
+		{
+			FormatSelectedHeadings(options.columns, headings, sizeof(headings));
+		}
+		if (!CompileSortOrder(&sort_order, sort_text, columns, num_columns, headings, sort_megabytes, program_name))
+		{
+			return -1;
+		}
+	}
+
+	if (!CheckReportKind(program_name, file_input_name, report_history))
+	{
+		return -1;
+	}
+
+	FILE* anomaly_file = NULL;
+	if (file_anomalies_name && fopen_s(&anomaly_file, file_anomalies_name, "w"))
+	{
+		printf("Could not create anomalies file: %s\n", file_anomalies_name);
+		return -1;
+	}
+
+	Report_summary summary = {0};
+	if (options.counters && !OpenPerfCounters(&summary.timings.counters))
+	{
+		printf("Hardware performance counters are not available.\n");
+	}
+
+	Phase_start read_start = BeginPhase(&summary.timings);
 	char* data = ReadEntireFile(file_input_name);
 	if (!data)
 	{
 		printf("Could not open input file: %s\n", file_input_name);
 		return -1;
 	}
+	summary.timings.input_bytes = GetFileSize64(file_input_name);
+	EndPhase(&summary.timings, phase_read, read_start);
+
+	Anomaly_log anomalies;
+	StartAnomalyLog(&anomalies, data, anomaly_file, file_anomalies_name, options.code_page);
+	options.anomalies = &anomalies;
+
+	// Progress goes to stderr and would be mixed in with the records printed to the screen.
+	Progress progress;
+	if (!options.no_progress && !options.print_to_screen && StderrIsConsole() && StartProgress(&progress, summary.timings.input_bytes))
+	{
+		summary.progress = &progress;
+	}
 
-	Report_summary summary = {0};
 	FILE* stream_output = NULL;
+	Arrow_writer arrow;
+	Arrow_writer* arrow_output = NULL;
 
-	if (file_output_name)
+	if (file_output_name && options.feather_output)
+	{
+		if (!ArrowOpen(&arrow, file_output_name))
+		{
+			printf("Could not create output file: %s\n", file_output_name);
+			return -1;
+		}
+		arrow.code_page = options.code_page;
+		arrow_output = &arrow;
+	}
+	else if (file_output_name)
 	{
 		errno_t error;
 
@@ -447,14 +1520,79 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	ParseProductHistory(data, stream_output, options, &summary);
+	Phase_start parse_start = BeginPhase(&summary.timings);
+	ParseProductHistory(data, stream_output, arrow_output, options, &summary);
+	EndParse(&summary.timings, parse_start);
+	if (summary.progress)
+	{
+		StopProgress(summary.progress);
+	}
+	FreeFileMemory(data);
+
 	printf("Processed a total of %d products (%d pages).\n", summary.num_products, summary.num_pages);
+	if (options.filter)
+	{
+		printf("Left out %d of them that did not match --where.\n", summary.num_left_out);
+	}
+	bool reconciled = ReconcileTotal(summary.report_total, "number of products", summary.num_products, options.allow_missing_totals);
+
+	if ((options.fields & SUMMARY_FIELDS) == SUMMARY_FIELDS) // Not read for all --columns.
+	{
+		i64 year_totals[2] = {0};
+		for (i32 period = 0; period < NUM_HISTORY_PERIODS; period++)
+		{
+			year_totals[period / 12] += summary.period_totals[period];
+		}
+		printf("Units sold: %lld (P1-P12), %lld (P13-P24). Units available: %lld, on order: %lld.\n",
+				(long long)year_totals[0], (long long)year_totals[1], (long long)summary.total_available, (long long)summary.total_on_order);
+	}
+	if (options.reorder_analysis)
+	{
+		History_calendar* calendar = &summary.calendar;
+		if (calendar->complete)
+		{
+			i32 current = calendar->months[calendar->periods[0]];
+			printf("The current period is P%u (%02d/%02d), and P%u is the same period last year.\n", calendar->periods[0] + 1,
+					current % 12 + 1, (current / 12) % 100, calendar->periods[12] + 1);
+		}
+		else
+		{
+			printf("Warning: The report's history calendar does not give the months of its 24 periods, so P1 was taken to be the current period and P13 the same period last year.\n");
+		}
+		printf("%d products have an order point below the suggested order point.\n", summary.num_below_suggested_order_point);
+	}
 
-	if (file_output_name)
+	Phase_start flush_start = BeginPhase(&summary.timings);
+	if (arrow_output)
+	{
+		ArrowClose(arrow_output);
+		printf("Output dumped to %s.\n", file_output_name);
+	}
+	else if (file_output_name)
 	{
 		fclose(stream_output);
 		printf("Output dumped to %s.\n", file_output_name);
 	}
+	EndPhase(&summary.timings, phase_flush, flush_start);
+	bool sorted = true;
+	if (sort_text)
+	{
+		Phase_start sort_start = BeginPhase(&summary.timings);
+		sorted = SortOutputFile(&sort_order, file_output_name, program_name);
+		EndPhase(&summary.timings, phase_sort, sort_start);
+	}
+
+	PrintLayoutDrift(&summary.layout, options.fixed_layout);
+	PrintAnomalies(&anomalies);
+	if (anomaly_file)
+	{
+		fclose(anomaly_file);
+	}
+	PrintTimings(&summary.timings, summary.num_products, options.print_stats);
+	if (options.stats_json)
+	{
+		PrintTimingsJson(&summary.timings, "producthistory", summary.num_products, summary.num_pages);
+	}
 
-	return 0;
+	return (reconciled && sorted) ? 0 : -1;
 }
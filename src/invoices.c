@@ -1,14 +1,39 @@
-#include <windows.h>
 #include <stdio.h>
 
+#include "platform.h"
 #include "utils.h"
-
-#define VERSION "2024-11-25"
+#include "arena.h"
+#include "encoding.h"
+#include "arrow.h"
+#include "layout.h"
+#include "timing.h"
+#include "progress.h"
+#include "sniff.h"
+#include "serve.h"
+#include "anomaly.h"
+#include "reconcile.h"
+#include "columns.h"
+#include "filter.h"
+#include "sort.h"
+
+#define VERSION "2026-10-19"
 
 typedef struct
 {
 	bool print_to_screen;
 	bool debug_output;
+	bool feather_output;
+	bool print_stats;
+	bool stats_json;
+	bool no_progress;
+	bool allow_missing_totals;
+	bool counters;
+	bool fixed_layout;
+	Code_page code_page;
+	struct Anomaly_log* anomalies; // Checks the record lines as they are parsed (only counting them without -a).
+	struct Column_selection* columns; // Chosen with --columns; NULL for the usual output.
+	u64 fields; // The fields of the report to read, FIELD(Invoice_field) (see columns.h).
+	struct Record_filter* filter; // Given with --where; NULL to write every invoice.
 } Program_options;
 
 typedef struct
@@ -16,12 +41,20 @@ typedef struct
 	u32 num_accounts;
 	u32 num_invoices;
 	u32 num_pages;
-	u32 total_owed;
+	u32 num_left_out; // Of num_invoices, by --where.
+	i64 total_owed; // In cents, the balance of all the invoices.
+	u32 num_account_totals;
+	u32 num_unbalanced_accounts; // Whose invoices do not add up to their ACCOUNT TOTAL line.
+	char first_unbalanced_account[10];
+	Footer_total report_total; // Of the invoices, from the Cust Loc line at the end of the report.
+	Report_layout layout;
+	Phase_timings timings;
+	Progress* progress;
 } Report_summary;
 
 typedef struct
 {
-	// char account_id[10]; // 9 + \0 // Not needed
+	char account_id[10]; // 9 + \0 (from the account line preceding the invoices)
 	char credit_memo[4]; // 3 + \0 (what is this for?)
 	char invoice_location[4]; // 2 + \0
 	char payment_code[4]; // 2 + \0
@@ -31,9 +64,220 @@ typedef struct
 	char date[10]; // 9 + \0
 	char transaction_amount[12]; // 11 + \0
 	char amount[12]; // 11 + \0
+	bool balance_minus;
 } Invoice;
 
-void ParseCrossReferences(char* data, FILE* output_file, Program_options options, Report_summary* summary)
+typedef struct
+{
+	Invoice* invoices;
+	u32 count;
+} Invoice_batch;
+
+typedef enum
+{
+	invoice_credit_memo,
+	invoice_location,
+	invoice_payment_code,
+	invoice_number,
+	invoice_transaction_type,
+	invoice_reference,
+	invoice_date,
+	invoice_transaction_amount,
+	invoice_amount,
+	invoice_field_count
+} Invoice_field;
+
+Layout_field invoice_layout[invoice_field_count] =
+{
+	{"Credit Memo", "CRM", 41, 3, false},
+	{"Location", "LC", 45, 2, false},
+	{"Payment Code", "PC", 48, 2, false},
+	{"Invoice", "INVOICE", 51, 6, false},
+	{"Transaction Type", "TYP", 59, 3, false},
+	{"Reference", "REF", 63, 6, false},
+	{"Date", "DATE", 70, 8, false},
+	{"Transaction Amount", "AMOUNT", 108, 10, true},
+	{"Amount", "BALANCE", 120, 10, true},
+};
+
+// The fields of an invoice line, checked as they are parsed (see anomaly.h) and compared by --where (see
+// filter.h). They start where the report's layout puts them.
+Field_check invoice_fields[invoice_field_count] =
+{
+	{"Credit Memo", 0, 3, field_code},
+	{"Location", 0, 2, field_code},
+	{"Payment Code", 0, 2, field_code},
+	{"Invoice", 0, 6, field_code},
+	{"Transaction Type", 0, 3, field_code},
+	{"Reference", 0, 6, field_code},
+	{"Date", 0, 8, field_date},
+	{"Transaction Amount", 0, 10, field_money},
+	{"Amount", 0, 10, field_money},
+};
+
+// The customer the invoices are of, compared by --where once it is read from the account line before them.
+Field_check invoice_account_fields[] =
+{
+	{"Cust ID", 0, 9, field_code},
+};
+
+typedef enum
+{
+	invoice_column_account,
+	invoice_column_location,
+	invoice_column_payment_code,
+	invoice_column_number,
+	invoice_column_transaction_type,
+	invoice_column_reference,
+	invoice_column_date,
+	invoice_column_transaction_amount,
+	invoice_column_amount,
+	invoice_column_count
+} Invoice_column;
+
+Output_column invoice_columns[invoice_column_count] =
+{
+	{"Cust ID", arrow_utf8, 0}, // From the account line.
+	{"Location", arrow_dictionary, FIELD(invoice_location)},
+	{"Payment Code", arrow_dictionary, FIELD(invoice_payment_code)},
+	{"Invoice", arrow_utf8, FIELD(invoice_number)},
+	{"Transaction Type", arrow_dictionary, FIELD(invoice_transaction_type)},
+	{"Reference", arrow_utf8, FIELD(invoice_reference)},
+	{"Date", arrow_date32, FIELD(invoice_date)},
+	{"Transaction Amount", arrow_int64, FIELD(invoice_transaction_amount)}, // Money is in cents.
+	{"Amount", arrow_int64, FIELD(invoice_amount)},
+};
+
+char invoice_headings[] = "Cust ID|Invoice|Date|Amount"; // Of the usual output.
+
+void AddInvoiceColumns(Arrow_writer* arrow)
+{
+	for (u32 column = 0; column < invoice_column_count; column++)
+	{
+		ArrowAddColumn(arrow, invoice_columns[column].name, invoice_columns[column].type);
+	}
+}
+
+// The text of a column of the invoice, in buffer unless it is a field as it is.
+char* InvoiceColumnText(Invoice* invoice, Invoice_column column, char* buffer, size_t size)
+{
+	switch (column)
+	{
+		case invoice_column_account:			return invoice->account_id;
+		case invoice_column_location:			return invoice->invoice_location;
+		case invoice_column_payment_code:		return invoice->payment_code;
+		case invoice_column_number:				return invoice->invoice;
+		case invoice_column_transaction_type:	return invoice->transaction_type;
+		case invoice_column_reference:			return invoice->reference;
+		case invoice_column_date:				return invoice->date;
+		case invoice_column_transaction_amount:	sprintf_s(buffer, size, "%s%s", invoice->balance_minus ? "-" : "", invoice->transaction_amount); return buffer;
+		case invoice_column_amount:				sprintf_s(buffer, size, "%s%s", invoice->balance_minus ? "-" : "", invoice->amount); return buffer;
+		default:								return "";
+	}
+}
+
+void WriteSelectedInvoices(Invoice_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	Column_selection* selection = options.columns;
+	for (u32 invoice_index = 0; invoice_index < batch->count; invoice_index++)
+	{
+		char row[SELECTED_ROW_SIZE];
+		size_t row_length = 0;
+		for (u32 position = 0; position < selection->num_selected; position++)
+		{
+			char buffer[32];
+			char* text = InvoiceColumnText(&batch->invoices[invoice_index], (Invoice_column)selection->selected[position], buffer, sizeof(buffer));
+			PutSelectedColumn(selection, position, text, row, sizeof(row), &row_length, arrow);
+		}
+		WriteSelectedRow(row, output_file, options.print_to_screen, options.code_page);
+	}
+	if (arrow)
+	{
+		ArrowWriteBatch(arrow);
+	}
+}
+
+void WriteInvoices(Invoice_batch* batch, FILE* output_file, Arrow_writer* arrow, Program_options options)
+{
+	if (options.columns)
+	{
+		WriteSelectedInvoices(batch, output_file, arrow, options);
+		return;
+	}
+
+	if (arrow)
+	{
+		for (u32 invoice_index = 0; invoice_index < batch->count; invoice_index++)
+		{
+			Invoice* invoice = &batch->invoices[invoice_index];
+			char transaction_amount[16] = {0};
+			char amount[16] = {0};
+			sprintf_s(transaction_amount, sizeof(transaction_amount), "%s%s", invoice->transaction_amount, invoice->balance_minus ? "-" : "");
+			sprintf_s(amount, sizeof(amount), "%s%s", invoice->amount, invoice->balance_minus ? "-" : "");
+
+			Arrow_column* columns = arrow->columns;
+			ArrowAppendText(&columns[0], invoice->account_id);
+			ArrowAppendText(&columns[1], invoice->invoice_location);
+			ArrowAppendText(&columns[2], invoice->payment_code);
+			ArrowAppendText(&columns[3], invoice->invoice);
+			ArrowAppendText(&columns[4], invoice->transaction_type);
+			ArrowAppendText(&columns[5], invoice->reference);
+			ArrowAppendDate(&columns[6], invoice->date);
+			ArrowAppendMoney(&columns[7], transaction_amount);
+			ArrowAppendMoney(&columns[8], amount);
+		}
+		ArrowWriteBatch(arrow);
+	}
+
+	for (u32 invoice_index = 0; invoice_index < batch->count; invoice_index++)
+	{
+		Invoice* invoice = &batch->invoices[invoice_index];
+
+		char buffer[256] = {0};
+		if (options.debug_output)
+		{
+			sprintf_s(buffer, sizeof(buffer),
+					"%9s-00%32s%3s%3s%7s%5s %-6s%9s %39s%s %11s%s\n",
+					invoice->account_id,
+					invoice->credit_memo,
+					invoice->invoice_location,
+					invoice->payment_code,
+					invoice->invoice,
+					invoice->transaction_type,
+					invoice->reference,
+					invoice->date,
+
+					invoice->transaction_amount,
+					invoice->balance_minus ? "-" : "",
+					invoice->amount,
+					invoice->balance_minus ? "-" : ""
+					);
+		}
+		else
+		{
+			sprintf_s(buffer, sizeof(buffer),
+					"%s|%s|%s|%s%s\n",
+					invoice->account_id,
+					invoice->invoice,
+					invoice->date,
+					invoice->balance_minus ? "-" : "",
+					invoice->amount
+					);
+		}
+		char utf8[TRANSCODED_SIZE(sizeof(buffer))];
+		char* output_line = TranscodeText(buffer, utf8, sizeof(utf8), options.code_page);
+		if (output_file)
+		{
+			fprintf(output_file, "%s", output_line);
+		}
+		if (options.print_to_screen)
+		{
+			printf("%s", output_line);
+		}
+	}
+}
+
+void ParseInvoices(char* data, FILE* output_file, Arrow_writer* arrow, Program_options options, Report_summary* summary)
 {
 	size_t index			= 0;
 	size_t line_start_index = 0;
@@ -42,15 +286,40 @@ void ParseCrossReferences(char* data, FILE* output_file, Program_options options
 								 // After the first header is a customer location line that we should skip befor regular processing.
 
 	char current_account[10] = {0};
-	char* current_line = malloc(sizeof(char) * 60);
+	i64 account_balance = 0; // In cents, of the current account's invoices so far.
 
-	Invoice invoice = {0};
-	Invoice invoice_reset = {0};
+	u32 column[invoice_field_count];
+	InferLayout(&summary->layout, invoice_layout, invoice_field_count, data, 4, NULL);
+	LayoutColumns(&summary->layout, options.fixed_layout, column);
 
+	Field_check fields[invoice_field_count];
+	for (u32 field = 0; field < invoice_field_count; field++)
+	{
+		fields[field] = invoice_fields[field];
+		fields[field].start = column[field];
+	}
+	Line_check check; // An invoice line must reach its balance.
+	CompileLineCheck(&check, fields, ArrayCount(fields), column[invoice_amount] + 10);
+
+	Memory_arena arena = AllocateArena(RECORD_BATCH_SIZE * sizeof(Invoice));
+	Invoice_batch batch = {0};
+	batch.invoices = PushArray(&arena, RECORD_BATCH_SIZE, Invoice);
 
-	if (output_file && !options.debug_output)
+	if (output_file && options.columns)
 	{
-		fprintf(output_file, "Cust ID|Invoice|Date|Amount\n");
+		WriteSelectedHeadings(options.columns, output_file);
+	}
+	else if (output_file && !options.debug_output)
+	{
+		fprintf(output_file, "%s\n", invoice_headings);
+	}
+	if (arrow && options.columns)
+	{
+		AddSelectedColumns(options.columns, arrow);
+	}
+	else if (arrow)
+	{
+		AddInvoiceColumns(arrow);
 	}
 
 	while (data[index])
@@ -65,6 +334,7 @@ void ParseCrossReferences(char* data, FILE* output_file, Program_options options
 			if (line_position == 0) // @BUG: Found issue around line 57,002 where the IRX reports generated do not put space before the header!
 			{						// will need another way of parsing these files if no manual fiddling is to be required.
 				// loop over header lines
+				Phase_start header_start = BeginPhase(&summary->timings);
 				while (data[index] && (page_header_line > 0)) // data[index] != '\0' is necessary in the case the report ends with a header.
 				{
 					if (data[index] == '\n')
@@ -74,102 +344,144 @@ void ParseCrossReferences(char* data, FILE* output_file, Program_options options
 					index++;
 				}
 				page_header_line = 5;
+				EndPhase(&summary->timings, phase_header_skip, header_start);
+				UpdateProgress(summary->progress, index, summary->num_invoices);
 				summary->num_pages++;
 				continue;
 			}
 
 			line_start_index = index - line_position;
-			invoice = invoice_reset;
+			char* line = &data[line_start_index];
+			Invoice* invoice = &batch.invoices[batch.count];
 
 			if (line_position < 60)
 			{
 				// This line is either the start of an account or the start of the summary.
-				memcpy(current_line, &data[line_start_index], line_position + 1);
-				current_line[line_position] = '\0';
-				if (strstr(current_line, "Cust Loc:") != NULL)
+				if (LineContains(line, line_position, "Cust Loc:"))
 				{
+					summary->report_total = ReadLineTotal(line, line_position, total_count);
 					break;
 				}
 
 				// This must be the start of an account.
-				char* first_space = strchr(&data[line_start_index], ' ');
+				char* first_space = (char*)memchr(line, ' ', line_position);
 				if (first_space != NULL)
 				{
-					memcpy(current_account, &data[line_start_index], first_space - &data[line_start_index]);
+					memset(current_account, 0, sizeof(current_account));
+					memcpy(current_account, line, MIN((size_t)(first_space - line), sizeof(current_account) - 1));
+				}
+				if (options.filter)
+				{
+					FilterCompare(options.filter, 1, invoice_account_fields, current_account, strlen(current_account));
 				}
+				account_balance = 0;
 				line_position = 0;
 				index++;
 				summary->num_accounts++;
 				continue;
 			}
-			if (data[line_start_index + 51] == '.')
-			{
+			if (line_position > column[invoice_number] && line[column[invoice_number]] == '.')
+			{	// The account's total line, reconciled with its invoices (see reconcile.h).
+				char account_total_text[12];
+				i64 account_total = 0;
+				FillLineField(account_total_text, line, line_position, column[invoice_amount], 10);
+				ParseMoneyCents(account_total_text, &account_total);
+				if ((line_position > 130) && (data[index - 1] == '-'))
+				{
+					account_total = -account_total;
+				}
+				summary->num_account_totals++;
+				if (account_total != account_balance && summary->num_unbalanced_accounts++ == 0)
+				{
+					memcpy(summary->first_unbalanced_account, current_account, sizeof(current_account));
+				}
 				line_position = 0;
 				index++;
 				continue;
 			}
-			FillTextFieldAndTrim(invoice.credit_memo, &data[line_start_index + 41], 3);
-			FillTextFieldAndTrim(invoice.invoice_location, &data[line_start_index + 45], 2);
-			FillTextFieldAndTrim(invoice.payment_code, &data[line_start_index + 48], 2);
-			FillTextFieldAndTrim(invoice.invoice, &data[line_start_index + 51], 6);
-			FillTextFieldAndTrim(invoice.transaction_type, &data[line_start_index + 59], 3);
-			FillTextFieldAndTrim(invoice.reference, &data[line_start_index + 63], 6);
-			FillTextFieldAndTrim(invoice.date, &data[line_start_index + 70], 8);
-			FillTextFieldAndTrim(invoice.transaction_amount, &data[line_start_index + 108], 10);
-			FillTextFieldAndTrim(invoice.amount, &data[line_start_index + 120], 10);
-
-
-			bool balance_minus = false;
-			if ((line_position > 130) && (data[index - 1] == '-'))
+			CheckRecordLine(options.anomalies, line, line_position, &check);
+			bool keep = true;
+			if (options.filter)
 			{
-				balance_minus = true;
+				FilterCompare(options.filter, 0, fields, line, line_position);
+				keep = FilterMatches(options.filter);
 			}
-
-			char buffer[256] = {0};
-			if (options.debug_output)
+			u64 fields_to_read = keep ? options.fields : 0;
+			if (fields_to_read & FIELD(invoice_credit_memo))
 			{
-				sprintf_s(buffer, sizeof(buffer),
-						"%9s-00%32s%3s%3s%7s%5s %-6s%9s %39s%s %11s%s\n",
-						current_account,
-						invoice.credit_memo,
-						invoice.invoice_location,
-						invoice.payment_code,
-						invoice.invoice,
-						invoice.transaction_type,
-						invoice.reference,
-						invoice.date,
-
-						invoice.transaction_amount,
-						balance_minus ? "-" : "",
-						invoice.amount,
-						balance_minus ? "-" : ""
-						);
+				FillLineField(invoice->credit_memo, line, line_position, column[invoice_credit_memo], 3);
 			}
-			else
+			if (fields_to_read & FIELD(invoice_location))
+			{
+				FillLineField(invoice->invoice_location, line, line_position, column[invoice_location], 2);
+			}
+			if (fields_to_read & FIELD(invoice_payment_code))
+			{
+				FillLineField(invoice->payment_code, line, line_position, column[invoice_payment_code], 2);
+			}
+			if (fields_to_read & FIELD(invoice_number))
+			{
+				FillLineField(invoice->invoice, line, line_position, column[invoice_number], 6);
+			}
+			if (fields_to_read & FIELD(invoice_transaction_type))
 			{
-				sprintf_s(buffer, sizeof(buffer),
-						"%s|%s|%s|%s%s\n",
-						current_account,
-						invoice.invoice,
-						invoice.date,
-						balance_minus ? "-" : "",
-						invoice.amount
-						);
+				FillLineField(invoice->transaction_type, line, line_position, column[invoice_transaction_type], 3);
 			}
-			if (output_file)
+			if (fields_to_read & FIELD(invoice_reference))
 			{
-				fprintf(output_file, "%s", buffer);
+				FillLineField(invoice->reference, line, line_position, column[invoice_reference], 6);
 			}
-			if (options.print_to_screen)
+			if (fields_to_read & FIELD(invoice_date))
 			{
-				printf("%s", buffer);
+				FillLineField(invoice->date, line, line_position, column[invoice_date], 8);
 			}
+			if (fields_to_read & FIELD(invoice_transaction_amount))
+			{
+				FillLineField(invoice->transaction_amount, line, line_position, column[invoice_transaction_amount], 10);
+			}
+			FillLineField(invoice->amount, line, line_position, column[invoice_amount], 10); // Always: reconciled with the account totals.
+
+
+			if ((line_position > 130) && (data[index - 1] == '-'))
+			{
+				invoice->balance_minus = true;
+			}
+			memcpy(invoice->account_id, current_account, sizeof(current_account));
+
+			i64 amount = 0;
+			ParseMoneyCents(invoice->amount, &amount);
+			account_balance += invoice->balance_minus ? -amount : amount;
+			summary->total_owed += invoice->balance_minus ? -amount : amount;
+
 
-			line_position = 0;
 			summary->num_invoices++;
+			if (!keep)
+			{
+				memset(invoice, 0, sizeof(*invoice)); // The slot is reused.
+				summary->num_left_out++;
+				line_position = 0;
+				index++;
+				continue;
+			}
+			if (++batch.count == RECORD_BATCH_SIZE)
+			{
+				Phase_start format_start = BeginPhase(&summary->timings);
+				WriteInvoices(&batch, output_file, arrow, options);
+				EndPhase(&summary->timings, phase_format, format_start);
+				ResetArena(&arena);
+				batch.invoices = PushArray(&arena, RECORD_BATCH_SIZE, Invoice);
+				batch.count = 0;
+			}
+
+			line_position = 0;
 			index++;
 		}
 	}
+
+	Phase_start format_start = BeginPhase(&summary->timings);
+	WriteInvoices(&batch, output_file, arrow, options);
+	EndPhase(&summary->timings, phase_format, format_start);
+	FreeArena(&arena);
 }
 
 #define USAGE_STRING "\
@@ -179,11 +491,47 @@ John Hosick <john@atikokancastle.com>\n\n\
 pipe-delimited file of open invoices by customer for use in the conversion to CashierPRO.\n\n\
 USAGE: %s [OPTIONS] <inputfile> [outputfile]\n\
   OPTIONS:\n\
+    -a, --anomalies <file>\n\
+                    Write the fields that do not look like what they should hold (a letter\n\
+                    in an amount, a line cut short, ...) to the file, with their line numbers.\n\
     -d, --debug     Dump output in original format (to check the correctness of the parse).\n\
+    -e, --encoding <code page>\n\
+                    Convert text from the report's code page (cp437, cp1252 or latin1)\n\
+                    to UTF-8. Without it, text is written exactly as it was read, except\n\
+                    in Feather files, which must be UTF-8 and take it to be cp1252.\n\
+    -f, --feather   Write the output file in Arrow IPC (Feather v2) format instead.\n\
     -h, --help      Show this help message.\n\
     -p, --print     Print to the screen. Note: This option does not preclude\n\
                     outputting to a file: If an output file is specified,\n\
-                    it will be created as well as displayed on the screen.\n"
+                    it will be created as well as displayed on the screen.\n\
+    -s, --stats     Show the time spent in each phase of the parse.\n\
+        --stats-json\n\
+                    Also print the throughput and phase times as a line of JSON.\n\
+        --counters  Count cycles, instructions, branch and cache misses in each phase\n\
+                    (Linux only) and add them to the statistics.\n\
+        --no-progress\n\
+                    Do not show the progress of a long parse on the console.\n\
+        --allow-missing-totals\n\
+                    Do not fail if the report has no totals at its end to check the parse\n\
+                    against (reports from old versions of ProfitMaster).\n\
+        --fixed-layout\n\
+                    Parse with the built-in column layout even if the report's headings\n\
+                    and data show that its columns have moved.\n\
+        --columns <names>\n\
+                    Write only these columns, in this order (names of the Feather columns,\n\
+                    separated by commas), reading only the fields of the report they need.\n\
+        --where <filter>\n\
+                    Write only the invoices that match the filter, e.g. \"date < 01/01/2024\n\
+                    and amount > 0\" (see the instructions for what a filter can be).\n\
+        --sort-by <columns>\n\
+                    Sort the output file by these columns (separated by commas, each with\n\
+                    \" desc\" after it to sort it descending) instead of in report order.\n\
+        --sort-memory <megabytes>\n\
+                    The most memory --sort-by may use (default 256); a bigger output is\n\
+                    sorted in runs that are merged from disk.\n\
+        --serve <socket>\n\
+                    Keep running, and convert the reports asked for over the Unix domain\n\
+                    socket (Linux only). Any other arguments are ignored.\n"
 
 void PrintUsageAndExit(char *program_name)
 {
@@ -196,6 +544,11 @@ int main(int argc, char *argv[])
 	char* program_name = argv[0];
 	char* file_input_name = {0};
 	char* file_output_name = {0};
+	char* file_anomalies_name = {0};
+	char* column_names = {0};
+	char* filter_text = {0};
+	char* sort_text = {0};
+	u32 sort_megabytes = SORT_DEFAULT_MEGABYTES;
 
 	Program_options options = {0};
 
@@ -226,6 +579,96 @@ int main(int argc, char *argv[])
 				{
 					options.debug_output = true;
 				}
+				else if (strcmp(option, "feather") == 0)
+				{
+					options.feather_output = true;
+				}
+				else if (strcmp(option, "stats") == 0)
+				{
+					options.print_stats = true;
+				}
+				else if (strcmp(option, "stats-json") == 0)
+				{
+					options.stats_json = true;
+				}
+				else if (strcmp(option, "no-progress") == 0)
+				{
+					options.no_progress = true;
+				}
+				else if (strcmp(option, "allow-missing-totals") == 0)
+				{
+					options.allow_missing_totals = true;
+				}
+				else if (strcmp(option, "counters") == 0)
+				{
+					options.counters = true;
+				}
+				else if (strcmp(option, "fixed-layout") == 0)
+				{
+					options.fixed_layout = true;
+				}
+				else if (strcmp(option, "encoding") == 0)
+				{
+					if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+					{
+						printf("%s: --encoding must be followed by cp437, cp1252 or latin1.\n", program_name);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "columns") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --columns must be followed by the names of the columns to write, separated by commas.\n", program_name);
+						return -1;
+					}
+					column_names = argv[++arg];
+				}
+				else if (strcmp(option, "where") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --where must be followed by a filter, e.g. \"date < 01/01/2024\".\n", program_name);
+						return -1;
+					}
+					filter_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-by") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --sort-by must be followed by the names of the columns to sort by, separated by commas.\n", program_name);
+						return -1;
+					}
+					sort_text = argv[++arg];
+				}
+				else if (strcmp(option, "sort-memory") == 0)
+				{
+					sort_megabytes = (arg + 1 == argc) ? 0 : (u32)strtoul(argv[++arg], NULL, 10);
+					if (sort_megabytes < 1 || sort_megabytes > SORT_MAX_MEGABYTES)
+					{
+						printf("%s: --sort-memory must be followed by a number of megabytes, from 1 to %d.\n", program_name, SORT_MAX_MEGABYTES);
+						return -1;
+					}
+				}
+				else if (strcmp(option, "anomalies") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --anomalies must be followed by the name of the file to write them to.\n", program_name);
+						return -1;
+					}
+					file_anomalies_name = argv[++arg];
+				}
+				else if (strcmp(option, "serve") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --serve must be followed by the path of the socket to listen on.\n", program_name);
+						return -1;
+					}
+					return ServeRequests(program_name, argv[arg + 1], main, NULL); // Each request is run by main() itself.
+				}
 				else
 				{
 					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
@@ -243,6 +686,14 @@ int main(int argc, char *argv[])
 
 				switch (c2)
 				{
+					case 'a':
+						if (arg + 1 == argc)
+						{
+							printf("%s: -a must be followed by the name of the file to write them to.\n", program_name);
+							return -1;
+						}
+						file_anomalies_name = argv[++arg];
+						break;
 					case 'h':
 						PrintUsageAndExit(program_name);
 					case 'p':
@@ -251,6 +702,19 @@ int main(int argc, char *argv[])
 					case 'd':
 						options.debug_output = true;
 						break;
+					case 'e':
+						if (arg + 1 == argc || !ParseCodePage(argv[++arg], &options.code_page))
+						{
+							printf("%s: -e must be followed by cp437, cp1252 or latin1.\n", program_name);
+							return -1;
+						}
+						break;
+					case 'f':
+						options.feather_output = true;
+						break;
+					case 's':
+						options.print_stats = true;
+						break;
 					default:
 						printf("%s: Invalid argument '%c'. Use -h or --help for more details.\n", program_name, c2);
 						return -1;
@@ -280,16 +744,122 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (!file_output_name && options.feather_output)
+	{
+		printf("Feather output requires an output file.\n");
+		return -1;
+	}
+
+	Column_selection selection;
+	options.fields = ALL_FIELDS;
+	if (column_names)
+	{
+		if (options.debug_output)
+		{
+			printf("--columns cannot be used with -d.\n");
+			return -1;
+		}
+		if (!SelectColumns(&selection, invoice_columns, invoice_column_count, column_names, program_name))
+		{
+			return -1;
+		}
+		options.columns = &selection;
+		options.fields = selection.fields;
+	}
+
+	Record_filter filter;
+	if (filter_text)
+	{
+		// The invoice's own fields, on every line, and its customer's, from the account line before them.
+		Filter_table tables[] = {{invoice_fields, invoice_field_count}, {invoice_account_fields, ArrayCount(invoice_account_fields)}};
+		if (!CompileFilter(&filter, filter_text, tables, ArrayCount(tables), invoice_columns, invoice_column_count, NULL, 0, program_name))
+		{
+			return -1;
+		}
+		options.filter = &filter;
+	}
+
+	Sort_order sort_order;
+	if (sort_text)
+	{
+		if (options.debug_output || options.feather_output || options.print_to_screen || !file_output_name)
+		{
+			printf("--sort-by sorts the output file, so it needs one, and cannot be used with -d, -f or -p.\n");
+			return -1;
+		}
+		char headings[COLUMN_HEADINGS_SIZE];
+		if (options.columns)
+		{
+			FormatSelectedHeadings(options.columns, headings, sizeof(headings));
+		}
+		else
+		{
+			strcpy_s(headings, sizeof(headings), invoice_headings);
+		}
+		if (!CompileSortOrder(&sort_order, sort_text, invoice_columns, invoice_column_count, headings, sort_megabytes, program_name))
+		{
+			return -1;
+		}
+	}
+
+	if (!CheckReportKind(program_name, file_input_name, report_invoices))
+	{
+		return -1;
+	}
+
+	FILE* anomaly_file = NULL;
+	if (file_anomalies_name && fopen_s(&anomaly_file, file_anomalies_name, "w"))
+	{
+		printf("Could not create anomalies file: %s\n", file_anomalies_name);
+		return -1;
+	}
+
+	Report_summary summary = {0};
+	if (options.counters && !OpenPerfCounters(&summary.timings.counters))
+	{
+		printf("Hardware performance counters are not available.\n");
+	}
+
+	Phase_start read_start = BeginPhase(&summary.timings);
 	char* data = ReadEntireFile(file_input_name);
 	if (!data)
 	{
 		printf("Could not open input file: %s\n", file_input_name);
 		return -1;
 	}
+	summary.timings.input_bytes = GetFileSize64(file_input_name);
+	EndPhase(&summary.timings, phase_read, read_start);
 
-	Report_summary summary = {0};
+	Anomaly_log anomalies;
+	StartAnomalyLog(&anomalies, data, anomaly_file, file_anomalies_name, options.code_page);
+	options.anomalies = &anomalies;
 
-	if (file_output_name)
+	// Progress goes to stderr and would be mixed in with the records printed to the screen.
+	Progress progress;
+	if (!options.no_progress && !options.print_to_screen && StderrIsConsole() && StartProgress(&progress, summary.timings.input_bytes))
+	{
+		summary.progress = &progress;
+	}
+
+	if (file_output_name && options.feather_output)
+	{
+		Arrow_writer arrow;
+		if (!ArrowOpen(&arrow, file_output_name))
+		{
+			printf("Could not create output file: %s\n", file_output_name);
+			return -1;
+		}
+		arrow.code_page = options.code_page;
+
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseInvoices(data, NULL, &arrow, options, &summary);
+		EndParse(&summary.timings, parse_start);
+
+		Phase_start flush_start = BeginPhase(&summary.timings);
+		ArrowClose(&arrow);
+		EndPhase(&summary.timings, phase_flush, flush_start);
+	}
+	else if (file_output_name)
 	{
 		FILE* stream_output;
 		errno_t error;
@@ -301,19 +871,67 @@ int main(int argc, char *argv[])
 			return -1;
 		}
 
-		ParseCrossReferences(data, stream_output, options, &summary);
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseInvoices(data, stream_output, NULL, options, &summary);
+		EndParse(&summary.timings, parse_start);
+
+		Phase_start flush_start = BeginPhase(&summary.timings);
 		fclose(stream_output);
+		EndPhase(&summary.timings, phase_flush, flush_start);
 	}
 	else
 	{
-		ParseCrossReferences(data, NULL, options, &summary);
+		Phase_start parse_start = BeginPhase(&summary.timings);
+		ParseInvoices(data, NULL, NULL, options, &summary);
+		EndParse(&summary.timings, parse_start);
+	}
+
+	if (summary.progress)
+	{
+		StopProgress(summary.progress);
 	}
+	FreeFileMemory(data);
 
-	printf("Processed a total of %d invoices ($%d) in %d customers (%d pages).\n",
-			summary.num_invoices, summary.total_owed, summary.num_accounts, summary.num_pages);
+	char total_owed[32];
+	FormatTotal(total_owed, sizeof(total_owed), total_amount, summary.total_owed);
+	printf("Processed a total of %d invoices ($%s) in %d customers (%d pages).\n",
+			summary.num_invoices, total_owed, summary.num_accounts, summary.num_pages);
+	if (options.filter)
+	{
+		printf("Left out %d of the invoices that did not match --where.\n", summary.num_left_out);
+	}
+	bool reconciled = ReconcileTotal(summary.report_total, "number of invoices", summary.num_invoices, options.allow_missing_totals);
+	if (summary.num_unbalanced_accounts)
+	{
+		printf("Error: The invoices of %u customers do not add up to their ACCOUNT TOTAL (the first is %s).\n",
+				summary.num_unbalanced_accounts, summary.first_unbalanced_account);
+		reconciled = false;
+	}
+	else if (summary.num_account_totals)
+	{
+		printf("Matches the report's %u ACCOUNT TOTAL lines.\n", summary.num_account_totals);
+	}
+	bool sorted = true;
+	if (sort_text)
+	{
+		Phase_start sort_start = BeginPhase(&summary.timings);
+		sorted = SortOutputFile(&sort_order, file_output_name, program_name);
+		EndPhase(&summary.timings, phase_sort, sort_start);
+	}
 	if (file_output_name)
 	{
 		printf("Output dumped to %s.\n", file_output_name);
 	}
-	return 0;
+	PrintLayoutDrift(&summary.layout, options.fixed_layout);
+	PrintAnomalies(&anomalies);
+	if (anomaly_file)
+	{
+		fclose(anomaly_file);
+	}
+	PrintTimings(&summary.timings, summary.num_invoices, options.print_stats);
+	if (options.stats_json)
+	{
+		PrintTimingsJson(&summary.timings, "invoices", summary.num_invoices, summary.num_pages);
+	}
+	return (reconciled && sorted) ? 0 : -1;
 }
@@ -0,0 +1,307 @@
+#ifndef LAYOUT
+#define LAYOUT
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	The parsers read every field at a fixed byte offset, and those offsets are only right for the version of
+	ProfitMaster the reports were taken from. If a later version moves a column over, the parse still "works"
+	but every field after it comes out cut in half. InferLayout() checks the built-in offsets against the
+	report itself before the parse, and moves the fields that have clearly moved.
+
+	Two things are looked at, both from the first LAYOUT_SAMPLE_LINES lines of the report:
+	  - The column headings in the page headers. Each field has one (e.g. "SKU"), and where the heading is
+	    found says where the field starts (or ends, for right aligned fields such as amounts).
+	  - A histogram of how many data lines have something other than a space in each column. A left aligned
+	    field starts where the count jumps up from a column that is mostly blank, the gap between two fields
+	    (an "edge"). A right aligned field ends where it drops to one.
+
+	Amounts are right aligned and often followed by a sign, so their edge is where the digits stop. Where the
+	lines of a record do not share one layout (the product line of an IRH report and the history periods under
+	it), the parser samples only the lines of one kind, and the fields of the others go along with them.
+
+	A field whose heading is found goes where the heading says, unless the data has a stronger edge at the
+	built-in column. The others are shifted by up to LAYOUT_MAX_SHIFT columns to wherever the data has the
+	strongest edge, but as a layout usually changes by a column being inserted or widened (which moves all the
+	fields after it by the same amount), the shifts are chosen together, left to right, with a cost for every
+	change of shift from one field to the next. A field only moves on its own if the data clearly says so, a
+	field with little data of its own (a credit memo flag that is usually blank) goes along with its
+	neighbours, and the fields of a report that does not look like a report at all stay where they are.
+
+	The parse then uses the inferred columns (or the built-in ones, with --fixed-layout), and the tools warn
+	about every field that has moved, so that a parse with a shifted layout never goes unnoticed. Sampling
+	a few thousand lines takes well under a millisecond.
+*/
+
+#define LAYOUT_MAX_FIELDS 16
+#define LAYOUT_MAX_COLUMNS 256
+#define LAYOUT_MAX_SHIFT 8
+#define LAYOUT_SAMPLE_LINES 4000
+#define LAYOUT_MAX_HEADER_LINES 32
+#define LAYOUT_SHIFTS (2 * LAYOUT_MAX_SHIFT + 1)
+#define LAYOUT_ANY_SHIFT 0x7FFFFFFF
+#define LAYOUT_IMPOSSIBLE (-0x7FFFFFFF)
+
+typedef struct
+{
+	char* name; // As in the output header.
+	char* heading; // As in the report's page header.
+	u32 start;
+	u32 length;
+	bool right_aligned;
+} Layout_field;
+
+typedef struct
+{
+	Layout_field* fields;
+	u32 num_fields;
+	u32 starts[LAYOUT_MAX_FIELDS]; // Inferred.
+	bool found_heading[LAYOUT_MAX_FIELDS];
+	u32 num_moved;
+	u32 num_sampled_lines;
+} Report_layout;
+
+// Column of the whole word heading in the line closest to expected, or -1 if it is not within LAYOUT_MAX_SHIFT.
+i32 FindHeading(char* line, size_t length, char* heading, u32 expected)
+{
+	size_t heading_length = strlen(heading);
+	i32 found = -1;
+	for (size_t column = 0; column + heading_length <= length; column++)
+	{
+		if (memcmp(&line[column], heading, heading_length) != 0 ||
+			(column > 0 && line[column - 1] != ' ') ||
+			(column + heading_length < length && line[column + heading_length] != ' '))
+		{
+			continue;
+		}
+		i32 distance = abs((i32)column - (i32)expected);
+		if (distance <= LAYOUT_MAX_SHIFT && (found < 0 || distance < abs(found - (i32)expected)))
+		{
+			found = (i32)column;
+		}
+	}
+	return found;
+}
+
+typedef struct
+{
+	u32 used[LAYOUT_MAX_COLUMNS]; // Lines with anything but a space in the column.
+	u32 digits[LAYOUT_MAX_COLUMNS]; // Lines with a digit in it.
+} Column_histogram;
+
+// How much more often the field's first column is used than the one before it, or for a right aligned field
+// how much more often its last column has a digit than the one after it (which may be a sign). The column
+// outside the field must look like the gap between two fields (used at most a quarter as often); 0 if not.
+i32 FieldEdge(Column_histogram* histogram, Layout_field* field, i32 start)
+{
+	if (start < 1 || start + (i32)field->length >= LAYOUT_MAX_COLUMNS)
+	{
+		return 0;
+	}
+	i32 end = start + (i32)field->length - 1;
+	u32 inside = field->right_aligned ? histogram->digits[end] : histogram->used[start];
+	u32 outside = field->right_aligned ? histogram->digits[end + 1] : histogram->used[start - 1];
+	return (outside * 4 <= inside) ? (i32)(inside - outside) : 0;
+}
+
+bool IsRulerLine(char* line, size_t length)
+{
+	for (size_t column = 0; column < length; column++)
+	{
+		if (line[column] != '-' && line[column] != '=' && line[column] != ' ')
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The columns to parse with: the inferred ones, or with fixed the built-in ones.
+void LayoutColumns(Report_layout* layout, bool fixed, u32* columns)
+{
+	for (u32 field = 0; field < layout->num_fields; field++)
+	{
+		columns[field] = fixed ? layout->fields[field].start : layout->starts[field];
+	}
+}
+
+// Whether a data line (length bytes long) is one to sample.
+typedef bool Layout_line_filter(char* line, size_t length);
+
+// Samples the start of the report, in which each page header is a blank line followed by header_lines lines: all
+// its data lines, or only those sample_line picks.
+void InferLayout(Report_layout* layout, Layout_field* fields, u32 num_fields, char* data, u32 header_lines, Layout_line_filter* sample_line)
+{
+	assert(num_fields <= LAYOUT_MAX_FIELDS, "Too many layout fields.");
+	memset(layout, 0, sizeof(*layout));
+	layout->fields = fields;
+	layout->num_fields = num_fields;
+
+	Column_histogram histogram = {0};
+	char* headers[LAYOUT_MAX_HEADER_LINES];
+	size_t header_lengths[LAYOUT_MAX_HEADER_LINES];
+	u32 num_headers = 0;
+
+	u32 header_line = header_lines + 1; // The report starts with a header, blank line included.
+	char* line = data;
+	for (u32 sampled = 0; *line && sampled < LAYOUT_SAMPLE_LINES; sampled++)
+	{
+		char* end = strchr(line, '\n');
+		size_t length = end ? (size_t)(end - line) : strlen(line);
+
+		if (length == 0)
+		{
+			header_line = header_lines;
+		}
+		else if (header_line > 0)
+		{
+			header_line--;
+			if (num_headers < LAYOUT_MAX_HEADER_LINES)
+			{
+				headers[num_headers] = line;
+				header_lengths[num_headers] = length;
+				num_headers++;
+			}
+		}
+		else if (!IsRulerLine(line, length) && (!sample_line || sample_line(line, length)))
+		{
+			for (size_t column = 0; column < MIN(length, LAYOUT_MAX_COLUMNS); column++)
+			{
+				histogram.used[column] += (line[column] != ' ');
+				histogram.digits[column] += (line[column] >= '0' && line[column] <= '9');
+			}
+			layout->num_sampled_lines++;
+		}
+
+		if (!end)
+		{
+			break;
+		}
+		line = end + 1;
+	}
+
+	// The shift of each field that the headings allow: only the one they show, if they show one.
+	i32 allowed[LAYOUT_MAX_FIELDS];
+	for (u32 field_index = 0; field_index < num_fields; field_index++)
+	{
+		Layout_field* field = &fields[field_index];
+		i32 heading_start = -1;
+		if (field->heading)
+		{
+			u32 heading_length = (u32)strlen(field->heading);
+			u32 expected = field->right_aligned ? field->start + field->length - MIN(heading_length, field->start + field->length) : field->start;
+			for (u32 header = 0; header < num_headers && heading_start < 0; header++)
+			{
+				i32 column = FindHeading(headers[header], header_lengths[header], field->heading, expected);
+				if (column >= 0)
+				{
+					heading_start = field->right_aligned ? column + (i32)heading_length - (i32)field->length : column;
+				}
+			}
+		}
+		layout->found_heading[field_index] = (heading_start >= 0);
+
+		allowed[field_index] = LAYOUT_ANY_SHIFT;
+		if (heading_start >= 0)
+		{
+			bool data_agrees = FieldEdge(&histogram, field, heading_start) >= FieldEdge(&histogram, field, (i32)field->start);
+			allowed[field_index] = data_agrees ? heading_start - (i32)field->start : 0;
+		}
+	}
+
+	// Best shift of every field, from left to right: a field gains the strength of its edge at the shifted
+	// column, and every change of shift from the previous field (the first is compared with no shift) costs a
+	// tenth of the sampled lines. So a field only moves alone if the data clearly says so, while a field with
+	// little data of its own (a usually blank flag) goes along with its neighbours.
+	i32 change_cost = (i32)MAX(layout->num_sampled_lines / 10, 8);
+	i32 scores[LAYOUT_MAX_FIELDS][LAYOUT_SHIFTS];
+	u8 previous[LAYOUT_MAX_FIELDS][LAYOUT_SHIFTS] = {0};
+	for (u32 field_index = 0; field_index < num_fields; field_index++)
+	{
+		Layout_field* field = &fields[field_index];
+		for (i32 shift = -LAYOUT_MAX_SHIFT; shift <= LAYOUT_MAX_SHIFT; shift++)
+		{
+			i32* score = &scores[field_index][shift + LAYOUT_MAX_SHIFT];
+			*score = LAYOUT_IMPOSSIBLE;
+			if ((allowed[field_index] != LAYOUT_ANY_SHIFT && allowed[field_index] != shift) || (i32)field->start + shift < 0)
+			{
+				continue;
+			}
+
+			i32 edge = FieldEdge(&histogram, field, (i32)field->start + shift);
+			if (field_index == 0)
+			{
+				*score = edge - (shift ? change_cost : 0);
+				continue;
+			}
+			for (i32 last_shift = -LAYOUT_MAX_SHIFT; last_shift <= LAYOUT_MAX_SHIFT; last_shift++)
+			{
+				i32 last_score = scores[field_index - 1][last_shift + LAYOUT_MAX_SHIFT];
+				// In order, and not run into the field before (unless the built-in layout has them overlap, for
+				// fields on different lines of a record).
+				Layout_field* last_field = &fields[field_index - 1];
+				i32 min_distance = MAX(1, (i32)MIN(last_field->length, field->start - last_field->start));
+				bool in_order = ((i32)field->start + shift) - ((i32)last_field->start + last_shift) >= min_distance;
+				if (last_score == LAYOUT_IMPOSSIBLE || !in_order)
+				{
+					continue;
+				}
+				i32 total = last_score + edge - ((shift != last_shift) ? change_cost : 0);
+				if (total > *score)
+				{
+					*score = total;
+					previous[field_index][shift + LAYOUT_MAX_SHIFT] = (u8)(last_shift + LAYOUT_MAX_SHIFT);
+				}
+			}
+		}
+	}
+
+	// Prefer no shift, then the smallest, on a tie.
+	u32 best = LAYOUT_MAX_SHIFT;
+	for (u32 shift = 0; shift < LAYOUT_SHIFTS; shift++)
+	{
+		i32 score = scores[num_fields - 1][shift];
+		i32 best_score = scores[num_fields - 1][best];
+		if (score > best_score || (score == best_score && abs((i32)shift - LAYOUT_MAX_SHIFT) < abs((i32)best - LAYOUT_MAX_SHIFT)))
+		{
+			best = shift;
+		}
+	}
+	if (scores[num_fields - 1][best] == LAYOUT_IMPOSSIBLE) // The headings put the fields out of order.
+	{
+		LayoutColumns(layout, true, layout->starts);
+		return;
+	}
+	for (u32 field_index = num_fields; field_index-- > 0; )
+	{
+		layout->starts[field_index] = fields[field_index].start + best - LAYOUT_MAX_SHIFT;
+		layout->num_moved += (best != LAYOUT_MAX_SHIFT);
+		if (field_index > 0)
+		{
+			best = previous[field_index][best];
+		}
+	}
+}
+
+void PrintLayoutDrift(Report_layout* layout, bool fixed)
+{
+	if (!layout->num_moved)
+	{
+		return;
+	}
+	printf("Warning: The report's layout differs from the built-in one:\n");
+	for (u32 field = 0; field < layout->num_fields; field++)
+	{
+		u32 start = layout->fields[field].start;
+		if (layout->starts[field] != start)
+		{
+			printf("  %-20s starts at column %u instead of %u%s.\n", layout->fields[field].name, layout->starts[field] + 1, start + 1,
+				   layout->found_heading[field] ? "" : " (no heading found)");
+		}
+	}
+	printf(fixed ? "The report was parsed with the built-in layout; check the output.\n" : "The report was parsed with the layout found in it.\n");
+}
+
+#endif
@@ -0,0 +1,663 @@
+#include <stdio.h>
+
+#include "platform.h"
+#include "utils.h"
+#include "serve.h"
+
+#define VERSION "2026-10-19"
+
+#define INDEX_MAGIC "PMCIDX1" // 7 + \0
+#define INDEX_KEY_LENGTH 16
+#define INDEX_MAX_SOURCES 8
+#define INDEX_MAX_INPUTS 32
+#define MAX_CACHED_INDEXES 8
+
+typedef struct
+{
+	bool prefix_search;
+} Program_options;
+
+typedef enum
+{
+	index_sku,
+	index_upc,
+	index_cust,
+	index_kind_count
+} Index_kind;
+
+char* index_kind_names[index_kind_count] = {"sku", "upc", "cust"};
+
+// Describes how a file produced by one of the other tools is indexed. Parsed files are recognized by their
+// header line; a file may feed more than one table (i.e. cross-references are indexed by SKU and by UPC).
+typedef struct
+{
+	char* header;
+	char* name;
+	Index_kind kind;
+	u32 key_column;
+} Index_source;
+
+Index_source index_sources[] =
+{
+	{"SKU Number|UPC",				 "cross-reference", index_sku,  0},
+	{"SKU Number|UPC",				 "cross-reference", index_upc,  1},
+	{"SKU|CURRENT|",				 "history",			index_sku,  0},
+	{"Cust ID|Credit Limit|",		 "account",			index_cust, 0},
+	{"Cust ID|First Name|",			 "address",			index_cust, 0},
+	{"Cust ID|Memo",				 "memo",			index_cust, 0},
+};
+
+#define NUM_INDEX_SOURCES (sizeof(index_sources) / sizeof(index_sources[0]))
+
+/*	INDEX FILE LAYOUT
+	=================
+
+	- Index_header, followed by the entries of each table, followed by the string pool.
+	- Every offset is relative to the start of the file so that the whole file can simply be mapped and used in place.
+	- Entries of a table are sorted by key. Keys are padded with '\0' so memcmp() gives the same order as strcmp()
+	  and both point and prefix lookups are a binary search.
+	- The string pool holds the source names, their column headers and the complete parsed row of every entry.
+*/
+
+typedef struct
+{
+	char key[INDEX_KEY_LENGTH]; // Not terminated when the key uses all 16 characters.
+	u32  row_offset;
+	u16  row_length;
+	u16  source;
+} Index_entry;
+
+typedef struct
+{
+	u32 num_entries;
+	u32 reserved;
+	u64 entries_offset;
+} Index_table;
+
+typedef struct
+{
+	u32 name_offset;
+	u32 header_offset;
+} Index_source_info;
+
+typedef struct
+{
+	char magic[8];
+	u32  num_sources;
+	u32  reserved;
+	Index_table tables[index_kind_count];
+	Index_source_info sources[INDEX_MAX_SOURCES];
+	u64  strings_offset;
+	u64  strings_size;
+} Index_header;
+
+typedef struct
+{
+	char* data;
+	size_t rows_start; // Index of the first character after the header line.
+	u32 num_rows;
+} Parsed_file;
+
+int CompareIndexEntries(const void* a, const void* b)
+{
+	const Index_entry* entry_a = (const Index_entry*)a;
+	const Index_entry* entry_b = (const Index_entry*)b;
+
+	int result = memcmp(entry_a->key, entry_b->key, INDEX_KEY_LENGTH);
+	if (result == 0)
+	{
+		result = (int)entry_a->source - (int)entry_b->source;
+	}
+	return result;
+}
+
+// Returns the length of the line starting at data, excluding the line ending.
+size_t LineLength(char* data)
+{
+	size_t length = 0;
+	while (data[length] && (data[length] != '\n'))
+	{
+		length++;
+	}
+	if ((length > 0) && (data[length - 1] == '\r'))
+	{
+		length--;
+	}
+	return length;
+}
+
+u32 AppendString(char* pool, u32* pool_size, char* string, size_t length)
+{
+	u32 offset = *pool_size;
+	memcpy(pool + offset, string, length);
+	pool[offset + length] = '\0';
+	*pool_size += TruncateUnsignedI64(length + 1);
+	return offset;
+}
+
+i32 BuildIndex(char* index_file_name, char** input_file_names, u32 num_inputs)
+{
+	Parsed_file files[INDEX_MAX_INPUTS] = {0};
+	u64 max_entries = 0;
+	u64 max_pool_size = 0;
+
+	for (u32 source = 0; source < NUM_INDEX_SOURCES; source++)
+	{
+		max_pool_size += strlen(index_sources[source].name) + strlen(index_sources[source].header) + 2;
+	}
+
+	// Load every parsed file up front so that the entries and string pool can be allocated exactly once.
+	for (u32 input = 0; input < num_inputs; input++)
+	{
+		Parsed_file* file = &files[input];
+		file->data = ReadEntireFile(input_file_names[input]);
+		if (!file->data)
+		{
+			printf("Could not open input file: %s\n", input_file_names[input]);
+			return -1;
+		}
+
+		u32 num_matching_sources = 0;
+		for (u32 source = 0; source < NUM_INDEX_SOURCES; source++)
+		{
+			if (strncmp(file->data, index_sources[source].header, strlen(index_sources[source].header)) == 0)
+			{
+				num_matching_sources++;
+			}
+		}
+		if (num_matching_sources == 0)
+		{
+			printf("%s was not produced by a supported tool (unrecognized header line).\n", input_file_names[input]);
+			return -1;
+		}
+
+		size_t index = LineLength(file->data);
+		while (file->data[index] && (file->data[index] != '\n'))
+		{
+			index++;
+		}
+		if (file->data[index] == '\n')
+		{
+			index++;
+		}
+		file->rows_start = index;
+
+		while (file->data[index])
+		{
+			if (file->data[index] == '\n')
+			{
+				file->num_rows++;
+			}
+			index++;
+		}
+		if ((index > 0) && (file->data[index - 1] != '\n')) // Last row is not terminated.
+		{
+			file->num_rows++;
+		}
+
+		max_entries += (u64)file->num_rows * num_matching_sources;
+		max_pool_size += (u64)(index - file->rows_start + file->num_rows) * num_matching_sources;
+		max_pool_size += (u64)(file->rows_start + 1) * num_matching_sources; // Column headers.
+	}
+
+	u32 pool_size = 0;
+	char* pool = (char*)AllocateMemory(TruncateUnsignedI64(max_pool_size));
+	Index_entry* entries = (Index_entry*)AllocateMemory(TruncateUnsignedI64(max_entries * sizeof(Index_entry) + 1));
+	if (!pool || !entries)
+	{
+		printf("Could not allocate memory for the index.\n");
+		return -1;
+	}
+
+	Index_header header = {0};
+	memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	header.num_sources = NUM_INDEX_SOURCES;
+	for (u32 source = 0; source < NUM_INDEX_SOURCES; source++)
+	{
+		// Keep the complete header line of the first matching file; the source only describes its start.
+		char* columns = index_sources[source].header;
+		for (u32 input = 0; input < num_inputs; input++)
+		{
+			if (strncmp(files[input].data, columns, strlen(columns)) == 0)
+			{
+				columns = files[input].data;
+				break;
+			}
+		}
+		header.sources[source].name_offset = AppendString(pool, &pool_size, index_sources[source].name, strlen(index_sources[source].name));
+		header.sources[source].header_offset = AppendString(pool, &pool_size, columns, LineLength(columns));
+	}
+
+	// Entries are grouped per table so that each table ends up contiguous after sorting.
+	u32 num_entries[index_kind_count] = {0};
+	u32 num_skipped = 0;
+	for (Index_kind kind = 0; kind < index_kind_count; kind++)
+	{
+		u64 first_entry = 0;
+		for (Index_kind previous = 0; previous < kind; previous++)
+		{
+			first_entry += num_entries[previous];
+		}
+
+		for (u32 input = 0; input < num_inputs; input++)
+		{
+			Parsed_file* file = &files[input];
+			for (u32 source = 0; source < NUM_INDEX_SOURCES; source++)
+			{
+				Index_source* index_source = &index_sources[source];
+				if ((index_source->kind != kind) || (strncmp(file->data, index_source->header, strlen(index_source->header)) != 0))
+				{
+					continue;
+				}
+
+				size_t index = file->rows_start;
+				while (file->data[index])
+				{
+					char* row = &file->data[index];
+					size_t row_length = LineLength(row);
+
+					// Find the key column.
+					size_t key_start = 0;
+					for (u32 column = 0; (column < index_source->key_column) && (key_start < row_length); column++)
+					{
+						while ((key_start < row_length) && (row[key_start] != '|'))
+						{
+							key_start++;
+						}
+						key_start++;
+					}
+					size_t key_length = 0;
+					while ((key_start + key_length < row_length) && (row[key_start + key_length] != '|'))
+					{
+						key_length++;
+					}
+
+					if ((key_start < row_length) && (key_length > 0) && (key_length <= INDEX_KEY_LENGTH) && (row_length <= 0xFFFF))
+					{
+						Index_entry* entry = &entries[first_entry + num_entries[kind]];
+						memcpy(entry->key, &row[key_start], key_length);
+						entry->row_offset = AppendString(pool, &pool_size, row, row_length);
+						entry->row_length = (u16)row_length;
+						entry->source = (u16)source;
+						num_entries[kind]++;
+					}
+					else if (row_length > 0)
+					{
+						num_skipped++;
+					}
+
+					index += row_length;
+					while (file->data[index] && (file->data[index] != '\n'))
+					{
+						index++;
+					}
+					if (file->data[index] == '\n')
+					{
+						index++;
+					}
+				}
+			}
+		}
+	}
+
+	u64 offset = sizeof(Index_header);
+	u64 first_entry = 0;
+	for (Index_kind kind = 0; kind < index_kind_count; kind++)
+	{
+		qsort(&entries[first_entry], num_entries[kind], sizeof(Index_entry), CompareIndexEntries);
+		header.tables[kind].num_entries = num_entries[kind];
+		header.tables[kind].entries_offset = offset;
+		offset += (u64)num_entries[kind] * sizeof(Index_entry);
+		first_entry += num_entries[kind];
+	}
+	header.strings_offset = offset;
+	header.strings_size = pool_size;
+
+	FILE* stream_output;
+	errno_t error = fopen_s(&stream_output, index_file_name, "wb");
+	if (error)
+	{
+		printf("Could not create index file: %s\n", index_file_name);
+		return -1;
+	}
+	fwrite(&header, sizeof(header), 1, stream_output);
+	fwrite(entries, sizeof(Index_entry), (size_t)first_entry, stream_output);
+	fwrite(pool, 1, pool_size, stream_output);
+	fclose(stream_output);
+
+	printf("Indexed %d SKUs, %d UPCs and %d customer records from %d files.\n",
+			num_entries[index_sku], num_entries[index_upc], num_entries[index_cust], num_inputs);
+	if (num_skipped)
+	{
+		printf("Skipped %d rows with an empty or oversized key.\n", num_skipped);
+	}
+	printf("Index written to %s.\n", index_file_name);
+
+	for (u32 input = 0; input < num_inputs; input++)
+	{
+		FreeFileMemory(files[input].data);
+	}
+	FreeFileMemory(entries);
+	FreeFileMemory(pool);
+
+	return 0;
+}
+
+// Prints a row as 'column: value' pairs using the column header of the tool that produced it.
+void PrintIndexRow(char* source_name, char* columns, char* row)
+{
+	printf("%s:", source_name);
+	while (*row || *columns)
+	{
+		printf(" ");
+		while (*columns && (*columns != '|'))
+		{
+			putchar(*columns++);
+		}
+		printf("=");
+		while (*row && (*row != '|'))
+		{
+			putchar(*row++);
+		}
+		if (*columns == '|')
+		{
+			columns++;
+		}
+		if (*row == '|')
+		{
+			row++;
+		}
+		if (*row || *columns)
+		{
+			printf(",");
+		}
+	}
+	printf("\n");
+}
+
+typedef struct
+{
+	char* file_name;
+	Mapped_file index;
+	u64 write_time;
+} Cached_index;
+
+// Indexes kept mapped by a server (--serve), which the processes running its queries inherit.
+Cached_index cached_indexes[MAX_CACHED_INDEXES];
+u32 num_cached_indexes;
+
+// Maps each cached index again if it has been rebuilt since it was mapped.
+void RefreshCachedIndexes(void)
+{
+	for (u32 cached = 0; cached < num_cached_indexes; cached++)
+	{
+		Cached_index* index = &cached_indexes[cached];
+		u64 write_time = GetFileWriteTime(index->file_name);
+		if (write_time != index->write_time)
+		{
+			UnmapFile(&index->index);
+			index->index = MapEntireFile(index->file_name);
+			index->write_time = write_time;
+		}
+	}
+}
+
+// The cached mapping of the index if there is one (given by the same name), or a new one, to be unmapped.
+Mapped_file MapIndex(char* index_file_name, bool* cached)
+{
+	for (u32 index = 0; index < num_cached_indexes; index++)
+	{
+		if (cached_indexes[index].index.data && strcmp(cached_indexes[index].file_name, index_file_name) == 0)
+		{
+			*cached = true;
+			return cached_indexes[index].index;
+		}
+	}
+	*cached = false;
+	return MapEntireFile(index_file_name);
+}
+
+i32 QueryIndex(char* index_file_name, Index_kind kind, char* key, Program_options options)
+{
+	size_t key_length = strlen(key);
+	if ((key_length == 0) || (key_length > INDEX_KEY_LENGTH))
+	{
+		printf("Keys must be between 1 and %d characters long.\n", INDEX_KEY_LENGTH);
+		return -1;
+	}
+
+	u64 start = ReadTimer();
+
+	bool cached;
+	Mapped_file index = MapIndex(index_file_name, &cached);
+	if (!index.data || (index.size < sizeof(Index_header)) || (memcmp(index.data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0))
+	{
+		printf("Could not open index file: %s\n", index_file_name);
+		if (!cached)
+		{
+			UnmapFile(&index);
+		}
+		return -1;
+	}
+
+	Index_header* header = (Index_header*)index.data;
+	Index_table* table = &header->tables[kind];
+	Index_entry* entries = (Index_entry*)(index.data + table->entries_offset);
+	char* strings = index.data + header->strings_offset;
+	if ((table->entries_offset + (u64)table->num_entries * sizeof(Index_entry) > index.size) ||
+		(header->strings_offset + header->strings_size > index.size))
+	{
+		printf("Index file is truncated: %s\n", index_file_name);
+		if (!cached)
+		{
+			UnmapFile(&index);
+		}
+		return -1;
+	}
+
+	char padded_key[INDEX_KEY_LENGTH] = {0};
+	memcpy(padded_key, key, key_length);
+
+	// Binary search for the first entry not less than the key (lower bound).
+	u32 low = 0;
+	u32 high = table->num_entries;
+	while (low < high)
+	{
+		u32 middle = low + (high - low) / 2;
+		if (memcmp(entries[middle].key, padded_key, INDEX_KEY_LENGTH) < 0)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	u32 num_matches = 0;
+	for (u32 entry_index = low; entry_index < table->num_entries; entry_index++)
+	{
+		Index_entry* entry = &entries[entry_index];
+		if (options.prefix_search)
+		{
+			if (memcmp(entry->key, padded_key, key_length) != 0)
+			{
+				break;
+			}
+		}
+		else if (memcmp(entry->key, padded_key, INDEX_KEY_LENGTH) != 0)
+		{
+			break;
+		}
+
+		Index_source_info* source = &header->sources[entry->source];
+		PrintIndexRow(strings + source->name_offset, strings + source->header_offset, strings + entry->row_offset);
+		num_matches++;
+	}
+
+	double elapsed_microseconds = TicksToSeconds(ReadTimer() - start) * 1000000.0;
+
+	if (num_matches == 0)
+	{
+		printf("No %s matching '%s'%s.\n", index_kind_names[kind], key, options.prefix_search ? "*" : "");
+	}
+	printf("Found %d matches in %.1f microseconds.\n", num_matches, elapsed_microseconds);
+
+	if (!cached)
+	{
+		UnmapFile(&index);
+	}
+	return num_matches ? 0 : 1;
+}
+
+#define USAGE_STRING "\
+%s %s\n\
+John Hosick <john@atikokancastle.com>\n\n\
+%s is used to build a lookup index over the pipe-delimited files produced by the\n\
+crossreferences, producthistory and customers tools, and to query it by SKU, UPC or Cust ID\n\
+without going back to the original reports.\n\n\
+USAGE: %s [OPTIONS] build <indexfile> <parsedfile> [parsedfile ...]\n\
+       %s [OPTIONS] query <indexfile> <sku|upc|cust> <key>\n\
+  OPTIONS:\n\
+    -h, --help      Show this help message.\n\
+    -x, --prefix    Treat the query key as a prefix and list every match.\n\
+        --serve <socket> [indexfile ...]\n\
+                    Keep running, and answer the builds and queries asked for over the Unix\n\
+                    domain socket (Linux only), with the index files given kept loaded.\n"
+
+void PrintUsageAndExit(char *program_name)
+{
+	printf(USAGE_STRING, program_name, VERSION, program_name, program_name, program_name);
+	exit (0);
+}
+
+int main(int argc, char *argv[])
+{
+	char* program_name = argv[0];
+	char* command = {0};
+	char* index_file_name = {0};
+	char* arguments[INDEX_MAX_INPUTS] = {0};
+	u32 num_arguments = 0;
+
+	Program_options options = {0};
+
+	if (argc < 2)
+	{
+		printf("%s: Command not specified. Use -h or --help for more details.\n", program_name);
+		return -1;
+	}
+
+	for (i32 arg = 1; arg < argc; arg++)
+	{
+		char c1 = argv[arg][0];
+		char c2 = argv[arg][1];
+		if (c1 == '-')
+		{
+			if (c2 == '-')
+			{
+				char* option = &argv[arg][2];
+				if (strcmp(option, "help") == 0)
+				{
+					PrintUsageAndExit(program_name);
+				}
+				else if (strcmp(option, "prefix") == 0)
+				{
+					options.prefix_search = true;
+				}
+				else if (strcmp(option, "serve") == 0)
+				{
+					if (arg + 1 == argc)
+					{
+						printf("%s: --serve must be followed by the path of the socket to listen on.\n", program_name);
+						return -1;
+					}
+					for (i32 index_arg = arg + 2; index_arg < argc && num_cached_indexes < MAX_CACHED_INDEXES; index_arg++)
+					{
+						cached_indexes[num_cached_indexes++].file_name = argv[index_arg];
+					}
+					RefreshCachedIndexes();
+					return ServeRequests(program_name, argv[arg + 1], main, RefreshCachedIndexes); // Each request is run by main() itself.
+				}
+				else
+				{
+					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
+					return -1;
+				}
+				continue;
+			}
+			else
+			{
+				if (strlen(argv[arg]) > 2) // Multiple arguments after a single '-' not currently supported.
+				{
+					printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, &argv[arg][1]);
+					return -1;
+				}
+
+				switch (c2)
+				{
+					case 'h':
+						PrintUsageAndExit(program_name);
+					case 'x':
+						options.prefix_search = true;
+						break;
+					default:
+						printf("%s: Invalid argument '%c'. Use -h or --help for more details.\n", program_name, c2);
+						return -1;
+				}
+				continue;
+			}
+		}
+		if (!command)
+		{
+			command = argv[arg];
+			continue;
+		}
+		if (!index_file_name)
+		{
+			index_file_name = argv[arg];
+			continue;
+		}
+		if (num_arguments == INDEX_MAX_INPUTS)
+		{
+			printf("%s: Too many arguments (at most %d parsed files can be indexed at once).\n", program_name, INDEX_MAX_INPUTS);
+			return -1;
+		}
+		arguments[num_arguments++] = argv[arg];
+	}
+
+	if (!command || !index_file_name)
+	{
+		printf("%s: Command or index file not specified. Use -h or --help for more details.\n", program_name);
+		return -1;
+	}
+
+	if (strcmp(command, "build") == 0)
+	{
+		if (num_arguments == 0)
+		{
+			printf("No parsed files specified.\n");
+			return -1;
+		}
+		return BuildIndex(index_file_name, arguments, num_arguments);
+	}
+	else if (strcmp(command, "query") == 0)
+	{
+		if (num_arguments != 2)
+		{
+			printf("%s: A query needs a key type and a key. Use -h or --help for more details.\n", program_name);
+			return -1;
+		}
+		for (Index_kind kind = 0; kind < index_kind_count; kind++)
+		{
+			if (strcmp(arguments[0], index_kind_names[kind]) == 0)
+			{
+				return QueryIndex(index_file_name, kind, arguments[1], options);
+			}
+		}
+		printf("%s: Invalid key type '%s'. Use -h or --help for more details.\n", program_name, arguments[0]);
+		return -1;
+	}
+
+	printf("%s: Invalid command '%s'. Use -h or --help for more details.\n", program_name, command);
+	return -1;
+}
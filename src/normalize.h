@@ -0,0 +1,382 @@
+#ifndef NORMALIZE
+#define NORMALIZE
+
+#include <emmintrin.h>
+#include <stddef.h>
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	Cleans up the fields of a batch of parsed records before they are written, one column at a time: each
+	Normalize_step runs its kernel over the same field of every record in the batch (the records are structs,
+	so the field is found at a fixed stride), which keeps the kernel's tables and code hot for the whole column.
+	A report opts in by listing its steps (see the address report in customers.c); adding a column is adding a
+	step.
+
+	Kernels return false when they do not recognize a field, in which case it is left exactly as it was and
+	counted against the step, so the summary can say how many fields still need looking at by hand.
+
+	The kernels:
+	  - Phone numbers become (807) 597-1234, or 597-1234 without an area code. A leading 1 is dropped. Numbers
+	    with fewer than 7 digits are the "(807) 597-" placeholders the report prints for a blank number, and
+	    are dropped.
+	  - Postal codes become A1A 1A1 (upper case, one space) when they are valid Canadian codes; US ZIP codes
+	    are accepted as 12345 or 12345-6789.
+	  - Provinces are upper cased and the old codes (PQ, NF, LB, YK) replaced.
+	  - Names go from the report's upper case to title case: Mc and apostrophes (McDonald, O'Brien) and
+	    hyphenated names are handled, and words without vowels (CN, RBC) are taken to be initials and left
+	    alone.
+
+	Digits are found and letters lower cased 16 bytes at a time with SSE2 compares; everything else is a
+	lookup in one of the tables below.
+*/
+
+typedef bool Normalize_kernel(char* field, size_t field_size);
+
+typedef struct
+{
+	char* name;
+	size_t offset; // Of the field in the record.
+	size_t field_size;
+	Normalize_kernel* kernel;
+	u32 num_unrecognized;
+} Normalize_step;
+
+#define NORMALIZE_STEP(name, record_type, field, kernel) {name, offsetof(record_type, field), sizeof(((record_type*)0)->field), kernel, 0}
+
+// Character classes.
+#define CHARACTER_DIGIT  0x01
+#define CHARACTER_UPPER  0x02
+#define CHARACTER_LOWER  0x04
+#define CHARACTER_VOWEL  0x08
+#define CHARACTER_PHONE  0x10 // Punctuation that can be part of a phone number.
+#define CHARACTER_BREAK  0x20 // Starts a new word (for name casing).
+
+u8 character_classes[256];
+
+// Letters that never appear in Canadian postal codes (and W and Z, which cannot start one).
+char postal_code_excluded_letters[] = "DFIOQU";
+char postal_code_excluded_first_letters[] = "DFIOQUWZ";
+
+char* province_codes[] = {"AB", "BC", "MB", "NB", "NL", "NS", "NT", "NU", "ON", "PE", "QC", "SK", "YT"};
+char* old_province_codes[][2] = {{"PQ", "QC"}, {"NF", "NL"}, {"LB", "NL"}, {"YK", "YT"}};
+char* state_codes[] =
+{
+	"AL", "AK", "AZ", "AR", "CA", "CO", "CT", "DE", "DC", "FL", "GA", "HI", "ID", "IL", "IN", "IA", "KS",
+	"KY", "LA", "ME", "MD", "MA", "MI", "MN", "MS", "MO", "MT", "NE", "NV", "NH", "NJ", "NM", "NY", "NC",
+	"ND", "OH", "OK", "OR", "PA", "RI", "SC", "SD", "TN", "TX", "UT", "VT", "VA", "WA", "WV", "WI", "WY",
+};
+
+void InitNormalizeTables(void)
+{
+	for (u32 character = 0; character < 256; character++)
+	{
+		u8 classes = 0;
+		if (character >= '0' && character <= '9') classes |= CHARACTER_DIGIT;
+		if (character >= 'A' && character <= 'Z') classes |= CHARACTER_UPPER;
+		if (character >= 'a' && character <= 'z') classes |= CHARACTER_LOWER;
+		if (strchr("AEIOUYaeiouy", (int)character) && character) classes |= CHARACTER_VOWEL;
+		if (strchr("()-. ", (int)character) && character) classes |= CHARACTER_PHONE;
+		if (strchr(" -'.&/", (int)character) && character) classes |= CHARACTER_BREAK;
+		character_classes[character] = classes;
+	}
+}
+
+void NormalizeBatch(Normalize_step* steps, u32 num_steps, void* records, u32 count, size_t record_size)
+{
+	for (u32 step_index = 0; step_index < num_steps; step_index++)
+	{
+		Normalize_step* step = &steps[step_index];
+		char* field = (char*)records + step->offset;
+		for (u32 record = 0; record < count; record++)
+		{
+			if (!step->kernel(field, step->field_size))
+			{
+				step->num_unrecognized++;
+			}
+			field += record_size;
+		}
+	}
+}
+
+// Bit mask of the bytes of the 16 at text that are digits.
+u32 DigitMask16(char* text)
+{
+	__m128i characters = _mm_loadu_si128((__m128i*)text);
+	__m128i above = _mm_cmpgt_epi8(characters, _mm_set1_epi8('0' - 1));
+	__m128i below = _mm_cmplt_epi8(characters, _mm_set1_epi8('9' + 1));
+	return (u32)_mm_movemask_epi8(_mm_and_si128(above, below));
+}
+
+// Copies the digits of the field to digits (which must hold field_size bytes), returning how many there were.
+u32 ExtractDigits(char* field, size_t field_size, char* digits)
+{
+	size_t length = strlen(field);
+	u32 num_digits = 0;
+	size_t index = 0;
+	for (; index + 16 <= field_size && index < length; index += 16)
+	{
+		u32 mask = DigitMask16(&field[index]);
+		if (length - index < 16)
+		{
+			mask &= (1u << (length - index)) - 1;
+		}
+		while (mask)
+		{
+			u32 bit = 0;
+			while (!(mask & (1u << bit)))
+			{
+				bit++;
+			}
+			mask &= mask - 1;
+			digits[num_digits++] = field[index + bit];
+		}
+	}
+	for (; index < length; index++)
+	{
+		if (character_classes[(u8)field[index]] & CHARACTER_DIGIT)
+		{
+			digits[num_digits++] = field[index];
+		}
+	}
+	return num_digits;
+}
+
+bool NormalizePhone(char* field, size_t field_size)
+{
+	char digits[64];
+	if (field[0] == '\0' || field_size > sizeof(digits))
+	{
+		return true;
+	}
+
+	u32 num_digits = ExtractDigits(field, field_size, digits);
+	for (char* character = field; *character; character++)
+	{
+		if (!(character_classes[(u8)*character] & (CHARACTER_DIGIT | CHARACTER_PHONE)))
+		{
+			return false; // An extension, a note or a name; leave it to whoever reads it.
+		}
+	}
+
+	char* number = digits;
+	if (num_digits == 11 && digits[0] == '1')
+	{
+		number++;
+		num_digits--;
+	}
+
+	if (num_digits == 10)
+	{
+		sprintf_s(field, field_size, "(%.3s) %.3s-%.4s", number, number + 3, number + 6);
+	}
+	else if (num_digits == 7)
+	{
+		sprintf_s(field, field_size, "%.3s-%.4s", number, number + 3);
+	}
+	else if (num_digits < 7)
+	{
+		field[0] = '\0'; // A placeholder, such as "(807) 597-".
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+bool NormalizePostalCode(char* field, size_t field_size)
+{
+	char code[16];
+	u32 length = 0;
+	for (char* character = field; *character && length < sizeof(code); character++)
+	{
+		u8 classes = character_classes[(u8)*character];
+		if (classes & CHARACTER_LOWER)
+		{
+			code[length++] = *character - ('a' - 'A');
+		}
+		else if (classes & (CHARACTER_UPPER | CHARACTER_DIGIT))
+		{
+			code[length++] = *character;
+		}
+		else if (*character != ' ' && *character != '-')
+		{
+			return false;
+		}
+	}
+	if (length == 0)
+	{
+		return true;
+	}
+
+	// A1A 1A1
+	if (length == 6 && field_size >= 8)
+	{
+		bool valid = !strchr(postal_code_excluded_first_letters, code[0]);
+		for (u32 index = 0; index < 6; index++)
+		{
+			u8 expected = (index % 2) ? CHARACTER_DIGIT : CHARACTER_UPPER;
+			valid &= (character_classes[(u8)code[index]] & expected) != 0;
+			if (index > 0 && !(index % 2))
+			{
+				valid &= !strchr(postal_code_excluded_letters, code[index]);
+			}
+		}
+		if (valid)
+		{
+			sprintf_s(field, field_size, "%.3s %.3s", code, code + 3);
+			return true;
+		}
+	}
+
+	// ZIP and ZIP+4
+	bool all_digits = true;
+	for (u32 index = 0; index < length; index++)
+	{
+		all_digits &= (character_classes[(u8)code[index]] & CHARACTER_DIGIT) != 0;
+	}
+	if (all_digits && length == 5)
+	{
+		sprintf_s(field, field_size, "%.5s", code);
+		return true;
+	}
+	if (all_digits && length == 9 && field_size >= 11)
+	{
+		sprintf_s(field, field_size, "%.5s-%.4s", code, code + 5);
+		return true;
+	}
+	return false;
+}
+
+bool NormalizeProvince(char* field, size_t field_size)
+{
+	if (field[0] == '\0')
+	{
+		return true;
+	}
+	for (char* character = field; *character; character++)
+	{
+		if (character_classes[(u8)*character] & CHARACTER_LOWER)
+		{
+			*character -= 'a' - 'A';
+		}
+	}
+
+	for (u32 code = 0; code < ArrayCount(old_province_codes); code++)
+	{
+		if (strcmp(field, old_province_codes[code][0]) == 0)
+		{
+			strcpy_s(field, field_size, old_province_codes[code][1]);
+			return true;
+		}
+	}
+	for (u32 code = 0; code < ArrayCount(province_codes); code++)
+	{
+		if (strcmp(field, province_codes[code]) == 0)
+		{
+			return true;
+		}
+	}
+	for (u32 code = 0; code < ArrayCount(state_codes); code++)
+	{
+		if (strcmp(field, state_codes[code]) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Lower cases the ASCII letters of the field, 16 at a time.
+void LowerCase(char* field, size_t field_size)
+{
+	size_t index = 0;
+	for (; index + 16 <= field_size; index += 16)
+	{
+		__m128i characters = _mm_loadu_si128((__m128i*)&field[index]);
+		__m128i above = _mm_cmpgt_epi8(characters, _mm_set1_epi8('A' - 1));
+		__m128i below = _mm_cmplt_epi8(characters, _mm_set1_epi8('Z' + 1));
+		__m128i upper = _mm_and_si128(above, below);
+		characters = _mm_add_epi8(characters, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+		_mm_storeu_si128((__m128i*)&field[index], characters);
+	}
+	for (; index < field_size; index++)
+	{
+		if (character_classes[(u8)field[index]] & CHARACTER_UPPER)
+		{
+			field[index] += 'a' - 'A';
+		}
+	}
+}
+
+bool NormalizeNameCase(char* field, size_t field_size)
+{
+	// Only names that are all upper case (as ProfitMaster prints them) are changed; anything with a lower
+	// case letter was typed that way on purpose.
+	for (char* character = field; *character; character++)
+	{
+		if (character_classes[(u8)*character] & CHARACTER_LOWER)
+		{
+			return true;
+		}
+	}
+
+	char original[64];
+	if (field_size > sizeof(original))
+	{
+		return false;
+	}
+	memcpy(original, field, field_size);
+	LowerCase(field, field_size);
+
+	size_t word_start = 0;
+	for (size_t index = 0; ; index++)
+	{
+		char character = field[index];
+		if (character != '\0' && !(character_classes[(u8)character] & CHARACTER_BREAK))
+		{
+			continue;
+		}
+
+		// The word is field[word_start, index).
+		size_t word_length = index - word_start;
+		if (word_length > 0)
+		{
+			bool has_vowel = false;
+			for (size_t letter = word_start; letter < index; letter++)
+			{
+				has_vowel |= (character_classes[(u8)field[letter]] & CHARACTER_VOWEL) != 0;
+			}
+			bool has_letter = false;
+			for (size_t letter = word_start; letter < index; letter++)
+			{
+				has_letter |= (character_classes[(u8)field[letter]] & CHARACTER_LOWER) != 0;
+			}
+
+			if (has_letter && !has_vowel)
+			{
+				memcpy(&field[word_start], &original[word_start], word_length); // Initials.
+			}
+			else if (character_classes[(u8)field[word_start]] & CHARACTER_LOWER)
+			{
+				field[word_start] -= 'a' - 'A';
+				if (word_length > 2 && field[word_start] == 'M' && field[word_start + 1] == 'c' &&
+					(character_classes[(u8)field[word_start + 2]] & CHARACTER_LOWER))
+				{
+					field[word_start + 2] -= 'a' - 'A';
+				}
+			}
+		}
+		if (character == '\0')
+		{
+			break;
+		}
+		word_start = index + 1;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,892 @@
+#ifndef PLATFORM
+#define PLATFORM
+
+/*	NOTES
+	=====
+
+	Everything the tools need from the operating system goes through this file, so the rest of the code is the
+	same on Windows (MSVC, build.bat) and Linux (gcc or clang, build.sh):
+
+	- Memory:   AllocateMemory() and FreeFileMemory(); memory always comes back zeroed.
+	- Files:    ReadEntireFile(), ReadFileStart() and ReadFileRange(), GetFileSize64() and GetFileWriteTime(),
+	            MapEntireFile() and UnmapFile(), MakeDirectory(), MoveOverFile(), IsSameFile(), and the regular
+	            files in a directory (OpenDirectoryListing(), NextDirectoryFile() and CloseDirectoryListing()).
+	- Time:     ReadTimer() and TicksToSeconds().
+	- Threads:  one worker thread that can be told to stop (StartWorkerThread(), WaitForStopRequest() and
+	            StopWorkerThread()), and unordered 64-bit loads and stores for counters shared with it.
+	- Console:  StderrIsConsole().
+	- Commands: OpenCommandPipe() and CloseCommandPipe() run a command and read its output, and
+	            StartProgram() and FinishProgram() do the same for a program and its arguments, without a shell.
+	- Watching: StartDirectoryWatch(), WaitForDirectoryChange() and StopDirectoryWatch() wait for files in a
+	            directory to be created, written to or renamed (inotify on Linux, change notifications on Windows).
+
+	On Linux the bounds-checked CRT functions the code uses (sprintf_s, strcpy_s and fopen_s) are provided here
+	too, as is __debugbreak() for the assert macro in DEBUG builds.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#	include <windows.h>
+#	include <fcntl.h>
+#	include <io.h>
+#else
+#	include <dirent.h>
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <pthread.h>
+#	include <sys/inotify.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <sys/wait.h>
+#	include <time.h>
+#	include <unistd.h>
+
+typedef int errno_t;
+
+#	define sprintf_s snprintf
+#	define __debugbreak() __builtin_trap()
+
+errno_t fopen_s(FILE** file, const char* file_name, const char* mode)
+{
+	*file = fopen(file_name, mode);
+	return *file ? 0 : errno;
+}
+
+// Unlike the CRT version, which aborts, a source too long for the destination is truncated.
+errno_t strcpy_s(char* destination, size_t size, const char* source)
+{
+	if (!destination || size == 0)
+	{
+		return EINVAL;
+	}
+	size_t length = strlen(source);
+	if (length >= size)
+	{
+		length = size - 1;
+	}
+	memcpy(destination, source, length);
+	destination[length] = '\0';
+	return 0;
+}
+#endif
+
+#include "utils.h"
+
+//
+// Memory
+//
+
+void* AllocateMemory(size_t size)
+{
+#if defined(_WIN32)
+	return VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	return calloc(1, size ? size : 1);
+#endif
+}
+
+void FreeFileMemory(void* memory)
+{
+	if (memory)
+	{
+#if defined(_WIN32)
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		free(memory);
+#endif
+	}
+}
+
+//
+// Files
+//
+
+u64 GetFileSize64(char* file_name)
+{
+	u64 size = 0;
+#if defined(_WIN32)
+	HANDLE file_handle = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER file_size;
+		if (GetFileSizeEx(file_handle, &file_size))
+		{
+			size = (u64)file_size.QuadPart;
+		}
+		CloseHandle(file_handle);
+	}
+#else
+	struct stat file_status;
+	if (stat(file_name, &file_status) == 0)
+	{
+		size = (u64)file_status.st_size;
+	}
+#endif
+	return size;
+}
+
+// An opaque stamp of when the file was last written (0 if it does not exist), to tell whether it has changed.
+u64 GetFileWriteTime(char* file_name)
+{
+	u64 time = 0;
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (GetFileAttributesExA(file_name, GetFileExInfoStandard, &attributes))
+	{
+		time = ((u64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	}
+#else
+	struct stat file_status;
+	if (stat(file_name, &file_status) == 0)
+	{
+		time = (u64)file_status.st_mtim.tv_sec * 1000000000 + (u64)file_status.st_mtim.tv_nsec;
+	}
+#endif
+	return time;
+}
+
+#define FILE_PADDING 16
+
+char* ReadEntireFile(char* file_name)
+{
+	char* data = NULL;
+
+#if defined(_WIN32)
+	HANDLE file_handle = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (file_handle == INVALID_HANDLE_VALUE)
+	{
+		return NULL;
+	}
+
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file_handle, &file_size))
+	{
+		u32 file_size_32bits = TruncateUnsignedI64(file_size.QuadPart);
+		// FILE_PADDING extra (zeroed) bytes so the parsers can rely on the data being terminated, and can load
+		// 16 bytes at a time up to the end of it.
+		data = (char*)AllocateMemory(file_size_32bits + FILE_PADDING);
+		if (data)
+		{
+			DWORD bytes_read = 0;
+			if (ReadFile(file_handle, data, file_size_32bits, &bytes_read, 0) && (file_size_32bits == bytes_read))
+			{
+				// success
+			}
+			else
+			{
+				FreeFileMemory(data);
+				data = NULL;
+			}
+		}
+
+		CloseHandle(file_handle);
+	}
+#else
+	int file_descriptor = open(file_name, O_RDONLY);
+	if (file_descriptor < 0)
+	{
+		return NULL;
+	}
+
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) == 0)
+	{
+		size_t file_size = (size_t)file_status.st_size;
+		// FILE_PADDING extra (zeroed) bytes so the parsers can rely on the data being terminated, and can load
+		// 16 bytes at a time up to the end of it.
+		data = (char*)AllocateMemory(file_size + FILE_PADDING);
+		size_t total_read = 0;
+		while (data && total_read < file_size)
+		{
+			ssize_t bytes_read = read(file_descriptor, data + total_read, file_size - total_read);
+			if (bytes_read <= 0)
+			{
+				FreeFileMemory(data);
+				data = NULL;
+				break;
+			}
+			total_read += (size_t)bytes_read;
+		}
+	}
+
+	close(file_descriptor);
+#endif
+
+	return data;
+}
+
+// Reads up to size bytes from the start of the file, e.g. to tell what kind of file it is without reading
+// all of it. Returns the number of bytes read (0 if the file could not be opened).
+size_t ReadFileStart(char* file_name, char* buffer, size_t size)
+{
+	FILE* file;
+	if (fopen_s(&file, file_name, "rb"))
+	{
+		return 0;
+	}
+	size_t bytes_read = fread(buffer, 1, size, file);
+	fclose(file);
+	return bytes_read;
+}
+
+// Reads up to size bytes from offset on, e.g. what has been added to a file that is still being written.
+// Returns the number of bytes read (0 if the file could not be opened or is not that long).
+size_t ReadFileRange(char* file_name, u64 offset, char* buffer, size_t size)
+{
+	FILE* file;
+	if (fopen_s(&file, file_name, "rb"))
+	{
+		return 0;
+	}
+	size_t bytes_read = 0;
+#if defined(_WIN32)
+	if (_fseeki64(file, (i64)offset, SEEK_SET) == 0)
+#else
+	if (fseeko(file, (off_t)offset, SEEK_SET) == 0)
+#endif
+	{
+		bytes_read = fread(buffer, 1, size, file);
+	}
+	fclose(file);
+	return bytes_read;
+}
+
+typedef struct Mapped_file
+{
+	char* data;
+	u64 size;
+} Mapped_file;
+
+// Maps a file read-only into memory. Unlike ReadEntireFile() nothing is copied, so this is what we use
+// for the large, persistent files (i.e. lookup indexes) that are only ever read.
+Mapped_file MapEntireFile(char* file_name)
+{
+	Mapped_file result = {0};
+
+#if defined(_WIN32)
+	HANDLE file_handle = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (file_handle == INVALID_HANDLE_VALUE)
+	{
+		return result;
+	}
+
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file_handle, &file_size) && (file_size.QuadPart > 0)) // Empty files cannot be mapped.
+	{
+		HANDLE mapping_handle = CreateFileMappingA(file_handle, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping_handle)
+		{
+			result.data = (char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+			if (result.data)
+			{
+				result.size = (u64)file_size.QuadPart;
+			}
+			CloseHandle(mapping_handle); // The view keeps the mapping alive.
+		}
+	}
+
+	CloseHandle(file_handle);
+#else
+	int file_descriptor = open(file_name, O_RDONLY);
+	if (file_descriptor < 0)
+	{
+		return result;
+	}
+
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) == 0 && file_status.st_size > 0) // Empty files cannot be mapped.
+	{
+		void* view = mmap(0, (size_t)file_status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+		if (view != MAP_FAILED)
+		{
+			result.data = (char*)view;
+			result.size = (u64)file_status.st_size;
+		}
+	}
+
+	close(file_descriptor); // The mapping stays valid.
+#endif
+
+	return result;
+}
+
+void UnmapFile(Mapped_file* file)
+{
+	if (file->data)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(file->data);
+#else
+		munmap(file->data, (size_t)file->size);
+#endif
+	}
+	file->data = NULL;
+	file->size = 0;
+}
+
+// Fails harmlessly if the directory already exists.
+bool MakeDirectory(char* path)
+{
+#if defined(_WIN32)
+	return CreateDirectoryA(path, NULL) != 0;
+#else
+	return mkdir(path, 0777) == 0;
+#endif
+}
+
+// Renames from_name to to_name, replacing to_name if it exists (which rename() does not do on Windows).
+bool MoveOverFile(char* from_name, char* to_name)
+{
+#if defined(_WIN32)
+	return MoveFileExA(from_name, to_name, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from_name, to_name) == 0;
+#endif
+}
+
+// Whether the two paths lead to the same file or directory, however they are written (links, "dir/.", ...).
+bool IsSameFile(char* path_a, char* path_b)
+{
+#if defined(_WIN32)
+	BY_HANDLE_FILE_INFORMATION information[2];
+	char* paths[2] = {path_a, path_b};
+	for (u32 index = 0; index < 2; index++)
+	{
+		// FILE_FLAG_BACKUP_SEMANTICS is what lets a directory be opened.
+		HANDLE handle = CreateFileA(paths[index], 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING,
+				FILE_FLAG_BACKUP_SEMANTICS, 0);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		BOOL found = GetFileInformationByHandle(handle, &information[index]);
+		CloseHandle(handle);
+		if (!found)
+		{
+			return false;
+		}
+	}
+	return information[0].dwVolumeSerialNumber == information[1].dwVolumeSerialNumber &&
+			information[0].nFileIndexHigh == information[1].nFileIndexHigh &&
+			information[0].nFileIndexLow == information[1].nFileIndexLow;
+#else
+	struct stat status_a, status_b;
+	return stat(path_a, &status_a) == 0 && stat(path_b, &status_b) == 0 &&
+			status_a.st_dev == status_b.st_dev && status_a.st_ino == status_b.st_ino;
+#endif
+}
+
+#define MAX_FILE_NAME_LENGTH 260
+
+typedef struct
+{
+#if defined(_WIN32)
+	HANDLE find_handle;
+	WIN32_FIND_DATAA find_data;
+	bool has_next;
+#else
+	DIR* directory;
+	char path[1024];
+#endif
+	char file_name[MAX_FILE_NAME_LENGTH];
+} Directory_listing;
+
+bool OpenDirectoryListing(Directory_listing* listing, char* path)
+{
+	memset(listing, 0, sizeof(*listing));
+#if defined(_WIN32)
+	char pattern[MAX_PATH];
+	sprintf_s(pattern, sizeof(pattern), "%s\\*", path);
+	listing->find_handle = FindFirstFileA(pattern, &listing->find_data);
+	listing->has_next = (listing->find_handle != INVALID_HANDLE_VALUE);
+	return listing->has_next;
+#else
+	strcpy_s(listing->path, sizeof(listing->path), path);
+	listing->directory = opendir(path);
+	return listing->directory != NULL;
+#endif
+}
+
+// The name of the next regular file in the directory (not a path), or NULL when there are no more. The name
+// is overwritten by the next call.
+char* NextDirectoryFile(Directory_listing* listing)
+{
+#if defined(_WIN32)
+	while (listing->has_next)
+	{
+		WIN32_FIND_DATAA* data = &listing->find_data;
+		bool is_file = !(data->dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_DEVICE));
+		strcpy_s(listing->file_name, sizeof(listing->file_name), data->cFileName);
+		listing->has_next = FindNextFileA(listing->find_handle, data) != 0;
+		if (is_file)
+		{
+			return listing->file_name;
+		}
+	}
+#else
+	struct dirent* entry;
+	while (listing->directory && (entry = readdir(listing->directory)) != NULL)
+	{
+		char file_path[sizeof(listing->path) + MAX_FILE_NAME_LENGTH];
+		sprintf_s(file_path, sizeof(file_path), "%s/%s", listing->path, entry->d_name);
+		struct stat file_status;
+		if (stat(file_path, &file_status) == 0 && S_ISREG(file_status.st_mode))
+		{
+			strcpy_s(listing->file_name, sizeof(listing->file_name), entry->d_name);
+			return listing->file_name;
+		}
+	}
+#endif
+	return NULL;
+}
+
+void CloseDirectoryListing(Directory_listing* listing)
+{
+#if defined(_WIN32)
+	if (listing->find_handle != INVALID_HANDLE_VALUE && listing->find_handle)
+	{
+		FindClose(listing->find_handle);
+	}
+#else
+	if (listing->directory)
+	{
+		closedir(listing->directory);
+	}
+#endif
+	memset(listing, 0, sizeof(*listing));
+}
+
+//
+// Time
+//
+
+u64 ReadTimer(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (u64)counter.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+#endif
+}
+
+double TicksToSeconds(u64 ticks)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (double)ticks / (double)frequency.QuadPart;
+#else
+	return (double)ticks / 1e9;
+#endif
+}
+
+//
+// Threads
+//
+
+typedef void Worker_function(void* parameter);
+
+typedef struct Worker_thread
+{
+	Worker_function* function;
+	void* parameter;
+#if defined(_WIN32)
+	HANDLE thread;
+	HANDLE stop_event;
+#else
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t stop_condition;
+	bool stop_requested;
+#endif
+} Worker_thread;
+
+#if defined(_WIN32)
+DWORD WINAPI WorkerThreadEntry(void* parameter)
+{
+	Worker_thread* worker = (Worker_thread*)parameter;
+	worker->function(worker->parameter);
+	return 0;
+}
+#else
+void* WorkerThreadEntry(void* parameter)
+{
+	Worker_thread* worker = (Worker_thread*)parameter;
+	worker->function(worker->parameter);
+	return NULL;
+}
+#endif
+
+bool StartWorkerThread(Worker_thread* worker, Worker_function* function, void* parameter)
+{
+	worker->function = function;
+	worker->parameter = parameter;
+
+#if defined(_WIN32)
+	worker->stop_event = CreateEventA(0, TRUE, FALSE, 0);
+	if (!worker->stop_event)
+	{
+		return false;
+	}
+	worker->thread = CreateThread(0, 0, WorkerThreadEntry, worker, 0, 0);
+	if (!worker->thread)
+	{
+		CloseHandle(worker->stop_event);
+		return false;
+	}
+#else
+	worker->stop_requested = false;
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&worker->stop_condition, &attributes);
+	pthread_condattr_destroy(&attributes);
+	pthread_mutex_init(&worker->mutex, NULL);
+	if (pthread_create(&worker->thread, NULL, WorkerThreadEntry, worker) != 0)
+	{
+		pthread_cond_destroy(&worker->stop_condition);
+		pthread_mutex_destroy(&worker->mutex);
+		return false;
+	}
+#endif
+	return true;
+}
+
+// Called by the worker. Waits for up to the given time and returns true once the worker has been asked to stop.
+bool WaitForStopRequest(Worker_thread* worker, u32 milliseconds)
+{
+#if defined(_WIN32)
+	return WaitForSingleObject(worker->stop_event, milliseconds) != WAIT_TIMEOUT;
+#else
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&worker->mutex);
+	while (!worker->stop_requested)
+	{
+		if (pthread_cond_timedwait(&worker->stop_condition, &worker->mutex, &deadline) != 0)
+		{
+			break; // Timed out.
+		}
+	}
+	bool stop_requested = worker->stop_requested;
+	pthread_mutex_unlock(&worker->mutex);
+	return stop_requested;
+#endif
+}
+
+// Asks the worker to stop and waits for it to finish.
+void StopWorkerThread(Worker_thread* worker)
+{
+#if defined(_WIN32)
+	SetEvent(worker->stop_event);
+	WaitForSingleObject(worker->thread, INFINITE);
+	CloseHandle(worker->thread);
+	CloseHandle(worker->stop_event);
+#else
+	pthread_mutex_lock(&worker->mutex);
+	worker->stop_requested = true;
+	pthread_cond_signal(&worker->stop_condition);
+	pthread_mutex_unlock(&worker->mutex);
+	pthread_join(worker->thread, NULL);
+	pthread_cond_destroy(&worker->stop_condition);
+	pthread_mutex_destroy(&worker->mutex);
+#endif
+}
+
+// For a counter with a single writer that other threads only ever read as a whole: no ordering, no fence.
+void StoreRelaxed64(volatile i64* target, i64 value)
+{
+#if defined(_WIN32)
+	WriteNoFence64(target, value);
+#else
+	__atomic_store_n(target, value, __ATOMIC_RELAXED);
+#endif
+}
+
+i64 LoadRelaxed64(volatile i64* source)
+{
+#if defined(_WIN32)
+	return ReadNoFence64(source);
+#else
+	return __atomic_load_n(source, __ATOMIC_RELAXED);
+#endif
+}
+
+//
+// Console
+//
+
+bool StderrIsConsole(void)
+{
+#if defined(_WIN32)
+	return GetFileType(GetStdHandle(STD_ERROR_HANDLE)) == FILE_TYPE_CHAR;
+#else
+	return isatty(STDERR_FILENO) != 0;
+#endif
+}
+
+//
+// Commands
+//
+
+// Runs a command through the shell and returns a stream of its standard output, or NULL.
+FILE* OpenCommandPipe(char* command)
+{
+#if defined(_WIN32)
+	// cmd.exe strips the first and last quote of a command line that starts with one, so the whole command
+	// is wrapped in another pair to keep the quotes around the tool and file names.
+	char quoted_command[8192];
+	sprintf_s(quoted_command, sizeof(quoted_command), "\"%s\"", command);
+	return _popen(quoted_command, "r");
+#else
+	return popen(command, "r");
+#endif
+}
+
+// Returns the command's exit status (0 for success).
+int CloseCommandPipe(FILE* pipe)
+{
+#if defined(_WIN32)
+	return _pclose(pipe);
+#else
+	int status = pclose(pipe);
+	return (status != -1 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
+typedef struct
+{
+	FILE* output; // What the program writes to its standard output.
+#if defined(_WIN32)
+	HANDLE process;
+#else
+	pid_t process;
+#endif
+} Program_process;
+
+#if defined(_WIN32)
+// Adds the argument to the command line, quoted the way the C runtime of the program splits it back out:
+// backslashes are doubled only where they come before a quote, and quotes are escaped.
+bool AppendQuotedArgument(char* command_line, size_t size, char* argument)
+{
+	size_t used = strlen(command_line);
+	size_t needed = used + 2 * strlen(argument) + 4;
+	if (needed > size)
+	{
+		return false;
+	}
+	if (used)
+	{
+		command_line[used++] = ' ';
+	}
+	command_line[used++] = '"';
+	for (char* character = argument;; character++)
+	{
+		u32 backslashes = 0;
+		while (*character == '\\')
+		{
+			backslashes++;
+			character++;
+		}
+		bool before_quote = (*character == '"' || *character == '\0');
+		for (u32 count = before_quote ? 2 * backslashes : backslashes; count > 0; count--)
+		{
+			command_line[used++] = '\\';
+		}
+		if (*character == '\0')
+		{
+			break;
+		}
+		if (*character == '"')
+		{
+			command_line[used++] = '\\';
+		}
+		command_line[used++] = *character;
+	}
+	command_line[used++] = '"';
+	command_line[used] = '\0';
+	return true;
+}
+#endif
+
+// Starts the program arguments[0] with the rest of the arguments (ending with NULL) as they are, without a shell,
+// so that nothing in them (quotes, $(...), %...%) is interpreted. Returns false if it could not be started.
+bool StartProgram(Program_process* program, char** arguments)
+{
+#if defined(_WIN32)
+	char command_line[8192] = "";
+	for (char** argument = arguments; *argument; argument++)
+	{
+		if (!AppendQuotedArgument(command_line, sizeof(command_line), *argument))
+		{
+			return false;
+		}
+	}
+
+	SECURITY_ATTRIBUTES security = {sizeof(security), NULL, TRUE};
+	HANDLE read_end, write_end;
+	if (!CreatePipe(&read_end, &write_end, &security, 0))
+	{
+		return false;
+	}
+	SetHandleInformation(read_end, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOA startup = {sizeof(startup)};
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+	startup.hStdOutput = write_end;
+	startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION information;
+	BOOL started = CreateProcessA(NULL, command_line, NULL, NULL, TRUE, 0, NULL, NULL, &startup, &information);
+	CloseHandle(write_end);
+	if (!started)
+	{
+		CloseHandle(read_end);
+		return false;
+	}
+	CloseHandle(information.hThread);
+	program->process = information.hProcess;
+	program->output = _fdopen(_open_osfhandle((intptr_t)read_end, _O_RDONLY), "r");
+#else
+	int pipe_ends[2];
+	if (pipe(pipe_ends) != 0)
+	{
+		return false;
+	}
+	pid_t process = fork();
+	if (process < 0)
+	{
+		close(pipe_ends[0]);
+		close(pipe_ends[1]);
+		return false;
+	}
+	if (process == 0)
+	{
+		dup2(pipe_ends[1], STDOUT_FILENO);
+		close(pipe_ends[0]);
+		close(pipe_ends[1]);
+		execvp(arguments[0], arguments);
+		_exit(127);
+	}
+	close(pipe_ends[1]);
+	program->process = process;
+	program->output = fdopen(pipe_ends[0], "r");
+#endif
+	return program->output != NULL;
+}
+
+// Waits for the program to end once its output has been read. Returns its exit status (0 for success).
+int FinishProgram(Program_process* program)
+{
+	if (program->output)
+	{
+		fclose(program->output);
+	}
+#if defined(_WIN32)
+	DWORD exit_code = (DWORD)-1;
+	WaitForSingleObject(program->process, INFINITE);
+	GetExitCodeProcess(program->process, &exit_code);
+	CloseHandle(program->process);
+	return (int)exit_code;
+#else
+	int status;
+	while (waitpid(program->process, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			return -1;
+		}
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
+//
+// Watching
+//
+
+typedef struct
+{
+#if defined(_WIN32)
+	HANDLE change_handle;
+#else
+	int inotify_descriptor;
+#endif
+} Directory_watch;
+
+bool StartDirectoryWatch(Directory_watch* watch, char* path)
+{
+#if defined(_WIN32)
+	DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+	watch->change_handle = FindFirstChangeNotificationA(path, FALSE, filter);
+	return watch->change_handle != INVALID_HANDLE_VALUE;
+#else
+	watch->inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->inotify_descriptor < 0)
+	{
+		return false;
+	}
+	u32 mask = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO;
+	if (inotify_add_watch(watch->inotify_descriptor, path, mask) < 0)
+	{
+		close(watch->inotify_descriptor);
+		watch->inotify_descriptor = -1;
+		return false;
+	}
+	return true;
+#endif
+}
+
+// Waits for up to the given time for a file in the directory to change. Returns true if one did. Which file
+// changed is not said (the caller looks at them all again), so any number of changes count as one.
+bool WaitForDirectoryChange(Directory_watch* watch, u32 milliseconds)
+{
+#if defined(_WIN32)
+	if (WaitForSingleObject(watch->change_handle, milliseconds) != WAIT_OBJECT_0)
+	{
+		return false;
+	}
+	FindNextChangeNotification(watch->change_handle);
+	return true;
+#else
+	struct pollfd poll_descriptor = {watch->inotify_descriptor, POLLIN, 0};
+	if (poll(&poll_descriptor, 1, (int)milliseconds) <= 0)
+	{
+		return false;
+	}
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (read(watch->inotify_descriptor, events, sizeof(events)) > 0)
+	{
+		// Drained; the events themselves are not needed.
+	}
+	return true;
+#endif
+}
+
+void StopDirectoryWatch(Directory_watch* watch)
+{
+#if defined(_WIN32)
+	FindCloseChangeNotification(watch->change_handle);
+#else
+	close(watch->inotify_descriptor);
+#endif
+}
+
+#endif
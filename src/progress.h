@@ -0,0 +1,100 @@
+#ifndef PROGRESS
+#define PROGRESS
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	The parser publishes how far it has got (bytes and records) each time it reaches a page header, and a
+	side thread samples those counters four times a second to show the percentage done, the current speed and
+	an estimate of the time left on stderr. Pages are a few dozen lines long, so the parser pays for two plain
+	stores every few KB and never waits on the reporter.
+
+	The counters have a single writer and are only ever read as a whole, so unordered (no fence) 64-bit loads
+	and stores are all that is needed.
+
+	Nothing is shown for the first second, so small reports finish without any progress output at all.
+*/
+
+#define PROGRESS_SAMPLE_MILLISECONDS 250
+#define PROGRESS_DELAY_SAMPLES 4
+
+typedef struct Progress
+{
+	volatile i64 bytes_done;
+	volatile i64 records_done;
+	u64 total_bytes;
+	Worker_thread worker;
+	bool shown;
+} Progress;
+
+void UpdateProgress(Progress* progress, u64 bytes_done, u64 records_done)
+{
+	if (progress)
+	{
+		StoreRelaxed64(&progress->bytes_done, (i64)bytes_done);
+		StoreRelaxed64(&progress->records_done, (i64)records_done);
+	}
+}
+
+void ProgressThread(void* parameter)
+{
+	Progress* progress = (Progress*)parameter;
+	double seconds_per_sample = PROGRESS_SAMPLE_MILLISECONDS / 1000.0;
+	double bytes_per_second = 0.0;
+	u64 last_bytes = 0;
+	u32 samples = 0;
+
+	while (!WaitForStopRequest(&progress->worker, PROGRESS_SAMPLE_MILLISECONDS))
+	{
+		u64 bytes_done = (u64)LoadRelaxed64(&progress->bytes_done);
+		u64 records_done = (u64)LoadRelaxed64(&progress->records_done);
+
+		// Smooth the speed so the estimate does not jump around from one page to the next.
+		double sample_rate = (double)(bytes_done - last_bytes) / seconds_per_sample;
+		bytes_per_second = samples ? 0.7 * bytes_per_second + 0.3 * sample_rate : sample_rate;
+		last_bytes = bytes_done;
+
+		if (++samples < PROGRESS_DELAY_SAMPLES || progress->total_bytes == 0)
+		{
+			continue;
+		}
+
+		double percent = 100.0 * (double)bytes_done / (double)progress->total_bytes;
+		u32 seconds_left = 0;
+		if (bytes_per_second > 0.0)
+		{
+			seconds_left = (u32)((double)(progress->total_bytes - MIN(bytes_done, progress->total_bytes)) / bytes_per_second);
+		}
+
+		fprintf(stderr, "\r%5.1f%%  %llu records  %.1f MB/s  ETA %u:%02u   ",
+				percent, (unsigned long long)records_done, bytes_per_second / (1024.0 * 1024.0), seconds_left / 60, seconds_left % 60);
+		fflush(stderr);
+		progress->shown = true;
+	}
+}
+
+bool StartProgress(Progress* progress, u64 total_bytes)
+{
+	progress->bytes_done = 0;
+	progress->records_done = 0;
+	progress->total_bytes = total_bytes;
+	progress->shown = false;
+
+	return StartWorkerThread(&progress->worker, ProgressThread, progress);
+}
+
+// Stops the reporter and clears its line, so the summary that follows starts on a clean line.
+void StopProgress(Progress* progress)
+{
+	StopWorkerThread(&progress->worker);
+
+	if (progress->shown)
+	{
+		fprintf(stderr, "\r%60s\r", "");
+		fflush(stderr);
+	}
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef RECONCILE
+#define RECONCILE
+
+#include "utils.h"
+
+/*	NOTES
+	=====
+
+	Every report ends with its totals, and every tool checks what it parsed against them, instead of that being
+	left to someone comparing the summary with the bottom of the report:
+	  - The number of records, in all the reports.
+	  - The sum of an amount, where the report has one: the balance of all the accounts (IRL account listing),
+	    and the balance of each account in the trial balance (RRT, the account total lines, which have the '.' of
+	    an amount in the invoice column). Amounts are added up in cents (see ParseMoneyCents()), so the sums
+	    are exact.
+
+	The totals are not looked for by the words in front of them, which are not the same from one version of
+	ProfitMaster to the next. Each parser already stops at the end of its report, and reads them from there:
+	a total is the number at the end of its line.
+	  - IRK: the line after the '-' rule under the last class.
+	  - IRX and IRH: the line after the '=' rule under the last product.
+	  - IRL: the account count is on the 69-column summary line (the balance on the line after it), the address
+	    count on the summary line in place of the next account, and the memo count on the last line that starts
+	    in the first column (the memos themselves are indented).
+	  - RRT: the Cust Loc line.
+	The same places are where the watch tool looks for the end of a report (see IsReportFooter() in sniff.h).
+
+	A total that does not match is printed with both numbers, and the run fails (returns -1) once the output has
+	been written, so that a script converting a batch of reports (or watch) stops at the one to look at. So does
+	a report whose count is missing (a transfer that broke off, or a report the parser lost its way in), unless
+	--allow-missing-totals is given for reports from an old version of ProfitMaster that does not print them. A
+	missing amount is only skipped, as the TOTAL BALANCE line is sometimes left blank.
+*/
+
+typedef enum
+{
+	total_count,
+	total_amount // In cents.
+} Total_kind;
+
+typedef struct Footer_total
+{
+	Total_kind kind;
+	bool found;
+	i64 value;
+} Footer_total;
+
+// The length of the line starting at `line`, up to its '\n' or the end of the report.
+size_t FooterLineLength(char* line)
+{
+	size_t length = 0;
+	while (line[length] && line[length] != '\n')
+	{
+		length++;
+	}
+	return length;
+}
+
+// The first line after `line` that is not blank, or NULL if the report ends first.
+char* NextFooterLine(char* line)
+{
+	while (*line)
+	{
+		line += FooterLineLength(line);
+		if (*line == '\n')
+		{
+			line++;
+		}
+		size_t length = FooterLineLength(line);
+		for (size_t index = 0; index < length; index++)
+		{
+			if (line[index] != ' ' && line[index] != '\r')
+			{
+				return line;
+			}
+		}
+	}
+	return NULL;
+}
+
+// The start of the last line of the report (size bytes long) that is not blank, or NULL if it is all blank.
+char* LastFooterLine(char* data, size_t size)
+{
+	char* last_line = NULL;
+	size_t index = size;
+	while (index > 0 && !last_line)
+	{
+		size_t line_end = index;
+		while (index > 0 && data[index - 1] != '\n')
+		{
+			index--;
+		}
+		for (size_t character = index; character < line_end; character++)
+		{
+			if (data[character] != ' ' && data[character] != '\r')
+			{
+				last_line = &data[index];
+				break;
+			}
+		}
+		if (index > 0)
+		{
+			index--; // Past the '\n' before the line.
+		}
+	}
+	return last_line;
+}
+
+// True if the line is a rule of `rule` characters (like the '=' rule above the IRH totals).
+bool LineIsRule(char* line, size_t length, char rule)
+{
+	while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\r'))
+	{
+		length--;
+	}
+	if (length < 20)
+	{
+		return false;
+	}
+	for (size_t index = 0; index < length; index++)
+	{
+		if (line[index] != rule)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Reads the total at the end of a footer line (length bytes long): its last word, which must be a whole number
+// for a count.
+Footer_total ReadLineTotal(char* line, size_t length, Total_kind kind)
+{
+	Footer_total total = {kind, false, 0};
+	while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\r'))
+	{
+		length--;
+	}
+	size_t start = length;
+	while (start > 0 && line[start - 1] != ' ' && line[start - 1] != ':')
+	{
+		start--;
+	}
+
+	char number[32];
+	size_t number_length = length - start;
+	if (number_length == 0 || number_length >= sizeof(number))
+	{
+		return total;
+	}
+	memcpy(number, &line[start], number_length);
+	number[number_length] = '\0';
+
+	if (kind == total_amount)
+	{
+		total.found = ParseMoneyCents(number, &total.value);
+	}
+	else if (number[0] >= '0' && number[0] <= '9')
+	{
+		char* number_end;
+		total.value = strtoll(number, &number_end, 10);
+		total.found = (*number_end == '\0');
+	}
+	return total;
+}
+
+// Reads the total at the end of the footer line starting at `line` (NULL if the report has no such line).
+Footer_total ReadFooterTotal(char* line, Total_kind kind)
+{
+	if (!line)
+	{
+		Footer_total total = {kind, false, 0};
+		return total;
+	}
+	return ReadLineTotal(line, FooterLineLength(line), kind);
+}
+
+void FormatTotal(char* text, size_t size, Total_kind kind, i64 value)
+{
+	if (kind == total_amount)
+	{
+		i64 magnitude = (value < 0) ? -value : value;
+		sprintf_s(text, size, "%s%lld.%02lld", (value < 0) ? "-" : "", (long long)(magnitude / 100), (long long)(magnitude % 100));
+	}
+	else
+	{
+		sprintf_s(text, size, "%lld", (long long)value);
+	}
+}
+
+// Prints how the parsed total (what `name` says, e.g. "number of classes") compares with the report's. Returns false if
+// they do not match, or if the report has no such total and that is not allowed.
+bool ReconcileTotal(Footer_total total, char* name, i64 parsed, bool allow_missing)
+{
+	char report_text[32];
+	char parsed_text[32];
+	FormatTotal(report_text, sizeof(report_text), total.kind, total.value);
+	FormatTotal(parsed_text, sizeof(parsed_text), total.kind, parsed);
+
+	if (!total.found)
+	{
+		if (total.kind == total_amount)
+		{
+			return true;
+		}
+		if (allow_missing)
+		{
+			printf("Warning: The report gives no %s at its end to check the parse against. It may not have been transferred in full.\n", name);
+			return true;
+		}
+		printf("Error: The report gives no %s at its end to check the parse against. It may not have been transferred in full "
+			   "(use --allow-missing-totals if it comes from a version of ProfitMaster that does not print it).\n", name);
+		return false;
+	}
+	if (total.value != parsed)
+	{
+		printf("Error: The report's %s is %s, but the parse came to %s.\n", name, report_text, parsed_text);
+		return false;
+	}
+	printf("Matches the report's %s (%s).\n", name, report_text);
+	return true;
+}
+
+#endif
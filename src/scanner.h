@@ -0,0 +1,189 @@
+#ifndef SCANNER
+#define SCANNER
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	Finds any number of fixed patterns in one pass over a piece of text, however many patterns there are.
+	The patterns are compiled once (Aho-Corasick) into a DFA: a transition table indexed by state and input
+	symbol, with the failure links already folded in, so scanning is one table lookup per byte and never backs
+	up.
+
+	Bytes are first mapped to a small alphabet of symbols, which keeps the table small and makes the patterns a
+	little more general than plain strings:
+	  - letters match either case ('A' to 'Z' in a pattern)
+	  - digits match any digit
+	  - ' ' matches any byte that is not a letter, a digit or one of the punctuation marks below
+	  - '@', '#', '.' and '-' match themselves
+	so "STATUS #" finds "Status #", "STATUS-#" and "status: #", and "9999999999" finds any 10 digit number
+	(a longer one is found once for every 10 digit run in it).
+
+	The scan only reports where each pattern ends; what to do with a match (checking word boundaries, pulling
+	the field around it out of the text) is up to the caller.
+*/
+
+#define SCANNER_MAX_STATES 128
+#define SCANNER_MAX_PATTERNS 32
+#define SCANNER_MAX_MATCHES 32
+
+typedef enum
+{
+	symbol_other = 0,
+	// 1 to 26 are the letters.
+	symbol_digit = 27,
+	symbol_at,
+	symbol_hash,
+	symbol_dot,
+	symbol_dash,
+	symbol_count
+} Scanner_symbol;
+
+typedef struct
+{
+	u8 symbols[256];
+	u8 next[SCANNER_MAX_STATES][symbol_count]; // 0 is the start state.
+	u32 matches[SCANNER_MAX_STATES]; // One bit for each pattern that ends in the state.
+	u32 pattern_lengths[SCANNER_MAX_PATTERNS];
+	u32 num_states;
+	u32 num_patterns;
+	bool compiled;
+} Pattern_scanner;
+
+typedef struct
+{
+	u32 pattern;
+	u32 start; // Offset of the first byte of the match.
+} Scanner_match;
+
+u8 ScannerSymbol(u8 byte)
+{
+	if (byte >= 'a' && byte <= 'z')
+	{
+		byte -= 'a' - 'A';
+	}
+	if (byte >= 'A' && byte <= 'Z')
+	{
+		return (u8)(1 + byte - 'A');
+	}
+	switch (byte)
+	{
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9': return symbol_digit;
+		case '@': return symbol_at;
+		case '#': return symbol_hash;
+		case '.': return symbol_dot;
+		case '-': return symbol_dash;
+		default:  return symbol_other;
+	}
+}
+
+void InitScanner(Pattern_scanner* scanner)
+{
+	memset(scanner, 0, sizeof(*scanner));
+	for (u32 byte = 0; byte < 256; byte++)
+	{
+		scanner->symbols[byte] = ScannerSymbol((u8)byte);
+	}
+	scanner->num_states = 1;
+}
+
+// Adds the pattern to the trie. Returns its number, which is the bit set in the matches of its final state.
+u32 AddScannerPattern(Pattern_scanner* scanner, char* pattern)
+{
+	assert(!scanner->compiled, "Patterns must be added before the scanner is compiled.");
+	if (scanner->num_patterns == SCANNER_MAX_PATTERNS)
+	{
+		printf("Error: Too many scanner patterns!\n");
+		exit (-1);
+	}
+
+	u32 state = 0;
+	for (char* character = pattern; *character; character++)
+	{
+		u8 symbol = scanner->symbols[(u8)*character];
+		if (!scanner->next[state][symbol])
+		{
+			if (scanner->num_states == SCANNER_MAX_STATES)
+			{
+				printf("Error: Too many scanner states!\n");
+				exit (-1);
+			}
+			scanner->next[state][symbol] = (u8)scanner->num_states++;
+		}
+		state = scanner->next[state][symbol];
+	}
+
+	u32 pattern_number = scanner->num_patterns++;
+	scanner->matches[state] |= 1u << pattern_number;
+	scanner->pattern_lengths[pattern_number] = (u32)strlen(pattern);
+	return pattern_number;
+}
+
+// Turns the trie into the DFA, breadth first so a state's failure state is always finished before it is.
+void CompileScanner(Pattern_scanner* scanner)
+{
+	u8 failure[SCANNER_MAX_STATES] = {0};
+	u8 queue[SCANNER_MAX_STATES];
+	u32 head = 0;
+	u32 tail = 0;
+
+	for (u32 symbol = 0; symbol < symbol_count; symbol++)
+	{
+		u8 child = scanner->next[0][symbol];
+		if (child)
+		{
+			queue[tail++] = child; // Children of the start state fail back to it.
+		}
+	}
+
+	while (head < tail)
+	{
+		u8 state = queue[head++];
+		scanner->matches[state] |= scanner->matches[failure[state]];
+		for (u32 symbol = 0; symbol < symbol_count; symbol++)
+		{
+			u8 child = scanner->next[state][symbol];
+			u8 fallback = scanner->next[failure[state]][symbol];
+			if (child)
+			{
+				failure[child] = fallback;
+				queue[tail++] = child;
+			}
+			else
+			{
+				scanner->next[state][symbol] = fallback;
+			}
+		}
+	}
+	scanner->compiled = true;
+}
+
+// Scans the text once, returning up to max_matches matches in the order they end.
+u32 ScanText(Pattern_scanner* scanner, char* text, size_t length, Scanner_match* matches, u32 max_matches)
+{
+	u32 num_matches = 0;
+	u32 state = 0;
+	for (size_t index = 0; index < length; index++)
+	{
+		state = scanner->next[state][scanner->symbols[(u8)text[index]]];
+		u32 patterns = scanner->matches[state];
+		while (patterns && num_matches < max_matches)
+		{
+			u32 pattern = 0;
+			while (!(patterns & (1u << pattern)))
+			{
+				pattern++;
+			}
+			patterns &= patterns - 1;
+
+			matches[num_matches].pattern = pattern;
+			matches[num_matches].start = (u32)(index + 1 - scanner->pattern_lengths[pattern]);
+			num_matches++;
+		}
+	}
+	return num_matches;
+}
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef SERVE
+#define SERVE
+
+#include "platform.h"
+
+/*	NOTES
+	=====
+
+	With --serve <socket> a tool stays running and takes its requests from scripts over a Unix domain socket,
+	instead of being started for each one. A request is the tool's command line; the reply is what the tool
+	would have printed and its exit status.
+
+	Protocol (all numbers are 32 bits, little-endian), one request per connection:
+	  - Request: the length of the arguments, then the arguments, each followed by a '\0', exactly as they
+	    would be given to the tool (without the tool's name). File names are relative to the directory the
+	    server was started in, so give full paths.
+	  - Reply:   the exit status (signed; -1 if the tool crashed), the length of the output, then the output
+	    (standard output and standard error together).
+
+	e.g. from Python:
+	    arguments = b"\0".join([b"query", b"/data/lookup.idx", b"sku", b"12345"]) + b"\0"
+	    client.sendall(struct.pack("<I", len(arguments)) + arguments)
+	    status, length = struct.unpack("<iI", recv_exactly(client, 8))
+
+	Every connection is handled by a worker process forked from the server, at most SERVE_MAX_WORKERS at once,
+	and every request is run by a process forked from its worker, with the output going to a temporary file.
+	The tools were written to run once and exit (and they do exit(), on a bad argument or when out of memory),
+	so a process per request is what keeps one request from leaving anything behind for the next. A fork
+	costs tens of microseconds, against milliseconds for starting a tool, and the forked process starts
+	with everything the server has loaded: the tools themselves, and whatever the tool keeps warm in the
+	server (the lookup tool keeps its indexes mapped, see refresh below). The worker waits for the request's
+	process, so a crash is reported to the client rather than taking the server down.
+
+	A client cannot hold a worker for good: the worker gives up on a connection that sends or takes nothing
+	for SERVE_SOCKET_TIMEOUT_SECONDS, and a request still running after SERVE_REQUEST_TIMEOUT_SECONDS is
+	stopped (and replied to as a crash, with a line saying so). Nor can a request start a server of its own:
+	--serve in a request is refused.
+
+	Before forking a worker the server calls the tool's refresh function, if it has one, to bring its warm
+	state up to date (i.e. to map an index again after it has been rebuilt).
+
+	Unix domain sockets and fork() are Linux only here; on Windows --serve just says so.
+*/
+
+#if defined(__linux__)
+#	include <signal.h>
+#	include <sys/socket.h>
+#	include <sys/time.h>
+#	include <sys/un.h>
+#endif
+
+#define SERVE_MAX_REQUEST (64 * 1024)
+#define SERVE_MAX_ARGUMENTS 64
+#define SERVE_MAX_WORKERS 16
+#define SERVE_SOCKET_TIMEOUT_SECONDS 30
+#define SERVE_REQUEST_TIMEOUT_SECONDS 600
+
+bool serving_request = false; // In the process running a request, which must not serve in turn.
+
+typedef int Serve_function(int argc, char* argv[]);
+typedef void Refresh_function(void);
+
+#if defined(__linux__)
+
+bool ReadExactly(int descriptor, void* buffer, size_t size)
+{
+	u8* bytes = (u8*)buffer;
+	while (size)
+	{
+		ssize_t bytes_read = read(descriptor, bytes, size);
+		if (bytes_read < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (bytes_read <= 0)
+		{
+			return false;
+		}
+		bytes += bytes_read;
+		size -= (size_t)bytes_read;
+	}
+	return true;
+}
+
+bool WriteExactly(int descriptor, void* buffer, size_t size)
+{
+	u8* bytes = (u8*)buffer;
+	while (size)
+	{
+		ssize_t bytes_written = write(descriptor, bytes, size);
+		if (bytes_written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (bytes_written <= 0)
+		{
+			return false;
+		}
+		bytes += bytes_written;
+		size -= (size_t)bytes_written;
+	}
+	return true;
+}
+
+// Runs in a worker: reads the request, runs it in a process of its own and sends back the reply.
+void HandleConnection(int connection, char* program_name, Serve_function* run)
+{
+	static char request[SERVE_MAX_REQUEST + 1];
+	struct timeval timeout = {SERVE_SOCKET_TIMEOUT_SECONDS, 0};
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	u32 length = 0;
+	if (!ReadExactly(connection, &length, sizeof(length)) || length > SERVE_MAX_REQUEST || !ReadExactly(connection, request, length))
+	{
+		return;
+	}
+	request[length] = '\0';
+
+	char* arguments[SERVE_MAX_ARGUMENTS + 2];
+	int num_arguments = 0;
+	arguments[num_arguments++] = program_name;
+	for (u32 offset = 0; offset < length && num_arguments <= SERVE_MAX_ARGUMENTS; offset += (u32)strlen(&request[offset]) + 1)
+	{
+		arguments[num_arguments++] = &request[offset];
+	}
+	arguments[num_arguments] = NULL;
+
+	FILE* output = tmpfile();
+	if (!output)
+	{
+		return;
+	}
+	i32 status = -1;
+	pid_t runner = fork();
+	if (runner == 0)
+	{
+		close(connection);
+		dup2(fileno(output), STDOUT_FILENO);
+		dup2(fileno(output), STDERR_FILENO);
+		serving_request = true;
+		alarm(SERVE_REQUEST_TIMEOUT_SECONDS); // SIGALRM ends the process.
+		exit(run(num_arguments, arguments)); // exit() flushes what the tool printed.
+	}
+	int wait_status;
+	if (runner > 0 && waitpid(runner, &wait_status, 0) == runner)
+	{
+		if (WIFEXITED(wait_status))
+		{
+			status = (i8)WEXITSTATUS(wait_status); // The tools return -1 on errors.
+		}
+		else if (WIFSIGNALED(wait_status) && WTERMSIG(wait_status) == SIGALRM)
+		{
+			fseek(output, 0, SEEK_END);
+			fprintf(output, "%s: The request was stopped after running for %d seconds.\n", program_name, SERVE_REQUEST_TIMEOUT_SECONDS);
+			fflush(output);
+		}
+	}
+
+	fseek(output, 0, SEEK_END);
+	u32 header[2] = {(u32)status, (u32)ftell(output)};
+	fseek(output, 0, SEEK_SET);
+	if (!WriteExactly(connection, header, sizeof(header)))
+	{
+		return;
+	}
+	char buffer[64 * 1024];
+	size_t bytes_read;
+	while ((bytes_read = fread(buffer, 1, sizeof(buffer), output)) > 0 && WriteExactly(connection, buffer, bytes_read))
+	{
+	}
+	fclose(output);
+}
+
+// Serves requests until the process is stopped. Returns only if the socket cannot be set up.
+int ServeRequests(char* program_name, char* socket_path, Serve_function* run, Refresh_function* refresh)
+{
+	if (serving_request)
+	{
+		printf("%s: --serve cannot be given in a request.\n", program_name);
+		return -1;
+	}
+
+	struct sockaddr_un address = {0};
+	address.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(address.sun_path))
+	{
+		printf("%s: The socket path is too long: %s\n", program_name, socket_path);
+		return -1;
+	}
+	strcpy_s(address.sun_path, sizeof(address.sun_path), socket_path);
+
+	// A socket left behind by a server that was stopped is in the way; anything else at that path is not ours.
+	struct stat file_status;
+	if (stat(socket_path, &file_status) == 0 && S_ISSOCK(file_status.st_mode))
+	{
+		unlink(socket_path);
+	}
+
+	int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+	{
+		printf("%s: Could not listen on %s: %s\n", program_name, socket_path, strerror(errno));
+		return -1;
+	}
+	signal(SIGPIPE, SIG_IGN); // A client that hangs up early must not take the worker with it.
+
+	printf("%s: Serving requests on %s (press Ctrl+C to stop).\n", program_name, socket_path);
+	u32 num_workers = 0;
+	for (;;)
+	{
+		fflush(stdout); // Or the forked processes would print it again.
+		while (num_workers > 0 && waitpid(-1, NULL, (num_workers < SERVE_MAX_WORKERS) ? WNOHANG : 0) > 0)
+		{
+			num_workers--;
+		}
+
+		int connection = accept(listener, NULL, NULL);
+		if (connection < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+			printf("%s: Could not accept a connection: %s\n", program_name, strerror(errno));
+			return -1;
+		}
+
+		if (refresh)
+		{
+			refresh();
+			fflush(stdout);
+		}
+		pid_t worker = fork();
+		if (worker == 0)
+		{
+			close(listener);
+			HandleConnection(connection, program_name, run);
+			_exit(0);
+		}
+		close(connection);
+		num_workers += (worker > 0);
+	}
+}
+
+#else
+
+int ServeRequests(char* program_name, char* socket_path, Serve_function* run, Refresh_function* refresh)
+{
+	printf("%s: --serve is only available on Linux.\n", program_name);
+	return -1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef SIMD
+#define SIMD
+
+#include <emmintrin.h> // SSE2 is part of the x64 baseline, so these kernels need no special compiler flags.
+
+#include "utils.h"
+
+// Element-wise sum of several columns: result[i] = columns[0][i] + columns[1][i] + ...
+void AddColumns(i32** columns, u32 num_columns, u32 count, i32* result)
+{
+	u32 index = 0;
+	for (; index + 4 <= count; index += 4)
+	{
+		__m128i sum = _mm_setzero_si128();
+		for (u32 column = 0; column < num_columns; column++)
+		{
+			sum = _mm_add_epi32(sum, _mm_loadu_si128((__m128i*)&columns[column][index]));
+		}
+		_mm_storeu_si128((__m128i*)&result[index], sum);
+	}
+	for (; index < count; index++)
+	{
+		i32 sum = 0;
+		for (u32 column = 0; column < num_columns; column++)
+		{
+			sum += columns[column][index];
+		}
+		result[index] = sum;
+	}
+}
+
+// Sum of a whole column. Lanes are widened to 64 bits so large catalogues cannot overflow.
+i64 SumColumn(i32* column, u32 count)
+{
+	__m128i sum_low = _mm_setzero_si128();
+	__m128i sum_high = _mm_setzero_si128();
+
+	u32 index = 0;
+	for (; index + 4 <= count; index += 4)
+	{
+		__m128i values = _mm_loadu_si128((__m128i*)&column[index]);
+		__m128i signs = _mm_srai_epi32(values, 31);
+		sum_low = _mm_add_epi64(sum_low, _mm_unpacklo_epi32(values, signs));
+		sum_high = _mm_add_epi64(sum_high, _mm_unpackhi_epi32(values, signs));
+	}
+
+	i64 lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(sum_low, sum_high));
+	i64 sum = lanes[0] + lanes[1];
+
+	for (; index < count; index++)
+	{
+		sum += column[index];
+	}
+	return sum;
+}
+
+// Returns true if the 8 bits of a field mask are a (possibly empty) run ending at the last character.
+static inline bool IsSuffixMask(u32 mask)
+{
+	u32 prefix = ~mask & 0xFF;
+	return (prefix & (prefix + 1)) == 0;
+}
+
+// Converts right-aligned 8 character integer fields (i.e. "      12", "     -12" or all blanks) four at a time.
+// num_fields must be a multiple of four. Returns false without converting anything if any field holds something
+// else (embedded blanks, a sign after the digits, stray characters), in which case the caller must fall back to
+// trimming and atoi().
+//
+// Each 16 byte load holds two fields. Digits are found with a compare, blanked out everywhere else, then
+// reduced with three multiply-add steps: pairs of digits (x10), pairs of pairs (x100), then halves (x10000).
+bool ParseEightCharIntegers(char* fields, u32 num_fields, i32* values)
+{
+	const __m128i zeros = _mm_set1_epi8('0');
+	const __m128i nines = _mm_set1_epi8(9);
+	const __m128i blanks = _mm_set1_epi8(' ');
+	const __m128i minuses = _mm_set1_epi8('-');
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i tens = _mm_set_epi16(1, 10, 1, 10, 1, 10, 1, 10);
+	const __m128i hundreds = _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100);
+	const __m128i ten_thousands = _mm_set_epi16(1, 10000, 1, 10000, 1, 10000, 1, 10000);
+
+	for (u32 field = 0; field < num_fields; field += 4)
+	{
+		__m128i reduced[2];
+		u32 minus_masks = 0;
+
+		for (u32 half = 0; half < 2; half++)
+		{
+			__m128i text = _mm_loadu_si128((__m128i*)&fields[(field + half * 2) * 8]);
+			__m128i digits = _mm_sub_epi8(text, zeros);
+			__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, nines), digits);
+			__m128i is_blank = _mm_cmpeq_epi8(text, blanks);
+			__m128i is_minus = _mm_cmpeq_epi8(text, minuses);
+
+			u32 digit_mask = (u32)_mm_movemask_epi8(is_digit);
+			u32 blank_mask = (u32)_mm_movemask_epi8(is_blank);
+			u32 minus_mask = (u32)_mm_movemask_epi8(is_minus);
+			if ((digit_mask | blank_mask | minus_mask) != 0xFFFF)
+			{
+				return false;
+			}
+
+			// Each field must be blanks, then at most one '-' directly before the digits, then the digits.
+			for (u32 side = 0; side < 2; side++)
+			{
+				u32 field_digits = (digit_mask >> (side * 8)) & 0xFF;
+				u32 field_minus = (minus_mask >> (side * 8)) & 0xFF;
+				if (!IsSuffixMask(field_digits) || (field_minus && ((field_digits == 0) || (field_minus != ((field_digits & (0 - field_digits)) >> 1)))))
+				{
+					return false;
+				}
+			}
+			minus_masks |= minus_mask << (half * 16);
+
+			digits = _mm_and_si128(digits, is_digit);
+			__m128i first = _mm_madd_epi16(_mm_unpacklo_epi8(digits, zero), tens);
+			__m128i second = _mm_madd_epi16(_mm_unpackhi_epi8(digits, zero), tens);
+			reduced[half] = _mm_madd_epi16(_mm_packs_epi32(first, second), hundreds);
+		}
+
+		i32 results[4];
+		_mm_storeu_si128((__m128i*)results, _mm_madd_epi16(_mm_packs_epi32(reduced[0], reduced[1]), ten_thousands));
+
+		for (u32 index = 0; index < 4; index++)
+		{
+			i32 negative = ((minus_masks >> (index * 8)) & 0xFF) ? 1 : 0;
+			values[field + index] = (results[index] ^ -negative) + negative;
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef SNIFF
+#define SNIFF
+
+#include "platform.h"
+#include "reconcile.h"
+
+/*	NOTES
+	=====
+
+	Tells which ProfitMaster report a file is from the first lines of its first page, so a tool can refuse a
+	report it does not parse (instead of writing a file of junk) and customers can work out which of its three
+	reports it was given.
+
+	Every report starts with a page header whose first line begins with the report's code (IRK, IRX, IRL, IRH
+	or RRT) and whose second line is its title. The code alone tells most reports apart; the three IRL reports
+	need the title. A report matches a signature by its code (1 point) and its title (2 points), and is
+	identified only if one signature scores higher than all the others. Anything else is report_unknown,
+	which the tools let through: it may be an old report with an odd header, and the parse will tell.
+
+	Only SNIFF_SIZE bytes are read, with ReadFileStart().
+
+	IsReportFooter() tells the last line of each report (its footer) by the same marks the parsers stop at
+	(see reconcile.h), not by the words on it, which is how the watch tool tells that a report has been
+	transferred in full.
+*/
+
+#define SNIFF_SIZE 4096
+#define SNIFF_MAX_LINES 12
+
+typedef enum
+{
+	report_unknown,
+	report_classes,
+	report_cross_references,
+	report_accounts,
+	report_addresses,
+	report_memos,
+	report_history,
+	report_invoices,
+	report_kind_count
+} Report_kind;
+
+typedef struct
+{
+	char* code;
+	char* title; // Part of it that no other report's title has.
+	char* name;
+	char* command; // That parses it.
+} Report_signature;
+
+Report_signature report_signatures[report_kind_count] =
+{
+	{NULL, NULL, "unknown", NULL},
+	{"IRK", "CLASS LISTING", "IRK class listing", "classes"},
+	{"IRX", "CROSS REFERENCE", "IRX cross-reference listing", "crossreferences"},
+	{"IRL", "ACCOUNT LISTING", "IRL customer account listing", "customers account"},
+	{"IRL", "ADDRESS LISTING", "IRL customer address listing", "customers address"},
+	{"IRL", "MEMO LISTING", "IRL customer memo listing", "customers memo"},
+	{"IRH", "PRODUCT HISTORY", "IRH product history", "producthistory"},
+	{"RRT", "TRIAL BALANCE", "RRT accounts receivable trial balance", "invoices"},
+};
+
+Report_kind SniffReport(char* text, size_t length)
+{
+	u32 scores[report_kind_count] = {0};
+	u32 num_lines = 0;
+	size_t line_start = 0;
+	while (line_start < length && num_lines < SNIFF_MAX_LINES)
+	{
+		size_t line_end = line_start;
+		while (line_end < length && text[line_end] != '\n')
+		{
+			line_end++;
+		}
+		size_t line_length = line_end - line_start;
+		char* line = &text[line_start];
+
+		if (line_length)
+		{
+			for (u32 kind = 1; kind < report_kind_count; kind++)
+			{
+				Report_signature* signature = &report_signatures[kind];
+				size_t code_length = strlen(signature->code);
+				if (line_length > code_length && memcmp(line, signature->code, code_length) == 0 && line[code_length] == ' ')
+				{
+					scores[kind] |= 1;
+				}
+				if (LineContains(line, line_length, signature->title))
+				{
+					scores[kind] |= 2;
+				}
+			}
+			num_lines++;
+		}
+		line_start = line_end + 1;
+	}
+
+	Report_kind best = report_unknown;
+	bool tied = false;
+	for (u32 kind = 1; kind < report_kind_count; kind++)
+	{
+		if (scores[kind] > scores[best])
+		{
+			best = (Report_kind)kind;
+			tied = false;
+		}
+		else if (scores[kind] && scores[kind] == scores[best])
+		{
+			tied = true;
+		}
+	}
+	return tied ? report_unknown : best;
+}
+
+// True if the line (length bytes long, after the previous line that was not blank) is the last line of a report
+// of this kind: the one with its totals, or for the account listing, the balance line after its summary line.
+bool IsReportFooter(Report_kind kind, char* previous, size_t previous_length, char* line, size_t length)
+{
+	bool count = ReadLineTotal(line, length, total_count).found;
+	switch (kind)
+	{
+		case report_classes:
+			return count && LineIsRule(previous, previous_length, '-');
+		case report_cross_references:
+		case report_history:
+			return count && LineIsRule(previous, previous_length, '=');
+		case report_accounts:
+			return previous_length == 69 && ReadLineTotal(previous, previous_length, total_count).found;
+		case report_addresses: // In place of an account, without its id (the address lines run on to the city).
+		{
+			bool no_id = (length > 9 && length < 79);
+			for (size_t index = 0; index < 9 && no_id; index++)
+			{
+				no_id = (line[index] == ' ');
+			}
+			return count && no_id;
+		}
+		case report_memos: // The memos are indented, and the first line of a page starts with the report's code.
+			return count && line[0] != ' ' && !(length > 3 && memcmp(line, "IRL ", 4) == 0);
+		case report_invoices:
+			return count && length < 60 && LineContains(line, length, "Cust Loc:");
+		default:
+			return false;
+	}
+}
+
+Report_kind SniffReportFile(char* file_name)
+{
+	char buffer[SNIFF_SIZE];
+	size_t length = ReadFileStart(file_name, buffer, sizeof(buffer));
+	return SniffReport(buffer, length);
+}
+
+// Prints why, and returns false, if the file is a report of another kind than expected.
+bool CheckReportKind(char* program_name, char* file_name, Report_kind expected)
+{
+	Report_kind kind = SniffReportFile(file_name);
+	if (kind == report_unknown || kind == expected)
+	{
+		return true;
+	}
+	printf("%s: %s is an %s, not an %s. Use '%s' for it.\n", program_name, file_name,
+		   report_signatures[kind].name, report_signatures[expected].name, report_signatures[kind].command);
+	return false;
+}
+
+#endif
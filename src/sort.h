@@ -0,0 +1,888 @@
+#ifndef SORT
+#define SORT
+
+#include "columns.h"
+
+/*	NOTES
+	=====
+
+	--sort-by writes the pipe-delimited output sorted by one or more of its columns, instead of in the order of
+	the report: e.g. --sort-by "Last Name or Company Name,Cust ID" or --sort-by "Current Balance desc". The names
+	are those of the output's headings, matched without regard to case, and each sorts ascending unless it is
+	followed by " desc". Records that are equal on every key keep the order they have in the report.
+
+	How a column compares follows its Feather type (see columns.h): amounts, counts and dates compare as numbers
+	(a date as its day), everything else as text, byte by byte (so by code point, with --encoding), except that
+	a code made of digits only compares as a number and before any other text (class 6 comes before class 5000,
+	as with --where). Blank values, and those that are not what their column holds, come first (last with desc).
+
+	The output is written as usual and then sorted in place, with an external merge sort that never holds more
+	than --sort-memory megabytes (SORT_DEFAULT_MEGABYTES if not given) of it:
+	  - Rows are read into a run until the run is full. Each row gets a packed key, its key columns encoded so
+	    that two keys compare with memcmp(): a byte for blank, number or text, then the number's bits in an
+	    order that compares as unsigned, or the first SORT_TEXT_BYTES of the text. A descending key has its
+	    bytes inverted. The run is radix sorted on the first 8 bytes of the keys, and the rows still tied are
+	    sorted on the rest of the key and, where text is longer than the key holds, on the text itself.
+	  - A run that holds the whole output is written out at once. Otherwise each run is spilled next to the
+	    output file (<output>.run<N>, with its keys, so that they are not packed again) and the runs are merged
+	    with a heap, up to SORT_MERGE_WAYS at a time (more runs than that take more than one pass). The spills
+	    are removed once merged.
+	  - The sorted output is written to <output>.sorted and only renamed over the output once it is complete,
+	    so the output is never lost: if sorting fails it is left as it was, unsorted. If the last merge fails,
+	    its runs are kept too (and named), as they hold what was sorted.
+	The time it takes is the sort phase of -s.
+
+	-d and -f output is not sorted: the one is the layout of the report, and Feather files are sorted by
+	whatever reads them.
+*/
+
+#define SORT_MAX_KEYS 8
+#define SORT_TEXT_BYTES 16
+#define SORT_MERGE_WAYS 64
+#define SORT_DEFAULT_MEGABYTES 256
+#define SORT_MAX_MEGABYTES 4095 // Rows are found in a run by 32-bit offsets.
+#define SORT_HEADING_SIZE 4096
+#define SORT_READ_CHUNK (1 << 20)
+#define SORT_MERGE_BUFFER (1 << 16) // The least read buffer for each run merged.
+#define SORT_FILE_NAME_SIZE 4096
+
+typedef enum
+{
+	sort_text,
+	sort_number,
+	sort_amount,
+	sort_date
+} Sort_type;
+
+typedef struct Sort_key
+{
+	char name[64];
+	Sort_type type;
+	bool descending;
+	u32 column; // Of the output, found from its headings.
+	u32 offset; // Of the key's bytes in the packed key.
+	u32 width;
+} Sort_key;
+
+typedef struct Sort_order
+{
+	char* text; // As given to --sort-by.
+	Sort_key keys[SORT_MAX_KEYS];
+	u32 num_keys;
+	u32 key_width; // Of the packed key.
+	bool has_text; // Keys that tie may still differ in text longer than they hold.
+	size_t memory_budget; // In bytes.
+	u32 num_runs; // That the output was sorted in.
+} Sort_order;
+
+// A row read into a run. Records are stacked down from the end of the run's memory, the rows up from its start.
+typedef struct Sort_record
+{
+	u32 row_offset;
+	u32 row_length; // With its line ending.
+	// Followed by its packed key, key_width bytes.
+} Sort_record;
+
+#define SORT_RECORD_KEY(record) ((u8*)((record) + 1))
+
+typedef struct Sort_entry
+{
+	u64 prefix; // The first 8 bytes of the packed key, as a number.
+	u32 record;
+	u32 unused;
+} Sort_entry;
+
+typedef struct Sort_run
+{
+	u8* memory;
+	size_t size;
+	size_t text_end; // Of what has been read, which may end in part of a row.
+	size_t parsed; // Up to the first row without a record.
+	u32 num_records;
+	u32 record_size;
+} Sort_run;
+
+typedef struct Sort_reader
+{
+	FILE* file;
+	u32 row_length;
+	u8* key;
+	char* row;
+} Sort_reader;
+
+// Finds the key columns in the heading of the output. Prints what is wrong and returns false if one is not there.
+bool FindSortColumns(Sort_order* order, char* heading, char* program_name)
+{
+	for (u32 key_index = 0; key_index < order->num_keys; key_index++)
+	{
+		Sort_key* key = &order->keys[key_index];
+		char* field = heading;
+		u32 column = 0;
+		while (true)
+		{
+			size_t length = strcspn(field, "|\r\n");
+			if (ColumnNameMatches(key->name, field, length))
+			{
+				key->column = column;
+				break;
+			}
+			field += length;
+			if (*field != '|')
+			{
+				printf("%s: The output has no column '%s' to sort by. Its columns are: %.*s.\n", program_name, key->name,
+						(int)strcspn(heading, "\r\n"), heading);
+				return false;
+			}
+			field++;
+			column++;
+		}
+	}
+	return true;
+}
+
+// Compiles the keys in text (column names separated by commas, each with " desc" after it to sort descending).
+// Their types come from the tool's columns; a name that is not one of them (a heading of a fixed output) is
+// text. headings are those the output will have, separated by '|', so that a key that is not one of them is
+// reported before the report is read. Prints what is wrong and returns false if it is not a list of keys.
+bool CompileSortOrder(Sort_order* order, char* text, Output_column* columns, u32 num_columns, char* headings, u32 megabytes,
+		char* program_name)
+{
+	memset(order, 0, sizeof(*order));
+	order->text = text;
+	order->memory_budget = (size_t)megabytes << 20;
+
+	char* name = text;
+	while (*name)
+	{
+		char* end = strchr(name, ',');
+		char* next = end ? end + 1 : name + strlen(name);
+		end = end ? end : next;
+		while (name < end && *name == ' ')
+		{
+			name++;
+		}
+		while (end > name && end[-1] == ' ')
+		{
+			end--;
+		}
+
+		bool descending = false;
+		if (end - name > 5 && ColumnNameMatches(" desc", end - 5, 5))
+		{
+			descending = true;
+			end -= 5;
+		}
+		else if (end - name > 4 && ColumnNameMatches(" asc", end - 4, 4))
+		{
+			end -= 4;
+		}
+		while (end > name && end[-1] == ' ')
+		{
+			end--;
+		}
+
+		size_t length = (size_t)(end - name);
+		if (length == 0 || length >= sizeof(order->keys[0].name) || order->num_keys == SORT_MAX_KEYS)
+		{
+			printf("%s: --sort-by must be followed by up to %d column names, separated by commas (each with \" desc\" after it to sort it descending).\n", program_name, SORT_MAX_KEYS);
+			return false;
+		}
+
+		Sort_key* key = &order->keys[order->num_keys++];
+		memcpy(key->name, name, length);
+		key->name[length] = '\0';
+		key->descending = descending;
+		key->type = sort_text;
+		for (u32 column = 0; column < num_columns; column++)
+		{
+			if (ColumnNameMatches(columns[column].name, name, length))
+			{
+				switch (columns[column].type)
+				{
+					case arrow_int32:
+					case arrow_float32:	key->type = sort_number; break;
+					case arrow_int64:	key->type = sort_amount; break; // Only amounts are int64.
+					case arrow_date32:	key->type = sort_date; break;
+					default: break;
+				}
+				break;
+			}
+		}
+		key->offset = order->key_width;
+		key->width = 1 + ((key->type == sort_text) ? SORT_TEXT_BYTES : 8);
+		order->key_width += key->width;
+		order->has_text |= (key->type == sort_text);
+		name = next;
+	}
+
+	if (order->num_keys == 0)
+	{
+		printf("%s: --sort-by must be followed by up to %d column names, separated by commas (each with \" desc\" after it to sort it descending).\n", program_name, SORT_MAX_KEYS);
+		return false;
+	}
+	return FindSortColumns(order, headings, program_name);
+}
+
+// The column of the row (which ends with a '\n'), and its length. A row with fewer columns has it blank.
+char* FindSortField(char* row, u32 column, u32* length)
+{
+	char* field = row;
+	for (u32 skipped = 0; skipped < column; skipped++)
+	{
+		while (*field != '|' && *field != '\n' && *field != '\r')
+		{
+			field++;
+		}
+		if (*field != '|')
+		{
+			*length = 0;
+			return field;
+		}
+		field++;
+	}
+	char* end = field;
+	while (*end != '|' && *end != '\n' && *end != '\r')
+	{
+		end++;
+	}
+	*length = (u32)(end - field);
+	return field;
+}
+
+static inline void PutSortBytes(u8* bytes, u64 value)
+{
+	for (u32 index = 0; index < 8; index++)
+	{
+		bytes[index] = (u8)(value >> (56 - 8 * index));
+	}
+}
+
+static inline u64 GetSortBytes(u8* bytes)
+{
+	u64 value = 0;
+	for (u32 index = 0; index < 8; index++)
+	{
+		value = (value << 8) | bytes[index];
+	}
+	return value;
+}
+
+void PackSortKey(Sort_order* order, char* row, u8* packed)
+{
+	memset(packed, 0, order->key_width);
+	for (u32 key_index = 0; key_index < order->num_keys; key_index++)
+	{
+		Sort_key* key = &order->keys[key_index];
+		u8* bytes = packed + key->offset;
+		u32 length;
+		char* field = FindSortField(row, key->column, &length);
+		if (length > 0 && key->type == sort_text)
+		{
+			u64 number = 0;
+			u32 digits = 0;
+			while (digits < length && digits < 19 && field[digits] >= '0' && field[digits] <= '9')
+			{
+				number = number * 10 + (u64)(field[digits] - '0');
+				digits++;
+			}
+			if (digits == length)
+			{
+				bytes[0] = 1;
+				PutSortBytes(&bytes[1], number);
+			}
+			else
+			{
+				bytes[0] = 2;
+				memcpy(&bytes[1], field, MIN(length, SORT_TEXT_BYTES));
+			}
+		}
+		else if (length > 0)
+		{
+			char text[64];
+			u32 text_length = MIN(length, (u32)sizeof(text) - 1);
+			memcpy(text, field, text_length);
+			text[text_length] = '\0';
+
+			double value = 0.0;
+			bool valid = false;
+			switch (key->type)
+			{
+				case sort_amount:
+				{
+					i64 cents;
+					valid = ParseMoneyCents(text, &cents);
+					value = (double)cents;
+				} break;
+				case sort_date:
+				{
+					i32 days;
+					valid = ParseReportDate(text, &days);
+					value = (double)days;
+				} break;
+				default:
+				{
+					char* end;
+					value = strtod(text, &end);
+					valid = (end != text && *end == '\0');
+				} break;
+			}
+			if (valid)
+			{
+				value = (value == 0.0) ? 0.0 : value; // -0 is 0.
+				u64 bits;
+				memcpy(&bits, &value, sizeof(bits));
+				bits = (bits >> 63) ? ~bits : bits | (1ull << 63);
+				bytes[0] = 1;
+				PutSortBytes(&bytes[1], bits);
+			}
+		}
+		if (key->descending)
+		{
+			for (u32 index = 0; index < key->width; index++)
+			{
+				bytes[index] = (u8)~bytes[index];
+			}
+		}
+	}
+}
+
+int CompareSortRows(Sort_order* order, u8* key_a, char* row_a, u8* key_b, char* row_b)
+{
+	if (!order->has_text)
+	{
+		return memcmp(key_a, key_b, order->key_width);
+	}
+
+	// Text that fills its bytes of the key may go on past them, and is compared in full before the next key.
+	for (u32 key_index = 0; key_index < order->num_keys; key_index++)
+	{
+		Sort_key* key = &order->keys[key_index];
+		u8* bytes = key_a + key->offset;
+		int result = memcmp(bytes, key_b + key->offset, key->width);
+		if (result != 0)
+		{
+			return result;
+		}
+		u8 inverted = key->descending ? 0xFF : 0;
+		if (key->type != sort_text || (bytes[0] ^ inverted) != 2 || (bytes[key->width - 1] ^ inverted) == 0)
+		{
+			continue;
+		}
+
+		u32 length_a, length_b;
+		char* field_a = FindSortField(row_a, key->column, &length_a);
+		char* field_b = FindSortField(row_b, key->column, &length_b);
+		result = memcmp(field_a, field_b, MIN(length_a, length_b));
+		if (result == 0)
+		{
+			result = (length_a > length_b) - (length_a < length_b);
+		}
+		if (result != 0)
+		{
+			return key->descending ? -result : result;
+		}
+	}
+	return 0;
+}
+
+static inline Sort_record* GetSortRecord(Sort_run* run, u32 record)
+{
+	return (Sort_record*)(run->memory + run->size - (size_t)(record + 1) * run->record_size);
+}
+
+// What the run needs past its text to hold count records, and to sort them.
+static inline size_t SortRecordSpace(Sort_run* run, u32 count)
+{
+	return (size_t)count * (run->record_size + 2 * sizeof(Sort_entry)) + sizeof(Sort_entry);
+}
+
+// Reads rows into the run, after any part of a row left from the last one, until it is full or the file ends.
+void FillSortRun(Sort_order* order, Sort_run* run, FILE* input, bool* at_end)
+{
+	memmove(run->memory, run->memory + run->parsed, run->text_end - run->parsed);
+	run->text_end -= run->parsed;
+	run->parsed = 0;
+	run->num_records = 0;
+
+	while (true)
+	{
+		while (true)
+		{
+			char* row = (char*)run->memory + run->parsed;
+			char* newline = memchr(row, '\n', run->text_end - run->parsed);
+			if (!newline)
+			{
+				break;
+			}
+			if (run->text_end + SortRecordSpace(run, run->num_records + 1) > run->size)
+			{
+				return;
+			}
+			Sort_record* record = GetSortRecord(run, run->num_records++);
+			record->row_offset = (u32)run->parsed;
+			record->row_length = (u32)(newline + 1 - row);
+			PackSortKey(order, row, SORT_RECORD_KEY(record));
+			run->parsed += record->row_length;
+		}
+
+		size_t needed = run->text_end + SortRecordSpace(run, run->num_records + 1);
+		size_t space = (needed < run->size) ? run->size - needed : 0;
+		if (*at_end)
+		{
+			if (run->parsed == run->text_end || space == 0)
+			{
+				return;
+			}
+			run->memory[run->text_end++] = '\n'; // The last row had no line ending.
+			continue;
+		}
+		if (space == 0)
+		{
+			return;
+		}
+
+		// Read in chunks that leave room for the records of their rows.
+		size_t chunk = MIN((space > 4096) ? space / 8 : space, (size_t)SORT_READ_CHUNK);
+		size_t read = fread(run->memory + run->text_end, 1, chunk, input);
+		run->text_end += read;
+		*at_end = (read < chunk);
+	}
+}
+
+static inline bool SortEntryBefore(Sort_order* order, Sort_run* run, Sort_entry* a, Sort_entry* b)
+{
+	Sort_record* record_a = GetSortRecord(run, a->record);
+	Sort_record* record_b = GetSortRecord(run, b->record);
+	return CompareSortRows(order, SORT_RECORD_KEY(record_a), (char*)run->memory + record_a->row_offset,
+			SORT_RECORD_KEY(record_b), (char*)run->memory + record_b->row_offset) < 0;
+}
+
+// A stable merge sort, for the entries left tied by the radix sort.
+void SortTiedEntries(Sort_order* order, Sort_run* run, Sort_entry* entries, Sort_entry* temp, u32 count)
+{
+	if (count <= 16)
+	{
+		for (u32 index = 1; index < count; index++)
+		{
+			Sort_entry entry = entries[index];
+			u32 position = index;
+			while (position > 0 && SortEntryBefore(order, run, &entry, &entries[position - 1]))
+			{
+				entries[position] = entries[position - 1];
+				position--;
+			}
+			entries[position] = entry;
+		}
+		return;
+	}
+
+	u32 half = count / 2;
+	SortTiedEntries(order, run, entries, temp, half);
+	SortTiedEntries(order, run, entries + half, temp + half, count - half);
+	u32 a = 0;
+	u32 b = half;
+	u32 out = 0;
+	while (a < half && b < count)
+	{
+		temp[out++] = SortEntryBefore(order, run, &entries[b], &entries[a]) ? entries[b++] : entries[a++];
+	}
+	while (a < half)
+	{
+		temp[out++] = entries[a++];
+	}
+	while (b < count)
+	{
+		temp[out++] = entries[b++];
+	}
+	memcpy(entries, temp, count * sizeof(Sort_entry));
+}
+
+// Sorts the records of the run, in the memory between its text and its records. Returns them in order.
+Sort_entry* SortRunRecords(Sort_order* order, Sort_run* run)
+{
+	u32 count = run->num_records;
+	Sort_entry* entries = (Sort_entry*)(run->memory + ((run->text_end + 15) & ~(size_t)15));
+	Sort_entry* temp = entries + count;
+
+	u32 histograms[8][256] = {0};
+	for (u32 index = 0; index < count; index++)
+	{
+		u64 prefix = GetSortBytes(SORT_RECORD_KEY(GetSortRecord(run, index)));
+		entries[index].prefix = prefix;
+		entries[index].record = index;
+		for (u32 byte = 0; byte < 8; byte++)
+		{
+			histograms[byte][(prefix >> (8 * byte)) & 255]++;
+		}
+	}
+
+	// LSD radix sort, which keeps the order of the report among equal prefixes.
+	for (u32 byte = 0; count > 1 && byte < 8; byte++)
+	{
+		u32* counts = histograms[byte];
+		if (counts[(entries[0].prefix >> (8 * byte)) & 255] == count)
+		{
+			continue; // Every prefix has the same byte here.
+		}
+		u32 offsets[256];
+		u32 offset = 0;
+		for (u32 value = 0; value < 256; value++)
+		{
+			offsets[value] = offset;
+			offset += counts[value];
+		}
+		for (u32 index = 0; index < count; index++)
+		{
+			temp[offsets[(entries[index].prefix >> (8 * byte)) & 255]++] = entries[index];
+		}
+		Sort_entry* sorted = temp;
+		temp = entries;
+		entries = sorted;
+	}
+
+	for (u32 first = 0; first < count;)
+	{
+		u32 last = first + 1;
+		while (last < count && entries[last].prefix == entries[first].prefix)
+		{
+			last++;
+		}
+		if (last - first > 1)
+		{
+			SortTiedEntries(order, run, entries + first, temp + first, last - first);
+		}
+		first = last;
+	}
+	return entries;
+}
+
+void GetSortRunName(char* name, size_t size, char* file_name, u32 run)
+{
+	sprintf_s(name, size, "%s.run%u", file_name, run);
+}
+
+void RemoveSortRuns(char* file_name, u32 first, u32 end)
+{
+	char name[SORT_FILE_NAME_SIZE];
+	for (u32 run = first; run < end; run++)
+	{
+		GetSortRunName(name, sizeof(name), file_name, run);
+		remove(name);
+	}
+}
+
+bool CloseSortFile(FILE* file, char* name, char* program_name)
+{
+	bool failed = ferror(file);
+	failed |= (fclose(file) != 0);
+	if (failed)
+	{
+		printf("%s: Could not write %s to sort the output.\n", program_name, name);
+	}
+	return !failed;
+}
+
+bool ReadSortRecord(Sort_order* order, Sort_reader* reader, u32 max_row_length)
+{
+	return fread(&reader->row_length, sizeof(reader->row_length), 1, reader->file) == 1 &&
+			reader->row_length <= max_row_length &&
+			fread(reader->key, order->key_width, 1, reader->file) == 1 &&
+			fread(reader->row, reader->row_length, 1, reader->file) == 1;
+}
+
+// Ties go to the earlier run, which has the earlier rows of the report.
+static inline bool SortReaderBefore(Sort_order* order, Sort_reader* readers, u32 a, u32 b)
+{
+	int result = CompareSortRows(order, readers[a].key, readers[a].row, readers[b].key, readers[b].row);
+	return result < 0 || (result == 0 && a < b);
+}
+
+void SiftSortHeap(Sort_order* order, Sort_reader* readers, u32* heap, u32 count, u32 at)
+{
+	while (true)
+	{
+		u32 first = at;
+		u32 left = 2 * at + 1;
+		u32 right = left + 1;
+		if (left < count && SortReaderBefore(order, readers, heap[left], heap[first]))
+		{
+			first = left;
+		}
+		if (right < count && SortReaderBefore(order, readers, heap[right], heap[first]))
+		{
+			first = right;
+		}
+		if (first == at)
+		{
+			return;
+		}
+		u32 swap = heap[at];
+		heap[at] = heap[first];
+		heap[first] = swap;
+		at = first;
+	}
+}
+
+// Merges the spilled runs first to first + num_runs - 1 into output, as spilled records if with_keys or else as
+// rows. memory is shared out between the runs as their buffers.
+bool MergeSortRuns(Sort_order* order, char* file_name, u32 first, u32 num_runs, FILE* output, bool with_keys,
+		u8* memory, size_t size, u32 max_row_length, char* program_name)
+{
+	Sort_reader readers[SORT_MERGE_WAYS] = {0};
+	u32 heap[SORT_MERGE_WAYS];
+	u32 count = 0;
+	size_t share = (size / num_runs) & ~(size_t)15;
+	size_t record_bytes = ((size_t)order->key_width + max_row_length + 1 + 15) & ~(size_t)15;
+	char name[SORT_FILE_NAME_SIZE];
+	bool merged = true;
+
+	for (u32 run = 0; run < num_runs; run++)
+	{
+		Sort_reader* reader = &readers[run];
+		GetSortRunName(name, sizeof(name), file_name, first + run);
+		if (fopen_s(&reader->file, name, "rb"))
+		{
+			printf("%s: Could not open %s to sort the output.\n", program_name, name);
+			merged = false;
+			break;
+		}
+		u8* buffer = memory + run * share;
+		reader->key = buffer;
+		reader->row = (char*)buffer + order->key_width;
+		setvbuf(reader->file, (char*)buffer + record_bytes, _IOFBF, share - record_bytes);
+		if (ReadSortRecord(order, reader, max_row_length))
+		{
+			heap[count++] = run;
+		}
+	}
+
+	for (u32 at = count / 2; merged && at-- > 0;)
+	{
+		SiftSortHeap(order, readers, heap, count, at);
+	}
+	while (merged && count > 0)
+	{
+		Sort_reader* reader = &readers[heap[0]];
+		if (with_keys)
+		{
+			fwrite(&reader->row_length, sizeof(reader->row_length), 1, output);
+			fwrite(reader->key, order->key_width, 1, output);
+		}
+		fwrite(reader->row, reader->row_length, 1, output);
+
+		if (!ReadSortRecord(order, reader, max_row_length))
+		{
+			heap[0] = heap[--count];
+		}
+		SiftSortHeap(order, readers, heap, count, 0);
+	}
+
+	for (u32 run = 0; run < num_runs; run++)
+	{
+		if (readers[run].file)
+		{
+			if (ferror(readers[run].file))
+			{
+				printf("%s: Could not read back a run spilled to sort the output.\n", program_name);
+				merged = false;
+			}
+			fclose(readers[run].file);
+		}
+	}
+	return merged;
+}
+
+// Sorts the pipe-delimited output file in place (see the notes). Prints what is wrong and returns false if it
+// could not be sorted.
+bool SortOutputFile(Sort_order* order, char* file_name, char* program_name)
+{
+	FILE* input;
+	if (fopen_s(&input, file_name, "rb"))
+	{
+		printf("%s: Could not open %s to sort it.\n", program_name, file_name);
+		return false;
+	}
+	char heading[SORT_HEADING_SIZE];
+	if (!fgets(heading, sizeof(heading), input))
+	{
+		fclose(input);
+		return true; // Nothing was written.
+	}
+	if (!FindSortColumns(order, heading, program_name))
+	{
+		fclose(input);
+		return false;
+	}
+
+	Sort_run run = {0};
+	run.memory = (u8*)AllocateMemory(order->memory_budget);
+	run.size = order->memory_budget;
+	run.record_size = (u32)((sizeof(Sort_record) + order->key_width + 7) & ~(size_t)7);
+	if (!run.memory)
+	{
+		printf("%s: Could not allocate the %zu MB of --sort-memory.\n", program_name, order->memory_budget >> 20);
+		fclose(input);
+		return false;
+	}
+
+	char name[SORT_FILE_NAME_SIZE];
+	char sorted_name[SORT_FILE_NAME_SIZE];
+	sprintf_s(sorted_name, sizeof(sorted_name), "%s.sorted", file_name);
+	bool sorted = true;
+	bool created_sorted = false;
+	bool at_end = false;
+	u32 max_row_length = 0;
+	order->num_runs = 0;
+	while (true)
+	{
+		FillSortRun(order, &run, input, &at_end);
+		bool last_run = at_end && run.parsed == run.text_end;
+		if (run.num_records == 0 && !last_run)
+		{
+			printf("%s: A row of the output is too long to sort in %zu MB of --sort-memory.\n", program_name, order->memory_budget >> 20);
+			sorted = false;
+			break;
+		}
+		Sort_entry* entries = SortRunRecords(order, &run);
+
+		// The whole output is in memory, and is written straight out sorted.
+		FILE* output;
+		bool in_memory = last_run && order->num_runs == 0;
+		if (in_memory)
+		{
+			fclose(input);
+			input = NULL;
+			strcpy_s(name, sizeof(name), sorted_name);
+		}
+		else
+		{
+			GetSortRunName(name, sizeof(name), file_name, order->num_runs);
+		}
+		order->num_runs++;
+		if (fopen_s(&output, name, "wb"))
+		{
+			printf("%s: Could not create %s to sort the output.\n", program_name, name);
+			sorted = false;
+			break;
+		}
+		created_sorted = in_memory;
+		setvbuf(output, NULL, _IOFBF, SORT_MERGE_BUFFER);
+		if (in_memory)
+		{
+			fputs(heading, output);
+		}
+		for (u32 index = 0; index < run.num_records; index++)
+		{
+			Sort_record* record = GetSortRecord(&run, entries[index].record);
+			if (!in_memory)
+			{
+				fwrite(&record->row_length, sizeof(record->row_length), 1, output);
+				fwrite(SORT_RECORD_KEY(record), order->key_width, 1, output);
+			}
+			fwrite(run.memory + record->row_offset, record->row_length, 1, output);
+			max_row_length = MAX(max_row_length, record->row_length);
+		}
+		if (!CloseSortFile(output, name, program_name))
+		{
+			sorted = false;
+			break;
+		}
+		if (last_run)
+		{
+			break;
+		}
+	}
+	if (input)
+	{
+		fclose(input);
+	}
+
+	// Merge the runs, as many at a time as leave each a read buffer.
+	u32 first = 0;
+	u32 end = order->num_runs;
+	size_t record_bytes = ((size_t)order->key_width + max_row_length + 1 + 15) & ~(size_t)15;
+	u32 ways = (u32)MIN(run.size / (record_bytes + SORT_MERGE_BUFFER), (size_t)SORT_MERGE_WAYS);
+	if (sorted && order->num_runs > 1 && ways < 2)
+	{
+		printf("%s: A row of the output is too long to sort in %zu MB of --sort-memory.\n", program_name, order->memory_budget >> 20);
+		sorted = false;
+	}
+	while (sorted && order->num_runs > 1 && end - first > ways)
+	{
+		u32 next_end = end;
+		for (u32 group = first; sorted && group < end; group += ways)
+		{
+			FILE* output;
+			GetSortRunName(name, sizeof(name), file_name, next_end++);
+			if (fopen_s(&output, name, "wb"))
+			{
+				printf("%s: Could not create %s to sort the output.\n", program_name, name);
+				sorted = false;
+				break;
+			}
+			setvbuf(output, NULL, _IOFBF, SORT_MERGE_BUFFER);
+			u32 group_end = group + MIN(ways, end - group);
+			sorted = MergeSortRuns(order, file_name, group, group_end - group, output, true, run.memory, run.size, max_row_length, program_name);
+			sorted &= CloseSortFile(output, name, program_name);
+			if (sorted)
+			{
+				RemoveSortRuns(file_name, group, group_end);
+			}
+		}
+		first = end;
+		end = next_end;
+	}
+
+	// The last merge goes next to the output, which is only replaced once it is sorted in full.
+	bool keep_runs = false;
+	if (sorted && order->num_runs > 1)
+	{
+		FILE* output;
+		if (fopen_s(&output, sorted_name, "wb"))
+		{
+			printf("%s: Could not create %s to sort the output.\n", program_name, sorted_name);
+			sorted = false;
+		}
+		else
+		{
+			created_sorted = true;
+			setvbuf(output, NULL, _IOFBF, SORT_MERGE_BUFFER);
+			fputs(heading, output);
+			sorted = MergeSortRuns(order, file_name, first, end - first, output, false, run.memory, run.size, max_row_length, program_name);
+			sorted &= CloseSortFile(output, sorted_name, program_name);
+		}
+		keep_runs = !sorted;
+	}
+	if (sorted && !MoveOverFile(sorted_name, file_name))
+	{
+		printf("%s: Could not replace %s with the sorted output, which is left in %s.\n", program_name, file_name, sorted_name);
+		sorted = false;
+		keep_runs = order->num_runs > 1;
+	}
+	else if (!sorted && created_sorted)
+	{
+		remove(sorted_name);
+	}
+	if (keep_runs)
+	{
+		printf("%s: %s is left unsorted. The runs it was being sorted from are kept as %s.run%u to %s.run%u.\n",
+				program_name, file_name, file_name, first, file_name, end - 1);
+	}
+	else if (!sorted || order->num_runs > 1)
+	{
+		RemoveSortRuns(file_name, sorted ? first : 0, end);
+	}
+	FreeFileMemory(run.memory);
+
+	if (sorted && order->num_runs > 1)
+	{
+		printf("Sorted the output by %s, in %u runs of up to %zu MB merged from disk.\n", order->text, order->num_runs, order->memory_budget >> 20);
+	}
+	else if (sorted)
+	{
+		printf("Sorted the output by %s, in memory.\n", order->text);
+	}
+	return sorted;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef TIMING
+#define TIMING
+
+#include "platform.h"
+#include "counters.h"
+
+/*	PHASES
+	======
+
+	- read:         opening and reading the report into memory.
+	- header skip:  skipping page headers (and the IRH history calendar).
+	- extract:      everything else the parser does, mostly finding lines and extracting/converting fields.
+	- format:       turning a batch of records into output (totals and analysis, formatting, buffered writes).
+	- flush:        closing the output file, which writes whatever is still buffered (and the Arrow footer).
+	- sort:         sorting the output file for --sort-by, once it is written (see sort.h).
+
+	Extraction is not timed directly: it is the time spent in the parser less the other two phases timed inside
+	it, so the byte loop itself carries no timing overhead. Header skips and formatting are timed once per page
+	and per batch respectively, which is too rarely for the timer calls to matter.
+
+	With --counters the hardware counters (see counters.h) are read at the same points and split between the
+	phases in the same way. That costs a system call per page, so phase times taken with counters on are a
+	little pessimistic.
+*/
+
+typedef enum
+{
+	phase_read,
+	phase_header_skip,
+	phase_extract,
+	phase_format,
+	phase_flush,
+	phase_sort,
+	phase_count
+} Phase;
+
+char* phase_names[phase_count] = {"read", "header skip", "extract", "format", "flush", "sort"};
+char* phase_json_names[phase_count] = {"read", "header_skip", "extract", "format", "flush", "sort"};
+
+typedef struct
+{
+	u64 ticks[phase_count];
+	u64 counts[phase_count][counter_count];
+	u64 input_bytes;
+	Perf_counters counters;
+} Phase_timings;
+
+typedef struct
+{
+	u64 ticks;
+	u64 counts[counter_count];
+} Phase_start;
+
+Phase_start BeginPhase(Phase_timings* timings)
+{
+	Phase_start start;
+	if (timings->counters.available)
+	{
+		ReadPerfCounters(&timings->counters, start.counts);
+	}
+	start.ticks = ReadTimer();
+	return start;
+}
+
+void EndPhase(Phase_timings* timings, Phase phase, Phase_start start)
+{
+	timings->ticks[phase] += ReadTimer() - start.ticks;
+	if (timings->counters.available)
+	{
+		u64 counts[counter_count];
+		ReadPerfCounters(&timings->counters, counts);
+		for (u32 counter = 0; counter < counter_count; counter++)
+		{
+			timings->counts[phase][counter] += counts[counter] - start.counts[counter];
+		}
+	}
+}
+
+// Call with the start of the parse, once the parser returns.
+void EndParse(Phase_timings* timings, Phase_start start)
+{
+	u64 parse_ticks = ReadTimer() - start.ticks;
+	u64 timed_ticks = timings->ticks[phase_header_skip] + timings->ticks[phase_format];
+	timings->ticks[phase_extract] += (parse_ticks > timed_ticks) ? parse_ticks - timed_ticks : 0;
+
+	if (timings->counters.available)
+	{
+		u64 counts[counter_count];
+		ReadPerfCounters(&timings->counters, counts);
+		for (u32 counter = 0; counter < counter_count; counter++)
+		{
+			u64 parse_count = counts[counter] - start.counts[counter];
+			u64 timed_count = timings->counts[phase_header_skip][counter] + timings->counts[phase_format][counter];
+			timings->counts[phase_extract][counter] += (parse_count > timed_count) ? parse_count - timed_count : 0;
+		}
+	}
+}
+
+double TotalSeconds(Phase_timings* timings)
+{
+	u64 ticks = 0;
+	for (u32 phase = 0; phase < phase_count; phase++)
+	{
+		ticks += timings->ticks[phase];
+	}
+	return TicksToSeconds(ticks);
+}
+
+// One line of throughput, followed by the time spent in each phase if asked for.
+void PrintTimings(Phase_timings* timings, u64 num_records, bool print_phases)
+{
+	double seconds = TotalSeconds(timings);
+	double megabytes = (double)timings->input_bytes / (1024.0 * 1024.0);
+	double safe_seconds = (seconds > 0.0) ? seconds : 1e-9;
+
+	printf("Read %.1f MB in %.3f s (%.1f MB/s, %.0f records/s).\n", megabytes, seconds, megabytes / safe_seconds, (double)num_records / safe_seconds);
+	if (print_phases)
+	{
+		for (u32 phase = 0; phase < phase_count; phase++)
+		{
+			double phase_seconds = TicksToSeconds(timings->ticks[phase]);
+			printf("  %-12s %9.3f s %6.1f%%\n", phase_names[phase], phase_seconds, 100.0 * phase_seconds / safe_seconds);
+		}
+	}
+	if (print_phases && timings->counters.available)
+	{
+		double safe_megabytes = (megabytes > 0.0) ? megabytes : 1e-9;
+		printf("  per MB       %12s %12s %8s %14s %12s %12s\n", "cycles", "instructions", "IPC", "branch misses", "L1d misses", "LLC misses");
+		for (u32 phase = 0; phase < phase_count; phase++)
+		{
+			u64* counts = timings->counts[phase];
+			double ipc = counts[counter_cycles] ? (double)counts[counter_instructions] / (double)counts[counter_cycles] : 0.0;
+			printf("  %-12s %12.0f %12.0f %8.2f %14.0f %12.0f %12.0f\n", phase_names[phase],
+					counts[counter_cycles] / safe_megabytes, counts[counter_instructions] / safe_megabytes, ipc,
+					counts[counter_branch_misses] / safe_megabytes, counts[counter_l1d_misses] / safe_megabytes, counts[counter_llc_misses] / safe_megabytes);
+		}
+	}
+}
+
+void PrintTimingsJson(Phase_timings* timings, char* tool_name, u64 num_records, u32 num_pages)
+{
+	double seconds = TotalSeconds(timings);
+	double safe_seconds = (seconds > 0.0) ? seconds : 1e-9;
+
+	printf("{\"tool\": \"%s\", \"input_bytes\": %llu, \"records\": %llu, \"pages\": %u, \"seconds\": %.6f, "
+			"\"bytes_per_second\": %.0f, \"records_per_second\": %.0f, \"phases\": {",
+			tool_name, (unsigned long long)timings->input_bytes, (unsigned long long)num_records, num_pages, seconds,
+			(double)timings->input_bytes / safe_seconds, (double)num_records / safe_seconds);
+	for (u32 phase = 0; phase < phase_count; phase++)
+	{
+		printf("%s\"%s\": %.6f", phase ? ", " : "", phase_json_names[phase], TicksToSeconds(timings->ticks[phase]));
+	}
+	printf("}");
+
+	// Raw counts; per MB figures are left to whoever reads this.
+	if (timings->counters.available)
+	{
+		printf(", \"counters\": {");
+		for (u32 phase = 0; phase < phase_count; phase++)
+		{
+			printf("%s\"%s\": {", phase ? ", " : "", phase_json_names[phase]);
+			char* separator = "";
+			for (u32 counter = 0; counter < counter_count; counter++)
+			{
+				if (timings->counters.enabled[counter])
+				{
+					printf("%s\"%s\": %llu", separator, counter_names[counter], (unsigned long long)timings->counts[phase][counter]);
+					separator = ", ";
+				}
+			}
+			printf("}");
+		}
+		printf("}");
+	}
+	printf("}\n");
+}
+
+#endif
@@ -6,10 +6,12 @@
 #if DEBUG
 #	define assert(expr, msg) if(!(expr)) { printf("Assert failed! %s(%d).\n", __FILE__, __LINE__); __debugbreak(); }
 #else
-#	define assert(expr, msg) ""
+#	define assert(expr, msg) ((void)0)
 #endif
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
+#define ArrayCount(array) (sizeof(array) / sizeof((array)[0]))
 
 typedef int8_t   i8;
 typedef int16_t  i16;
@@ -23,56 +25,13 @@ typedef uint64_t u64;
 
 typedef enum {false, true} bool;
 
-inline u32 TruncateUnsignedI64(u64 value)
+static inline u32 TruncateUnsignedI64(u64 value)
 {
 	// @TODO: define for maximum value
 	assert(value <= 0xFFFFFFFF, "File is greater than 4GiB, giving up.\n");
 	return (u32)value;
 }
 
-void FreeFileMemory(void* memory)
-{
-	if (memory)
-	{
-		VirtualFree(memory, 0, MEM_RELEASE);
-	}
-}
-
-char* ReadEntireFile(char* file_name)
-{
-	void* data = NULL;
-
-	HANDLE file_handle = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-	if (file_handle == INVALID_HANDLE_VALUE)
-	{
-		return NULL;
-	}
-
-	LARGE_INTEGER file_size;
-	if (GetFileSizeEx(file_handle, &file_size))
-	{
-		u32 file_size_32bits = TruncateUnsignedI64(file_size.QuadPart);
-		data = (char*)VirtualAlloc(0, file_size_32bits, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-		if (data)
-		{
-			DWORD bytes_read = 0;
-			if (ReadFile(file_handle, data, file_size_32bits, &bytes_read, 0) && (file_size_32bits == bytes_read))
-			{
-				// success
-			}
-			else
-			{
-				FreeFileMemory(data);
-				data = NULL;
-			}
-		}
-
-		CloseHandle(file_handle);
-	}
-
-	return data;
-}
-
 void PrintSubstring(const char* start, size_t length)
 {
 	for (int index = 0; index < length; index++)
@@ -119,7 +78,162 @@ size_t FillTextFieldAndTrim(char* field, char* start, size_t length)
 	return index + 1;
 }
 
-inline i32 FindCharInString(char* data, char character)
+// FillTextFieldAndTrim() for a field of a line that may end before the field does: only what is on the line
+// is read, and a field past the end of the line is made empty (returns 0).
+size_t FillLineField(char* field, char* line, size_t line_length, size_t start, size_t length)
+{
+	if (start >= line_length)
+	{
+		field[0] = '\0';
+		return 0;
+	}
+	return FillTextFieldAndTrim(field, &line[start], MIN(length, line_length - start));
+}
+
+// Like strstr() but bounded by length, so it can be used directly on a line of the report.
+bool LineContains(char* line, size_t length, char* text)
+{
+	size_t text_length = strlen(text);
+	for (size_t index = 0; index + text_length <= length; index++)
+	{
+		if (memcmp(&line[index], text, text_length) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// FNV-1a
+u32 HashBytes(u8* bytes, size_t length)
+{
+	u32 hash = 2166136261u;
+	for (size_t index = 0; index < length; index++)
+	{
+		hash = (hash ^ bytes[index]) * 16777619u;
+	}
+	return hash;
+}
+
+// Parses a (trimmed) money field such as "1,234.56", ".00", "-12.50", "12.50-" or "12.50CR" into cents.
+// Returns false if the field is empty or is not a number.
+bool ParseMoneyCents(char* text, i64* cents)
+{
+	i64 whole = 0;
+	i64 fraction = 0;
+	i32 fraction_digits = -1; // -1 until the decimal point is seen.
+	bool negative = false;
+	bool any_digits = false;
+
+	for (char* character = text; *character; character++)
+	{
+		if (*character >= '0' && *character <= '9')
+		{
+			any_digits = true;
+			if (fraction_digits < 0)
+			{
+				whole = whole * 10 + (*character - '0');
+			}
+			else if (fraction_digits < 2)
+			{
+				fraction = fraction * 10 + (*character - '0');
+				fraction_digits++;
+			}
+		}
+		else if (*character == '.' && fraction_digits < 0)
+		{
+			fraction_digits = 0;
+		}
+		else if (*character == '-')
+		{
+			negative = true;
+		}
+		else if (*character == 'C' && character[1] == 'R')
+		{
+			negative = true;
+			character++;
+		}
+		else if (*character != ',' && *character != '$' && *character != ' ')
+		{
+			return false;
+		}
+	}
+	if (!any_digits)
+	{
+		return false;
+	}
+
+	if (fraction_digits == 1)
+	{
+		fraction *= 10;
+	}
+	*cents = (whole * 100 + fraction) * (negative ? -1 : 1);
+	return true;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date.
+i32 DaysFromCivil(i32 year, i32 month, i32 day)
+{
+	year -= month <= 2;
+	i32 era = (year >= 0 ? year : year - 399) / 400;
+	i32 year_of_era = year - era * 400;
+	i32 day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	i32 day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+	return era * 146097 + day_of_era - 719468;
+}
+
+// Parses the report dates, "MM/DD/YY" (or "MM-DD-YY", or with a four digit year), into days since 1970-01-01.
+// Two digit years before 70 are taken to be in the 2000s. Returns false if the field is not a valid date.
+bool ParseReportDate(char* text, i32* days)
+{
+	i32 parts[3] = {0};
+	i32 digits[3] = {0};
+	i32 part = 0;
+
+	for (char* character = text; *character; character++)
+	{
+		if (*character >= '0' && *character <= '9')
+		{
+			parts[part] = parts[part] * 10 + (*character - '0');
+			digits[part]++;
+		}
+		else if ((*character == '/' || *character == '-') && part < 2)
+		{
+			part++;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	i32 month = parts[0];
+	i32 day = parts[1];
+	i32 year = parts[2];
+	if (part != 2 || digits[0] == 0 || digits[1] == 0 || (digits[2] != 2 && digits[2] != 4))
+	{
+		return false;
+	}
+	if (digits[2] == 2)
+	{
+		year += year < 70 ? 2000 : 1900;
+	}
+
+	static const i32 days_in_month[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	if (month < 1 || month > 12 || day < 1 || day > days_in_month[month - 1])
+	{
+		return false;
+	}
+	if (month == 2 && day == 29 && !((year % 4 == 0 && year % 100 != 0) || year % 400 == 0))
+	{
+		return false;
+	}
+
+	*days = DaysFromCivil(year, month, day);
+	return true;
+}
+
+static inline i32 FindCharInString(char* data, char character)
 {
 	i32 index = 0;
 	while (data[index] != '\0')
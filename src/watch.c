@@ -0,0 +1,470 @@
+#include <stdio.h>
+
+#include "platform.h"
+#include "utils.h"
+#include "sniff.h"
+
+#define VERSION "2026-10-19"
+
+#define MAX_PATH_LENGTH 1024
+#define MAX_WATCHED_FILES 1024
+#define WATCH_READ_SIZE (64 * 1024)
+#define WATCH_POLL_MILLISECONDS 1000
+#define WATCH_PREVIOUS_LINE_SIZE 128 // Enough of a line to tell a rule or a summary line.
+
+typedef struct
+{
+	u32 idle_seconds;
+	bool once;
+	bool feather_output;
+	char* code_page_name;
+} Program_options;
+
+/*	NOTES
+	=====
+
+	- Reports are transferred into the drop directory by FTP, which writes each one from start to end over a
+	  few seconds or minutes. Every file in the directory is followed as it grows: its kind is told from its
+	  first page (see sniff.h) as soon as that has arrived, and from then on only the lines added since the
+	  last look are read, for the report's footer (the summary line at its very end, told by the rule or
+	  summary line before it, as the parser tells it: see IsReportFooter() in sniff.h). When the footer has
+	  arrived the report is complete, and it is converted right away by the tool that parses it.
+	- The tools are run as separate processes, exactly as they are used by hand, and are expected to sit next to
+	  this program. Each one then parses the whole report at a few hundred MB/s, so the conversion ends moments
+	  after the transfer does; the parsers themselves are not made to resume part way through a report.
+	- A report without a footer (an old version of ProfitMaster, or a transfer that broke off) is converted
+	  anyway once it has not grown for a while, with a warning (and --allow-missing-totals, so that the tool
+	  does not fail for want of the totals), and a file that is not a report is ignored.
+	- A file that shrinks, or changes after it was converted, is a new transfer under the same name, and is
+	  followed (and converted) again from the start.
+	- Between changes the directory is looked at once a second, which is what notices the idle files; the
+	  changes themselves wake it up at once (inotify on Linux, change notifications on Windows).
+*/
+
+typedef enum
+{
+	file_arriving,
+	file_converted,
+	file_failed,
+	file_ignored
+} Watched_state;
+
+typedef struct
+{
+	char name[MAX_FILE_NAME_LENGTH];
+	Watched_state state;
+	Report_kind kind;
+	u64 size;
+	u64 line_start; // Of the first line not yet looked at for the footer.
+	char previous_line[WATCH_PREVIOUS_LINE_SIZE]; // The last one looked at that was not blank (its start).
+	size_t previous_length;
+	double last_growth;
+	bool footer_seen;
+	bool listed; // In the latest directory listing.
+} Watched_file;
+
+double GetSeconds(void)
+{
+	return TicksToSeconds(ReadTimer());
+}
+
+// Reads the complete lines added to the file since the last call, looking for the footer.
+void ScanForFooter(char* path, Watched_file* file)
+{
+	char buffer[WATCH_READ_SIZE];
+	while (!file->footer_seen && file->line_start < file->size)
+	{
+		size_t wanted = (size_t)MIN(file->size - file->line_start, WATCH_READ_SIZE);
+		size_t length = ReadFileRange(path, file->line_start, buffer, wanted);
+		size_t line_start = 0;
+		for (size_t index = 0; index < length; index++)
+		{
+			if (buffer[index] == '\n')
+			{
+				char* line = &buffer[line_start];
+				size_t line_length = index - line_start;
+				if (line_length && line[line_length - 1] == '\r')
+				{
+					line_length--;
+				}
+				bool blank = true;
+				for (size_t character = 0; character < line_length && blank; character++)
+				{
+					blank = (line[character] == ' ');
+				}
+				if (!blank)
+				{
+					file->footer_seen |= IsReportFooter(file->kind, file->previous_line, file->previous_length, line, line_length);
+					memcpy(file->previous_line, line, MIN(line_length, sizeof(file->previous_line)));
+					file->previous_length = MIN(line_length, sizeof(file->previous_line));
+				}
+				line_start = index + 1;
+			}
+		}
+
+		if (line_start == 0 && length == WATCH_READ_SIZE)
+		{
+			line_start = length; // No report has lines that long; skip it.
+		}
+		file->line_start += line_start;
+		if (length < wanted || line_start == 0)
+		{
+			break; // The rest is a line that has not been written in full yet.
+		}
+	}
+}
+
+void ConvertReport(Watched_file* file, char* path, char* tool_directory, char* output_directory, Program_options options)
+{
+	Report_signature* signature = &report_signatures[file->kind];
+	char output_file_name[MAX_PATH_LENGTH];
+	sprintf_s(output_file_name, sizeof(output_file_name), "%s/%s", output_directory, file->name);
+	if (IsSameFile(path, output_file_name))
+	{
+		printf("Not converting %s: its output file would be the report itself.\n", file->name);
+		file->state = file_failed;
+		fflush(stdout);
+		return;
+	}
+
+	// The tool is started with its arguments as they are, not through a shell, as the file names are
+	// whatever was transferred into the drop directory.
+	char command[64];
+	strcpy_s(command, sizeof(command), signature->command);
+	char tool[MAX_PATH_LENGTH];
+	char* report_type = strchr(command, ' ');
+	if (report_type)
+	{
+		*report_type++ = '\0';
+	}
+	sprintf_s(tool, sizeof(tool), "%s%s", tool_directory, command);
+
+	char* arguments[12];
+	u32 num_arguments = 0;
+	arguments[num_arguments++] = tool;
+	arguments[num_arguments++] = "--no-progress";
+	if (!file->footer_seen)
+	{
+		arguments[num_arguments++] = "--allow-missing-totals"; // Already warned about.
+	}
+	if (options.feather_output)
+	{
+		arguments[num_arguments++] = "-f";
+	}
+	if (options.code_page_name)
+	{
+		arguments[num_arguments++] = "-e";
+		arguments[num_arguments++] = options.code_page_name;
+	}
+	if (report_type)
+	{
+		arguments[num_arguments++] = report_type;
+	}
+	arguments[num_arguments++] = path;
+	arguments[num_arguments++] = output_file_name;
+	arguments[num_arguments] = NULL;
+
+	printf("Converting %s (%s) with %s...\n", file->name, signature->name, signature->command);
+	fflush(stdout);
+	double start = GetSeconds();
+	Program_process program;
+	if (!StartProgram(&program, arguments))
+	{
+		printf("Could not run %s.\n", tool);
+		file->state = file_failed;
+		return;
+	}
+	char line[4096];
+	while (fgets(line, sizeof(line), program.output))
+	{
+		printf("  %s", line);
+	}
+	if (FinishProgram(&program) == 0)
+	{
+		printf("Converted %s to %s in %.2f s.\n", file->name, output_file_name, GetSeconds() - start);
+		file->state = file_converted;
+	}
+	else
+	{
+		printf("Could not convert %s: %s failed.\n", file->name, command);
+		file->state = file_failed;
+	}
+	fflush(stdout);
+}
+
+// Looks at a file of the drop directory again, and converts it if it has arrived in full.
+void UpdateWatchedFile(Watched_file* file, char* drop_directory, char* tool_directory, char* output_directory, Program_options options)
+{
+	char path[MAX_PATH_LENGTH];
+	sprintf_s(path, sizeof(path), "%s/%s", drop_directory, file->name);
+	u64 size = GetFileSize64(path);
+	double now = GetSeconds();
+
+	if (size < file->size || (file->state != file_arriving && size != file->size))
+	{
+		// Transferred again under the same name.
+		file->state = file_arriving;
+		file->kind = report_unknown;
+		file->size = 0;
+		file->line_start = 0;
+		file->previous_length = 0;
+		file->footer_seen = false;
+	}
+	if (size > file->size || file->last_growth == 0.0)
+	{
+		file->size = size;
+		file->last_growth = now;
+	}
+	bool idle = (now - file->last_growth >= (double)options.idle_seconds);
+	if (file->state != file_arriving || size == 0)
+	{
+		return;
+	}
+
+	if (file->kind == report_unknown)
+	{
+		file->kind = SniffReportFile(path);
+		if (file->kind == report_unknown)
+		{
+			if (size >= SNIFF_SIZE || idle)
+			{
+				printf("Ignoring %s: it is not a ProfitMaster report.\n", file->name);
+				fflush(stdout);
+				file->state = file_ignored;
+			}
+			return;
+		}
+		printf("Following %s (%s) as it arrives.\n", file->name, report_signatures[file->kind].name);
+		fflush(stdout);
+	}
+
+	ScanForFooter(path, file);
+	if (file->footer_seen)
+	{
+		ConvertReport(file, path, tool_directory, output_directory, options);
+	}
+	else if (idle)
+	{
+		printf("Warning: %s has not grown for %u seconds and has no footer. It may not have been transferred in full.\n",
+			   file->name, options.idle_seconds);
+		ConvertReport(file, path, tool_directory, output_directory, options);
+	}
+}
+
+// Brings the list of files up to date with the directory. Returns the number of files still arriving.
+u32 UpdateWatchedFiles(Watched_file* files, u32* num_files, char* drop_directory, char* tool_directory, char* output_directory, Program_options options)
+{
+	for (u32 index = 0; index < *num_files; index++)
+	{
+		files[index].listed = false;
+	}
+
+	Directory_listing listing;
+	if (OpenDirectoryListing(&listing, drop_directory))
+	{
+		char* name;
+		while ((name = NextDirectoryFile(&listing)) != NULL)
+		{
+			Watched_file* file = NULL;
+			for (u32 index = 0; index < *num_files && !file; index++)
+			{
+				if (strcmp(files[index].name, name) == 0)
+				{
+					file = &files[index];
+				}
+			}
+			if (!file)
+			{
+				if (*num_files == MAX_WATCHED_FILES)
+				{
+					continue;
+				}
+				file = &files[(*num_files)++];
+				memset(file, 0, sizeof(*file));
+				strcpy_s(file->name, sizeof(file->name), name);
+			}
+			file->listed = true;
+		}
+		CloseDirectoryListing(&listing);
+	}
+
+	u32 num_arriving = 0;
+	u32 num_kept = 0;
+	for (u32 index = 0; index < *num_files; index++)
+	{
+		if (!files[index].listed)
+		{
+			continue; // Deleted or moved away.
+		}
+		files[num_kept] = files[index];
+		UpdateWatchedFile(&files[num_kept], drop_directory, tool_directory, output_directory, options);
+		num_arriving += (files[num_kept].state == file_arriving);
+		num_kept++;
+	}
+	*num_files = num_kept;
+	return num_arriving;
+}
+
+#define USAGE_STRING "\
+%s %s\n\
+John Hosick <john@atikokancastle.com>\n\n\
+%s watches the directory the reports are transferred into, and converts each ProfitMaster\n\
+report with the right tool as soon as it has arrived in full (when its footer has been written).\n\
+Reports already in the directory are converted too. The tools must be in the same directory as %s.\n\n\
+USAGE: %s [OPTIONS] <dropdirectory> [outputdirectory]\n\
+  The output files have the names of the reports, in the output directory (by default the\n\
+  converted directory inside the drop directory).\n\
+  OPTIONS:\n\
+    -e, --encoding <code page>\n\
+                    Convert text from the reports' code page (cp437, cp1252 or latin1)\n\
+                    to UTF-8.\n\
+    -f, --feather   Write the output files in Arrow IPC (Feather v2) format instead.\n\
+    -h, --help      Show this help message.\n\
+    -o, --once      Convert the reports in the directory and stop, instead of waiting for more.\n\
+    -t, --timeout <seconds>\n\
+                    Convert a report without a footer once it has not grown for this long\n\
+                    (default 60).\n"
+
+void PrintUsageAndExit(char *program_name)
+{
+	printf(USAGE_STRING, program_name, VERSION, program_name, program_name, program_name);
+	exit (0);
+}
+
+int main(int argc, char *argv[])
+{
+	char* program_name = argv[0];
+	char* drop_directory = NULL;
+	char* output_directory = NULL;
+
+	Program_options options = {0};
+	options.idle_seconds = 60;
+
+	for (i32 arg = 1; arg < argc; arg++)
+	{
+		char c1 = argv[arg][0];
+		char c2 = argv[arg][1];
+		if (c1 == '-')
+		{
+			char* option = (c2 == '-') ? &argv[arg][2] : &argv[arg][1];
+			if ((strcmp(option, "help") == 0) || (strcmp(option, "h") == 0))
+			{
+				PrintUsageAndExit(program_name);
+			}
+
+			if ((strcmp(option, "feather") == 0) || (strcmp(option, "f") == 0))
+			{
+				options.feather_output = true;
+				continue;
+			}
+			if ((strcmp(option, "once") == 0) || (strcmp(option, "o") == 0))
+			{
+				options.once = true;
+				continue;
+			}
+
+			// Every other option takes a value.
+			if (arg + 1 == argc)
+			{
+				printf("%s: No value given for '%s'. Use -h or --help for more details.\n", program_name, option);
+				return -1;
+			}
+			char* value = argv[++arg];
+
+			if ((strcmp(option, "encoding") == 0) || (strcmp(option, "e") == 0))
+			{
+				options.code_page_name = value;
+			}
+			else if ((strcmp(option, "timeout") == 0) || (strcmp(option, "t") == 0))
+			{
+				options.idle_seconds = (u32)strtoul(value, NULL, 10);
+			}
+			else
+			{
+				printf("%s: Invalid argument '%s'. Use -h or --help for more details.\n", program_name, option);
+				return -1;
+			}
+			continue;
+		}
+		if (!drop_directory)
+		{
+			drop_directory = argv[arg];
+		}
+		else
+		{
+			output_directory = argv[arg];
+			break; // No point in processing any additional arguments.
+		}
+	}
+
+	if (!drop_directory)
+	{
+		printf("%s: Drop directory not specified. Use -h or --help for more details.\n", program_name);
+		return -1;
+	}
+
+	char default_output_directory[MAX_PATH_LENGTH];
+	if (!output_directory)
+	{
+		sprintf_s(default_output_directory, sizeof(default_output_directory), "%s/converted", drop_directory);
+		output_directory = default_output_directory;
+	}
+	MakeDirectory(output_directory); // Fails harmlessly if it already exists.
+	if (strcmp(output_directory, drop_directory) == 0 || IsSameFile(output_directory, drop_directory))
+	{
+		printf("%s: The output directory must not be the drop directory (the reports would be overwritten).\n", program_name);
+		return -1;
+	}
+
+	// The tools live next to this program.
+	char tool_directory[MAX_PATH_LENGTH] = {0};
+	char* last_separator = strrchr(program_name, '\\');
+	char* last_slash = strrchr(program_name, '/');
+	if (!last_separator || (last_slash && last_slash > last_separator))
+	{
+		last_separator = last_slash;
+	}
+	if (last_separator && (size_t)(last_separator - program_name + 1) < sizeof(tool_directory))
+	{
+		memcpy(tool_directory, program_name, last_separator - program_name + 1);
+	}
+
+	// Started before the first look at the directory, so that nothing written in between is missed.
+	Directory_watch watch;
+	if (!StartDirectoryWatch(&watch, drop_directory))
+	{
+		printf("%s: Could not watch directory: %s\n", program_name, drop_directory);
+		return -1;
+	}
+
+	Watched_file* files = (Watched_file*)AllocateMemory(MAX_WATCHED_FILES * sizeof(Watched_file));
+	if (!files)
+	{
+		printf("%s: Out of memory!\n", program_name);
+		return -1;
+	}
+	u32 num_files = 0;
+
+	if (!options.once)
+	{
+		printf("Waiting for reports in %s (press Ctrl+C to stop).\n", drop_directory);
+		fflush(stdout);
+	}
+	for (;;)
+	{
+		u32 num_arriving = UpdateWatchedFiles(files, &num_files, drop_directory, tool_directory, output_directory, options);
+		if (options.once && num_arriving == 0)
+		{
+			break;
+		}
+		WaitForDirectoryChange(&watch, WATCH_POLL_MILLISECONDS);
+	}
+
+	u32 num_failed = 0;
+	for (u32 index = 0; index < num_files; index++)
+	{
+		num_failed += (files[index].state == file_failed);
+	}
+	StopDirectoryWatch(&watch);
+	return num_failed ? 1 : 0;
+}